@@ -0,0 +1,272 @@
+/// @file TimeSeriesRing.hpp
+/// @brief Lock free history of timestamped samples that other threads can look up at any time.
+#ifndef _GRL_TIME_SERIES_RING_HPP_
+#define _GRL_TIME_SERIES_RING_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+
+namespace grl {
+
+/// @brief a position and orientation as plain numbers, so it can be kept in a TimeSeriesRing
+struct RigidPose
+{
+    std::array<double,3> translation; ///< x, y, z
+    std::array<double,4> rotation;    ///< unit quaternion w, x, y, z, the argument order of Eigen::Quaterniond(w,x,y,z)
+};
+
+/// @brief interpolates a fraction of the way from a to b elementwise
+struct LinearInterpolator
+{
+    template<typename T>
+    void operator()(const T& a, const T& b, double fraction, T& out) const
+    {
+        out = a + (b - a) * fraction;
+    }
+
+    template<typename T, std::size_t N>
+    void operator()(const std::array<T,N>& a, const std::array<T,N>& b, double fraction, std::array<T,N>& out) const
+    {
+        for(std::size_t i = 0; i < N; ++i) out[i] = a[i] + (b[i] - a[i]) * fraction;
+    }
+};
+
+/// @brief interpolates a RigidPose, linear in the translation and slerp in the rotation
+struct SlerpInterpolator
+{
+    void operator()(const RigidPose& a, const RigidPose& b, double fraction, RigidPose& out) const
+    {
+        LinearInterpolator()(a.translation, b.translation, fraction, out.translation);
+
+        // take the shorter way around, q and -q are the same rotation
+        double dot = 0.0;
+        for(std::size_t i = 0; i < 4; ++i) dot += a.rotation[i] * b.rotation[i];
+        const double sign = dot < 0.0 ? -1.0 : 1.0;
+        dot *= sign;
+
+        double wa = 1.0 - fraction;
+        double wb = fraction;
+        // nearly identical rotations divide by a vanishing sine, normalized lerp is exact enough there
+        if(dot < 0.9995)
+        {
+            const double angle = std::acos(dot);
+            const double sine = std::sin(angle);
+            wa = std::sin(wa * angle) / sine;
+            wb = std::sin(wb * angle) / sine;
+        }
+
+        double norm = 0.0;
+        for(std::size_t i = 0; i < 4; ++i)
+        {
+            out.rotation[i] = wa * a.rotation[i] + wb * sign * b.rotation[i];
+            norm += out.rotation[i] * out.rotation[i];
+        }
+        norm = std::sqrt(norm);
+        for(std::size_t i = 0; i < 4; ++i) out.rotation[i] /= norm;
+    }
+};
+
+/// @brief The newest samples of a value over time, written by one thread and looked up by any number of others
+///
+/// A driver thread calls push() with each new measurement, overwriting the oldest
+/// one once capacity() samples are held. Other threads call at() to get the value
+/// at any time between the oldest and newest sample, such as the arm's joint
+/// angles at the capture time of an optical tracker frame. at() finds the two
+/// samples around the time with a binary search, O(log n), and blends them with
+/// the Interpolator, LinearInterpolator or SlerpInterpolator for a RigidPose.
+///
+/// Nothing locks, allocates after construction, or waits. Each slot has a
+/// sequence number that is odd while the writer changes it, and a reader that
+/// sees it change while copying the slot discards the copy and tries again.
+/// So the writer is never slowed down by readers, and T must be trivially
+/// copyable, such as std::array<double,7> or RigidPose. Sample times must never
+/// decrease.
+///
+/// usage:
+/// @code
+///    grl::TimeSeriesRing<std::array<double,7>> jointAngles(4096);
+///    // driver thread
+///    jointAngles.push(std::chrono::system_clock::now(), measuredJointAngles);
+///    // any other thread
+///    std::array<double,7> atCapture;
+///    if(jointAngles.at(frameCaptureTime, atCapture)) use(atCapture);
+/// @endcode
+template<typename T, typename TimePoint = std::chrono::system_clock::time_point, typename Interpolator = LinearInterpolator>
+class TimeSeriesRing
+{
+public:
+    static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_copyable<TimePoint>::value,
+                  "TimeSeriesRing: samples are copied while they may be overwritten, so they must be trivially copyable");
+
+    typedef T value_type;
+    typedef TimePoint time_point;
+
+    /// @param capacity number of samples kept, at least 2 so there is something to interpolate
+    explicit TimeSeriesRing(std::size_t capacity, Interpolator interpolator = Interpolator())
+    : slots_(capacity), interpolator_(interpolator), count_(0)
+    {
+        if(capacity < 2)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TimeSeriesRing: capacity must be at least 2"));
+        }
+    }
+
+    TimeSeriesRing(const TimeSeriesRing&) = delete;
+    TimeSeriesRing& operator=(const TimeSeriesRing&) = delete;
+
+    std::size_t capacity() const { return slots_.size(); }
+
+    /// number of samples currently held
+    std::size_t size() const
+    {
+        const uint64_t count = count_.load(std::memory_order_acquire);
+        return count < slots_.size() ? static_cast<std::size_t>(count) : slots_.size();
+    }
+
+    bool empty() const { return count_.load(std::memory_order_acquire) == 0; }
+
+    /// @brief writer only, append the newest sample, replacing the oldest when full
+    /// @param time not before the time of the previous sample
+    void push(const TimePoint& time, const T& value)
+    {
+        const uint64_t n = count_.load(std::memory_order_relaxed);
+        if(n && time < newest_)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TimeSeriesRing: sample times must never decrease"));
+        }
+        Slot& slot = slots_[n % slots_.size()];
+        slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.time = time;
+        slot.value = value;
+        slot.sequence.store(2 * n + 2, std::memory_order_release);
+        count_.store(n + 1, std::memory_order_release);
+        newest_ = time;
+    }
+
+    /// @brief any thread, the newest sample
+    /// @return false if there are no samples
+    bool latest(TimePoint& time, T& value) const
+    {
+        for(;;)
+        {
+            const uint64_t count = count_.load(std::memory_order_acquire);
+            if(count == 0) return false;
+            if(read(count - 1, time, &value)) return true;
+        }
+    }
+
+    /// @brief any thread, the value at a time between the oldest and newest sample
+    ///
+    /// A time equal to a sample's gives that sample, otherwise the samples before
+    /// and after the time are interpolated.
+    ///
+    /// @return false if the time is outside the samples held, value is then unchanged
+    bool at(const TimePoint& time, T& value) const
+    {
+        for(;;)
+        {
+            const uint64_t count = count_.load(std::memory_order_acquire);
+            if(count == 0) return false;
+            const uint64_t oldest = count > slots_.size() ? count - slots_.size() : 0;
+
+            TimePoint newestTime;
+            if(!read(count - 1, newestTime)) continue;
+            if(newestTime < time) return false;
+
+            // first sample not before the time, a slot that fails to read was overwritten and is too old
+            uint64_t lo = oldest;
+            uint64_t hi = count - 1;
+            while(lo < hi)
+            {
+                const uint64_t mid = lo + (hi - lo) / 2;
+                TimePoint midTime;
+                if(!read(mid, midTime) || midTime < time) lo = mid + 1;
+                else hi = mid;
+            }
+
+            TimePoint afterTime;
+            T after;
+            if(!read(lo, afterTime, &after)) continue;
+            if(afterTime == time)
+            {
+                value = after;
+                return true;
+            }
+            if(lo == oldest) return false;
+
+            TimePoint beforeTime;
+            T before;
+            if(!read(lo - 1, beforeTime, &before))
+            {
+                // overwritten while searching, so the time left the history unless the writer lapped us
+                const uint64_t now = count_.load(std::memory_order_acquire);
+                if(now > slots_.size() && now - slots_.size() >= lo) return false;
+                continue;
+            }
+
+            const double span = std::chrono::duration<double>(afterTime - beforeTime).count();
+            const double fraction = span > 0.0 ? std::chrono::duration<double>(time - beforeTime).count() / span : 1.0;
+            interpolator_(before, after, fraction, value);
+            return true;
+        }
+    }
+
+    /// @brief any thread, the times of the oldest and newest samples held
+    /// @return false if there are no samples
+    bool range(TimePoint& oldestTime, TimePoint& newestTime) const
+    {
+        for(;;)
+        {
+            const uint64_t count = count_.load(std::memory_order_acquire);
+            if(count == 0) return false;
+            const uint64_t oldest = count > slots_.size() ? count - slots_.size() : 0;
+            // the oldest slot is the next one to be overwritten, so fall back to the one after it
+            if((read(oldest, oldestTime) || (oldest + 1 < count && read(oldest + 1, oldestTime))) &&
+               read(count - 1, newestTime))
+            {
+                return true;
+            }
+        }
+    }
+
+private:
+
+    struct Slot
+    {
+        Slot() : sequence(0), time(), value() {}
+        std::atomic<uint64_t> sequence; ///< 2n+2 once sample n is complete, odd while it is written
+        TimePoint time;
+        T value;
+    };
+
+    /// copy sample n, false if it is not or no longer in its slot
+    bool read(uint64_t n, TimePoint& time, T* value = nullptr) const
+    {
+        const Slot& slot = slots_[n % slots_.size()];
+        const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if(sequence != 2 * n + 2) return false;
+        time = slot.time;
+        if(value) *value = slot.value;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+    std::vector<Slot> slots_;
+    Interpolator interpolator_;
+    std::atomic<uint64_t> count_; ///< samples pushed since construction, sample n is in slot n % capacity()
+    TimePoint newest_;            ///< writer only
+};
+
+} // namespace grl
+
+#endif // _GRL_TIME_SERIES_RING_HPP_
@@ -0,0 +1,91 @@
+/// @file TripleBuffer.hpp
+/// @brief Lock free handoff of the latest value from one producer thread to one consumer thread.
+#ifndef _GRL_TRIPLE_BUFFER_HPP_
+#define _GRL_TRIPLE_BUFFER_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace grl {
+
+/// @brief Three copies of a value so a producer and a consumer never wait for each other
+///
+/// The producer fills back() and calls publish(), the consumer calls update() and
+/// reads front(). Each side owns one of the three buffers, the third is in the
+/// middle, and the only shared state is one atomic byte naming the middle buffer
+/// and whether it holds a value the consumer has not seen. Neither side ever blocks,
+/// allocates or copies a T, so it suits handing data to and from a real time
+/// control loop. When the producer is faster the consumer only sees the latest
+/// value, intermediate ones are dropped.
+///
+/// The buffers are reused, so a T holding vectors sized once keeps its capacity and
+/// later writes of the same size do not allocate. There must be exactly one
+/// producer thread and one consumer thread.
+///
+/// usage:
+/// @code
+///    grl::TripleBuffer<std::vector<double>> joints(std::vector<double>(7, 0.0));
+///    // producer thread
+///    joints.back() = measuredJoints;
+///    joints.publish();
+///    // consumer thread
+///    if(joints.update()) use(joints.front());
+/// @endcode
+template<typename T>
+class TripleBuffer
+{
+public:
+
+    /// default constructs each buffer, so a constructor of T that reserves memory applies to all three
+    TripleBuffer()
+    : front_(0), middle_(1), back_(2)
+    {
+    }
+
+    /// @param initial value of all three buffers, front() returns it until the first update()
+    explicit TripleBuffer(const T& initial)
+    : buffers_{{initial, initial, initial}}, front_(0), middle_(1), back_(2)
+    {
+    }
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    /// producer only, the buffer to write the next value into
+    T& back() { return buffers_[back_]; }
+
+    /// @brief producer only, make back() the latest value and get a new back()
+    ///
+    /// The new back() holds an older value, write all of it before publishing again.
+    void publish()
+    {
+        back_ = middle_.exchange(static_cast<uint8_t>(back_ | fresh), std::memory_order_acq_rel) & indexMask;
+    }
+
+    /// @brief consumer only, take the latest published value into front()
+    /// @return true if there was a value the consumer had not seen, false leaves front() unchanged
+    bool update()
+    {
+        if(!(middle_.load(std::memory_order_acquire) & fresh)) return false;
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    /// consumer only, the latest value taken by update()
+    T& front() { return buffers_[front_]; }
+    const T& front() const { return buffers_[front_]; }
+
+private:
+
+    enum : uint8_t { indexMask = 3, fresh = 4 };
+
+    std::array<T,3> buffers_;
+    uint8_t front_;               ///< consumer's buffer
+    std::atomic<uint8_t> middle_; ///< buffer waiting to be swapped, with the fresh bit
+    uint8_t back_;                ///< producer's buffer
+};
+
+} // namespace grl
+
+#endif // _GRL_TRIPLE_BUFFER_HPP_
@@ -0,0 +1,105 @@
+/// @file LogKUKAiiwaFusionTrackPoses.hpp
+/// @brief Extract time stamped flange and marker poses from LogKUKAiiwaFusionTrack recordings.
+#ifndef _GRL_CALIBRATION_LOG_KUKA_IIWA_FUSION_TRACK_POSES_HPP_
+#define _GRL_CALIBRATION_LOG_KUKA_IIWA_FUSION_TRACK_POSES_HPP_
+
+#include <map>
+#include <string>
+#include <stdexcept>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+#include <flatbuffers/util.h>
+
+#include "grl/flatbuffer/LogKUKAiiwaFusionTrack_generated.h"
+#include "grl/calibration/TimeAlignedPoses.hpp"
+
+namespace grl { namespace calibration {
+
+/// All poses found in one recording
+struct LogPoses
+{
+    /// KUKAiiwaMonitorState::cartesianFlangePose, the flange relative to the arm base
+    StampedPoses flangePoses;
+    /// ftkMarker::transform of every marker in the tracker frame, by marker name or ID if it has no name
+    std::map<std::string,StampedPoses> markerPoses;
+};
+
+inline Eigen::Affine3d toEigen(const grl::flatbuffer::Pose& fbPose)
+{
+    Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+    const grl::flatbuffer::Quaternion& q = fbPose.orientation();
+    pose.linear() = Eigen::Quaterniond(q.w(), q.x(), q.y(), q.z()).normalized().toRotationMatrix();
+    pose.translation() = Eigen::Vector3d(fbPose.position().x(), fbPose.position().y(), fbPose.position().z());
+    return pose;
+}
+
+/// @brief seconds at which a message was measured
+///
+/// Messages from both devices are stamped with the same local clock in the TimeEvent,
+/// in cartographer universal time of 100ns ticks. The corrected local time is preferred,
+/// then the local receive time, and the message timestamp is used when neither was recorded.
+inline double messageTime(const grl::flatbuffer::KUKAiiwaFusionTrackMessage& message)
+{
+    static const double ticksToSec = 1.0e-7;
+    const grl::flatbuffer::TimeEvent* timeEvent = message.timeEvent();
+    if(timeEvent && timeEvent->corrected_local_time() != 0) return timeEvent->corrected_local_time() * ticksToSec;
+    if(timeEvent && timeEvent->local_receive_time() != 0) return timeEvent->local_receive_time() * ticksToSec;
+    return message.timestamp();
+}
+
+/// @brief collect the flange and marker poses from a verified LogKUKAiiwaFusionTrack
+inline LogPoses toLogPoses(const grl::flatbuffer::LogKUKAiiwaFusionTrack& log)
+{
+    LogPoses logPoses;
+    if(!log.states()) return logPoses;
+
+    for(const grl::flatbuffer::KUKAiiwaFusionTrackMessage* message : *log.states())
+    {
+        StampedPose stamped;
+        stamped.time = messageTime(*message);
+
+        if(message->deviceState_type() == grl::flatbuffer::DeviceState::KUKAiiwaState)
+        {
+            auto kukaState = static_cast<const grl::flatbuffer::KUKAiiwaState*>(message->deviceState());
+            const grl::flatbuffer::KUKAiiwaMonitorState* monitorState = kukaState->monitorState();
+            if(!monitorState || !monitorState->cartesianFlangePose()) continue;
+            stamped.pose = toEigen(*monitorState->cartesianFlangePose());
+            logPoses.flangePoses.push_back(stamped);
+        }
+        else if(message->deviceState_type() == grl::flatbuffer::DeviceState::FusionTrackMessage)
+        {
+            auto fusionTrackMessage = static_cast<const grl::flatbuffer::FusionTrackMessage*>(message->deviceState());
+            const grl::flatbuffer::FusionTrackFrame* frame = fusionTrackMessage->frame();
+            if(!frame || !frame->markers()) continue;
+            for(const grl::flatbuffer::ftkMarker* marker : *frame->markers())
+            {
+                if(!marker->transform()) continue;
+                std::string name = (marker->name() && marker->name()->size()) ? marker->name()->str() : std::to_string(marker->ID());
+                stamped.pose = toEigen(*marker->transform());
+                logPoses.markerPoses[name].push_back(stamped);
+            }
+        }
+    }
+    return logPoses;
+}
+
+/// @brief load the poses of a binary LogKUKAiiwaFusionTrack (.flik) file, the buffer is verified first
+inline LogPoses loadLogKUKAiiwaFusionTrackPoses(const std::string& fileName)
+{
+    std::string buffer;
+    if(!flatbuffers::LoadFile(fileName.c_str(), true, &buffer))
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error(std::string("loadLogKUKAiiwaFusionTrackPoses: unable to open ") + fileName));
+    }
+    flatbuffers::Verifier verifier(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+    if(!grl::flatbuffer::VerifyLogKUKAiiwaFusionTrackBuffer(verifier))
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error(std::string("loadLogKUKAiiwaFusionTrackPoses: ") + fileName + " is not a valid LogKUKAiiwaFusionTrack flatbuffer"));
+    }
+    return toLogPoses(*grl::flatbuffer::GetLogKUKAiiwaFusionTrack(buffer.data()));
+}
+
+}} // grl::calibration
+
+#endif // _GRL_CALIBRATION_LOG_KUKA_IIWA_FUSION_TRACK_POSES_HPP_
@@ -0,0 +1,198 @@
+/// @file PoseDiversitySelector.hpp
+/// @brief Pick a small informative subset of a long stream of calibration poses.
+#ifndef _GRL_CALIBRATION_POSE_DIVERSITY_SELECTOR_HPP_
+#define _GRL_CALIBRATION_POSE_DIVERSITY_SELECTOR_HPP_
+
+#include <tuple>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/Cholesky>
+
+namespace grl { namespace calibration {
+
+/// @brief Greedily selects the poses that best condition a hand eye or pivot calibration
+///
+/// Calibration frames recorded continuously, or added by an operator who holds
+/// still, are mostly near duplicates that add solve time but no information.
+/// Each candidate pose contributes a 6x6 information matrix to the linear system
+/// of the calibration, and the selector repeatedly keeps the candidate that raises
+/// the log determinant of the summed information the most (D-optimal design). This
+/// spreads the rotation axes and keeps the system well conditioned. Selection stops
+/// once no candidate adds at least MinInformationGain, or MaxFrames were kept.
+///
+/// Only the rotations matter for the information, translations are used to skip
+/// near duplicate poses.
+///
+///  - PIVOT: rows [R_i -I] of the pivot system R_i * tipOffset + t_i = pivotPoint,
+///    see RansacPivotCalibration.
+///  - HAND_EYE: for the motion A_0^-1 A_i from the first pose, the rotation vector
+///    r_i r_i^T which spreads the screw axes, and (R_i - I)^T (R_i - I) which
+///    conditions the translation equation (R_i - I) t_X = R_X t_B - t_i.
+///
+/// usage:
+/// @code
+///    grl::calibration::PoseDiversitySelector selector;
+///    std::vector<std::size_t> keep = selector.select(armPoses);
+///    // use armPoses[keep[i]] with the matching trackerPoses[keep[i]]
+/// @endcode
+class PoseDiversitySelector
+{
+public:
+
+    enum Model { PIVOT, HAND_EYE };
+
+    enum ParamIndex {
+        CalibrationModel,   ///< PIVOT or HAND_EYE
+        MaxFrames,          ///< stop after this many poses, 0 for no limit
+        MinInformationGain, ///< stop when the best candidate raises the log determinant of the information by less than this
+        MinRotationAngle,   ///< radians, a candidate closer than this in rotation and MinTranslation in translation to a kept pose is a duplicate
+        MinTranslation      ///< meters, see MinRotationAngle
+    };
+
+    typedef std::tuple<
+        Model,
+        std::size_t,
+        double,
+        double,
+        double
+        > Params;
+
+    static const Params defaultParams()
+    {
+        return std::make_tuple(
+                    HAND_EYE , // CalibrationModel
+                    0        , // MaxFrames
+                    0.05     , // MinInformationGain
+                    0.02     , // MinRotationAngle
+                    0.002      // MinTranslation
+               );
+    }
+
+    typedef std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> > Poses;
+    typedef Eigen::Matrix<double,6,6> Information;
+
+    PoseDiversitySelector(Params params = defaultParams())
+    : params_(params)
+    {
+        if(std::get<MinInformationGain>(params_) < 0.0)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("PoseDiversitySelector: MinInformationGain must not be negative"));
+        }
+    }
+
+    /// @brief indices of the selected poses in the order they were selected
+    ///
+    /// For HAND_EYE the first pose is the reference of the motions and always kept.
+    std::vector<std::size_t> select(const Poses& poses) const
+    {
+        std::vector<std::size_t> selected;
+        if(poses.empty()) return selected;
+
+        const Model model = std::get<CalibrationModel>(params_);
+        const std::size_t maxFrames = (std::get<MaxFrames>(params_) == 0) ? poses.size() : std::get<MaxFrames>(params_);
+
+        std::vector<Information, Eigen::aligned_allocator<Information> > information(poses.size());
+        for(std::size_t i = 0; i < poses.size(); ++i)
+        {
+            information[i] = (model == PIVOT) ? pivotInformation(poses[i].linear())
+                                              : handEyeInformation(poses.front().linear().transpose() * poses[i].linear());
+        }
+
+        // a small prior keeps the log determinant finite before the system is fully determined
+        Information total = Information::Identity() * 1e-6;
+        double totalLogDet = logDeterminant(total);
+        std::vector<bool> available(poses.size(), true);
+
+        if(model == HAND_EYE)
+        {
+            // the reference pose itself carries no motion
+            selected.push_back(0);
+            available[0] = false;
+        }
+
+        while(selected.size() < maxFrames)
+        {
+            std::size_t best = poses.size();
+            double bestLogDet = -std::numeric_limits<double>::infinity();
+            for(std::size_t i = 0; i < poses.size(); ++i)
+            {
+                if(!available[i]) continue;
+                double logDet = logDeterminant(total + information[i]);
+                if(logDet > bestLogDet)
+                {
+                    bestLogDet = logDet;
+                    best = i;
+                }
+            }
+
+            if(best == poses.size() || bestLogDet - totalLogDet < std::get<MinInformationGain>(params_)) break;
+
+            selected.push_back(best);
+            available[best] = false;
+            total += information[best];
+            totalLogDet = bestLogDet;
+
+            // near duplicates of the kept pose can't add information
+            for(std::size_t i = 0; i < poses.size(); ++i)
+            {
+                if(available[i] && isDuplicate(poses[i], poses[best])) available[i] = false;
+            }
+        }
+        return selected;
+    }
+
+    /// @brief information one pose adds to the pivot system [R -I] [tipOffset; pivotPoint] = -t
+    static Information pivotInformation(const Eigen::Matrix3d& rotation)
+    {
+        Information info;
+        info.block<3,3>(0,0) = Eigen::Matrix3d::Identity();
+        info.block<3,3>(0,3) = -rotation.transpose();
+        info.block<3,3>(3,0) = -rotation;
+        info.block<3,3>(3,3) = Eigen::Matrix3d::Identity();
+        return info;
+    }
+
+    /// @brief information one motion adds to the hand eye rotation axes and translation
+    static Information handEyeInformation(const Eigen::Matrix3d& motionRotation)
+    {
+        Eigen::AngleAxisd angleAxis(motionRotation);
+        Eigen::Vector3d rotationVector = angleAxis.angle() * angleAxis.axis();
+        Eigen::Matrix3d translationRows = motionRotation - Eigen::Matrix3d::Identity();
+        Information info = Information::Zero();
+        info.block<3,3>(0,0) = rotationVector * rotationVector.transpose();
+        info.block<3,3>(3,3) = translationRows.transpose() * translationRows;
+        return info;
+    }
+
+    /// log determinant of the information, summing the information of all kept poses
+    static double logDeterminant(const Information& information)
+    {
+        Eigen::LLT<Information> llt(information);
+        if(llt.info() != Eigen::Success) return -std::numeric_limits<double>::infinity();
+        return 2.0 * llt.matrixL().toDenseMatrix().diagonal().array().log().sum();
+    }
+
+    const Params& getParams() const { return params_; }
+
+private:
+
+    bool isDuplicate(const Eigen::Affine3d& a, const Eigen::Affine3d& b) const
+    {
+        Eigen::AngleAxisd difference(Eigen::Matrix3d(a.linear().transpose() * b.linear()));
+        return std::abs(difference.angle()) < std::get<MinRotationAngle>(params_)
+            && (a.translation() - b.translation()).norm() < std::get<MinTranslation>(params_);
+    }
+
+    Params params_;
+};
+
+}} // grl::calibration
+
+#endif // _GRL_CALIBRATION_POSE_DIVERSITY_SELECTOR_HPP_
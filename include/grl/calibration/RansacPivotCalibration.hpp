@@ -0,0 +1,296 @@
+/// @file RansacPivotCalibration.hpp
+/// @brief Pivot calibration that is robust to outlier frames.
+#ifndef _GRL_CALIBRATION_RANSAC_PIVOT_CALIBRATION_HPP_
+#define _GRL_CALIBRATION_RANSAC_PIVOT_CALIBRATION_HPP_
+
+#include <tuple>
+#include <vector>
+#include <random>
+#include <thread>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+#include <Eigen/Core>
+#include <Eigen/SVD>
+
+namespace grl { namespace calibration {
+
+/// @brief Estimate the tip offset of a tool pivoted about a fixed point, ignoring outlier frames
+///
+/// Each frame i is the pose R_i, t_i of the tool in the tracker frame and must satisfy
+/// R_i * translation + t_i = pivotPoint, which is 3 linear equations in the 6 unknowns.
+/// Hypotheses are solved from random minimal subsets of frames, then every frame is
+/// scored by the distance between its tip position and the pivot point. Hypotheses are
+/// scored in parallel batches across threads, and the number of hypotheses adapts to
+/// the inlier ratio seen so far. The result is the least squares solution over the
+/// inliers of the best hypothesis.
+///
+/// Rotations and locations are the same as TRTK::PivotCalibration::setRotations() and
+/// setLocations(), so the inliers can also be passed on to one of the TRTK algorithms.
+///
+/// usage:
+/// @code
+///    grl::calibration::RansacPivotCalibration ransac;
+///    ransac.compute(rotations, locations);
+///    Eigen::Vector3d tipOffset = ransac.getTranslation();
+/// @endcode
+class RansacPivotCalibration
+{
+public:
+
+    enum ParamIndex {
+        SampleSize,      ///< frames in each minimal subset, at least 3 with different rotations since 2 always leave the tip unobservable along an axis
+        MaxIterations,   ///< maximum number of hypotheses
+        InlierThreshold, ///< meters between a frame's tip position and the pivot point for it to be an inlier
+        Confidence,      ///< stop once an outlier free sample was drawn with this probability
+        ThreadCount,     ///< threads scoring hypotheses, 0 uses std::thread::hardware_concurrency()
+        Seed             ///< random number seed, so results can be reproduced
+    };
+
+    typedef std::tuple<
+        int,
+        int,
+        double,
+        double,
+        unsigned int,
+        unsigned int
+        > Params;
+
+    static const Params defaultParams()
+    {
+        return std::make_tuple(
+                    3      , // SampleSize
+                    1000   , // MaxIterations
+                    0.001  , // InlierThreshold
+                    0.999  , // Confidence
+                    0u     , // ThreadCount
+                    0u       // Seed
+               );
+    }
+
+    typedef std::vector<Eigen::Matrix3d> Rotations;
+    typedef std::vector<Eigen::Vector3d> Locations;
+
+    RansacPivotCalibration(Params params = defaultParams())
+    : params_(params), translation_(Eigen::Vector3d::Zero()), pivotPoint_(Eigen::Vector3d::Zero()), rmse_(0.0), iterations_(0)
+    {
+        if(std::get<SampleSize>(params_) < 3 || std::get<InlierThreshold>(params_) <= 0.0)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("RansacPivotCalibration: SampleSize must be at least 3 and InlierThreshold must be positive"));
+        }
+    }
+
+    /// @brief find the tip offset and pivot point from the inlier frames
+    /// @return the number of inlier frames
+    /// @throws std::runtime_error if there are too few frames or every sample was degenerate
+    std::size_t compute(const Rotations& rotations, const Locations& locations)
+    {
+        if(rotations.size() != locations.size())
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("RansacPivotCalibration: the number of rotations and locations must match"));
+        }
+
+        const int sampleSize = std::get<SampleSize>(params_);
+        const std::size_t frameCount = rotations.size();
+        if(frameCount < std::size_t(sampleSize))
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error(std::string("RansacPivotCalibration: ") + std::to_string(frameCount) +
+                                  " frames were added but at least " + std::to_string(sampleSize) + " are required"));
+        }
+
+        const double threshold = std::get<InlierThreshold>(params_);
+        unsigned int threadCount = std::get<ThreadCount>(params_);
+        if(threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+        std::mt19937 gen(std::get<Seed>(params_));
+        std::vector<std::size_t> pool(frameCount);
+        for(std::size_t i = 0; i < frameCount; ++i) pool[i] = i;
+
+        Hypothesis best;
+        int maxIterations = std::max(std::get<MaxIterations>(params_), 1);
+        int iterations = 0;
+        std::vector<Hypothesis> batch;
+
+        while(iterations < maxIterations)
+        {
+            // draw samples serially so the result only depends on the seed
+            batch.resize(std::min(int(threadCount) * 16, maxIterations - iterations));
+            for(Hypothesis& hypothesis : batch)
+            {
+                for(int j = 0; j < sampleSize; ++j)
+                {
+                    std::uniform_int_distribution<std::size_t> dis(std::size_t(j), frameCount - 1);
+                    std::swap(pool[j], pool[dis(gen)]);
+                }
+                hypothesis.sample.assign(pool.begin(), pool.begin() + sampleSize);
+            }
+
+            std::vector<std::thread> threads;
+            for(unsigned int t = 0; t < threadCount; ++t)
+            {
+                threads.push_back(std::thread([&, t]()
+                {
+                    for(std::size_t b = t; b < batch.size(); b += threadCount)
+                    {
+                        evaluate(batch[b], rotations, locations, threshold);
+                    }
+                }));
+            }
+            for(auto& thread : threads) thread.join();
+            iterations += int(batch.size());
+
+            for(const Hypothesis& hypothesis : batch)
+            {
+                if(hypothesis.valid && (!best.valid || hypothesis.inlierCount > best.inlierCount ||
+                   (hypothesis.inlierCount == best.inlierCount && hypothesis.inlierError < best.inlierError)))
+                {
+                    best = hypothesis;
+                }
+            }
+
+            if(best.valid)
+            {
+                double outlierFreeProbability = std::pow(double(best.inlierCount) / double(frameCount), sampleSize);
+                if(outlierFreeProbability >= 1.0) break;
+                double needed = std::log(1.0 - std::get<Confidence>(params_)) / std::log(1.0 - outlierFreeProbability);
+                if(std::isfinite(needed)) maxIterations = std::min(maxIterations, std::max(iterations, int(std::ceil(needed))));
+            }
+        }
+        iterations_ = iterations;
+
+        if(!best.valid)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("RansacPivotCalibration: every sample was degenerate, pivot the tool through a wider range of orientations"));
+        }
+
+        // refit on the inliers, which may change the inlier set slightly
+        inliers_.assign(frameCount, false);
+        std::vector<std::size_t> inlierIndices;
+        for(std::size_t i = 0; i < frameCount; ++i)
+        {
+            if(residual(best.translation, best.pivotPoint, rotations[i], locations[i]) <= threshold)
+            {
+                inliers_[i] = true;
+                inlierIndices.push_back(i);
+            }
+        }
+
+        translation_ = best.translation;
+        pivotPoint_ = best.pivotPoint;
+        solve(rotations, locations, inlierIndices, translation_, pivotPoint_);
+
+        double squaredErrorSum = 0.0;
+        for(std::size_t i : inlierIndices)
+        {
+            double error = residual(translation_, pivotPoint_, rotations[i], locations[i]);
+            squaredErrorSum += error * error;
+        }
+        rmse_ = inlierIndices.empty() ? 0.0 : std::sqrt(squaredErrorSum / double(inlierIndices.size()));
+
+        return inlierIndices.size();
+    }
+
+    /// tip offset in the coordinates of the tracked tool, same as TRTK::PivotCalibration::getTranslation()
+    const Eigen::Vector3d& getTranslation() const { return translation_; }
+
+    /// fixed point the tool was pivoted about in the tracker frame, same as TRTK::PivotCalibration::getPivotPoint()
+    const Eigen::Vector3d& getPivotPoint() const { return pivotPoint_; }
+
+    /// true for each frame used in the final estimate
+    const std::vector<bool>& getInliers() const { return inliers_; }
+
+    /// root mean square distance of the inlier tip positions from the pivot point
+    double getRMSE() const { return rmse_; }
+
+    /// hypotheses evaluated by the last compute()
+    int getIterations() const { return iterations_; }
+
+    const Params& getParams() const { return params_; }
+
+    /// @brief least squares tip offset and pivot point over the frames at indices
+    /// @return false if the frames do not determine a unique solution, for example all have the same rotation
+    static bool solve(const Rotations& rotations, const Locations& locations, const std::vector<std::size_t>& indices,
+                      Eigen::Vector3d& translation, Eigen::Vector3d& pivotPoint)
+    {
+        // normal equations of [R_i -I] [translation; pivotPoint] = -t_i
+        Eigen::Matrix<double,6,6> AtA = Eigen::Matrix<double,6,6>::Zero();
+        Eigen::Matrix<double,6,1> Atb = Eigen::Matrix<double,6,1>::Zero();
+        for(std::size_t i : indices)
+        {
+            const Eigen::Matrix3d& R = rotations[i];
+            AtA.block<3,3>(0,3) -= R.transpose();
+            Atb.head<3>() -= R.transpose() * locations[i];
+            Atb.tail<3>() += locations[i];
+        }
+        const double n = double(indices.size());
+        AtA.block<3,3>(0,0) = n * Eigen::Matrix3d::Identity();
+        AtA.block<3,3>(3,3) = n * Eigen::Matrix3d::Identity();
+        AtA.block<3,3>(3,0) = AtA.block<3,3>(0,3).transpose();
+
+        Eigen::JacobiSVD<Eigen::Matrix<double,6,6> > svd(AtA, Eigen::ComputeFullU | Eigen::ComputeFullV);
+        const Eigen::Matrix<double,6,1>& singularValues = svd.singularValues();
+        if(!(singularValues(5) > singularValues(0) * 1e-9)) return false;
+
+        Eigen::Matrix<double,6,1> x = svd.solve(Atb);
+        translation = x.head<3>();
+        pivotPoint = x.tail<3>();
+        return true;
+    }
+
+private:
+
+    struct Hypothesis
+    {
+        Hypothesis() : valid(false), inlierCount(0), inlierError(std::numeric_limits<double>::max()) {}
+
+        std::vector<std::size_t> sample;
+        Eigen::Vector3d translation;
+        Eigen::Vector3d pivotPoint;
+        bool valid;
+        std::size_t inlierCount;
+        double inlierError; ///< sum of the inlier distances, breaks ties between equal inlier counts
+    };
+
+    static double residual(const Eigen::Vector3d& translation, const Eigen::Vector3d& pivotPoint,
+                           const Eigen::Matrix3d& rotation, const Eigen::Vector3d& location)
+    {
+        return (rotation * translation + location - pivotPoint).norm();
+    }
+
+    /// solve and score one hypothesis, only reads shared data so hypotheses run in parallel
+    static void evaluate(Hypothesis& hypothesis, const Rotations& rotations, const Locations& locations, double threshold)
+    {
+        hypothesis.valid = solve(rotations, locations, hypothesis.sample, hypothesis.translation, hypothesis.pivotPoint);
+        if(!hypothesis.valid) return;
+
+        hypothesis.inlierCount = 0;
+        hypothesis.inlierError = 0.0;
+        for(std::size_t i = 0; i < rotations.size(); ++i)
+        {
+            double error = residual(hypothesis.translation, hypothesis.pivotPoint, rotations[i], locations[i]);
+            if(error <= threshold)
+            {
+                ++hypothesis.inlierCount;
+                hypothesis.inlierError += error;
+            }
+        }
+    }
+
+    Params params_;
+    Eigen::Vector3d translation_;
+    Eigen::Vector3d pivotPoint_;
+    std::vector<bool> inliers_;
+    double rmse_;
+    int iterations_;
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+}} // grl::calibration
+
+#endif // _GRL_CALIBRATION_RANSAC_PIVOT_CALIBRATION_HPP_
@@ -0,0 +1,155 @@
+/// @file TimeAlignedPoses.hpp
+/// @brief Pair up poses recorded by two devices at different rates and times.
+#ifndef _GRL_CALIBRATION_TIME_ALIGNED_POSES_HPP_
+#define _GRL_CALIBRATION_TIME_ALIGNED_POSES_HPP_
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+
+namespace grl { namespace calibration {
+
+/// A pose with the time in seconds it was measured
+struct StampedPose
+{
+    double time = 0.0;
+    Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+typedef std::vector<StampedPose,Eigen::aligned_allocator<StampedPose>> StampedPoses;
+
+/// same as PoseDiversitySelector::Poses
+typedef std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> > Poses;
+
+/// @brief pose a fraction t from a to b, linear in the translation and slerp in the rotation
+inline Eigen::Affine3d interpolatePose(const Eigen::Affine3d& a, const Eigen::Affine3d& b, double t)
+{
+    Eigen::Quaterniond qa(a.rotation());
+    Eigen::Quaterniond qb(b.rotation());
+    Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+    pose.linear() = qa.slerp(t, qb).toRotationMatrix();
+    pose.translation() = a.translation() + t * (b.translation() - a.translation());
+    return pose;
+}
+
+/// @brief Sample one pose stream at the times of another
+///
+/// For every reference pose, such as an optical tracker marker measurement, the
+/// interpolated stream, such as the robot flange, is interpolated at the same time.
+/// A reference pose is dropped when no interpolated pose lies within maxGap seconds
+/// on both sides of it, so frames recorded while one device stalled are not paired
+/// with a stale pose. Both streams are sorted by time first if needed.
+///
+/// @param timeOffset seconds added to every reference time, for example a known tracker latency
+/// @param referenceOut the kept reference poses
+/// @param interpolatedOut the interpolated poses, matching referenceOut index by index
+/// @return the number of aligned pairs
+inline std::size_t alignPoses(StampedPoses reference, StampedPoses interpolated, double maxGap, double timeOffset,
+                              Poses& referenceOut, Poses& interpolatedOut)
+{
+    auto byTime = [](const StampedPose& a, const StampedPose& b){ return a.time < b.time; };
+    if(!std::is_sorted(reference.begin(), reference.end(), byTime)) std::stable_sort(reference.begin(), reference.end(), byTime);
+    if(!std::is_sorted(interpolated.begin(), interpolated.end(), byTime)) std::stable_sort(interpolated.begin(), interpolated.end(), byTime);
+
+    referenceOut.clear();
+    interpolatedOut.clear();
+    if(interpolated.empty()) return 0;
+
+    // reference times only increase, so the bracketing pair only moves forward
+    std::size_t after = 0;
+    for(const StampedPose& sample : reference)
+    {
+        const double time = sample.time + timeOffset;
+        while(after < interpolated.size() && interpolated[after].time < time) ++after;
+
+        if(after < interpolated.size() && interpolated[after].time == time)
+        {
+            referenceOut.push_back(sample.pose);
+            interpolatedOut.push_back(interpolated[after].pose);
+            continue;
+        }
+        if(after == 0 || after == interpolated.size()) continue;
+
+        const StampedPose& a = interpolated[after-1];
+        const StampedPose& b = interpolated[after];
+        if(time - a.time > maxGap || b.time - time > maxGap) continue;
+
+        double span = b.time - a.time;
+        double t = (span > 0.0) ? (time - a.time) / span : 0.0;
+        referenceOut.push_back(sample.pose);
+        interpolatedOut.push_back(interpolatePose(a.pose, b.pose, t));
+    }
+    return referenceOut.size();
+}
+
+/// Summary of how well an estimated transform explains a set of measurements
+struct ResidualStatistics
+{
+    std::size_t count = 0;
+    double rmsRotation = 0.0;    ///< radians
+    double maxRotation = 0.0;    ///< radians
+    double rmsTranslation = 0.0; ///< meters
+    double maxTranslation = 0.0; ///< meters
+};
+
+/// @brief residuals of a hand eye estimate X over time aligned arm and tracker poses
+///
+/// The motion between each pair of consecutive poses, A_i = arm_i^-1 * arm_i+1 and
+/// B_i = tracker_i^-1 * tracker_i+1, should satisfy A_i * X = X * B_i, which is the
+/// convention of camodocal::HandEyeCalibration::estimateHandEyeScrew(). The residual
+/// of each motion is the rotation angle and translation of (A_i * X)^-1 * X * B_i.
+inline ResidualStatistics handEyeResiduals(const Poses& armPoses, const Poses& trackerPoses, const Eigen::Affine3d& X)
+{
+    ResidualStatistics stats;
+    const std::size_t count = std::min(armPoses.size(), trackerPoses.size());
+    if(count < 2) return stats;
+
+    double sumRotation = 0.0;
+    double sumTranslation = 0.0;
+    for(std::size_t i = 1; i < count; ++i)
+    {
+        Eigen::Affine3d A = armPoses[i-1].inverse() * armPoses[i];
+        Eigen::Affine3d B = trackerPoses[i-1].inverse() * trackerPoses[i];
+        Eigen::Affine3d error = (A * X).inverse() * (X * B);
+        double rotation = Eigen::AngleAxisd(error.rotation()).angle();
+        double translation = error.translation().norm();
+        sumRotation += rotation * rotation;
+        sumTranslation += translation * translation;
+        stats.maxRotation = std::max(stats.maxRotation, rotation);
+        stats.maxTranslation = std::max(stats.maxTranslation, translation);
+    }
+    stats.count = count - 1;
+    stats.rmsRotation = std::sqrt(sumRotation / double(stats.count));
+    stats.rmsTranslation = std::sqrt(sumTranslation / double(stats.count));
+    return stats;
+}
+
+/// @brief motions between consecutive poses in the axis angle format of camodocal::HandEyeCalibration
+///
+/// Consecutive motions are small and independent, while motions relative to the
+/// first pose all share its measurement error and start with an identity motion.
+/// n poses give n-1 motions.
+template<typename Vector3dVector>
+inline void posesToMotions(const Poses& poses, Vector3dVector& rvecs, Vector3dVector& tvecs)
+{
+    rvecs.clear();
+    tvecs.clear();
+    for(std::size_t i = 1; i < poses.size(); ++i)
+    {
+        Eigen::Affine3d motion = poses[i-1].inverse() * poses[i];
+        Eigen::AngleAxisd angleAxis(motion.rotation());
+        rvecs.push_back(angleAxis.angle() * angleAxis.axis());
+        tvecs.push_back(motion.translation());
+    }
+}
+
+}} // grl::calibration
+
+#endif // _GRL_CALIBRATION_TIME_ALIGNED_POSES_HPP_
@@ -3,6 +3,7 @@
 #ifndef GRL_KUKA_HPP
 #define GRL_KUKA_HPP
 
+#include <iterator>
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/container/static_vector.hpp>
@@ -183,6 +184,55 @@ copy(std::string model, OutputIterator it,
     return it;
 }
 
+/// @brief copy vector of joint acceleration limits in radians/s^2
+///
+/// KUKA does not publish joint acceleration limits for the iiwa, so these
+/// are conservative values that let each joint reach its velocity limit
+/// in 0.5 s, twice its velocity limit per second. Exceeding what the
+/// drives can do makes the arm lag behind the commanded positions and
+/// stop with an error, so lower them for heavy payloads.
+template <typename OutputIterator>
+OutputIterator
+copy(std::string model, OutputIterator it,
+     grl::revolute_joint_acceleration_open_chain_state_constraint_tag) {
+  KukaState::joint_state maxVel;
+  copy(model, std::back_inserter(maxVel),
+       grl::revolute_joint_velocity_open_chain_state_constraint_tag());
+
+  KukaState::joint_state maxAccel;
+  for (double velocity : maxVel)
+    maxAccel.push_back(2.0 * velocity);
+
+  return boost::copy(maxAccel, it);
+}
+
+/// @brief copy vector of joint angle limits in radians
+///
+/// Each joint may move this far either side of zero. From the KUKA LBR iiwa
+/// specification, which gives the same range for the R800 and R820:
+/// A1, A3, A5 +-170 deg, A2, A4, A6 +-120 deg, A7 +-175 deg.
+template <typename OutputIterator>
+OutputIterator
+copy(std::string model, OutputIterator it,
+     grl::revolute_joint_angle_open_chain_state_constraint_tag) {
+  if (boost::iequals(model, KUKA_LBR_IIWA_14_R820) ||
+      boost::iequals(model, KUKA_LBR_IIWA_7_R800)) {
+    KukaState::joint_state maxAngle;
+    maxAngle.push_back(2.967059728390); // 170 deg
+    maxAngle.push_back(2.094395102393); // 120 deg
+    maxAngle.push_back(2.967059728390);
+    maxAngle.push_back(2.094395102393);
+    maxAngle.push_back(2.967059728390);
+    maxAngle.push_back(2.094395102393);
+    maxAngle.push_back(3.054326190990); // 175 deg
+
+    return boost::copy(maxAngle, it);
+  }
+
+  else
+    return it;
+}
+
 
 /// @brief Internal class, defines some default status variables
 ///
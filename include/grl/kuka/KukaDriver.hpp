@@ -171,6 +171,20 @@ namespace grl { namespace robot { namespace arm {
       *
       */
       bool run_one(){
+        return run_one(true);
+      }
+
+     /**
+      * @brief spin once, passing the commanded position on only when it is new
+      *
+      * Call this at the FRI rate with newCommand set only when a new position
+      * or time to reach it was set. The JAVA interface then sends at the rate
+      * commands arrive rather than every FRI tick, and FRI keeps
+      * interpolating toward the current goal in between.
+      *
+      * @param newCommand false to only sync state, the JAVA interface is skipped
+      */
+      bool run_one(bool newCommand){
 
         // @todo CHECK FOR REAL DATA BEFORE SENDING COMMANDS
         //if(!m_haveReceivedRealDataCount) return;
@@ -178,7 +192,7 @@ namespace grl { namespace robot { namespace arm {
 
         /// @todo make this handled by template driver implementations/extensions
 
-        if(JAVAdriverP_.get() != nullptr)
+        if(JAVAdriverP_.get() != nullptr && newCommand)
         {
           if (debug) {
             std::cout << "commandedpos:" << armState_.commandedPosition << "\n";
@@ -225,7 +239,7 @@ namespace grl { namespace robot { namespace arm {
 
         if(FRIdriverP_.get() != nullptr)
         {
-          if( boost::iequals(std::get<KukaCommandMode>(params_),std::string("FRI")))
+          if(newCommand && boost::iequals(std::get<KukaCommandMode>(params_),std::string("FRI")))
           {
             FRIdriverP_->set(armState_.commandedPosition,revolute_joint_angle_open_chain_command_tag());
           }
@@ -235,7 +249,7 @@ namespace grl { namespace robot { namespace arm {
           if( boost::iequals(std::get<KukaMonitorMode>(params_),std::string("FRI")))
           {
             FRIdriverP_->get(armState_);
-            JAVAdriverP_->getWrench(armState_);
+            if(JAVAdriverP_) JAVAdriverP_->getWrench(armState_);
           }
         }
 
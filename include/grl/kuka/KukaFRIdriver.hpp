@@ -7,6 +7,8 @@
 #include <boost/circular_buffer.hpp>
 #include <boost/config.hpp>
 #include <boost/exception/all.hpp>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <thread>
@@ -26,6 +28,7 @@
 #include "grl/exception.hpp"
 #include "grl/vector_ostream.hpp"
 #include "grl/kuka/KukaFRIalgorithm.hpp"
+#include "grl/TimeSeriesRing.hpp"
 
 
 /// @todo TODO(ahundt) REMOVE SPDLOG FROM LOW LEVEL CODE
@@ -88,7 +91,7 @@ struct LinearInterpolation {
   }
   /// Default constructor
   /// @todo verify this doesn't corrupt the state of the system
-  LinearInterpolation() {
+  LinearInterpolation() : goal_position_command_time_duration_remaining(0) {
   };
 
   // no action by default
@@ -402,6 +405,10 @@ void update_state(boost::asio::ip::udp::socket &socket,
       boost::asio::buffer(friData.receiveBuffer,
                           KUKA::FRI::FRI_MONITOR_MSG_MAX_SIZE),
       sender_endpoint, message_flags, receive_ec);
+  send_bytes_transferred = 0;
+  // nothing to decode or answer, the caller decides if the link is down
+  if (receive_ec || receive_bytes_transferred == 0)
+    return;
   decode(friData, receive_bytes_transferred);
 
   friData.lastSendCounter++;
@@ -416,6 +423,43 @@ void update_state(boost::asio::ip::udp::socket &socket,
   }
 }
 
+/// @brief wait until a message can be read from the socket without blocking
+///
+/// A blocking receive never returns when the robot stops sending, so waiting
+/// here first lets the caller notice a dropped link and check for shutdown.
+///
+/// @param ec set to boost::asio::error::timed_out when nothing arrived in time
+/// @return true if a message is ready to be received
+inline bool wait_for_receive(boost::asio::ip::udp::socket &socket,
+                             std::chrono::milliseconds timeout,
+                             boost::system::error_code &ec) {
+  auto handle = socket.native_handle();
+  fd_set readSet;
+  FD_ZERO(&readSet);
+  FD_SET(handle, &readSet);
+  timeval tv;
+  tv.tv_sec = static_cast<long>(timeout.count() / 1000);
+  tv.tv_usec = static_cast<long>((timeout.count() % 1000) * 1000);
+
+  const int ready =
+      ::select(static_cast<int>(handle) + 1, &readSet, nullptr, nullptr, &tv);
+  if (ready > 0) {
+    ec.clear();
+    return true;
+  }
+  ec = ready == 0 ? boost::system::error_code(boost::asio::error::timed_out)
+                  : boost::system::errc::make_error_code(
+                        boost::system::errc::io_error);
+  return false;
+}
+
+/// @brief forget the counters of an FRI session that was lost, so the reply to
+/// the first message of the next session starts a new sequence and the
+/// reflected counter is taken from that message
+inline void reset_session_counters(KUKA::FRI::ClientData &friData) {
+  friData.sequenceCounter = 0;
+  friData.lastSendCounter = 0;
+}
 
 /// @brief don't use this
 /// @deprecated this is an old implemenation that will be removed in the future
@@ -466,6 +510,16 @@ void copy(const FRIMonitoringMessage &monitoringMsg, KukaState &state) {
 /// async_getLatestState(handler) frequently enought that the 5ms response
 /// requirement of the KUKA
 /// FRI interface is met.
+///
+/// When the robot stops sending for longer than the receive timeout the driver
+/// moves to the reconnecting state instead of exiting. The socket and the client
+/// data buffers are kept, and the first message of the next FRI session restarts
+/// the sequence counters, so commanding resumes as soon as the controller is back
+/// in COMMANDING_WAIT. The low level algorithm starts over without a goal, the
+/// arm may have been moved while the link was down, so send a new goal.
+///
+/// Every measured joint position is also kept in joint_angle_history(), so
+/// other threads can look up the arm at the time of another sensor's data.
 template <typename LowLevelStepAlgorithmType = LinearInterpolation>
 class KukaFRIClientDataDriver
     : public std::enable_shared_from_this<
@@ -478,9 +532,19 @@ public:
   using KukaUDP::Params;
   using KukaUDP::defaultParams;
 
+  /// measured joint angles by the local system_clock time they were received
+  typedef grl::TimeSeriesRing<std::array<double, KUKA::LBRState::NUM_DOF>>
+      JointAngleHistory;
+
+  /// joint angle samples kept, 4 s at the fastest FRI rate of 1 ms
+  static const std::size_t jointAngleHistoryCapacity = 4096;
+
   KukaFRIClientDataDriver(boost::asio::io_service &ios,
                           Params params = defaultParams())
       : params_(params), m_shouldStop(false), isConnectionEstablished_(false),
+        connectionState_(connecting), reconnectCount_(0),
+        receiveTimeoutMilliseconds_(100),
+        jointAngleHistory_(jointAngleHistoryCapacity),
         io_service_(ios)
   //,socketP_(std::move(connect(params, io_service_,sender_endpoint_))) ///<
   //@todo this breaks the assumption that the object can be constructed without
@@ -491,6 +555,9 @@ public:
 
   KukaFRIClientDataDriver(Params params = defaultParams())
       : params_(params), m_shouldStop(false), isConnectionEstablished_(false),
+        connectionState_(connecting), reconnectCount_(0),
+        receiveTimeoutMilliseconds_(100),
+        jointAngleHistory_(jointAngleHistoryCapacity),
         optional_internal_io_service_P(new boost::asio::io_service),
         io_service_(*optional_internal_io_service_P)
   //,socketP_(std::move(connect(params, io_service_,sender_endpoint_))) ///<
@@ -552,6 +619,10 @@ public:
   /// then the driver won't be able to acquire the lock and send updates to the
   /// robot.
   ///
+  /// @param[in] step_alg_params a new goal for the low level algorithm, or
+  /// null to keep moving toward the current one. The goal is set once, so the
+  /// time to reach it is not restarted by later calls.
+  ///
   /// @param[in,out] friData supply a new command, receive a new update of the
   /// robot state. Pointer is null if no new data is available.
   ///
@@ -575,6 +646,13 @@ public:
 
     bool haveNewData = false;
 
+    // a new goal is handed to the driver thread once, it is not reapplied
+    // with every message
+    if (step_alg_params) {
+      boost::lock_guard<boost::mutex> lock(ptrMutex_);
+      newGoalForDriver_ = step_alg_params;
+    }
+
     if (!isConnectionEstablished_ ||
         !std::get<latest_receive_monitor_state>(latestStateForUser_)) {
       // no new data, so immediately return results accordingly
@@ -639,6 +717,37 @@ public:
   /// @todo consider expanding to support real error codes
   bool is_active() { return !exceptionPtr && isConnectionEstablished_; }
 
+  enum ConnectionState {
+    connecting,  ///< waiting for the first message from the robot
+    connected,   ///< messages are arriving
+    reconnecting ///< the link dropped, waiting for the next FRI session
+  };
+
+  ConnectionState connection_state() const {
+    return static_cast<ConnectionState>(connectionState_.load());
+  }
+
+  /// number of times the link dropped and came back since construction
+  std::size_t reconnect_count() const { return reconnectCount_; }
+
+  /// @brief time without a message from the robot after which the link is
+  /// considered lost, 100 ms by default
+  ///
+  /// FRI sends every 1-5 ms, so this only needs to be long enough to ride out
+  /// scheduling hiccups on this side.
+  void set_receive_timeout(std::chrono::milliseconds timeout) {
+    receiveTimeoutMilliseconds_ = timeout.count();
+  }
+
+  /// @brief the measured joint angles of the last jointAngleHistoryCapacity
+  /// messages, safe to read from any thread while the driver runs
+  ///
+  /// Samples are stamped with std::chrono::system_clock when they arrive, use
+  /// JointAngleHistory::at() to get the joint angles at another sensor's time.
+  const JointAngleHistory &joint_angle_history() const {
+    return jointAngleHistory_;
+  }
+
 private:
   /// Reads data off of the real kuka fri device in a separate thread
   /// @todo consider switching to single producer single consumer queue to avoid
@@ -659,6 +768,11 @@ private:
           connect(params_, io_service_, sender_endpoint));
       KukaState kukastate; ///< @todo TODO(ahundt) remove this line when new
                            /// api works completely since old one is deprecated
+      std::chrono::steady_clock::time_point lastReceiveTime =
+          std::chrono::steady_clock::now();
+      KukaState::joint_state measuredJointAngles;
+      std::array<double, KUKA::LBRState::NUM_DOF> jointAngleSample;
+      std::chrono::system_clock::time_point lastHistoryTime;
 
       /////////////
       // run the primary update loop in a separate thread
@@ -675,20 +789,64 @@ private:
         std::get<latest_receive_monitor_state>(nextState)
             ->expectedMonitorMsgID = KUKA::LBRState::LBRMONITORMESSAGEID;
 
-        auto lowLevelAlgorithmParamP = std::get<latest_low_level_algorithm_params>(nextState);
-
-        // if there is a valid low level algorithm param command set the new goal
-        if(lowLevelAlgorithmParamP) step_alg.setGoal(*lowLevelAlgorithmParamP);
-
         // actually talk over the network to receive an update and send out a
         // new command
-        grl::robot::arm::update_state(
-            socket, step_alg,
-            *std::get<latest_receive_monitor_state>(nextState),
-            std::get<latest_receive_ec>(nextState),
-            std::get<latest_receive_bytes_transferred>(nextState),
-            std::get<latest_send_ec>(nextState),
-            std::get<latest_send_bytes_transferred>(nextState));
+        std::get<latest_send_ec>(nextState).clear();
+        std::get<latest_send_bytes_transferred>(nextState) = 0;
+        std::get<latest_receive_bytes_transferred>(nextState) = 0;
+        const std::chrono::milliseconds receiveTimeout(
+            receiveTimeoutMilliseconds_.load());
+        if (wait_for_receive(socket, receiveTimeout,
+                             std::get<latest_receive_ec>(nextState))) {
+          grl::robot::arm::update_state(
+              socket, step_alg,
+              *std::get<latest_receive_monitor_state>(nextState),
+              std::get<latest_receive_ec>(nextState),
+              std::get<latest_receive_bytes_transferred>(nextState),
+              std::get<latest_send_ec>(nextState),
+              std::get<latest_send_bytes_transferred>(nextState));
+        }
+
+        // connection state machine, a lost link is recovered in place
+        const auto now = std::chrono::steady_clock::now();
+        if (!std::get<latest_receive_ec>(nextState) &&
+            std::get<latest_receive_bytes_transferred>(nextState)) {
+          lastReceiveTime = now;
+
+          measuredJointAngles.clear();
+          grl::robot::arm::copy(
+              std::get<latest_receive_monitor_state>(nextState)->monitoringMsg,
+              std::back_inserter(measuredJointAngles),
+              revolute_joint_angle_open_chain_state_tag());
+          // skip samples while the wall clock is set back, times must not decrease
+          const auto receiveTime = std::chrono::system_clock::now();
+          if (measuredJointAngles.size() == jointAngleSample.size() &&
+              receiveTime >= lastHistoryTime) {
+            boost::copy(measuredJointAngles, jointAngleSample.begin());
+            jointAngleHistory_.push(receiveTime, jointAngleSample);
+            lastHistoryTime = receiveTime;
+          }
+
+          if (connectionState_ == reconnecting)
+            ++reconnectCount_;
+          connectionState_ = connected;
+          isConnectionEstablished_ = true;
+        } else {
+          if (connectionState_ == connected &&
+              now - lastReceiveTime >= receiveTimeout) {
+            connectionState_ = reconnecting;
+            isConnectionEstablished_ = false;
+            reset_session_counters(
+                *std::get<latest_receive_monitor_state>(nextState));
+            // don't resume interpolating toward a goal from the lost session
+            step_alg = LowLevelStepAlgorithmType();
+          }
+          // a connected udp socket reports the robot's port as unreachable
+          // right away, don't spin on that
+          if (std::get<latest_receive_ec>(nextState) !=
+              boost::asio::error::timed_out)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
 
         /// @todo use atomics to eliminate the global mutex lock for this object
         // lock the mutex to communicate with the user thread
@@ -770,13 +928,11 @@ private:
           set(nextClientData.commandMsg,
               latestCommandBackupClientData.commandMsg);
 
-          // if there are no error codes and we have received data,
-          // then we can consider the connection established!
-          /// @todo perhaps data should always send too?
-          if (!std::get<latest_receive_ec>(nextState) &&
-              !std::get<latest_send_ec>(nextState) &&
-              std::get<latest_receive_bytes_transferred>(nextState)) {
-            isConnectionEstablished_ = true;
+          // 4) start moving toward a new goal, the time to reach it counts
+          // down from here
+          if (newGoalForDriver_) {
+            step_alg.setGoal(*newGoalForDriver_);
+            newGoalForDriver_.reset();
           }
 
           ptrMutex_.unlock();
@@ -862,6 +1018,8 @@ private:
   /// the latest state we have available to give to the user
   LatestState latestStateForUser_;
   LatestState newCommandForDriver_;
+  /// goal from the user the driver thread has not started on yet, null if none
+  std::shared_ptr<typename LowLevelStepAlgorithmType::Params> newGoalForDriver_;
 
   /// should always be valid, never null
   boost::container::static_vector<LatestState, 2> spareStates_;
@@ -869,6 +1027,10 @@ private:
   std::atomic<bool> m_shouldStop;
   std::exception_ptr exceptionPtr;
   std::atomic<bool> isConnectionEstablished_;
+  std::atomic<int> connectionState_;
+  std::atomic<std::size_t> reconnectCount_;
+  std::atomic<std::chrono::milliseconds::rep> receiveTimeoutMilliseconds_;
+  JointAngleHistory jointAngleHistory_;
 
   /// may be null, allows the user to choose if they want to provide an
   /// io_service
@@ -976,6 +1138,17 @@ public:
 
   const Params &getParams() { return params_; }
 
+  typedef typename KukaFRIClientDataDriver<
+      LowLevelStepAlgorithmType>::JointAngleHistory JointAngleHistory;
+
+  /// @brief measured joint angles over the last few seconds, readable from any
+  /// thread
+  /// @pre construct() was called
+  /// @see KukaFRIClientDataDriver::joint_angle_history()
+  const JointAngleHistory &joint_angle_history() const {
+    return kukaFRIClientDataDriverP_->joint_angle_history();
+  }
+
   ~KukaFRIdriver() {
     device_driver_workP_.reset();
 
@@ -1042,10 +1215,16 @@ public:
     // This is the key point where the arm's motion goal command is updated and
     // sent to the robot
     // Set the FRI to the simulated joint positions
+    // this count is not reset when the low level driver reconnects after a
+    // dropped link, so commanding resumes without waiting again
+    // only a changed goal is passed down, so the low level algorithm keeps
+    // the time it has left to reach the current one
+    boost::unique_lock<boost::mutex> goalLock(jt_mutex);
     if (this->m_haveReceivedRealDataCount >
-        minimumConsecutiveSuccessesBeforeSendingCommands) {
+            minimumConsecutiveSuccessesBeforeSendingCommands &&
+        goalChanged_) {
       /// @todo TODO(ahundt) Need to eliminate this allocation
-      boost::lock_guard<boost::mutex> lock(jt_mutex);
+      goalChanged_ = false;
 
       boost::container::static_vector<double, 7> jointStateToCommand;
       boost::copy(armState.commandedPosition,std::back_inserter(jointStateToCommand));
@@ -1058,12 +1237,9 @@ public:
       // std::cout << "commandToSend: " << commandToSend << "\n" <<
       // "currentJointPos: " << currentJointPos << "\n" << "amountToMove: " <<
       // amountToMove << "\n" << "maxVel: " << maxvel << "\n";
-    } else {
-      /// @todo TODO(ahundt) BUG: Need way to pass time to reach specified goal for position control and eliminate this allocation
-      lowLevelStepAlgorithmCommandParamsP.reset(new typename LowLevelStepAlgorithmType::Params());
     }
+    goalLock.unlock();
 
-    BOOST_VERIFY(lowLevelStepAlgorithmCommandParamsP != nullptr);
     boost::system::error_code send_ec, recv_ec;
     std::size_t send_bytes, recv_bytes;
     // sync with device over network
@@ -1200,6 +1376,7 @@ public:
     armState.clearCommands();
     boost::copy(range, std::back_inserter(armState.commandedPosition));
     boost::copy(range, std::back_inserter(armState.commandedPosition_goal));
+    goalChanged_ = true;
   }
 
   /**
@@ -1225,6 +1402,7 @@ public:
   void set(double duration_to_goal_command, time_duration_command_tag) {
     boost::lock_guard<boost::mutex> lock(jt_mutex);
     armState.goal_position_command_time_duration = duration_to_goal_command;
+    goalChanged_ = true;
   }
 
   /**
@@ -1325,6 +1503,9 @@ public:
 private:
   KukaState armState;
   boost::mutex jt_mutex;
+  /// a goal position or time was set since the last one was passed to the
+  /// low level driver
+  bool goalChanged_ = false;
 
   Params params_;
   std::shared_ptr<KUKA::FRI::ClientData> friData_;
@@ -0,0 +1,269 @@
+/// @file ArcLengthPath.hpp
+/// @brief Path of control points with precomputed arc length for fast sampling.
+///
+/// Replaces parsing and sampling V-REP paths in interpreted Lua, see grl.loadPathFile
+/// and grl.getPathPointInWorldFrame in src/lua/grl.lua.
+#ifndef _GRL_PATH_ARC_LENGTH_PATH_HPP_
+#define _GRL_PATH_ARC_LENGTH_PATH_HPP_
+
+#include <string>
+#include <vector>
+#include <array>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+#include <boost/algorithm/string.hpp>
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+
+namespace grl { namespace path {
+
+/// A single path control point, mirrors grl::flatbuffer::VrepControlPoint
+/// @see http://www.coppeliarobotics.com/helpFiles/en/pathImportExport.htm
+struct ControlPoint
+{
+    Eigen::Vector3d position = Eigen::Vector3d::Zero();
+    Eigen::Quaterniond orientation = Eigen::Quaterniond::Identity();
+    double relativeVelocity = 1.0;
+    int bezierPointCount = 1;
+    double interpolationFactor1 = 0.5;
+    double interpolationFactor2 = 0.5;
+    double virtualDistance = 0.0;
+    int auxiliaryFlags = 0;
+    std::array<double,4> auxiliaryChannels{{0.0, 0.0, 0.0, 0.0}};
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+typedef std::vector<ControlPoint,Eigen::aligned_allocator<ControlPoint>> ControlPoints;
+
+/// V-REP euler angles alpha, beta, gamma in radians to a quaternion
+/// @see http://www.coppeliarobotics.com/helpFiles/en/eulerAngles.htm
+inline Eigen::Quaterniond vrepEulerToQuaternion(double alpha, double beta, double gamma)
+{
+    return Eigen::AngleAxisd(alpha, Eigen::Vector3d::UnitX())
+         * Eigen::AngleAxisd(beta,  Eigen::Vector3d::UnitY())
+         * Eigen::AngleAxisd(gamma, Eigen::Vector3d::UnitZ());
+}
+
+/// @brief Path through control points that answers pose at distance queries in O(log n)
+///
+/// The cumulative arc length at every control point is computed once on construction,
+/// so a query is a binary search for the segment followed by linear interpolation of
+/// the position and spherical linear interpolation (slerp) of the orientation.
+/// Batch sampling of sorted distances walks the segments and is O(n + m).
+///
+/// Control points are connected by straight segments, which is what V-REP does
+/// for control points with a bezierPointCount of 1.
+class ArcLengthPath
+{
+public:
+
+    /// 7 values per sampled pose: x, y, z, qx, qy, qz, qw
+    static const std::size_t PoseStride = 7;
+
+    ArcLengthPath(){}
+
+    explicit ArcLengthPath(const ControlPoints& controlPoints)
+    : controlPoints_(controlPoints)
+    {
+        if(controlPoints_.empty())
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("ArcLengthPath: a path needs at least one control point"));
+        }
+
+        cumulativeLength_.reserve(controlPoints_.size());
+        cumulativeLength_.push_back(0.0);
+        for(std::size_t i = 1; i < controlPoints_.size(); ++i)
+        {
+            cumulativeLength_.push_back(cumulativeLength_.back() + (controlPoints_[i].position - controlPoints_[i-1].position).norm());
+        }
+    }
+
+    double length() const { return cumulativeLength_.empty() ? 0.0 : cumulativeLength_.back(); }
+
+    std::size_t size() const { return controlPoints_.size(); }
+
+    const ControlPoints& controlPoints() const { return controlPoints_; }
+
+    /// distance along the path at each control point
+    const std::vector<double>& cumulativeLength() const { return cumulativeLength_; }
+
+    /// @brief pose at a distance in meters from the start, clamped to the ends of the path
+    void poseAtDistance(double distance, Eigen::Vector3d& position, Eigen::Quaterniond& orientation) const
+    {
+        interpolate(segmentAtDistance(distance), distance, position, orientation);
+    }
+
+    /// @brief pose at a relative distance from the start at 0 to the end at 1
+    /// @see simGetPositionOnPath
+    void poseAtRelativeDistance(double relativeDistance, Eigen::Vector3d& position, Eigen::Quaterniond& orientation) const
+    {
+        poseAtDistance(relativeDistance * length(), position, orientation);
+    }
+
+    Eigen::Affine3d transformAtDistance(double distance) const
+    {
+        Eigen::Vector3d position;
+        Eigen::Quaterniond orientation;
+        poseAtDistance(distance, position, orientation);
+        Eigen::Affine3d transform = Eigen::Affine3d::Identity();
+        transform.translate(position);
+        transform.rotate(orientation);
+        return transform;
+    }
+
+    /// @brief sample poses at a range of distances, writing PoseStride values per pose
+    ///
+    /// Distances that are sorted in increasing order are sampled in a single
+    /// pass over the segments, otherwise each sample falls back to a binary search.
+    ///
+    /// @param out output iterator of double, for example into a std::vector<double> or a raw buffer
+    template<typename DistanceIterator, typename OutputIterator>
+    OutputIterator sample(DistanceIterator distanceBegin, DistanceIterator distanceEnd, OutputIterator out) const
+    {
+        Eigen::Vector3d position;
+        Eigen::Quaterniond orientation;
+        std::size_t segment = 0;
+        double previousDistance = -std::numeric_limits<double>::infinity();
+        for(; distanceBegin != distanceEnd; ++distanceBegin)
+        {
+            double distance = *distanceBegin;
+            if(distance >= previousDistance)
+            {
+                // advance from the previous segment, amortized O(1)
+                while(segment + 2 < cumulativeLength_.size() && cumulativeLength_[segment+1] < distance) ++segment;
+            }
+            else
+            {
+                segment = segmentAtDistance(distance);
+            }
+            previousDistance = distance;
+            interpolate(segment, distance, position, orientation);
+            out = writePose(position, orientation, out);
+        }
+        return out;
+    }
+
+    /// @brief sample count evenly spaced poses from startDistance to endDistance inclusive
+    template<typename OutputIterator>
+    OutputIterator sampleUniform(double startDistance, double endDistance, std::size_t count, OutputIterator out) const
+    {
+        std::vector<double> distances(count);
+        double step = (count > 1) ? (endDistance - startDistance) / double(count - 1) : 0.0;
+        for(std::size_t i = 0; i < count; ++i) distances[i] = startDistance + step * double(i);
+        return sample(distances.begin(), distances.end(), out);
+    }
+
+private:
+
+    /// index i of the segment from control point i to i+1 containing the distance
+    std::size_t segmentAtDistance(double distance) const
+    {
+        if(cumulativeLength_.size() < 2) return 0;
+        auto upper = std::upper_bound(cumulativeLength_.begin(), cumulativeLength_.end(), distance);
+        std::size_t segment = (upper == cumulativeLength_.begin()) ? 0 : std::size_t(std::distance(cumulativeLength_.begin(), upper) - 1);
+        return std::min(segment, cumulativeLength_.size() - 2);
+    }
+
+    void interpolate(std::size_t segment, double distance, Eigen::Vector3d& position, Eigen::Quaterniond& orientation) const
+    {
+        if(controlPoints_.empty())
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("ArcLengthPath: cannot sample an empty path"));
+        }
+        if(controlPoints_.size() == 1)
+        {
+            position = controlPoints_.front().position;
+            orientation = controlPoints_.front().orientation;
+            return;
+        }
+        const ControlPoint& a = controlPoints_[segment];
+        const ControlPoint& b = controlPoints_[segment+1];
+        double segmentLength = cumulativeLength_[segment+1] - cumulativeLength_[segment];
+        double t = (segmentLength > 0.0) ? (distance - cumulativeLength_[segment]) / segmentLength : 0.0;
+        t = std::min(std::max(t, 0.0), 1.0);
+        position = a.position + t * (b.position - a.position);
+        orientation = a.orientation.slerp(t, b.orientation);
+    }
+
+    template<typename OutputIterator>
+    static OutputIterator writePose(const Eigen::Vector3d& position, const Eigen::Quaterniond& orientation, OutputIterator out)
+    {
+        *out++ = position.x();
+        *out++ = position.y();
+        *out++ = position.z();
+        *out++ = orientation.x();
+        *out++ = orientation.y();
+        *out++ = orientation.z();
+        *out++ = orientation.w();
+        return out;
+    }
+
+    ControlPoints controlPoints_;
+    std::vector<double> cumulativeLength_;
+};
+
+/// @brief Load control points from a V-REP path text file, as used by grl.loadPathFile
+///
+/// Each line has 11 or 16 comma or whitespace separated values:
+/// x, y, z, alpha, beta, gamma (radians), relativeVelocity, bezierPointCount,
+/// interpolationFactor1, interpolationFactor2, virtualDistance and optionally
+/// auxiliaryFlags and auxiliaryChannel1 to 4.
+///
+/// @see http://www.coppeliarobotics.com/helpFiles/en/pathImportExport.htm
+inline ControlPoints loadVrepPathTextFile(const std::string& fileName)
+{
+    std::ifstream file(fileName);
+    if(!file)
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error(std::string("loadVrepPathTextFile: unable to open ") + fileName));
+    }
+
+    ControlPoints controlPoints;
+    std::string line;
+    std::vector<double> values;
+    std::size_t lineNumber = 0;
+    while(std::getline(file, line))
+    {
+        ++lineNumber;
+        std::replace(line.begin(), line.end(), ',', ' ');
+        boost::algorithm::trim(line);
+        if(line.empty()) continue;
+
+        values.clear();
+        std::istringstream iss(line);
+        double value;
+        while(iss >> value) values.push_back(value);
+        if(values.size() != 11 && values.size() != 16)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error(std::string("loadVrepPathTextFile: ") + fileName + " line " +
+                                  std::to_string(lineNumber) + " has " + std::to_string(values.size()) + " values but 11 or 16 are required"));
+        }
+
+        ControlPoint point;
+        point.position = Eigen::Vector3d(values[0], values[1], values[2]);
+        point.orientation = vrepEulerToQuaternion(values[3], values[4], values[5]);
+        point.relativeVelocity = values[6];
+        point.bezierPointCount = static_cast<int>(values[7]);
+        point.interpolationFactor1 = values[8];
+        point.interpolationFactor2 = values[9];
+        point.virtualDistance = values[10];
+        if(values.size() == 16)
+        {
+            point.auxiliaryFlags = static_cast<int>(values[11]);
+            std::copy(values.begin() + 12, values.end(), point.auxiliaryChannels.begin());
+        }
+        controlPoints.push_back(point);
+    }
+    return controlPoints;
+}
+
+}} // grl::path
+
+#endif // _GRL_PATH_ARC_LENGTH_PATH_HPP_
@@ -0,0 +1,125 @@
+/// @file ForceControlledVelocity.hpp
+/// @brief Force feedback velocity law for following a path while cutting.
+///
+/// Replaces calcToolTipForce and fcv from robone.cutBoneScript in src/lua/robone.lua,
+/// so the controller runs in the plugin update instead of a lua thread.
+#ifndef _GRL_PATH_FORCE_CONTROLLED_VELOCITY_HPP_
+#define _GRL_PATH_FORCE_CONTROLLED_VELOCITY_HPP_
+
+#include <string>
+#include <tuple>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+#include <Eigen/Core>
+#include <Eigen/SVD>
+
+namespace grl { namespace path {
+
+/// @brief estimate the wrench at the tool tip from the external joint torques
+///
+/// Solves tau = J^T * F for F in the least squares sense, which is the
+/// pseudo-inverse of the transposed Jacobian applied to the torques.
+///
+/// @param jacobian 6xN geometric jacobian of the tool tip, translation rows first then rotation rows
+/// @param externalTorque N external joint torques, for example from the KUKA FRI driver
+/// @return force x,y,z followed by torque x,y,z at the tool tip
+inline Eigen::Matrix<double,6,1> externalTorqueToToolTipWrench(const Eigen::MatrixXd& jacobian, const Eigen::VectorXd& externalTorque)
+{
+    if(jacobian.rows() != 6 || jacobian.cols() != externalTorque.size())
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error("externalTorqueToToolTipWrench: the jacobian must be 6xN for N external joint torques"));
+    }
+    Eigen::JacobiSVD<Eigen::MatrixXd> svd(jacobian.transpose(), Eigen::ComputeThinU | Eigen::ComputeThinV);
+    return svd.solve(externalTorque);
+}
+
+/// @brief Velocity along a path that slows down as the measured cutting force rises
+///
+/// At zero force the path is followed at MaxVelocity and at MaxForce or above the
+/// motion stops. ForceToVelocityModel selects how the velocity falls in between:
+///
+///  - "LOG"  v = MaxVelocity * log(MaxForce + 1 - f) / log(MaxForce + 1)
+///  - "SQRT" v = MaxVelocity * sqrt(1 - f / MaxForce)
+///
+/// usage:
+/// @code
+///    grl::path::ForceControlledVelocity fcv;
+///    distance = fcv.step(distance, measuredForce, timeStep, pathLength);
+/// @endcode
+class ForceControlledVelocity
+{
+public:
+
+    enum ParamIndex {
+        MaxVelocity,          ///< meters per second along the path
+        MaxForce,             ///< newtons at the tool tip where motion stops
+        ForceToVelocityModel  ///< options are LOG, SQRT
+    };
+
+    typedef std::tuple<
+        double,
+        double,
+        std::string
+        > Params;
+
+    static const Params defaultParams()
+    {
+        return std::make_tuple(
+                    0.04   , // MaxVelocity
+                    30.0   , // MaxForce
+                    "LOG"    // ForceToVelocityModel
+               );
+    }
+
+    ForceControlledVelocity(Params params = defaultParams())
+    : params_(params)
+    {
+        if(std::get<MaxVelocity>(params_) < 0.0 || std::get<MaxForce>(params_) <= 0.0)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("ForceControlledVelocity: MaxVelocity must be non negative and MaxForce must be positive"));
+        }
+        const std::string& model = std::get<ForceToVelocityModel>(params_);
+        if(model != "LOG" && model != "SQRT")
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error(std::string("ForceControlledVelocity: unknown ForceToVelocityModel ") + model + ", options are LOG and SQRT"));
+        }
+        useLogModel_ = (model == "LOG");
+    }
+
+    /// @return velocity along the path in meters per second for the measured tool tip force magnitude
+    double velocity(double measuredForce) const
+    {
+        const double maxVelocity = std::get<MaxVelocity>(params_);
+        const double maxForce = std::get<MaxForce>(params_);
+        const double force = std::min(std::max(measuredForce, 0.0), maxForce);
+        if(useLogModel_)
+        {
+            return maxVelocity * std::log(maxForce + 1.0 - force) / std::log(maxForce + 1.0);
+        }
+        return maxVelocity * std::sqrt(1.0 - force / maxForce);
+    }
+
+    /// @brief advance the distance along the path by one time step
+    /// @param distance current distance from the start of the path in meters
+    /// @param timeStep seconds since the previous step
+    /// @param pathLength total path length in meters, the result is clamped to it
+    /// @return the new distance from the start of the path in meters
+    double step(double distance, double measuredForce, double timeStep, double pathLength) const
+    {
+        return std::min(distance + velocity(measuredForce) * std::max(timeStep, 0.0), pathLength);
+    }
+
+    const Params& getParams() const { return params_; }
+
+private:
+    Params params_;
+    bool useLogModel_;
+};
+
+}} // grl::path
+
+#endif // _GRL_PATH_FORCE_CONTROLLED_VELOCITY_HPP_
@@ -0,0 +1,188 @@
+/// @file JointTrajectory.hpp
+/// @brief Timed joint space waypoints that can be sampled at any time, for streaming to an arm driver.
+#ifndef _GRL_PATH_JOINT_TRAJECTORY_HPP_
+#define _GRL_PATH_JOINT_TRAJECTORY_HPP_
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+
+namespace grl { namespace path {
+
+/// @brief Joint positions at increasing times from the start of a motion
+///
+/// Mirrors the positions, velocities and time_from_start of the points of a
+/// trajectory_msgs::JointTrajectory without depending on ROS. Between two waypoints
+/// that both have velocities the joints follow the cubic Hermite spline through the
+/// positions and velocities, as ROS joint trajectory controllers do, otherwise they
+/// move linearly.
+///
+/// sample() finds the segment with a binary search, except when the time is in the
+/// segment of the previous call or the one after it, which is the case when a driver
+/// streams the trajectory in its control loop, so streaming is O(1) per sample.
+/// That remembered segment means one trajectory must not be sampled from several
+/// threads at once.
+///
+/// usage:
+/// @code
+///    grl::path::JointTrajectory trajectory(7);
+///    trajectory.addWaypoint(0.0, currentJointAngles);
+///    trajectory.addWaypoint(2.0, goalJointAngles);
+///    // in the control loop
+///    trajectory.sample(secondsSinceStart, commandedJointAngles);
+/// @endcode
+class JointTrajectory
+{
+public:
+
+    explicit JointTrajectory(std::size_t jointCount = 0)
+    : jointCount_(jointCount), segment_(0)
+    {
+    }
+
+    std::size_t jointCount() const { return jointCount_; }
+    std::size_t size() const { return times_.size(); }
+    bool empty() const { return times_.empty(); }
+
+    /// seconds from the start to the last waypoint
+    double duration() const { return times_.empty() ? 0.0 : times_.back(); }
+
+    /// seconds from the start to waypoint i
+    double time(std::size_t i) const { return times_[i]; }
+
+    /// the joint positions of waypoint i
+    std::vector<double> positions(std::size_t i) const
+    {
+        return std::vector<double>(positions_.begin() + i * jointCount_, positions_.begin() + (i + 1) * jointCount_);
+    }
+
+    void reserve(std::size_t waypoints)
+    {
+        times_.reserve(waypoints);
+        positions_.reserve(waypoints * jointCount_);
+        velocities_.reserve(waypoints * jointCount_);
+        hasVelocities_.reserve(waypoints);
+    }
+
+    void clear()
+    {
+        times_.clear();
+        positions_.clear();
+        velocities_.clear();
+        hasVelocities_.clear();
+        segment_ = 0;
+    }
+
+    /// @brief append a waypoint
+    /// @param time seconds from the start of the motion, not before the previous waypoint
+    /// @param positions one position per joint
+    /// @param velocities one velocity per joint, or empty when unknown
+    void addWaypoint(double time, const std::vector<double>& positions,
+                     const std::vector<double>& velocities = std::vector<double>())
+    {
+        if(positions.size() != jointCount_)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("JointTrajectory: a waypoint has the wrong number of joint positions"));
+        }
+        if(!velocities.empty() && velocities.size() != jointCount_)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("JointTrajectory: a waypoint has the wrong number of joint velocities"));
+        }
+        if(!(time >= 0.0) || (!times_.empty() && time < times_.back()))
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("JointTrajectory: waypoint times must start at or after 0 and never decrease"));
+        }
+        times_.push_back(time);
+        positions_.insert(positions_.end(), positions.begin(), positions.end());
+        hasVelocities_.push_back(!velocities.empty());
+        if(velocities.empty()) velocities_.insert(velocities_.end(), jointCount_, 0.0);
+        else velocities_.insert(velocities_.end(), velocities.begin(), velocities.end());
+    }
+
+    /// @brief joint positions at a time from the start
+    ///
+    /// Times before the first waypoint give the first waypoint and times after the
+    /// last give the last, so a driver can keep sampling a finished trajectory.
+    ///
+    /// @param positions resized to jointCount() and set
+    void sample(double time, std::vector<double>& positions) const
+    {
+        if(times_.empty())
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("JointTrajectory: cannot sample a trajectory without waypoints"));
+        }
+        positions.resize(jointCount_);
+
+        const std::size_t last = times_.size() - 1;
+        if(time <= times_.front() || last == 0)
+        {
+            std::copy(positions_.begin(), positions_.begin() + jointCount_, positions.begin());
+            return;
+        }
+        if(time >= times_.back())
+        {
+            std::copy(positions_.begin() + last * jointCount_, positions_.end(), positions.begin());
+            return;
+        }
+
+        const std::size_t i = findSegment(time);
+        const double t0 = times_[i];
+        const double h = times_[i+1] - t0;
+        const double* p0 = &positions_[i * jointCount_];
+        const double* p1 = &positions_[(i+1) * jointCount_];
+        if(h <= 0.0)
+        {
+            std::copy(p1, p1 + jointCount_, positions.begin());
+            return;
+        }
+
+        const double s = (time - t0) / h;
+        if(hasVelocities_[i] && hasVelocities_[i+1])
+        {
+            const double* v0 = &velocities_[i * jointCount_];
+            const double* v1 = &velocities_[(i+1) * jointCount_];
+            const double s2 = s * s;
+            const double s3 = s2 * s;
+            const double h00 = 2.0*s3 - 3.0*s2 + 1.0;
+            const double h10 = s3 - 2.0*s2 + s;
+            const double h01 = -2.0*s3 + 3.0*s2;
+            const double h11 = s3 - s2;
+            for(std::size_t j = 0; j < jointCount_; ++j)
+            {
+                positions[j] = h00*p0[j] + h10*h*v0[j] + h01*p1[j] + h11*h*v1[j];
+            }
+        }
+        else
+        {
+            for(std::size_t j = 0; j < jointCount_; ++j) positions[j] = p0[j] + s * (p1[j] - p0[j]);
+        }
+    }
+
+private:
+
+    /// index of the waypoint starting the segment containing time, times_.front() < time < times_.back()
+    std::size_t findSegment(double time) const
+    {
+        // streaming mostly stays in the same segment or moves to the next
+        for(std::size_t i = segment_; i < std::min(segment_ + 2, times_.size() - 1); ++i)
+        {
+            if(times_[i] <= time && time < times_[i+1]) return segment_ = i;
+        }
+        const std::size_t upper = std::upper_bound(times_.begin(), times_.end(), time) - times_.begin();
+        return segment_ = upper - 1;
+    }
+
+    std::size_t jointCount_;
+    std::vector<double> times_;
+    std::vector<double> positions_;  ///< jointCount_ per waypoint
+    std::vector<double> velocities_; ///< jointCount_ per waypoint, zero when unknown
+    std::vector<bool> hasVelocities_;
+    mutable std::size_t segment_;    ///< segment of the last sample, where the next one most likely is
+};
+
+}} // grl::path
+
+#endif // _GRL_PATH_JOINT_TRAJECTORY_HPP_
@@ -0,0 +1,449 @@
+/// @file TimeOptimalParameterization.hpp
+/// @brief Retime a joint space path to be as fast as joint velocity and acceleration limits allow.
+#ifndef _GRL_PATH_TIME_OPTIMAL_PARAMETERIZATION_HPP_
+#define _GRL_PATH_TIME_OPTIMAL_PARAMETERIZATION_HPP_
+
+#include <tuple>
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+
+#include "grl/path/JointTrajectory.hpp"
+
+namespace grl { namespace path {
+
+/// @brief Time optimal path parameterization (TOPP) by reachability analysis
+///
+/// The waypoints are joined by a natural cubic spline q(s), parameterized by the
+/// cumulative joint space distance s between waypoints, so the path is smooth and
+/// passes through every waypoint. Any timing in the input is ignored. Along a path
+/// the joint velocities and accelerations are
+///
+///     dq/dt = q'(s) s_dot        d2q/dt2 = q''(s) s_dot^2 + q'(s) s_ddot
+///
+/// which are linear in x = s_dot^2 and u = s_ddot, with dx/ds = 2u. On a grid
+/// over s that includes every waypoint this makes every limit a linear constraint
+/// on (x, u) at each grid point.
+/// A backward pass finds the largest x at each grid point from which the end can
+/// still be reached at rest, then a forward pass accelerates as hard as allowed
+/// while staying under it, as in TOPP-RA by Pham and Pham, IEEE T-RO 2018. The
+/// result is the fastest motion that starts and ends at rest and keeps to the
+/// limits at the grid points.
+///
+/// Only VelocityScaling and AccelerationScaling of each limit are used, so a
+/// margin can be left for the arm to track the commands. A spline can overshoot
+/// between waypoints, so when position limits are given retime() checks the
+/// whole spline against them and throws instead of leaving them.
+///
+/// Computation is O(GridPoints * joints) with a small constant, well under a
+/// millisecond for typical planner output. Buffers are members reused between
+/// calls, so keep one instance per thread.
+///
+/// usage:
+/// @code
+///    grl::path::TimeOptimalParameterization::Params params = grl::path::TimeOptimalParameterization::defaultParams();
+///    std::get<grl::path::TimeOptimalParameterization::VelocityLimits>(params) = velocityLimits;
+///    std::get<grl::path::TimeOptimalParameterization::AccelerationLimits>(params) = accelerationLimits;
+///    grl::path::TimeOptimalParameterization topp(params);
+///    grl::path::JointTrajectory retimed;
+///    topp.retime(plannedPath, retimed);
+///    // retimed has a waypoint with position and velocity at every grid point
+/// @endcode
+class TimeOptimalParameterization
+{
+public:
+
+    enum ParamIndex {
+        VelocityLimits,     ///< rad/s, largest joint speed of each joint
+        AccelerationLimits, ///< rad/s^2, largest joint acceleration of each joint
+        GridPoints,         ///< about how many points along the path the limits are enforced at, every waypoint is one
+        VelocityScaling,    ///< fraction of each velocity limit used, greater than 0 and at most 1
+        AccelerationScaling,///< fraction of each acceleration limit used, greater than 0 and at most 1
+        PositionLowerLimits,///< rad, smallest angle of each joint, empty to skip the check
+        PositionUpperLimits ///< rad, largest angle of each joint, empty to skip the check
+    };
+
+    typedef std::tuple<
+        std::vector<double>,
+        std::vector<double>,
+        int,
+        double,
+        double,
+        std::vector<double>,
+        std::vector<double>
+        > Params;
+
+    static const Params defaultParams()
+    {
+        return std::make_tuple(
+                    std::vector<double>(), // VelocityLimits
+                    std::vector<double>(), // AccelerationLimits
+                    200,                   // GridPoints
+                    1.0,                   // VelocityScaling
+                    1.0,                   // AccelerationScaling
+                    std::vector<double>(), // PositionLowerLimits
+                    std::vector<double>()  // PositionUpperLimits
+               );
+    }
+
+    explicit TimeOptimalParameterization(Params params = defaultParams())
+    {
+        setParams(params);
+    }
+
+    void setParams(const Params& params)
+    {
+        const std::vector<double>& velocity = std::get<VelocityLimits>(params);
+        const std::vector<double>& acceleration = std::get<AccelerationLimits>(params);
+        if(velocity.size() != acceleration.size())
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TimeOptimalParameterization: there must be one velocity and one acceleration limit per joint"));
+        }
+        for(std::size_t j = 0; j < velocity.size(); ++j)
+        {
+            if(!(velocity[j] > 0.0) || !(acceleration[j] > 0.0))
+            {
+                BOOST_THROW_EXCEPTION(std::runtime_error("TimeOptimalParameterization: velocity and acceleration limits must be positive"));
+            }
+        }
+        if(std::get<GridPoints>(params) < 3)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TimeOptimalParameterization: GridPoints must be at least 3"));
+        }
+        const double velocityScaling = std::get<VelocityScaling>(params);
+        const double accelerationScaling = std::get<AccelerationScaling>(params);
+        if(!(velocityScaling > 0.0 && velocityScaling <= 1.0) || !(accelerationScaling > 0.0 && accelerationScaling <= 1.0))
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TimeOptimalParameterization: VelocityScaling and AccelerationScaling must be greater than 0 and at most 1"));
+        }
+        const std::vector<double>& lower = std::get<PositionLowerLimits>(params);
+        const std::vector<double>& upper = std::get<PositionUpperLimits>(params);
+        if(lower.size() != upper.size() || (!lower.empty() && lower.size() != velocity.size()))
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TimeOptimalParameterization: position limits must be empty or have one lower and one upper limit per joint"));
+        }
+        params_ = params;
+        vmax_.resize(velocity.size());
+        amax_.resize(acceleration.size());
+        for(std::size_t j = 0; j < velocity.size(); ++j)
+        {
+            vmax_[j] = velocity[j] * velocityScaling;
+            amax_[j] = acceleration[j] * accelerationScaling;
+        }
+    }
+
+    const Params& getParams() const { return params_; }
+
+    /// @brief the fastest timing of the path through the waypoints of path
+    ///
+    /// @param path waypoints, only their positions are used
+    /// @param trajectory output, a waypoint with position and velocity at each grid point,
+    ///        or a single waypoint if path does not move
+    /// @throws std::runtime_error if position limits are set and the spline leaves them,
+    ///         trajectory is then empty
+    void retime(const JointTrajectory& path, JointTrajectory& trajectory)
+    {
+        const std::vector<double>& vmax = vmax_;
+        const std::vector<double>& amax = amax_;
+        dof_ = vmax.size();
+        if(path.jointCount() != dof_)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TimeOptimalParameterization: the path and the limits have different numbers of joints"));
+        }
+        if(path.empty())
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TimeOptimalParameterization: the path has no waypoints"));
+        }
+
+        if(trajectory.jointCount() == dof_) trajectory.clear();
+        else trajectory = JointTrajectory(dof_);
+        const bool moves = buildSpline(path);
+        checkPositionLimits();
+        if(!moves)
+        {
+            trajectory.addWaypoint(0.0, path.positions(0), std::vector<double>(dof_, 0.0));
+            return;
+        }
+
+        // grid points evenly spaced within each spline segment, including every waypoint
+        const std::size_t segments = knots_.size() - 1;
+        const double spacing = knots_.back() / (std::get<GridPoints>(params_) - 1);
+        grid_.clear();
+        for(std::size_t k = 0; k < segments; ++k)
+        {
+            const double h = knots_[k + 1] - knots_[k];
+            const int steps = std::max(2, static_cast<int>(std::ceil(h / spacing - 1e-9)));
+            for(int step = 0; step < steps; ++step) grid_.push_back(knots_[k] + h * step / steps);
+        }
+        grid_.push_back(knots_.back());
+
+        // derivatives of the path at each grid point
+        const int n = static_cast<int>(grid_.size());
+        q_.resize(n * dof_);
+        dq_.resize(n * dof_);
+        ddq_.resize(n * dof_);
+        std::size_t segment = 0;
+        for(int i = 0; i < n; ++i)
+        {
+            while(segment + 2 < knots_.size() && grid_[i] >= knots_[segment + 1]) ++segment;
+            evaluate(segment, grid_[i], &q_[i * dof_], &dq_[i * dof_], &ddq_[i * dof_]);
+        }
+
+        // backward pass, the largest s_dot^2 at each grid point that can still stop at the end
+        reachable_.assign(n, 0.0);
+        for(int i = n - 2; i >= 0; --i)
+        {
+            reachable_[i] = largestFeasible(i, reachable_[i + 1], vmax, amax);
+        }
+
+        // forward pass, accelerate as hard as the limits and the backward pass allow
+        x_.assign(n, 0.0);
+        for(int i = 0; i + 1 < n; ++i)
+        {
+            double uMin, uMax;
+            if(!accelerationBounds(i, x_[i], amax, uMin, uMax)) uMax = 0.0;
+            const double ds = grid_[i + 1] - grid_[i];
+            const double u = std::min(uMax, (reachable_[i + 1] - x_[i]) / (2.0 * ds));
+            x_[i + 1] = std::max(0.0, std::min(reachable_[i + 1], x_[i] + 2.0 * ds * u));
+        }
+
+        trajectory.reserve(n);
+        std::vector<double> position(dof_), velocity(dof_);
+        double time = 0.0;
+        for(int i = 0; i < n; ++i)
+        {
+            if(i > 0)
+            {
+                // constant s_ddot over the step
+                const double speeds = std::sqrt(x_[i - 1]) + std::sqrt(x_[i]);
+                if(!(speeds > 0.0))
+                {
+                    BOOST_THROW_EXCEPTION(std::runtime_error("TimeOptimalParameterization: the limits do not allow moving along the path"));
+                }
+                time += 2.0 * (grid_[i] - grid_[i - 1]) / speeds;
+            }
+            const double sDot = std::sqrt(x_[i]);
+            for(std::size_t j = 0; j < dof_; ++j)
+            {
+                position[j] = q_[i * dof_ + j];
+                velocity[j] = dq_[i * dof_ + j] * sDot;
+            }
+            trajectory.addWaypoint(time, position, velocity);
+        }
+    }
+
+private:
+
+    /// @brief natural cubic spline through the distinct waypoints of path
+    /// @return false if the path does not move
+    bool buildSpline(const JointTrajectory& path)
+    {
+        knots_.clear();
+        points_.clear();
+        std::vector<double> previous;
+        for(std::size_t w = 0; w < path.size(); ++w)
+        {
+            std::vector<double> position = path.positions(w);
+            double distance = 0.0;
+            if(!previous.empty())
+            {
+                for(std::size_t j = 0; j < dof_; ++j) distance += (position[j] - previous[j]) * (position[j] - previous[j]);
+                distance = std::sqrt(distance);
+                if(distance < 1e-12) continue;
+            }
+            knots_.push_back(knots_.empty() ? 0.0 : knots_.back() + distance);
+            points_.insert(points_.end(), position.begin(), position.end());
+            previous.swap(position);
+        }
+        const std::size_t k = knots_.size();
+        if(k < 2) return false;
+
+        // second derivatives M at the knots, zero at both ends, from the tridiagonal system per joint
+        secondDerivatives_.assign(k * dof_, 0.0);
+        if(k == 2) return true;
+        diagonal_.resize(k);
+        rhs_.resize(k);
+        for(std::size_t j = 0; j < dof_; ++j)
+        {
+            for(std::size_t i = 1; i + 1 < k; ++i)
+            {
+                const double h0 = knots_[i] - knots_[i - 1];
+                const double h1 = knots_[i + 1] - knots_[i];
+                diagonal_[i] = 2.0 * (h0 + h1);
+                rhs_[i] = 6.0 * ((point(i + 1, j) - point(i, j)) / h1 - (point(i, j) - point(i - 1, j)) / h0);
+                if(i > 1)
+                {
+                    // eliminate the sub diagonal h0 using the previous row
+                    const double factor = h0 / diagonal_[i - 1];
+                    diagonal_[i] -= factor * h0;
+                    rhs_[i] -= factor * rhs_[i - 1];
+                }
+            }
+            for(std::size_t i = k - 2; i >= 1; --i)
+            {
+                const double h1 = knots_[i + 1] - knots_[i];
+                const double next = (i + 2 < k) ? secondDerivatives_[(i + 1) * dof_ + j] : 0.0;
+                secondDerivatives_[i * dof_ + j] = (rhs_[i] - h1 * next) / diagonal_[i];
+            }
+        }
+        return true;
+    }
+
+    double point(std::size_t knot, std::size_t joint) const { return points_[knot * dof_ + joint]; }
+
+    /// @brief throw if the spline leaves the position limits anywhere, including between grid points
+    void checkPositionLimits() const
+    {
+        const std::vector<double>& lower = std::get<PositionLowerLimits>(params_);
+        const std::vector<double>& upper = std::get<PositionUpperLimits>(params_);
+        if(lower.empty()) return;
+        const double tolerance = 1e-9;
+        for(std::size_t j = 0; j < dof_; ++j)
+        {
+            double smallest = point(0, j);
+            double largest = smallest;
+            for(std::size_t k = 0; k + 1 < knots_.size(); ++k)
+            {
+                // the extremes of a cubic segment are at its ends or where q' = b + 2c t + 3d t^2 is zero
+                const double h = knots_[k + 1] - knots_[k];
+                double b, c, d;
+                coefficients(k, j, b, c, d);
+                double roots[2];
+                int rootCount = 0;
+                if(std::abs(d) < 1e-15)
+                {
+                    if(std::abs(c) > 1e-15) roots[rootCount++] = -b / (2.0 * c);
+                }
+                else
+                {
+                    const double discriminant = c * c - 3.0 * b * d;
+                    if(discriminant >= 0.0)
+                    {
+                        roots[rootCount++] = (-c + std::sqrt(discriminant)) / (3.0 * d);
+                        roots[rootCount++] = (-c - std::sqrt(discriminant)) / (3.0 * d);
+                    }
+                }
+                const double end = point(k + 1, j);
+                smallest = std::min(smallest, end);
+                largest = std::max(largest, end);
+                for(int r = 0; r < rootCount; ++r)
+                {
+                    const double t = roots[r];
+                    if(!(t > 0.0 && t < h)) continue;
+                    const double q = point(k, j) + t * (b + t * (c + t * d));
+                    smallest = std::min(smallest, q);
+                    largest = std::max(largest, q);
+                }
+            }
+            if(smallest < lower[j] - tolerance || largest > upper[j] + tolerance)
+            {
+                BOOST_THROW_EXCEPTION(std::runtime_error("TimeOptimalParameterization: the path through the waypoints leaves the joint position limits"));
+            }
+        }
+    }
+
+    /// the spline segment starting at knot k is point(k, j) + b t + c t^2 + d t^3
+    void coefficients(std::size_t k, std::size_t j, double& b, double& c, double& d) const
+    {
+        const double h = knots_[k + 1] - knots_[k];
+        const double m0 = secondDerivatives_[k * dof_ + j];
+        const double m1 = secondDerivatives_[(k + 1) * dof_ + j];
+        b = (point(k + 1, j) - point(k, j)) / h - h * (2.0 * m0 + m1) / 6.0;
+        c = 0.5 * m0;
+        d = (m1 - m0) / (6.0 * h);
+    }
+
+    /// q, q' and q'' at s in the spline segment starting at knot k
+    void evaluate(std::size_t k, double s, double* q, double* dq, double* ddq) const
+    {
+        const double t = s - knots_[k];
+        for(std::size_t j = 0; j < dof_; ++j)
+        {
+            double b, c, d;
+            coefficients(k, j, b, c, d);
+            q[j] = point(k, j) + t * (b + t * (c + t * d));
+            dq[j] = b + t * (2.0 * c + 3.0 * t * d);
+            ddq[j] = 2.0 * c + 6.0 * t * d;
+        }
+    }
+
+    /// @brief the range of s_ddot the acceleration limits allow at grid point i moving with s_dot^2 = x
+    /// @return false if no s_ddot keeps every joint within its limit
+    bool accelerationBounds(int i, double x, const std::vector<double>& amax, double& uMin, double& uMax) const
+    {
+        uMin = -std::numeric_limits<double>::infinity();
+        uMax = std::numeric_limits<double>::infinity();
+        for(std::size_t j = 0; j < dof_; ++j)
+        {
+            // -amax <= q'' x + q' u <= amax
+            const double dq = dq_[i * dof_ + j];
+            const double curvature = ddq_[i * dof_ + j] * x;
+            if(std::abs(dq) < 1e-12)
+            {
+                if(std::abs(curvature) > amax[j]) return false;
+                continue;
+            }
+            double lower = (-amax[j] - curvature) / dq;
+            double upper = (amax[j] - curvature) / dq;
+            if(dq < 0.0) std::swap(lower, upper);
+            uMin = std::max(uMin, lower);
+            uMax = std::min(uMax, upper);
+        }
+        return uMin <= uMax;
+    }
+
+    /// @brief the largest s_dot^2 at grid point i within the limits from which next is reachable at i + 1
+    ///
+    /// The (x, u) that satisfy the linear constraints form a convex set containing
+    /// x = 0, so the feasible x form an interval starting at 0 and bisection finds its end.
+    double largestFeasible(int i, double next, const std::vector<double>& vmax, const std::vector<double>& amax) const
+    {
+        double upper = std::numeric_limits<double>::infinity();
+        for(std::size_t j = 0; j < dof_; ++j)
+        {
+            const double dq = std::abs(dq_[i * dof_ + j]);
+            if(dq > 1e-12) upper = std::min(upper, (vmax[j] / dq) * (vmax[j] / dq));
+        }
+
+        const double ds = grid_[i + 1] - grid_[i];
+        auto feasible = [&](double x) {
+            double uMin, uMax;
+            if(!accelerationBounds(i, x, amax, uMin, uMax)) return false;
+            // some u must land in [0, next] at the following grid point
+            return x + 2.0 * ds * uMin <= next && x + 2.0 * ds * uMax >= 0.0;
+        };
+        if(feasible(upper)) return upper;
+
+        double lower = 0.0;
+        for(int iteration = 0; iteration < 60 && upper - lower > 1e-12 * upper; ++iteration)
+        {
+            const double middle = 0.5 * (lower + upper);
+            if(feasible(middle)) lower = middle;
+            else upper = middle;
+        }
+        return lower;
+    }
+
+    Params params_;
+    std::vector<double> vmax_;              ///< velocity limits times VelocityScaling
+    std::vector<double> amax_;              ///< acceleration limits times AccelerationScaling
+    std::size_t dof_ = 0;
+    std::vector<double> knots_;             ///< path distance of each distinct waypoint
+    std::vector<double> points_;            ///< dof_ positions per knot
+    std::vector<double> secondDerivatives_; ///< dof_ spline second derivatives per knot
+    std::vector<double> diagonal_;
+    std::vector<double> rhs_;
+    std::vector<double> grid_;              ///< path distance of each grid point
+    std::vector<double> q_, dq_, ddq_;      ///< dof_ values per grid point
+    std::vector<double> reachable_;         ///< largest s_dot^2 per grid point from the backward pass
+    std::vector<double> x_;                 ///< s_dot^2 per grid point from the forward pass
+};
+
+}} // grl::path
+
+#endif // _GRL_PATH_TIME_OPTIMAL_PARAMETERIZATION_HPP_
@@ -0,0 +1,87 @@
+/// @file VrepPathFlatbuffer.hpp
+/// @brief Load ArcLengthPath control points from VrepPath flatbuffers.
+#ifndef _GRL_PATH_VREP_PATH_FLATBUFFER_HPP_
+#define _GRL_PATH_VREP_PATH_FLATBUFFER_HPP_
+
+#include <string>
+
+#include <flatbuffers/util.h>
+
+#include "grl/flatbuffer/VrepPath_generated.h"
+#include "grl/path/ArcLengthPath.hpp"
+
+namespace grl { namespace path {
+
+/// Convert a VrepControlPoint flatbuffer, its euler angles are in degrees
+inline ControlPoint toControlPoint(const grl::flatbuffer::VrepControlPoint& fbPoint)
+{
+    const double degToRad = M_PI / 180.0;
+    ControlPoint point;
+    if(fbPoint.position())
+    {
+        point.position = Eigen::Vector3d(fbPoint.position()->x(), fbPoint.position()->y(), fbPoint.position()->z());
+    }
+    if(fbPoint.rotation())
+    {
+        point.orientation = vrepEulerToQuaternion(fbPoint.rotation()->rx() * degToRad,
+                                                  fbPoint.rotation()->ry() * degToRad,
+                                                  fbPoint.rotation()->rz() * degToRad);
+    }
+    point.relativeVelocity = fbPoint.relativeVelocity();
+    point.bezierPointCount = fbPoint.bezierPointCount();
+    point.interpolationFactor1 = fbPoint.interpolationFactor1();
+    point.interpolationFactor2 = fbPoint.interpolationFactor2();
+    point.virtualDistance = fbPoint.virtualDistance();
+    point.auxiliaryFlags = fbPoint.auxiliaryFlags();
+    point.auxiliaryChannels = {{fbPoint.auxiliaryChannel1(), fbPoint.auxiliaryChannel2(),
+                                fbPoint.auxiliaryChannel3(), fbPoint.auxiliaryChannel4()}};
+    return point;
+}
+
+/// Convert all control points of a VrepPath flatbuffer
+inline ControlPoints toControlPoints(const grl::flatbuffer::VrepPath& fbPath)
+{
+    ControlPoints controlPoints;
+    if(fbPath.controlPoints())
+    {
+        controlPoints.reserve(fbPath.controlPoints()->size());
+        for(const grl::flatbuffer::VrepControlPoint* fbPoint : *fbPath.controlPoints())
+        {
+            controlPoints.push_back(toControlPoint(*fbPoint));
+        }
+    }
+    return controlPoints;
+}
+
+/// @brief Load control points from a binary VrepPath flatbuffer file, the buffer is verified first
+inline ControlPoints loadVrepPathFlatbufferFile(const std::string& fileName)
+{
+    std::string buffer;
+    if(!flatbuffers::LoadFile(fileName.c_str(), true, &buffer))
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error(std::string("loadVrepPathFlatbufferFile: unable to open ") + fileName));
+    }
+    flatbuffers::Verifier verifier(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+    if(!grl::flatbuffer::VerifyVrepPathBuffer(verifier))
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error(std::string("loadVrepPathFlatbufferFile: ") + fileName + " is not a valid VrepPath flatbuffer"));
+    }
+    return toControlPoints(*grl::flatbuffer::GetVrepPath(buffer.data()));
+}
+
+/// @brief Load control points from a VrepPath flatbuffer or a V-REP path text file
+///
+/// Files ending in .csv or .txt are loaded as text, everything else as a flatbuffer.
+inline ControlPoints loadVrepPathFile(const std::string& fileName)
+{
+    std::string lower = boost::algorithm::to_lower_copy(fileName);
+    if(boost::algorithm::ends_with(lower, ".csv") || boost::algorithm::ends_with(lower, ".txt"))
+    {
+        return loadVrepPathTextFile(fileName);
+    }
+    return loadVrepPathFlatbufferFile(fileName);
+}
+
+}} // grl::path
+
+#endif // _GRL_PATH_VREP_PATH_FLATBUFFER_HPP_
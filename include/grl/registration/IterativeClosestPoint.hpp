@@ -0,0 +1,436 @@
+/// @file IterativeClosestPoint.hpp
+/// @brief Rigid registration of measured points to a TargetModel with robust or sparse ICP.
+///
+/// Adapted from the SICP and ICP namespaces of "Sparse Iterative Closest Point"
+/// by Sofien Bouaziz, Andrea Tagliasacchi, Mark Pauly, Copyright (C) 2013 LGG, EPFL.
+#ifndef _GRL_REGISTRATION_ITERATIVE_CLOSEST_POINT_HPP_
+#define _GRL_REGISTRATION_ITERATIVE_CLOSEST_POINT_HPP_
+
+#include <tuple>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "grl/registration/TargetModel.hpp"
+#include "grl/registration/RigidMotionEstimator.hpp"
+
+namespace grl { namespace registration {
+
+namespace detail {
+
+/// Shrinkage operator of the sparse ICP proximal step, unrolled I times
+template<unsigned int I>
+inline double shrinkage(double mu, double n, double p, double s)
+{
+    return shrinkage<I-1>(mu, n, p, 1.0 - (p/mu)*std::pow(n, p-2.0)*std::pow(s, p-1.0));
+}
+
+template<>
+inline double shrinkage<0>(double, double, double, double s) { return s; }
+
+/// shrink the norm of each column of Q towards zero, point to point
+inline void shrink(Eigen::Matrix3Xd& Q, double mu, double p)
+{
+    const double Ba = std::pow((2.0/mu)*(1.0-p), 1.0/(2.0-p));
+    const double ha = Ba + (p/mu)*std::pow(Ba, p-1.0);
+    for(int i = 0; i < Q.cols(); ++i)
+    {
+        double n = Q.col(i).norm();
+        double w = 0.0;
+        if(n > ha) w = shrinkage<3>(mu, n, p, (Ba/n + 1.0)/2.0);
+        Q.col(i) *= w;
+    }
+}
+
+/// shrink each element of y towards zero, point to plane
+inline void shrink(Eigen::VectorXd& y, double mu, double p)
+{
+    const double Ba = std::pow((2.0/mu)*(1.0-p), 1.0/(2.0-p));
+    const double ha = Ba + (p/mu)*std::pow(Ba, p-1.0);
+    for(int i = 0; i < y.rows(); ++i)
+    {
+        double n = std::abs(y(i));
+        double s = 0.0;
+        if(n > ha) s = shrinkage<3>(mu, n, p, (Ba/n + 1.0)/2.0);
+        y(i) *= s;
+    }
+}
+
+} // detail
+
+/// @brief Register a set of measured points, such as tracker digitized bone surface points, to a model
+///
+/// Each iteration finds the closest model point to every measured point, either the
+/// closest vertex with the kd-tree of a TargetModel or the closest point on the surface
+/// with a TriangleMeshBVH, then solves for the rigid motion that best aligns the
+/// correspondences. Outliers are handled either by reweighting the residuals with a
+/// robust function, by rejecting correspondences beyond MaxCorrespondenceDistance,
+/// or with the sparse p-norm formulation of Bouaziz et al. solved with ADMM.
+///
+/// All correspondence and solver buffers are members sized on the first call, so
+/// repeated registrations of the same number of points do not allocate. Registration
+/// stops when the points move less than StopTolerance in an iteration, after
+/// MaxIterations, or once TimeBudget seconds have passed, whichever comes first.
+///
+/// usage:
+/// @code
+///    grl::registration::TargetModel femur(vertices, vertexNormals);
+///    grl::registration::IterativeClosestPoint icp;
+///    const grl::registration::IterativeClosestPoint::Result& result = icp.align(digitizedPoints, femur, initialEstimate);
+///    Eigen::Affine3d pointsInModel = result.transform;
+/// @endcode
+class IterativeClosestPoint
+{
+public:
+
+    enum ErrorMetric { POINT_TO_POINT, POINT_TO_PLANE };
+
+    /// weight of a correspondence given its residual r and RobustParameter p
+    enum WeightFunction {
+        NONE,     ///< 1
+        PNORM,    ///< p / r^(2-p), minimizes the p-norm of the residuals
+        TUKEY,    ///< (1 - (r/p)^2)^2 below p and 0 above
+        FAIR,     ///< 1 / (1 + r/p)
+        LOGISTIC, ///< (p/r) tanh(r/p)
+        TRIMMED,  ///< 1 for the fraction p of smallest residuals and 0 for the rest
+        SPARSE    ///< not a weight, solves the sparse p-norm problem with ADMM instead of reweighting
+    };
+
+    enum ParamIndex {
+        Metric,                    ///< POINT_TO_POINT or POINT_TO_PLANE, which needs target normals
+        Robust,                    ///< how outliers are down weighted, see WeightFunction
+        RobustParameter,           ///< p of the WeightFunction, for SPARSE the norm in (0,1], smaller is more robust but more prone to local minima
+        MaxIterations,             ///< closest point searches
+        MaxInnerIterations,        ///< rigid motion updates with fixed correspondences per search
+        StopTolerance,             ///< meters, stop when no point moves more than this in an iteration
+        MaxCorrespondenceDistance, ///< meters, correspondences further apart are ignored, 0 to keep all
+        TimeBudget                 ///< seconds, stop and return the current estimate after this long, 0 for no limit
+    };
+
+    typedef std::tuple<
+        ErrorMetric,
+        WeightFunction,
+        double,
+        int,
+        int,
+        double,
+        double,
+        double
+        > Params;
+
+    static const Params defaultParams()
+    {
+        return std::make_tuple(
+                    POINT_TO_POINT , // Metric
+                    NONE           , // Robust
+                    0.1            , // RobustParameter
+                    100            , // MaxIterations
+                    100            , // MaxInnerIterations
+                    1e-5           , // StopTolerance
+                    0.0            , // MaxCorrespondenceDistance
+                    0.0              // TimeBudget
+               );
+    }
+
+    struct Result
+    {
+        Eigen::Affine3d transform = Eigen::Affine3d::Identity(); ///< maps the measured points onto the model
+        int iterations = 0;           ///< closest point searches run
+        std::size_t inliers = 0;      ///< correspondences within MaxCorrespondenceDistance at the end
+        double rmse = 0.0;            ///< meters, root mean squared distance of the inliers to their closest model point
+        bool converged = false;       ///< the points moved less than StopTolerance
+        bool timedOut = false;        ///< TimeBudget ran out before convergence
+        double seconds = 0.0;         ///< time spent in align()
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    IterativeClosestPoint(Params params = defaultParams())
+    {
+        setParams(params);
+    }
+
+    void setParams(const Params& params)
+    {
+        if(std::get<MaxIterations>(params) < 1 || std::get<MaxInnerIterations>(params) < 1)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("IterativeClosestPoint: MaxIterations and MaxInnerIterations must be at least 1"));
+        }
+        if(std::get<Robust>(params) == SPARSE && (std::get<RobustParameter>(params) <= 0.0 || std::get<RobustParameter>(params) > 1.0))
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("IterativeClosestPoint: the SPARSE RobustParameter is a norm in (0,1]"));
+        }
+        params_ = params;
+    }
+
+    const Params& getParams() const { return params_; }
+
+    /// @brief size the buffers for registrations of pointCount points ahead of time
+    void reserve(int pointCount)
+    {
+        if(X_.cols() == pointCount) return;
+        X_.resize(3, pointCount);
+        Xprevious_.resize(3, pointCount);
+        Xinner_.resize(3, pointCount);
+        Qp_.resize(3, pointCount);
+        Qn_.resize(3, pointCount);
+        W_.resize(pointCount);
+        valid_.resize(pointCount);
+        Z3_.resize(3, pointCount);
+        C3_.resize(3, pointCount);
+        U3_.resize(3, pointCount);
+        Z1_.resize(pointCount);
+        C1_.resize(pointCount);
+        U1_.resize(pointCount);
+        sortedResiduals_.reserve(pointCount);
+    }
+
+    /// @brief find the transform that maps source onto target
+    /// @param source measured points, one 3D point per column
+    /// @param target a TargetModel for closest vertices, or a TriangleMeshBVH for closest points on the surface
+    /// @param initialEstimate starting transform, registration only converges to the right answer from nearby
+    /// @return the result, valid until the next call
+    template<typename Target>
+    const Result& align(const Eigen::Matrix3Xd& source, const Target& target,
+                        const Eigen::Affine3d& initialEstimate = Eigen::Affine3d::Identity())
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const ErrorMetric metric = std::get<Metric>(params_);
+        const double stopTolerance = std::get<StopTolerance>(params_);
+        const double timeBudget = std::get<TimeBudget>(params_);
+        if(source.cols() == 0)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("IterativeClosestPoint: there are no source points to register"));
+        }
+        if(metric == POINT_TO_PLANE && !target.hasNormals())
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("IterativeClosestPoint: POINT_TO_PLANE needs a target with normals"));
+        }
+
+        reserve(static_cast<int>(source.cols()));
+        result_ = Result();
+        result_.transform = initialEstimate;
+        X_.noalias() = initialEstimate * source;
+        Z3_.setZero(); C3_.setZero(); Z1_.setZero(); C1_.setZero();
+
+        for(int icp = 0; icp < std::get<MaxIterations>(params_); ++icp)
+        {
+            if(timeBudget > 0.0 && secondsSince(start) > timeBudget)
+            {
+                result_.timedOut = true;
+                break;
+            }
+
+            if(findCorrespondences(target) == 0) break;
+            Xprevious_ = X_;
+            if(std::get<Robust>(params_) == SPARSE)
+            {
+                if(metric == POINT_TO_POINT) sparsePointToPoint(start);
+                else sparsePointToPlane(start);
+            }
+            else
+            {
+                reweighted(metric, start);
+            }
+            ++result_.iterations;
+
+            if(maxDisplacement(Xprevious_) < stopTolerance)
+            {
+                result_.converged = true;
+                break;
+            }
+        }
+
+        // statistics of the final alignment
+        result_.inliers = findCorrespondences(target);
+        double sumSquared = 0.0;
+        for(int i = 0; i < X_.cols(); ++i) if(valid_(i)) sumSquared += (X_.col(i) - Qp_.col(i)).squaredNorm();
+        result_.rmse = result_.inliers ? std::sqrt(sumSquared / double(result_.inliers)) : 0.0;
+        result_.seconds = secondsSince(start);
+        return result_;
+    }
+
+    const Result& result() const { return result_; }
+
+    /// source points after the last align(), transformed onto the model
+    const Eigen::Matrix3Xd& alignedPoints() const { return X_; }
+
+private:
+
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    // sparse ICP penalty schedule, the defaults of Bouaziz et al.
+    static double constexpr initialMu = 10.0;
+    static double constexpr muGrowth = 1.2;
+    static double constexpr maxMu = 1e5;
+
+    static double secondsSince(const TimePoint& start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool outOfTime(const TimePoint& start) const
+    {
+        const double timeBudget = std::get<TimeBudget>(params_);
+        return timeBudget > 0.0 && secondsSince(start) > timeBudget;
+    }
+
+    /// fill Qp_, Qn_ and valid_ from the closest model points, returns the number of valid correspondences
+    template<typename Target>
+    std::size_t findCorrespondences(const Target& target)
+    {
+        const double maxDistance = std::get<MaxCorrespondenceDistance>(params_);
+        const double maxDistanceSquared = (maxDistance > 0.0) ? maxDistance * maxDistance : std::numeric_limits<double>::infinity();
+        std::size_t count = 0;
+        Eigen::Vector3d nearest, normal = Eigen::Vector3d::Zero();
+        for(int i = 0; i < X_.cols(); ++i)
+        {
+            double distanceSquared = target.closestPoint(X_.col(i), nearest, normal);
+            Qp_.col(i) = nearest;
+            Qn_.col(i) = normal;
+            valid_(i) = (distanceSquared <= maxDistanceSquared) ? 1.0 : 0.0;
+            if(valid_(i)) ++count;
+        }
+        return count;
+    }
+
+    void apply(const Eigen::Affine3d& delta)
+    {
+        X_ = delta * X_;
+        result_.transform = delta * result_.transform;
+    }
+
+    double maxDisplacement(const Eigen::Matrix3Xd& previous) const
+    {
+        return (X_ - previous).colwise().norm().maxCoeff();
+    }
+
+    /// robust weights of the residuals in W_, in place
+    void robustWeight(WeightFunction f, double p)
+    {
+        switch(f)
+        {
+            case PNORM:
+                for(int i = 0; i < W_.rows(); ++i) W_(i) = p / (std::pow(W_(i), 2.0 - p) + 1e-8);
+                break;
+            case TUKEY:
+                for(int i = 0; i < W_.rows(); ++i) W_(i) = (W_(i) > p) ? 0.0 : std::pow(1.0 - std::pow(W_(i) / p, 2.0), 2.0);
+                break;
+            case FAIR:
+                for(int i = 0; i < W_.rows(); ++i) W_(i) = 1.0 / (1.0 + W_(i) / p);
+                break;
+            case LOGISTIC:
+                for(int i = 0; i < W_.rows(); ++i) W_(i) = (W_(i) > 0.0) ? (p / W_(i)) * std::tanh(W_(i) / p) : 1.0;
+                break;
+            case TRIMMED:
+            {
+                sortedResiduals_.clear();
+                for(int i = 0; i < W_.rows(); ++i) if(valid_(i)) sortedResiduals_.push_back(std::make_pair(W_(i), i));
+                std::size_t keep = static_cast<std::size_t>(sortedResiduals_.size() * p);
+                std::nth_element(sortedResiduals_.begin(), sortedResiduals_.begin() + std::min(keep, sortedResiduals_.size()), sortedResiduals_.end());
+                W_.setZero();
+                for(std::size_t i = 0; i < keep && i < sortedResiduals_.size(); ++i) W_(sortedResiduals_[i].second) = 1.0;
+                break;
+            }
+            default:
+                W_.setOnes();
+                break;
+        }
+        W_.array() *= valid_.array();
+    }
+
+    /// iteratively reweighted least squares with fixed correspondences
+    void reweighted(ErrorMetric metric, const TimePoint& start)
+    {
+        for(int outer = 0; outer < std::get<MaxInnerIterations>(params_); ++outer)
+        {
+            if(metric == POINT_TO_POINT) W_ = (X_ - Qp_).colwise().norm().transpose();
+            else W_ = (Qn_.array() * (X_ - Qp_).array()).colwise().sum().abs().transpose();
+            robustWeight(std::get<Robust>(params_), std::get<RobustParameter>(params_));
+            if(W_.sum() <= 0.0) break;
+
+            Xinner_ = X_;
+            if(metric == POINT_TO_POINT) apply(pointToPoint(X_, Qp_, W_));
+            else apply(pointToPlane(X_, Qp_, Qn_, W_));
+
+            if(maxDisplacement(Xinner_) < std::get<StopTolerance>(params_) || outOfTime(start)) break;
+        }
+    }
+
+    /// sparse ICP point to point, alternating direction method of multipliers
+    void sparsePointToPoint(const TimePoint& start)
+    {
+        const double p = std::get<RobustParameter>(params_);
+        const double stopTolerance = std::get<StopTolerance>(params_);
+        double mu = initialMu;
+        for(int outer = 0; outer < std::get<MaxInnerIterations>(params_); ++outer)
+        {
+            Z3_ = X_ - Qp_ + C3_ / mu;
+            detail::shrink(Z3_, mu, p);
+            U3_ = Qp_ + Z3_ - C3_ / mu;
+            Xinner_ = X_;
+            apply(pointToPoint(X_, U3_, valid_));
+            double dual = maxDisplacement(Xinner_);
+
+            // reuse U3_ for the primal residual
+            U3_ = X_ - Qp_ - Z3_;
+            for(int i = 0; i < U3_.cols(); ++i) if(!valid_(i)) U3_.col(i).setZero();
+            C3_.noalias() += mu * U3_;
+            if(mu < maxMu) mu *= muGrowth;
+            double primal = U3_.colwise().norm().maxCoeff();
+            if((primal < stopTolerance && dual < stopTolerance) || outOfTime(start)) break;
+        }
+    }
+
+    /// sparse ICP point to plane, alternating direction method of multipliers
+    void sparsePointToPlane(const TimePoint& start)
+    {
+        const double p = std::get<RobustParameter>(params_);
+        const double stopTolerance = std::get<StopTolerance>(params_);
+        double mu = initialMu;
+        for(int outer = 0; outer < std::get<MaxInnerIterations>(params_); ++outer)
+        {
+            Z1_ = (Qn_.array() * (X_ - Qp_).array()).colwise().sum().transpose() + C1_.array() / mu;
+            detail::shrink(Z1_, mu, p);
+            U1_ = Z1_ - C1_ / mu;
+            Xinner_ = X_;
+            apply(pointToPlane(X_, Qp_, Qn_, valid_, U1_));
+            double dual = maxDisplacement(Xinner_);
+
+            // reuse U1_ for the primal residual
+            U1_ = ((Qn_.array() * (X_ - Qp_).array()).colwise().sum().transpose() - Z1_.array()) * valid_.array();
+            C1_.noalias() += mu * U1_;
+            if(mu < maxMu) mu *= muGrowth;
+            double primal = U1_.array().abs().maxCoeff();
+            if((primal < stopTolerance && dual < stopTolerance) || outOfTime(start)) break;
+        }
+    }
+
+    Params params_;
+    Result result_;
+
+    // preallocated buffers, see reserve()
+    Eigen::Matrix3Xd X_;         ///< source points in the current estimate
+    Eigen::Matrix3Xd Xprevious_; ///< X_ before the current closest point search
+    Eigen::Matrix3Xd Xinner_;    ///< X_ before the current inner update
+    Eigen::Matrix3Xd Qp_;        ///< closest model point of each source point
+    Eigen::Matrix3Xd Qn_;        ///< normal at each closest model point
+    Eigen::VectorXd W_;          ///< residuals, then weights
+    Eigen::VectorXd valid_;      ///< 1 for correspondences within MaxCorrespondenceDistance, else 0
+    Eigen::Matrix3Xd Z3_, C3_, U3_;
+    Eigen::VectorXd Z1_, C1_, U1_;
+    std::vector<std::pair<double,int> > sortedResiduals_;
+};
+
+}} // grl::registration
+
+#endif // _GRL_REGISTRATION_ITERATIVE_CLOSEST_POINT_HPP_
@@ -0,0 +1,286 @@
+/// @file MultiResolutionRegistration.hpp
+/// @brief Coarse to fine registration of measured points against a pyramid of bone models.
+#ifndef _GRL_REGISTRATION_MULTI_RESOLUTION_REGISTRATION_HPP_
+#define _GRL_REGISTRATION_MULTI_RESOLUTION_REGISTRATION_HPP_
+
+#include <tuple>
+#include <array>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/Eigenvalues>
+
+#include "grl/registration/TriangleMeshBVH.hpp"
+#include "grl/registration/IterativeClosestPoint.hpp"
+
+namespace grl { namespace registration {
+
+/// @brief Register measured points to the same model at several resolutions, coarsest first
+///
+/// Most ICP iterations are spent far from the answer, where a coarse model is as good
+/// as a detailed one. So the global alignment and the first iterations run against
+/// the first, low resolution level with a subset of the points, and only the last few
+/// iterations against the following, finer levels with all of them. data/ has such a
+/// pair, FemurSegmentation26_VeryLowRes.stl and FemurSegmentation26_Smoothed_PixelSizeDec0.5.stl.
+///
+/// Levels are shared and only read, so build them once, ideally with
+/// loadTriangleMeshBVH() given a cache file so the built hierarchy is kept on disk,
+/// and reuse them for every registration.
+///
+/// Global alignment tries the initial estimate and the four proper rotations that
+/// map the principal axes of the points onto those of the coarsest model, and keeps
+/// whichever registers best on the coarse level. It only helps when the points cover
+/// most of the model, for a small digitized patch provide an initial estimate, for
+/// example from a few landmarks, and turn GlobalAlignment off.
+///
+/// usage:
+/// @code
+///    grl::registration::MultiResolutionRegistration femur({
+///        grl::registration::loadTriangleMeshBVH("FemurSegmentation26_VeryLowRes.stl", 0.001, cacheDir + "/femurLow.bvh"),
+///        grl::registration::loadTriangleMeshBVH("FemurSegmentation26_Smoothed_PixelSizeDec0.5.stl", 0.001, cacheDir + "/femur.bvh")});
+///    Eigen::Affine3d pointsInModel = femur.align(digitizedPoints, initialEstimate).transform;
+/// @endcode
+class MultiResolutionRegistration
+{
+public:
+
+    typedef std::vector<std::shared_ptr<const TriangleMeshBVH> > Levels;
+
+    enum ParamIndex {
+        GlobalAlignment,  ///< also try aligning principal axes, see the class description
+        CoarsePoints,     ///< most points registered on the coarsest level, evenly spaced through the input
+        CoarseIterations, ///< ICP iterations on the coarsest level for each starting estimate
+        FineIterations,   ///< ICP iterations on each finer level
+        Metric,           ///< IterativeClosestPoint::POINT_TO_POINT or POINT_TO_PLANE
+        StopTolerance,    ///< meters, stop a level when no point moves more than this in an iteration
+        TimeBudget        ///< seconds for the whole registration, 0 for no limit
+    };
+
+    typedef std::tuple<
+        bool,
+        int,
+        int,
+        int,
+        IterativeClosestPoint::ErrorMetric,
+        double,
+        double
+        > Params;
+
+    static const Params defaultParams()
+    {
+        return std::make_tuple(
+                    true                                 , // GlobalAlignment
+                    200                                  , // CoarsePoints
+                    30                                   , // CoarseIterations
+                    10                                   , // FineIterations
+                    IterativeClosestPoint::POINT_TO_PLANE, // Metric
+                    1e-6                                 , // StopTolerance
+                    0.0                                    // TimeBudget
+               );
+    }
+
+    struct Result
+    {
+        Eigen::Affine3d transform = Eigen::Affine3d::Identity(); ///< maps the measured points onto the model
+        std::vector<int> iterations;  ///< ICP iterations run on each level, all starting estimates added up on the first
+        double rmse = 0.0;            ///< meters, on the last level that ran
+        bool timedOut = false;        ///< TimeBudget ran out before the finest level finished
+        double seconds = 0.0;         ///< time spent in align()
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    /// @param levels the same model from the lowest to the highest resolution, at least one
+    MultiResolutionRegistration(Levels levels, Params params = defaultParams())
+    : levels_(std::move(levels))
+    {
+        if(levels_.empty())
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("MultiResolutionRegistration: there must be at least one level"));
+        }
+        for(const auto& level : levels_)
+        {
+            if(!level)
+            {
+                BOOST_THROW_EXCEPTION(std::runtime_error("MultiResolutionRegistration: a level is empty"));
+            }
+        }
+        setParams(params);
+        principalAxes(levels_.front()->mesh(), modelMean_, modelAxes_);
+    }
+
+    void setParams(const Params& params)
+    {
+        if(std::get<CoarsePoints>(params) < 3 || std::get<CoarseIterations>(params) < 1 || std::get<FineIterations>(params) < 1)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("MultiResolutionRegistration: CoarsePoints must be at least 3 and the iterations at least 1"));
+        }
+        params_ = params;
+    }
+
+    const Params& getParams() const { return params_; }
+
+    const Levels& levels() const { return levels_; }
+
+    /// @brief find the transform that maps source onto the model
+    /// @param source measured points, one 3D point per column
+    /// @param initialEstimate starting transform, always tried, and the only one without GlobalAlignment
+    /// @return the result, valid until the next call
+    const Result& align(const Eigen::Matrix3Xd& source,
+                        const Eigen::Affine3d& initialEstimate = Eigen::Affine3d::Identity())
+    {
+        const auto start = std::chrono::steady_clock::now();
+        if(source.cols() < 3)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("MultiResolutionRegistration: at least 3 source points are needed"));
+        }
+        result_ = Result();
+        result_.transform = initialEstimate;
+        result_.iterations.assign(levels_.size(), 0);
+
+        // an evenly spaced subset for the coarse level
+        const int coarseCount = std::min<int>(std::get<CoarsePoints>(params_), static_cast<int>(source.cols()));
+        coarseSource_.resize(3, coarseCount);
+        for(int i = 0; i < coarseCount; ++i) coarseSource_.col(i) = source.col((i * source.cols()) / coarseCount);
+
+        std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> > starts(1, initialEstimate);
+        if(std::get<GlobalAlignment>(params_)) globalCandidates(source, starts);
+
+        double bestRmse = std::numeric_limits<double>::infinity();
+        for(const Eigen::Affine3d& estimate : starts)
+        {
+            if(!configure(std::get<CoarseIterations>(params_), start)) break;
+            const IterativeClosestPoint::Result& coarse = icp_.align(coarseSource_, *levels_.front(), estimate);
+            result_.iterations.front() += coarse.iterations;
+            if(coarse.inliers && coarse.rmse < bestRmse)
+            {
+                bestRmse = coarse.rmse;
+                result_.transform = coarse.transform;
+                result_.rmse = coarse.rmse;
+            }
+        }
+
+        // with a single level the finer pass uses the same model with every point
+        for(std::size_t level = (levels_.size() == 1) ? 0 : 1; level < levels_.size() && !result_.timedOut; ++level)
+        {
+            if(!configure(std::get<FineIterations>(params_), start)) break;
+            const IterativeClosestPoint::Result& fine = icp_.align(source, *levels_[level], result_.transform);
+            result_.iterations[level] += fine.iterations;
+            result_.transform = fine.transform;
+            result_.rmse = fine.rmse;
+            result_.timedOut = fine.timedOut;
+        }
+
+        result_.seconds = secondsSince(start);
+        return result_;
+    }
+
+    const Result& result() const { return result_; }
+
+private:
+
+    /// @brief set up icp_ for one pass with the time left
+    /// @return false and mark the result timed out when there is no time left
+    bool configure(int iterations, const std::chrono::steady_clock::time_point& start)
+    {
+        double timeLeft = 0.0;
+        const double timeBudget = std::get<TimeBudget>(params_);
+        if(timeBudget > 0.0)
+        {
+            timeLeft = timeBudget - secondsSince(start);
+            if(timeLeft <= 0.0)
+            {
+                result_.timedOut = true;
+                return false;
+            }
+        }
+        IterativeClosestPoint::Params params = IterativeClosestPoint::defaultParams();
+        std::get<IterativeClosestPoint::Metric>(params) = std::get<Metric>(params_);
+        std::get<IterativeClosestPoint::MaxIterations>(params) = iterations;
+        std::get<IterativeClosestPoint::StopTolerance>(params) = std::get<StopTolerance>(params_);
+        std::get<IterativeClosestPoint::TimeBudget>(params) = timeLeft;
+        icp_.setParams(params);
+        return true;
+    }
+
+    /// the initial guesses that map the principal axes of source onto those of the coarsest model
+    void globalCandidates(const Eigen::Matrix3Xd& source,
+                          std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> >& starts) const
+    {
+        Eigen::Vector3d sourceMean = source.rowwise().mean();
+        Eigen::Matrix3Xd centered = source.colwise() - sourceMean;
+        Eigen::Matrix3d sourceAxes = eigenvectors(centered * centered.transpose());
+
+        // an eigenvector is only known up to its sign, keep the four choices that are rotations
+        static const std::array<Eigen::Vector3d, 4> signs = {{
+            Eigen::Vector3d( 1.0,  1.0,  1.0), Eigen::Vector3d( 1.0, -1.0, -1.0),
+            Eigen::Vector3d(-1.0,  1.0, -1.0), Eigen::Vector3d(-1.0, -1.0,  1.0)}};
+        for(const Eigen::Vector3d& sign : signs)
+        {
+            Eigen::Affine3d estimate = Eigen::Affine3d::Identity();
+            estimate.linear() = modelAxes_ * sign.asDiagonal() * sourceAxes.transpose();
+            estimate.translation() = modelMean_ - estimate.linear() * sourceMean;
+            starts.push_back(estimate);
+        }
+    }
+
+    /// @brief area weighted mean and principal axes of the surface of a mesh
+    static void principalAxes(const TriangleMesh& mesh, Eigen::Vector3d& mean, Eigen::Matrix3d& axes)
+    {
+        double area = 0.0;
+        mean.setZero();
+        Eigen::Matrix3d secondMoment = Eigen::Matrix3d::Zero();
+        for(int t = 0; t < mesh.triangleCount(); ++t)
+        {
+            const Eigen::Vector3d a = mesh.vertex(t,0), b = mesh.vertex(t,1), c = mesh.vertex(t,2);
+            const double triangleArea = 0.5 * (b - a).cross(c - a).norm();
+            area += triangleArea;
+            mean += triangleArea * (a + b + c) / 3.0;
+            // exact second moment of a uniformly weighted triangle
+            secondMoment += triangleArea / 12.0 * (a*a.transpose() + b*b.transpose() + c*c.transpose()
+                                                   + (a + b + c)*(a + b + c).transpose());
+        }
+        if(!(area > 0.0))
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("MultiResolutionRegistration: the coarsest level has no surface area"));
+        }
+        mean /= area;
+        axes = eigenvectors(secondMoment / area - mean * mean.transpose());
+    }
+
+    /// eigenvectors of a symmetric matrix as the columns of a rotation, largest eigenvalue first
+    static Eigen::Matrix3d eigenvectors(const Eigen::Matrix3d& covariance)
+    {
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(covariance);
+        Eigen::Matrix3d axes = solver.eigenvectors().rowwise().reverse();
+        if(axes.determinant() < 0.0) axes.col(2) *= -1.0;
+        return axes;
+    }
+
+    static double secondsSince(const std::chrono::steady_clock::time_point& start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    Levels levels_;
+    Params params_;
+    Eigen::Vector3d modelMean_;
+    Eigen::Matrix3d modelAxes_;
+    IterativeClosestPoint icp_;
+    Eigen::Matrix3Xd coarseSource_;
+    Result result_;
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+}} // grl::registration
+
+#endif // _GRL_REGISTRATION_MULTI_RESOLUTION_REGISTRATION_HPP_
@@ -0,0 +1,273 @@
+/// @file OnlineRegistration.hpp
+/// @brief Registration that updates with every digitized point instead of solving once at the end.
+#ifndef _GRL_REGISTRATION_ONLINE_REGISTRATION_HPP_
+#define _GRL_REGISTRATION_ONLINE_REGISTRATION_HPP_
+
+#include <tuple>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <stdexcept>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "grl/registration/TriangleMeshBVH.hpp"
+#include "grl/registration/RigidMotionEstimator.hpp"
+
+namespace grl { namespace registration {
+
+/// @brief Track the registration of a bone model while its surface is being digitized
+///
+/// Points from a tracked pointer arrive one at a time. Each addPoint() finds the
+/// closest surface point of the new point, refreshes the correspondences of a fixed
+/// number of older points in turn, and takes one point to plane Gauss-Newton step
+/// from the current estimate using every stored correspondence. The estimate
+/// therefore converges while the surgeon is still collecting points, and the cost
+/// of a point is bounded: 1 + RefreshPerPoint closest point queries and one linear
+/// pass over at most MaxPoints points.
+///
+/// Once MaxPoints are stored, each new point replaces a random stored point with
+/// the probability that keeps the stored points a uniform sample of every point
+/// added (reservoir sampling), so long digitizations neither grow without bound
+/// nor forget the first areas touched.
+///
+/// No update is made until MinPoints points have correspondences within
+/// MaxCorrespondenceDistance, so start from a rough initial estimate, for example
+/// from a few anatomical landmarks. For a final answer once digitization is done,
+/// pass points() and state().transform to IterativeClosestPoint.
+///
+/// Not thread safe, call it from the thread that receives the tracker data and copy
+/// state() out to whatever displays it.
+///
+/// usage:
+/// @code
+///    grl::registration::OnlineRegistration femur(grl::registration::loadTriangleMeshBVH("femur.stl", 0.001), landmarkEstimate);
+///    // in the tracker callback, for each new pointer tip position
+///    const grl::registration::OnlineRegistration::State& state = femur.addPoint(tipInTracker);
+///    if(state.converged) { /* state.transform maps tracker coordinates onto the model */ }
+/// @endcode
+class OnlineRegistration
+{
+public:
+
+    enum ParamIndex {
+        MaxPoints,                 ///< most points kept, which bounds the cost of each update
+        MinPoints,                 ///< inlier points needed before the estimate is updated, at least 6
+        RefreshPerPoint,           ///< older correspondences searched again with each new point
+        MaxCorrespondenceDistance, ///< meters, correspondences further apart are ignored, 0 to keep all
+        StopTolerance              ///< meters, converged when an update moves no point more than this
+    };
+
+    typedef std::tuple<
+        int,
+        int,
+        int,
+        double,
+        double
+        > Params;
+
+    static const Params defaultParams()
+    {
+        return std::make_tuple(
+                    1000  , // MaxPoints
+                    12    , // MinPoints
+                    8     , // RefreshPerPoint
+                    0.01  , // MaxCorrespondenceDistance
+                    1e-5    // StopTolerance
+               );
+    }
+
+    struct State
+    {
+        Eigen::Affine3d transform = Eigen::Affine3d::Identity(); ///< maps tracker coordinates onto the model
+        std::size_t pointsAdded = 0;  ///< every point passed to addPoint() since the last reset()
+        int inliers = 0;              ///< stored points with a correspondence within MaxCorrespondenceDistance
+        int updates = 0;              ///< Gauss-Newton steps taken
+        double rmse = 0.0;            ///< meters, root mean squared point to plane distance of the inliers
+        double lastMotion = 0.0;      ///< meters, most any stored point moved in the last update
+        bool converged = false;       ///< the last update moved the points less than StopTolerance
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    /// @param target surface of the model, shared with other registrations
+    /// @param initialEstimate rough transform from tracker coordinates to the model
+    OnlineRegistration(std::shared_ptr<const TriangleMeshBVH> target,
+                       const Eigen::Affine3d& initialEstimate = Eigen::Affine3d::Identity(),
+                       Params params = defaultParams())
+    : target_(std::move(target)), random_(0)
+    {
+        if(!target_)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("OnlineRegistration: there is no target surface"));
+        }
+        setParams(params);
+        reset(initialEstimate);
+    }
+
+    /// @brief change the parameters, a smaller MaxPoints drops the points beyond it
+    void setParams(const Params& params)
+    {
+        if(std::get<MinPoints>(params) < 6 || std::get<MaxPoints>(params) < std::get<MinPoints>(params))
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("OnlineRegistration: MinPoints must be at least 6 and no more than MaxPoints"));
+        }
+        if(std::get<RefreshPerPoint>(params) < 0)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("OnlineRegistration: RefreshPerPoint must not be negative"));
+        }
+        params_ = params;
+        const int capacity = std::get<MaxPoints>(params_);
+        count_ = std::min(count_, capacity);
+        points_.conservativeResize(3, capacity);
+        closest_.conservativeResize(3, capacity);
+        normals_.conservativeResize(3, capacity);
+        weights_.conservativeResize(capacity);
+        X_.resize(3, capacity);
+        if(next_ >= count_) next_ = 0;
+    }
+
+    const Params& getParams() const { return params_; }
+
+    /// @brief forget every point and start again from initialEstimate
+    void reset(const Eigen::Affine3d& initialEstimate = Eigen::Affine3d::Identity())
+    {
+        state_ = State();
+        state_.transform = initialEstimate;
+        count_ = 0;
+        next_ = 0;
+    }
+
+    /// @brief add one measured point in tracker coordinates and update the estimate
+    /// @return the updated state, valid until the next call
+    const State& addPoint(const Eigen::Vector3d& point)
+    {
+        ++state_.pointsAdded;
+        int slot = count_;
+        if(count_ == points_.cols())
+        {
+            std::uniform_int_distribution<std::size_t> pick(0, state_.pointsAdded - 1);
+            const std::size_t replace = pick(random_);
+            if(replace >= std::size_t(count_)) return state_;
+            slot = static_cast<int>(replace);
+        }
+        else
+        {
+            ++count_;
+        }
+        points_.col(slot) = point;
+        correspond(slot);
+
+        // refresh older correspondences round robin, they drift as the estimate moves
+        const int refresh = std::min(std::get<RefreshPerPoint>(params_), count_ - 1);
+        for(int i = 0; i < refresh; ++i)
+        {
+            if(next_ == slot) next_ = (next_ + 1) % count_;
+            correspond(next_);
+            next_ = (next_ + 1) % count_;
+        }
+
+        update();
+        return state_;
+    }
+
+    const State& state() const { return state_; }
+
+    /// the stored points in tracker coordinates, one per column
+    Eigen::Matrix3Xd points() const { return points_.leftCols(count_); }
+
+    const TriangleMeshBVH& target() const { return *target_; }
+
+private:
+
+    /// closest surface point and normal of stored point i under the current estimate
+    void correspond(int i)
+    {
+        TriangleMeshBVH::ClosestPoint closest;
+        const double maxDistance = std::get<MaxCorrespondenceDistance>(params_);
+        const Eigen::Vector3d x = state_.transform * points_.col(i);
+        if(target_->closestPoint(x, closest, (maxDistance > 0.0) ? maxDistance : std::numeric_limits<double>::infinity()))
+        {
+            closest_.col(i) = closest.point;
+            normals_.col(i) = closest.normal;
+            weights_(i) = 1.0;
+        }
+        else
+        {
+            weights_(i) = 0.0;
+        }
+    }
+
+    /// one point to plane Gauss-Newton step with the stored correspondences
+    void update()
+    {
+        const double maxDistance = std::get<MaxCorrespondenceDistance>(params_);
+        X_.leftCols(count_).noalias() = state_.transform * points_.leftCols(count_);
+
+        // correspondences found under an older estimate may have drifted out of range
+        int inliers = 0;
+        for(int i = 0; i < count_; ++i)
+        {
+            if(weights_(i) == 0.0) continue;
+            if(maxDistance > 0.0 && (X_.col(i) - closest_.col(i)).squaredNorm() > maxDistance * maxDistance) weights_(i) = 0.0;
+            else ++inliers;
+        }
+        state_.inliers = inliers;
+        if(inliers < std::get<MinPoints>(params_))
+        {
+            state_.rmse = planeRmse();
+            return;
+        }
+
+        const Eigen::Affine3d step = pointToPlane(X_.leftCols(count_), closest_.leftCols(count_),
+                                                  normals_.leftCols(count_), weights_.head(count_));
+        state_.lastMotion = 0.0;
+        for(int i = 0; i < count_; ++i)
+        {
+            const Eigen::Vector3d moved = step * X_.col(i);
+            state_.lastMotion = std::max(state_.lastMotion, (moved - X_.col(i)).norm());
+            X_.col(i) = moved;
+        }
+        state_.transform = step * state_.transform;
+        state_.converged = state_.lastMotion < std::get<StopTolerance>(params_);
+        ++state_.updates;
+        state_.rmse = planeRmse();
+    }
+
+    /// root mean squared point to plane distance of the inliers in X_
+    double planeRmse() const
+    {
+        double sumSquared = 0.0;
+        int inliers = 0;
+        for(int i = 0; i < count_; ++i)
+        {
+            if(weights_(i) == 0.0) continue;
+            const double distance = (X_.col(i) - closest_.col(i)).dot(normals_.col(i));
+            sumSquared += distance * distance;
+            ++inliers;
+        }
+        return inliers ? std::sqrt(sumSquared / inliers) : 0.0;
+    }
+
+    std::shared_ptr<const TriangleMeshBVH> target_;
+    Params params_;
+    State state_;
+    int count_ = 0; ///< points stored
+    int next_ = 0;  ///< next stored point to refresh
+    Eigen::Matrix3Xd points_;  ///< tracker coordinates
+    Eigen::Matrix3Xd closest_; ///< closest surface point of each, model coordinates
+    Eigen::Matrix3Xd normals_; ///< surface normal at each closest point
+    Eigen::VectorXd weights_;  ///< 1 for a correspondence in range, 0 otherwise
+    Eigen::Matrix3Xd X_;       ///< points under the current estimate
+    std::mt19937 random_;
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+}} // grl::registration
+
+#endif // _GRL_REGISTRATION_ONLINE_REGISTRATION_HPP_
@@ -0,0 +1,125 @@
+/// @file RigidMotionEstimator.hpp
+/// @brief Weighted least squares rigid motion between corresponding point sets.
+///
+/// Adapted from "Sparse Iterative Closest Point"
+/// by Sofien Bouaziz, Andrea Tagliasacchi, Mark Pauly, Copyright (C) 2013 LGG, EPFL.
+#ifndef _GRL_REGISTRATION_RIGID_MOTION_ESTIMATOR_HPP_
+#define _GRL_REGISTRATION_RIGID_MOTION_ESTIMATOR_HPP_
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/SVD>
+#include <Eigen/Cholesky>
+
+namespace grl { namespace registration {
+
+/// @brief rigid transform T minimizing sum w_i * ||T * X_i - Y_i||^2
+///
+/// @param X source points, one 3D point per column
+/// @param Y corresponding target points, one 3D point per column
+/// @param w non negative weight of each correspondence, not all zero
+/// @return the transform to apply to X, X itself is not modified
+template <typename Derived1, typename Derived2, typename Derived3>
+Eigen::Affine3d pointToPoint(const Eigen::MatrixBase<Derived1>& X,
+                             const Eigen::MatrixBase<Derived2>& Y,
+                             const Eigen::MatrixBase<Derived3>& w)
+{
+    const double weightSum = w.sum();
+    Eigen::Vector3d xMean = Eigen::Vector3d::Zero();
+    Eigen::Vector3d yMean = Eigen::Vector3d::Zero();
+    for(int i = 0; i < X.cols(); ++i)
+    {
+        xMean += w(i) * X.col(i);
+        yMean += w(i) * Y.col(i);
+    }
+    xMean /= weightSum;
+    yMean /= weightSum;
+
+    Eigen::Matrix3d sigma = Eigen::Matrix3d::Zero();
+    for(int i = 0; i < X.cols(); ++i)
+    {
+        sigma.noalias() += w(i) * (X.col(i) - xMean) * (Y.col(i) - yMean).transpose();
+    }
+
+    Eigen::JacobiSVD<Eigen::Matrix3d> svd(sigma, Eigen::ComputeFullU | Eigen::ComputeFullV);
+    Eigen::Affine3d transformation = Eigen::Affine3d::Identity();
+    if(svd.matrixU().determinant() * svd.matrixV().determinant() < 0.0)
+    {
+        // reflection, flip the axis of the smallest singular value
+        Eigen::Vector3d S = Eigen::Vector3d::Ones(); S(2) = -1.0;
+        transformation.linear().noalias() = svd.matrixV() * S.asDiagonal() * svd.matrixU().transpose();
+    }
+    else
+    {
+        transformation.linear().noalias() = svd.matrixV() * svd.matrixU().transpose();
+    }
+    transformation.translation().noalias() = yMean - transformation.linear() * xMean;
+    return transformation;
+}
+
+/// @brief rigid transform T minimizing sum w_i * ((T * X_i - Y_i) . N_i - u_i)^2
+///
+/// The rotation is linearized about the identity, so this is one Gauss-Newton step
+/// and is accurate when X is already close to Y, as it is between ICP iterations.
+///
+/// @param X source points, one 3D point per column
+/// @param Y corresponding target points, one 3D point per column
+/// @param N unit normal at each target point, one per column
+/// @param w non negative weight of each correspondence
+/// @param u desired signed distance of each point from its plane, zero for plain point to plane
+/// @return the transform to apply to X, X itself is not modified
+template <typename Derived1, typename Derived2, typename Derived3, typename Derived4, typename Derived5>
+Eigen::Affine3d pointToPlane(const Eigen::MatrixBase<Derived1>& X,
+                             const Eigen::MatrixBase<Derived2>& Y,
+                             const Eigen::MatrixBase<Derived3>& N,
+                             const Eigen::MatrixBase<Derived4>& w,
+                             const Eigen::MatrixBase<Derived5>& u)
+{
+    typedef Eigen::Matrix<double, 6, 6> Matrix66;
+    typedef Eigen::Matrix<double, 6, 1> Vector6;
+
+    // linearize about the weighted mean of X, which keeps the normal equations well conditioned
+    const double weightSum = w.sum();
+    Eigen::Vector3d xMean = Eigen::Vector3d::Zero();
+    for(int i = 0; i < X.cols(); ++i) xMean += w(i) * X.col(i);
+    if(weightSum > 0.0) xMean /= weightSum;
+
+    Matrix66 LHS = Matrix66::Zero();
+    Vector6 RHS = Vector6::Zero();
+    Vector6 J;
+    for(int i = 0; i < X.cols(); ++i)
+    {
+        if(w(i) == 0.0) continue;
+        const Eigen::Vector3d x = X.col(i) - xMean;
+        J.head<3>() = x.cross(N.col(i));
+        J.tail<3>() = N.col(i);
+        const double distanceToPlane = (X.col(i) - Y.col(i)).dot(N.col(i)) - u(i);
+        LHS.selfadjointView<Eigen::Upper>().rankUpdate(J, w(i));
+        RHS.noalias() -= w(i) * distanceToPlane * J;
+    }
+    LHS = LHS.selfadjointView<Eigen::Upper>();
+
+    Vector6 step = Eigen::LDLT<Matrix66>(LHS).solve(RHS);
+    Eigen::Matrix3d R = (Eigen::AngleAxisd(step(0), Eigen::Vector3d::UnitX()) *
+                         Eigen::AngleAxisd(step(1), Eigen::Vector3d::UnitY()) *
+                         Eigen::AngleAxisd(step(2), Eigen::Vector3d::UnitZ())).toRotationMatrix();
+
+    // x -> R * (x - xMean) + t + xMean
+    Eigen::Affine3d transformation = Eigen::Affine3d::Identity();
+    transformation.linear() = R;
+    transformation.translation() = step.tail<3>() + xMean - R * xMean;
+    return transformation;
+}
+
+template <typename Derived1, typename Derived2, typename Derived3, typename Derived4>
+inline Eigen::Affine3d pointToPlane(const Eigen::MatrixBase<Derived1>& X,
+                                    const Eigen::MatrixBase<Derived2>& Y,
+                                    const Eigen::MatrixBase<Derived3>& N,
+                                    const Eigen::MatrixBase<Derived4>& w)
+{
+    return pointToPlane(X, Y, N, w, Eigen::VectorXd::Zero(X.cols()));
+}
+
+}} // grl::registration
+
+#endif // _GRL_REGISTRATION_RIGID_MOTION_ESTIMATOR_HPP_
@@ -0,0 +1,127 @@
+/// @file TargetModel.hpp
+/// @brief Points of a model to register against, with a kd-tree built once for closest point queries.
+///
+/// Adapted from the KDTreeAdaptor of "Sparse Iterative Closest Point"
+/// by Sofien Bouaziz, Andrea Tagliasacchi, Mark Pauly, Copyright (C) 2013 LGG, EPFL.
+#ifndef _GRL_REGISTRATION_TARGET_MODEL_HPP_
+#define _GRL_REGISTRATION_TARGET_MODEL_HPP_
+
+#include <memory>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+#include <Eigen/Core>
+
+#include "nanoflann.hpp"
+
+namespace grl { namespace registration {
+
+/// @brief A fixed point cloud, such as the vertices of a bone model, indexed for closest point queries
+///
+/// Building the kd-tree is the expensive part of setting up a registration, so a
+/// TargetModel is built once and then shared by any number of registrations, for example
+/// one per tracked frame. Queries are const and may run concurrently from several threads.
+///
+/// The kd-tree refers to the points stored in this object, so it can be neither copied
+/// nor moved, share it with a std::shared_ptr instead.
+///
+/// usage:
+/// @code
+///    auto femur = std::make_shared<grl::registration::TargetModel>(vertices, vertexNormals);
+///    double distanceSquared;
+///    int closest = femur->closest(point, distanceSquared);
+/// @endcode
+class TargetModel
+{
+public:
+
+    typedef nanoflann::metric_L2_Simple::traits<double,TargetModel>::distance_t Metric;
+    typedef nanoflann::KDTreeSingleIndexAdaptor<Metric,TargetModel,3,int> Index;
+
+    /// @param points one 3D point per column
+    /// @param normals optional unit normal of each point, one per column, needed for point to plane registration
+    /// @param leafMaxSize points in each kd-tree leaf
+    explicit TargetModel(const Eigen::Matrix3Xd& points, const Eigen::Matrix3Xd& normals = Eigen::Matrix3Xd(), int leafMaxSize = 10)
+    : points_(points), normals_(normals)
+    {
+        if(points_.cols() == 0)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TargetModel: a target model needs at least one point"));
+        }
+        if(normals_.cols() != 0 && normals_.cols() != points_.cols())
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TargetModel: there must be one normal per point or none at all"));
+        }
+        index_.reset(new Index(3, *this, nanoflann::KDTreeSingleIndexAdaptorParams(leafMaxSize)));
+        index_->buildIndex();
+    }
+
+    TargetModel(const TargetModel&) = delete;
+    TargetModel& operator=(const TargetModel&) = delete;
+
+    const Eigen::Matrix3Xd& points() const { return points_; }
+    const Eigen::Matrix3Xd& normals() const { return normals_; }
+    bool hasNormals() const { return normals_.cols() != 0; }
+    int size() const { return static_cast<int>(points_.cols()); }
+
+    /// @brief index of the model point closest to point
+    /// @param distanceSquared output squared distance to the closest point
+    int closest(const Eigen::Vector3d& point, double& distanceSquared) const
+    {
+        int closestIndex = 0;
+        distanceSquared = std::numeric_limits<double>::infinity();
+        nanoflann::KNNResultSet<double,int> resultSet(1);
+        resultSet.init(&closestIndex, &distanceSquared);
+        index_->findNeighbors(resultSet, point.data(), nanoflann::SearchParams());
+        return closestIndex;
+    }
+
+    int closest(const Eigen::Vector3d& point) const
+    {
+        double distanceSquared;
+        return closest(point, distanceSquared);
+    }
+
+    /// @brief closest point interface used by IterativeClosestPoint, same as TriangleMeshBVH
+    /// @param normal set to the normal of the closest point when the model has normals
+    /// @return the squared distance from point to the closest model point
+    double closestPoint(const Eigen::Vector3d& point, Eigen::Vector3d& nearest, Eigen::Vector3d& normal) const
+    {
+        double distanceSquared;
+        int id = closest(point, distanceSquared);
+        nearest = points_.col(id);
+        if(hasNormals()) normal = normals_.col(id);
+        return distanceSquared;
+    }
+
+    /// @name nanoflann dataset adaptor interface
+    /// @{
+    inline std::size_t kdtree_get_point_count() const { return static_cast<std::size_t>(points_.cols()); }
+
+    inline double kdtree_distance(const double* p1, const std::size_t idx_p2, std::size_t size) const
+    {
+        double s = 0.0;
+        for(std::size_t i = 0; i < size; ++i)
+        {
+            const double d = p1[i] - points_.coeff(i, idx_p2);
+            s += d * d;
+        }
+        return s;
+    }
+
+    inline double kdtree_get_pt(const std::size_t idx, int dim) const { return points_.coeff(dim, idx); }
+
+    template <class BBOX> bool kdtree_get_bbox(BBOX&) const { return false; }
+    /// @}
+
+private:
+    Eigen::Matrix3Xd points_;
+    Eigen::Matrix3Xd normals_;
+    std::unique_ptr<Index> index_;
+};
+
+}} // grl::registration
+
+#endif // _GRL_REGISTRATION_TARGET_MODEL_HPP_
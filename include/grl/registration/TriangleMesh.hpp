@@ -0,0 +1,215 @@
+/// @file TriangleMesh.hpp
+/// @brief Indexed triangle meshes and an STL file loader, for bone models such as those in data/.
+#ifndef _GRL_REGISTRATION_TRIANGLE_MESH_HPP_
+#define _GRL_REGISTRATION_TRIANGLE_MESH_HPP_
+
+#include <array>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <stdexcept>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+#include <boost/algorithm/string.hpp>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+namespace grl { namespace registration {
+
+/// Triangles sharing vertices, with counter clockwise winding seen from outside
+struct TriangleMesh
+{
+    Eigen::Matrix3Xd vertices;  ///< one vertex per column
+    Eigen::Matrix3Xi triangles; ///< three vertex indices per column
+
+    int vertexCount() const { return static_cast<int>(vertices.cols()); }
+    int triangleCount() const { return static_cast<int>(triangles.cols()); }
+
+    Eigen::Vector3d vertex(int triangle, int corner) const { return vertices.col(triangles(corner, triangle)); }
+
+    /// unit normal of each triangle from its winding, zero for degenerate triangles
+    Eigen::Matrix3Xd faceNormals() const
+    {
+        Eigen::Matrix3Xd normals(3, triangles.cols());
+        for(int t = 0; t < triangleCount(); ++t)
+        {
+            Eigen::Vector3d n = (vertex(t,1) - vertex(t,0)).cross(vertex(t,2) - vertex(t,0));
+            double norm = n.norm();
+            normals.col(t) = (norm > 0.0) ? Eigen::Vector3d(n / norm) : Eigen::Vector3d::Zero();
+        }
+        return normals;
+    }
+
+    /// @brief unit normal at each vertex, the average of the incident face normals weighted by their angle at the vertex
+    ///
+    /// The angle weighted pseudo normal of Baerentzen and Aanaes, which gives the correct
+    /// inside or outside sign for points closest to a vertex of a closed mesh.
+    Eigen::Matrix3Xd vertexNormals() const
+    {
+        Eigen::Matrix3Xd faces = faceNormals();
+        Eigen::Matrix3Xd normals = Eigen::Matrix3Xd::Zero(3, vertices.cols());
+        for(int t = 0; t < triangleCount(); ++t)
+        {
+            for(int corner = 0; corner < 3; ++corner)
+            {
+                Eigen::Vector3d e1 = vertex(t,(corner+1)%3) - vertex(t,corner);
+                Eigen::Vector3d e2 = vertex(t,(corner+2)%3) - vertex(t,corner);
+                double denominator = e1.norm() * e2.norm();
+                if(denominator <= 0.0) continue;
+                double angle = std::acos(std::max(-1.0, std::min(1.0, e1.dot(e2) / denominator)));
+                normals.col(triangles(corner,t)) += angle * faces.col(t);
+            }
+        }
+        for(int v = 0; v < vertexCount(); ++v)
+        {
+            double norm = normals.col(v).norm();
+            if(norm > 0.0) normals.col(v) /= norm;
+        }
+        return normals;
+    }
+};
+
+namespace detail {
+
+/// @brief the whole content of a file, false if it cannot be read
+inline bool readFile(const std::string& fileName, std::string& bytes)
+{
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    if(!file) return false;
+    const std::streamoff size = file.tellg();
+    if(size < 0) return false;
+    bytes.resize(static_cast<std::size_t>(size));
+    file.seekg(0);
+    return static_cast<bool>(file.read(&bytes[0], size));
+}
+
+struct VertexHash
+{
+    std::size_t operator()(const std::array<float,3>& v) const
+    {
+        std::size_t seed = 0;
+        for(float f : v)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            seed ^= std::hash<uint32_t>()(bits) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    }
+};
+
+/// collects triangle soup corners into shared vertices
+class VertexWelder
+{
+public:
+    void reserve(std::size_t triangles)
+    {
+        indices_.reserve(triangles * 3);
+        vertices_.reserve(triangles / 2 + 3);
+        lookup_.reserve(triangles / 2 + 3);
+    }
+
+    void add(std::array<float,3> corner)
+    {
+        // -0 and 0 compare equal so they must hash the same
+        for(float& f : corner) f += 0.0f;
+        auto inserted = lookup_.insert(std::make_pair(corner, static_cast<int>(vertices_.size())));
+        if(inserted.second) vertices_.push_back(corner);
+        indices_.push_back(inserted.first->second);
+    }
+
+    TriangleMesh mesh(double scale) const
+    {
+        TriangleMesh mesh;
+        mesh.vertices.resize(3, vertices_.size());
+        for(std::size_t v = 0; v < vertices_.size(); ++v)
+        {
+            mesh.vertices.col(v) = scale * Eigen::Vector3d(vertices_[v][0], vertices_[v][1], vertices_[v][2]);
+        }
+        mesh.triangles = Eigen::Map<const Eigen::Matrix3Xi>(indices_.data(), 3, indices_.size() / 3);
+        return mesh;
+    }
+
+private:
+    std::vector<std::array<float,3> > vertices_;
+    std::vector<int> indices_;
+    std::unordered_map<std::array<float,3>, int, VertexHash> lookup_;
+};
+
+} // detail
+
+/// @brief Load a binary or ASCII STL file into an indexed mesh
+///
+/// STL stores every triangle with its own copy of its corners. Corners with exactly
+/// the same coordinates are merged, so neighbouring triangles share vertices. The
+/// stored facet normals are ignored and recomputed from the winding.
+///
+/// @param scale multiplies every coordinate, for example 0.001 for models in millimeters
+inline TriangleMesh loadStlFile(const std::string& fileName, double scale = 1.0)
+{
+    std::string buffer;
+    if(!detail::readFile(fileName, buffer))
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error(std::string("loadStlFile: unable to open ") + fileName));
+    }
+
+    detail::VertexWelder welder;
+
+    // a binary STL has an 80 byte header, a triangle count, and 50 bytes per triangle.
+    // Some binary files also start with "solid", so the size decides.
+    uint32_t binaryCount = 0;
+    if(buffer.size() >= 84) std::memcpy(&binaryCount, buffer.data() + 80, sizeof(binaryCount));
+    if(buffer.size() >= 84 && buffer.size() == 84 + 50 * std::size_t(binaryCount))
+    {
+        welder.reserve(binaryCount);
+        for(std::size_t t = 0; t < binaryCount; ++t)
+        {
+            // skip the 12 byte facet normal, then 3 corners of 3 floats, then 2 attribute bytes
+            const char* facet = buffer.data() + 84 + 50 * t + 12;
+            for(int corner = 0; corner < 3; ++corner)
+            {
+                std::array<float,3> v;
+                std::memcpy(v.data(), facet + 12 * corner, 12);
+                welder.add(v);
+            }
+        }
+        return welder.mesh(scale);
+    }
+
+    if(!boost::algorithm::istarts_with(buffer, "solid"))
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error(std::string("loadStlFile: ") + fileName + " is neither a binary nor an ASCII STL file"));
+    }
+
+    std::istringstream ascii(buffer);
+    std::string token;
+    std::size_t corners = 0;
+    while(ascii >> token)
+    {
+        if(token != "vertex") continue;
+        std::array<float,3> v;
+        if(!(ascii >> v[0] >> v[1] >> v[2]))
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error(std::string("loadStlFile: ") + fileName + " has a vertex without 3 coordinates"));
+        }
+        welder.add(v);
+        ++corners;
+    }
+    if(corners % 3 != 0)
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error(std::string("loadStlFile: ") + fileName + " has a facet without 3 vertices"));
+    }
+    return welder.mesh(scale);
+}
+
+}} // grl::registration
+
+#endif // _GRL_REGISTRATION_TRIANGLE_MESH_HPP_
@@ -0,0 +1,675 @@
+/// @file TriangleMeshBVH.hpp
+/// @brief Exact closest point on surface, signed distance and normal queries against a triangle mesh.
+#ifndef _GRL_REGISTRATION_TRIANGLE_MESH_BVH_HPP_
+#define _GRL_REGISTRATION_TRIANGLE_MESH_BVH_HPP_
+
+#include <map>
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "grl/registration/TriangleMesh.hpp"
+
+namespace grl { namespace registration {
+
+/// @brief Bounding volume hierarchy over the triangles of a mesh
+///
+/// Where TargetModel finds the closest mesh vertex, this finds the closest point
+/// anywhere on the surface, so registration accuracy no longer depends on how
+/// densely the model is meshed. Axis aligned boxes are split at the median triangle
+/// centroid along their longest axis, and stored depth first in one array so a
+/// query walks memory mostly forwards. A query visits the nearer child first and
+/// skips every box further away than the closest triangle found so far.
+///
+/// The sign of signedDistance() comes from the angle weighted pseudo normal of the
+/// closest feature (face, edge or vertex), which is exact for closed meshes whose
+/// triangles wind counter clockwise seen from outside; negative is inside.
+///
+/// Queries are const and do not allocate, so any number of threads may query one
+/// TriangleMeshBVH at once, for example ICP correspondences on one thread and tool
+/// to bone proximity checks in the control loop on another.
+///
+/// Building takes a noticeable fraction of a second for a full resolution bone model,
+/// so save() writes the finished hierarchy to a file that load() reads back without
+/// rebuilding, see loadTriangleMeshBVH().
+///
+/// usage:
+/// @code
+///    grl::registration::TriangleMeshBVH femur(grl::registration::loadStlFile("FemurSegmentation26_Smoothed_PixelSizeDec0.5.stl", 0.001));
+///    grl::registration::TriangleMeshBVH::ClosestPoint closest;
+///    if(femur.closestPoint(toolTip, closest, 0.005)) { /* within 5mm of the bone */ }
+/// @endcode
+class TriangleMeshBVH
+{
+public:
+
+    /// Result of a closest point query
+    struct ClosestPoint
+    {
+        Eigen::Vector3d point = Eigen::Vector3d::Zero();  ///< closest point on the surface
+        Eigen::Vector3d normal = Eigen::Vector3d::Zero(); ///< unit normal of the closest triangle
+        int triangle = -1;                                ///< index of the closest triangle in the mesh
+        double distanceSquared = std::numeric_limits<double>::infinity();
+        double signedDistance = std::numeric_limits<double>::infinity(); ///< negative inside the mesh
+    };
+
+    /// @param leafSize most triangles in a leaf box
+    explicit TriangleMeshBVH(const TriangleMesh& mesh, int leafSize = 4)
+    : mesh_(mesh)
+    {
+        if(mesh_.triangleCount() == 0)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TriangleMeshBVH: the mesh has no triangles"));
+        }
+        if(mesh_.triangles.minCoeff() < 0 || mesh_.triangles.maxCoeff() >= mesh_.vertexCount())
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TriangleMeshBVH: a triangle refers to a vertex that does not exist"));
+        }
+        buildPseudoNormals();
+        std::vector<int> order(mesh_.triangleCount());
+        for(int t = 0; t < mesh_.triangleCount(); ++t) order[t] = t;
+        nodes_.reserve(2 * mesh_.triangleCount() / std::max(leafSize,1) + 1);
+        build(order, 0, static_cast<int>(order.size()), std::max(leafSize,1));
+
+        // store triangles in leaf order so each leaf is contiguous
+        triangles_.reserve(order.size());
+        for(int t : order) triangles_.push_back(triangleData(t));
+    }
+
+    const TriangleMesh& mesh() const { return mesh_; }
+
+    /// @brief write the mesh and the built hierarchy, in the byte order of this machine
+    void save(std::ostream& out) const
+    {
+        writeValue(out, static_cast<uint32_t>(fileVersion));
+        writeMatrix(out, mesh_.vertices);
+        writeMatrix(out, mesh_.triangles);
+        writeMatrix(out, faceNormals_);
+        writeMatrix(out, vertexNormals_);
+        writeMatrix(out, edgeNormals_);
+        writeVector(out, triangleEdges_);
+        std::vector<int> order;
+        order.reserve(triangles_.size());
+        for(const Triangle& triangle : triangles_) order.push_back(triangle.index);
+        writeVector(out, order);
+        // nodes as two flat arrays, so loading is a few large reads
+        std::vector<double> bounds;
+        std::vector<int> links;
+        bounds.reserve(6 * nodes_.size());
+        links.reserve(3 * nodes_.size());
+        for(const Node& node : nodes_)
+        {
+            bounds.insert(bounds.end(), node.bounds.min().data(), node.bounds.min().data() + 3);
+            bounds.insert(bounds.end(), node.bounds.max().data(), node.bounds.max().data() + 3);
+            links.push_back(node.first);
+            links.push_back(node.count);
+            links.push_back(node.right);
+        }
+        writeVector(out, bounds);
+        writeVector(out, links);
+        if(!out)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TriangleMeshBVH: unable to write the hierarchy"));
+        }
+    }
+
+    /// @brief read a hierarchy written by save(), throws if it is incomplete or from another version
+    static TriangleMeshBVH load(std::istream& in)
+    {
+        TriangleMeshBVH bvh;
+        if(readValue<uint32_t>(in) != static_cast<uint32_t>(fileVersion))
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TriangleMeshBVH: the saved hierarchy is from an incompatible version"));
+        }
+        readMatrix(in, bvh.mesh_.vertices);
+        readMatrix(in, bvh.mesh_.triangles);
+        readMatrix(in, bvh.faceNormals_);
+        readMatrix(in, bvh.vertexNormals_);
+        readMatrix(in, bvh.edgeNormals_);
+        readVector(in, bvh.triangleEdges_);
+        std::vector<int> order;
+        readVector(in, order);
+        std::vector<double> bounds;
+        std::vector<int> links;
+        readVector(in, bounds);
+        readVector(in, links);
+        const std::size_t nodeCount = links.size() / 3;
+        if(bounds.size() == 6 * nodeCount && links.size() == 3 * nodeCount)
+        {
+            bvh.nodes_.resize(nodeCount);
+            for(std::size_t n = 0; n < nodeCount; ++n)
+            {
+                Node& node = bvh.nodes_[n];
+                node.bounds.min() = Eigen::Vector3d::Map(&bounds[6*n]);
+                node.bounds.max() = Eigen::Vector3d::Map(&bounds[6*n + 3]);
+                node.first = links[3*n];
+                node.count = links[3*n + 1];
+                node.right = links[3*n + 2];
+            }
+        }
+
+        const int triangleCount = bvh.mesh_.triangleCount();
+        bool valid = in && triangleCount > 0 && !bvh.nodes_.empty()
+                && int(order.size()) == triangleCount
+                && int(bvh.triangleEdges_.size()) == 3 * triangleCount
+                && bvh.faceNormals_.cols() == triangleCount
+                && bvh.vertexNormals_.cols() == bvh.mesh_.vertexCount()
+                && bvh.mesh_.triangles.minCoeff() >= 0 && bvh.mesh_.triangles.maxCoeff() < bvh.mesh_.vertexCount();
+        for(std::size_t i = 0; valid && i < order.size(); ++i)
+        {
+            valid = order[i] >= 0 && order[i] < triangleCount;
+        }
+        for(int e = 0; valid && e < 3 * triangleCount; ++e)
+        {
+            valid = bvh.triangleEdges_[e] >= 0 && bvh.triangleEdges_[e] < bvh.edgeNormals_.cols();
+        }
+        for(int n = 0; valid && n < int(nodeCount); ++n)
+        {
+            // inner nodes must point forwards, so a traversal always terminates
+            const Node& node = bvh.nodes_[n];
+            valid = node.count
+                  ? (node.first >= 0 && node.count > 0 && node.first + node.count <= triangleCount)
+                  : (n + 1 < int(nodeCount) && node.right > n + 1 && node.right < int(nodeCount));
+        }
+        if(!valid)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("TriangleMeshBVH: the saved hierarchy is truncated or corrupt"));
+        }
+
+        bvh.triangles_.reserve(order.size());
+        for(int t : order) bvh.triangles_.push_back(bvh.triangleData(t));
+        return bvh;
+    }
+
+    /// bounds of the whole mesh
+    const Eigen::AlignedBox3d& bounds() const { return nodes_.front().bounds; }
+
+    /// @brief the closest point on the surface to point
+    /// @param maxDistance only search this far, which is much faster for proximity checks
+    /// @return false when no surface is within maxDistance, closest is then unchanged
+    bool closestPoint(const Eigen::Vector3d& point, ClosestPoint& closest,
+                      double maxDistance = std::numeric_limits<double>::infinity()) const
+    {
+        double best = (maxDistance < std::numeric_limits<double>::infinity()) ? maxDistance * maxDistance : maxDistance;
+        int bestTriangle = -1;
+        int bestFeature = Face;
+        Eigen::Vector3d bestPoint = Eigen::Vector3d::Zero();
+
+        int stack[64];
+        int stackSize = 0;
+        if(nodes_.front().bounds.squaredExteriorDistance(point) <= best) stack[stackSize++] = 0;
+        while(stackSize)
+        {
+            const int index = stack[--stackSize];
+            const Node& node = nodes_[index];
+            if(node.bounds.squaredExteriorDistance(point) > best) continue;
+
+            if(node.count)
+            {
+                for(int i = node.first; i < node.first + node.count; ++i)
+                {
+                    int feature;
+                    Eigen::Vector3d candidate = closestPointOnTriangle(point, triangles_[i], feature);
+                    double distanceSquared = (candidate - point).squaredNorm();
+                    if(distanceSquared < best)
+                    {
+                        best = distanceSquared;
+                        bestTriangle = i;
+                        bestFeature = feature;
+                        bestPoint = candidate;
+                    }
+                }
+                continue;
+            }
+
+            // visit the nearer child first, it usually shrinks best enough to skip the other
+            const int left = index + 1;
+            const int right = node.right;
+            double leftDistance = nodes_[left].bounds.squaredExteriorDistance(point);
+            double rightDistance = nodes_[right].bounds.squaredExteriorDistance(point);
+            if(leftDistance < rightDistance)
+            {
+                if(rightDistance <= best) stack[stackSize++] = right;
+                if(leftDistance <= best) stack[stackSize++] = left;
+            }
+            else
+            {
+                if(leftDistance <= best) stack[stackSize++] = left;
+                if(rightDistance <= best) stack[stackSize++] = right;
+            }
+        }
+
+        if(bestTriangle < 0) return false;
+        const Triangle& triangle = triangles_[bestTriangle];
+        closest.point = bestPoint;
+        closest.normal = triangle.normal;
+        closest.triangle = triangle.index;
+        closest.distanceSquared = best;
+        const double distance = std::sqrt(best);
+        closest.signedDistance = ((point - bestPoint).dot(pseudoNormal(triangle, bestFeature)) < 0.0) ? -distance : distance;
+        return true;
+    }
+
+    /// @return the distance to the surface, negative inside the mesh
+    double signedDistance(const Eigen::Vector3d& point) const
+    {
+        ClosestPoint closest;
+        closestPoint(point, closest);
+        return closest.signedDistance;
+    }
+
+    /// @brief closest points of many query points at once, split across threads
+    ///
+    /// @param points one query point per column
+    /// @param closest output closest surface point per column
+    /// @param normals output unit normal of the closest triangle per column
+    /// @param signedDistances output signed distance of each point
+    /// @param threadCount 0 uses std::thread::hardware_concurrency(), small batches use fewer threads
+    void closestPoints(const Eigen::Matrix3Xd& points, Eigen::Matrix3Xd& closest, Eigen::Matrix3Xd& normals,
+                       Eigen::VectorXd& signedDistances, unsigned int threadCount = 0) const
+    {
+        const int count = static_cast<int>(points.cols());
+        closest.resize(3, count);
+        normals.resize(3, count);
+        signedDistances.resize(count);
+
+        auto query = [&](int begin, int end){
+            ClosestPoint result;
+            for(int i = begin; i < end; ++i)
+            {
+                closestPoint(points.col(i), result);
+                closest.col(i) = result.point;
+                normals.col(i) = result.normal;
+                signedDistances(i) = result.signedDistance;
+            }
+        };
+
+        // starting a thread costs about as much as a few hundred queries
+        static const int minPointsPerThread = 256;
+        if(threadCount == 0) threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+        threadCount = std::max(1u, std::min(threadCount, static_cast<unsigned int>(count / minPointsPerThread)));
+        if(threadCount == 1)
+        {
+            query(0, count);
+            return;
+        }
+
+        std::vector<std::thread> threads;
+        const int chunk = (count + int(threadCount) - 1) / int(threadCount);
+        for(unsigned int t = 1; t < threadCount; ++t)
+        {
+            int begin = std::min(count, int(t) * chunk);
+            threads.emplace_back(query, begin, std::min(count, begin + chunk));
+        }
+        query(0, std::min(count, chunk));
+        for(std::thread& thread : threads) thread.join();
+    }
+
+    /// @name closest point interface used by IterativeClosestPoint, same as TargetModel
+    /// @{
+    bool hasNormals() const { return true; }
+
+    /// @return the squared distance from point to the surface
+    double closestPoint(const Eigen::Vector3d& point, Eigen::Vector3d& closest, Eigen::Vector3d& normal) const
+    {
+        ClosestPoint result;
+        closestPoint(point, result);
+        closest = result.point;
+        normal = result.normal;
+        return result.distanceSquared;
+    }
+    /// @}
+
+private:
+
+    /// changes whenever the layout written by save() does
+    enum { fileVersion = 1 };
+
+    TriangleMeshBVH() {}
+
+    template<typename T>
+    static void writeValue(std::ostream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    static T readValue(std::istream& in)
+    {
+        T value = T();
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+
+    /// bytes left in a seekable stream, so sizes read from a corrupt file cannot request huge allocations
+    static uint64_t remaining(std::istream& in)
+    {
+        const std::streampos position = in.tellg();
+        in.seekg(0, std::ios::end);
+        const std::streampos end = in.tellg();
+        in.seekg(position);
+        return (in && end >= position) ? uint64_t(end - position) : 0;
+    }
+
+    template<typename T>
+    static void writeVector(std::ostream& out, const std::vector<T>& values)
+    {
+        writeValue(out, static_cast<uint64_t>(values.size()));
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    template<typename T>
+    static void readVector(std::istream& in, std::vector<T>& values)
+    {
+        const uint64_t size = readValue<uint64_t>(in);
+        if(!in || size > remaining(in) / sizeof(T)) { in.setstate(std::ios::failbit); return; }
+        values.resize(size);
+        in.read(reinterpret_cast<char*>(values.data()), size * sizeof(T));
+    }
+
+    /// matrices with 3 rows and any number of columns
+    template<typename Scalar>
+    static void writeMatrix(std::ostream& out, const Eigen::Matrix<Scalar,3,Eigen::Dynamic>& matrix)
+    {
+        writeValue(out, static_cast<uint64_t>(matrix.cols()));
+        out.write(reinterpret_cast<const char*>(matrix.data()), matrix.size() * sizeof(Scalar));
+    }
+
+    template<typename Scalar>
+    static void readMatrix(std::istream& in, Eigen::Matrix<Scalar,3,Eigen::Dynamic>& matrix)
+    {
+        const uint64_t cols = readValue<uint64_t>(in);
+        if(!in || cols > remaining(in) / (3 * sizeof(Scalar))) { in.setstate(std::ios::failbit); return; }
+        matrix.resize(3, cols);
+        in.read(reinterpret_cast<char*>(matrix.data()), matrix.size() * sizeof(Scalar));
+    }
+
+    /// region of a triangle a point is closest to
+    enum Feature { VertexA, VertexB, VertexC, EdgeAB, EdgeBC, EdgeCA, Face };
+
+    struct Node
+    {
+        Eigen::AlignedBox3d bounds;
+        int first = 0; ///< first triangle of a leaf
+        int count = 0; ///< triangles in a leaf, 0 for an inner node whose left child is the next node
+        int right = 0; ///< right child of an inner node
+    };
+
+    struct Triangle
+    {
+        Eigen::Vector3d a, b, c;
+        Eigen::Vector3d normal;
+        int index;        ///< triangle index in the mesh
+        int vertices[3];  ///< vertex indices in the mesh
+        int edges[3];     ///< pseudo normal of edges AB, BC and CA in edgeNormals_
+    };
+
+    Triangle triangleData(int t) const
+    {
+        Triangle triangle;
+        triangle.a = mesh_.vertex(t,0);
+        triangle.b = mesh_.vertex(t,1);
+        triangle.c = mesh_.vertex(t,2);
+        triangle.normal = faceNormals_.col(t);
+        triangle.index = t;
+        for(int corner = 0; corner < 3; ++corner)
+        {
+            triangle.vertices[corner] = mesh_.triangles(corner,t);
+            triangle.edges[corner] = triangleEdges_[3*t + corner];
+        }
+        return triangle;
+    }
+
+    /// angle weighted vertex normals and edge normals, the mean of the two adjacent face normals
+    void buildPseudoNormals()
+    {
+        faceNormals_ = mesh_.faceNormals();
+        vertexNormals_ = mesh_.vertexNormals();
+
+        std::map<std::pair<int,int>,int> edgeIndex;
+        std::vector<Eigen::Vector3d> edgeSums;
+        triangleEdges_.resize(3 * mesh_.triangleCount());
+        for(int t = 0; t < mesh_.triangleCount(); ++t)
+        {
+            for(int corner = 0; corner < 3; ++corner)
+            {
+                int v0 = mesh_.triangles(corner,t);
+                int v1 = mesh_.triangles((corner+1)%3,t);
+                auto inserted = edgeIndex.insert(std::make_pair(std::make_pair(std::min(v0,v1), std::max(v0,v1)), int(edgeSums.size())));
+                if(inserted.second) edgeSums.push_back(Eigen::Vector3d::Zero());
+                edgeSums[inserted.first->second] += faceNormals_.col(t);
+                triangleEdges_[3*t + corner] = inserted.first->second;
+            }
+        }
+        edgeNormals_.resize(3, edgeSums.size());
+        for(std::size_t e = 0; e < edgeSums.size(); ++e)
+        {
+            double norm = edgeSums[e].norm();
+            edgeNormals_.col(e) = (norm > 0.0) ? Eigen::Vector3d(edgeSums[e] / norm) : Eigen::Vector3d::Zero();
+        }
+    }
+
+    Eigen::Vector3d pseudoNormal(const Triangle& triangle, int feature) const
+    {
+        switch(feature)
+        {
+            case VertexA: return vertexNormals_.col(triangle.vertices[0]);
+            case VertexB: return vertexNormals_.col(triangle.vertices[1]);
+            case VertexC: return vertexNormals_.col(triangle.vertices[2]);
+            case EdgeAB:  return edgeNormals_.col(triangle.edges[0]);
+            case EdgeBC:  return edgeNormals_.col(triangle.edges[1]);
+            case EdgeCA:  return edgeNormals_.col(triangle.edges[2]);
+            default:      return triangle.normal;
+        }
+    }
+
+    /// @brief recursively build nodes over order[begin,end), reordering it so each leaf is contiguous
+    int build(std::vector<int>& order, int begin, int end, int leafSize)
+    {
+        const int nodeIndex = static_cast<int>(nodes_.size());
+        nodes_.push_back(Node());
+
+        Eigen::AlignedBox3d bounds;
+        Eigen::AlignedBox3d centroidBounds;
+        for(int i = begin; i < end; ++i)
+        {
+            int t = order[i];
+            for(int corner = 0; corner < 3; ++corner) bounds.extend(mesh_.vertex(t,corner));
+            centroidBounds.extend(centroid(t));
+        }
+        nodes_[nodeIndex].bounds = bounds;
+
+        int axis;
+        centroidBounds.sizes().maxCoeff(&axis);
+        if(end - begin <= leafSize || centroidBounds.sizes()(axis) <= 0.0)
+        {
+            nodes_[nodeIndex].first = begin;
+            nodes_[nodeIndex].count = end - begin;
+            return nodeIndex;
+        }
+
+        const int middle = begin + (end - begin) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                         [&](int t0, int t1){ return centroid(t0)(axis) < centroid(t1)(axis); });
+        build(order, begin, middle, leafSize);
+        int right = build(order, middle, end, leafSize);
+        nodes_[nodeIndex].right = right;
+        return nodeIndex;
+    }
+
+    Eigen::Vector3d centroid(int t) const
+    {
+        return (mesh_.vertex(t,0) + mesh_.vertex(t,1) + mesh_.vertex(t,2)) / 3.0;
+    }
+
+    /// @brief closest point on a triangle and the feature it lies on
+    /// @see Christer Ericson, Real-Time Collision Detection, section 5.1.5
+    static Eigen::Vector3d closestPointOnTriangle(const Eigen::Vector3d& p, const Triangle& triangle, int& feature)
+    {
+        const Eigen::Vector3d& a = triangle.a;
+        const Eigen::Vector3d& b = triangle.b;
+        const Eigen::Vector3d& c = triangle.c;
+        const Eigen::Vector3d ab = b - a;
+        const Eigen::Vector3d ac = c - a;
+
+        const Eigen::Vector3d ap = p - a;
+        const double d1 = ab.dot(ap);
+        const double d2 = ac.dot(ap);
+        if(d1 <= 0.0 && d2 <= 0.0) { feature = VertexA; return a; }
+
+        const Eigen::Vector3d bp = p - b;
+        const double d3 = ab.dot(bp);
+        const double d4 = ac.dot(bp);
+        if(d3 >= 0.0 && d4 <= d3) { feature = VertexB; return b; }
+
+        const double vc = d1*d4 - d3*d2;
+        if(vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+        {
+            feature = EdgeAB;
+            return a + (d1 / (d1 - d3)) * ab;
+        }
+
+        const Eigen::Vector3d cp = p - c;
+        const double d5 = ab.dot(cp);
+        const double d6 = ac.dot(cp);
+        if(d6 >= 0.0 && d5 <= d6) { feature = VertexC; return c; }
+
+        const double vb = d5*d2 - d1*d6;
+        if(vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+        {
+            feature = EdgeCA;
+            return a + (d2 / (d2 - d6)) * ac;
+        }
+
+        const double va = d3*d6 - d5*d4;
+        if(va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+        {
+            feature = EdgeBC;
+            return b + ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (c - b);
+        }
+
+        const double sum = va + vb + vc;
+        if(!(sum > 0.0))
+        {
+            // degenerate triangle, the regions above already covered its vertices and edges
+            feature = VertexA;
+            return a;
+        }
+        feature = Face;
+        return a + (vb / sum) * ab + (vc / sum) * ac;
+    }
+
+    TriangleMesh mesh_;
+    std::vector<Node> nodes_;
+    std::vector<Triangle> triangles_;
+    Eigen::Matrix3Xd faceNormals_;
+    Eigen::Matrix3Xd vertexNormals_;
+    Eigen::Matrix3Xd edgeNormals_;
+    std::vector<int> triangleEdges_;
+};
+
+namespace detail {
+
+/// 64 bit FNV-1a hash, which identifies the STL file a cached hierarchy was built from
+inline uint64_t fnv1a(const std::string& bytes)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for(unsigned char c : bytes)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+} // detail
+
+/// @brief Load an STL file as a TriangleMeshBVH, optionally reusing a hierarchy cached on disk
+///
+/// Nothing is written unless a cache file is given, the STL file may well sit in a
+/// read only or shared data directory. The cache file records the size and hash of
+/// the STL file and the scale it was loaded with. When they all match, the hierarchy
+/// is read back directly, which takes milliseconds instead of the fraction of a second
+/// needed to weld and build a full resolution bone model. Otherwise the hierarchy is
+/// built and the cache rewritten. A cache that cannot be written is not an error, it
+/// is just slower next time.
+///
+/// @param stlFile binary or ASCII STL file, see loadStlFile()
+/// @param scale multiplies every coordinate, for example 0.001 for models in millimeters
+/// @param cacheFile where to keep the built hierarchy, such as a file in the user's cache directory, empty to always build it
+inline std::shared_ptr<const TriangleMeshBVH> loadTriangleMeshBVH(const std::string& stlFile, double scale = 1.0,
+                                                                  const std::string& cacheFile = std::string())
+{
+    if(cacheFile.empty()) return std::make_shared<const TriangleMeshBVH>(loadStlFile(stlFile, scale));
+
+    std::string bytes;
+    if(!detail::readFile(stlFile, bytes))
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error(std::string("loadTriangleMeshBVH: unable to open ") + stlFile));
+    }
+    const uint64_t size = bytes.size();
+    const uint64_t hash = detail::fnv1a(bytes);
+
+    static const char magic[8] = {'g','r','l','b','v','h','\0','\0'};
+    {
+        std::ifstream cache(cacheFile, std::ios::binary);
+        char cachedMagic[8] = {};
+        uint64_t cachedSize = 0, cachedHash = 0;
+        double cachedScale = 0.0;
+        cache.read(cachedMagic, sizeof(cachedMagic));
+        cache.read(reinterpret_cast<char*>(&cachedSize), sizeof(cachedSize));
+        cache.read(reinterpret_cast<char*>(&cachedHash), sizeof(cachedHash));
+        cache.read(reinterpret_cast<char*>(&cachedScale), sizeof(cachedScale));
+        if(cache && std::equal(magic, magic + sizeof(magic), cachedMagic)
+                 && cachedSize == size && cachedHash == hash && cachedScale == scale)
+        {
+            try
+            {
+                return std::make_shared<const TriangleMeshBVH>(TriangleMeshBVH::load(cache));
+            }
+            catch(const std::runtime_error&)
+            {
+                // stale or damaged cache, rebuild it below
+            }
+        }
+    }
+
+    // loadStlFile reads the file again, which is cheap next to welding and building
+    auto bvh = std::make_shared<const TriangleMeshBVH>(loadStlFile(stlFile, scale));
+    std::ofstream cache(cacheFile, std::ios::binary | std::ios::trunc);
+    if(cache)
+    {
+        cache.write(magic, sizeof(magic));
+        cache.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        cache.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+        cache.write(reinterpret_cast<const char*>(&scale), sizeof(scale));
+        try
+        {
+            bvh->save(cache);
+        }
+        catch(const std::runtime_error&)
+        {
+            cache.close();
+            std::remove(cacheFile.c_str());
+        }
+    }
+    return bvh;
+}
+
+}} // grl::registration
+
+#endif // _GRL_REGISTRATION_TRIANGLE_MESH_BVH_HPP_
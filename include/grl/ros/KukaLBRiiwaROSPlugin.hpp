@@ -5,6 +5,9 @@
 #include <memory>
 #include <array>
 #include <vector>
+#include <chrono>
+#include <atomic>
+#include <utility>
 
 #include <boost/exception/all.hpp>
 #include <boost/algorithm/string.hpp>
@@ -19,6 +22,9 @@
 #include <geometry_msgs/Wrench.h>
 
 #include "grl/kuka/KukaDriver.hpp"
+#include "grl/path/JointTrajectory.hpp"
+#include "grl/path/TimeOptimalParameterization.hpp"
+#include "grl/TripleBuffer.hpp"
 #include "grl/flatbuffer/JointState_generated.h"
 #include "grl/flatbuffer/ArmControlState_generated.h"
 #include "grl/flatbuffer/KUKAiiwa_generated.h"
@@ -33,6 +39,13 @@ namespace grl {
      *
      * This class contains code to offer a simple communication layer between ROS and the KUKA LBR iiwa
      *
+     * Three threads may share it: ROS callbacks, run_one() talking to the arm, and
+     * publish_one() publishing what the arm reported. Callbacks hand goals to
+     * run_one() and run_one() hands arm states to publish_one() through lock free
+     * TripleBuffer objects, so neither message bursts nor publishing can delay the
+     * driver cycle. jt_mutex only serializes the callbacks with each other and with
+     * publish_one(), the driver thread never takes it.
+     *
      * @todo Main Loop Update Rate must be supplied to underlying Driver for FRI mode. see KukaLBRiiwaVrepPlugin for reference, particularly kukaDriverP_->set(simulationTimeStep_,time_duration_command_tag());
      */
     class KukaLBRiiwaROSPlugin : public std::enable_shared_from_this<KukaLBRiiwaROSPlugin>
@@ -136,8 +149,13 @@ namespace grl {
 
 
       KukaLBRiiwaROSPlugin(Params params = defaultParams())
-        : debug(false),params_(params), nh_("")
+        : debug(false),
+          interaction_mode(grl::flatbuffer::ArmState::NONE),
+          applied_interaction_mode_(grl::flatbuffer::ArmState::NONE),
+          params_(params), nh_("")
       {
+        simJointPosition.reserve(KUKA::LBRState::NUM_DOF);
+        simJointForce.reserve(KUKA::LBRState::NUM_DOF);
         loadRosParams(params_);
       }
 
@@ -174,6 +192,35 @@ namespace grl {
           //jt_sub_ = nh.subscribe<trajectory_msgs::JointTrajectory>("joint_traj_cmd",1000,boost::bind(&KukaLBRiiwaROSPlugin::jt_callback, this, _1));
 
         params_ = params;
+
+        // joint trajectories keep the planner's timing unless ~TrajectoryTiming is TIME_OPTIMAL
+        {
+          boost::lock_guard<boost::mutex> lock(jt_mutex);
+          ::ros::NodeHandle privateNh("~");
+          std::string trajectoryTiming("AS_RECEIVED");
+          privateNh.getParam("TrajectoryTiming", trajectoryTiming);
+          timeOptimalTrajectories_ = boost::iequals(trajectoryTiming, "TIME_OPTIMAL");
+          grl::path::TimeOptimalParameterization::Params toppParams = grl::path::TimeOptimalParameterization::defaultParams();
+          grl::robot::arm::copy(std::get<RobotModel>(params), std::back_inserter(std::get<grl::path::TimeOptimalParameterization::VelocityLimits>(toppParams)),
+                                grl::revolute_joint_velocity_open_chain_state_constraint_tag());
+          grl::robot::arm::copy(std::get<RobotModel>(params), std::back_inserter(std::get<grl::path::TimeOptimalParameterization::AccelerationLimits>(toppParams)),
+                                grl::revolute_joint_acceleration_open_chain_state_constraint_tag());
+          // leave a margin for the arm to track the retimed commands
+          privateNh.param("VelocityScaling", std::get<grl::path::TimeOptimalParameterization::VelocityScaling>(toppParams), 0.5);
+          privateNh.param("AccelerationScaling", std::get<grl::path::TimeOptimalParameterization::AccelerationScaling>(toppParams), 0.5);
+          std::vector<double>& lowerLimits = std::get<grl::path::TimeOptimalParameterization::PositionLowerLimits>(toppParams);
+          std::vector<double>& upperLimits = std::get<grl::path::TimeOptimalParameterization::PositionUpperLimits>(toppParams);
+          grl::robot::arm::copy(std::get<RobotModel>(params), std::back_inserter(upperLimits),
+                                grl::revolute_joint_angle_open_chain_state_constraint_tag());
+          for (double limit : upperLimits) lowerLimits.push_back(-limit);
+          if (timeOptimalTrajectories_ && (std::get<grl::path::TimeOptimalParameterization::VelocityLimits>(toppParams).size() != KUKA::LBRState::NUM_DOF ||
+                                           upperLimits.size() != KUKA::LBRState::NUM_DOF)) {
+            ROS_WARN("No joint limits are known for RobotModel %s, joint trajectories will keep their own timing", std::get<RobotModel>(params).c_str());
+            timeOptimalTrajectories_ = false;
+          }
+          if (timeOptimalTrajectories_) topp_.setParams(toppParams);
+        }
+
         // keep driver threads from exiting immediately after creation, because they have work to do!
         device_driver_workP_.reset(new boost::asio::io_service::work(device_driver_io_service));
 
@@ -207,33 +254,46 @@ namespace grl {
 
       /**
        * ROS joint trajectory callback
-       * this code needs to execute the joint trajectory on the robot
+       *
+       * Buffers the whole trajectory with the time_from_start of each point, run_one()
+       * then streams it to the arm in MoveArmJointServo mode, interpolating between
+       * the points at the rate run_one() is called. A new trajectory or trajectory
+       * point preempts the one being executed, and an empty trajectory stops it
+       * where it is.
+       *
+       * If the first point is not at time 0, the motion starts from the last
+       * commanded position, or the measured one if nothing was commanded yet.
+       *
+       * If the ~TrajectoryTiming parameter is TIME_OPTIMAL rather than the default
+       * AS_RECEIVED, the time_from_start and velocities of the points are replaced
+       * by the fastest timing within ~VelocityScaling and ~AccelerationScaling,
+       * 0.5 by default, of the joint limits of RobotModel, starting from that
+       * position and ending at rest, see grl::path::TimeOptimalParameterization.
+       * The points are joined by a spline, and a trajectory whose spline leaves
+       * the joint position limits is rejected.
+       *
+       * A rejected trajectory, such as one with the wrong number of joints or a
+       * decreasing time_from_start, is reported with ROS_ERROR and dropped, so the
+       * arm carries on with the command it already had.
        */
       void jt_callback(const trajectory_msgs::JointTrajectoryConstPtr &msg) {
         boost::lock_guard<boost::mutex> lock(jt_mutex);
 
-
-        for(auto &pt: msg->points) {
-          // positions velocities ac
-          if (pt.positions.size() != KUKA::LBRState::NUM_DOF) {
-            BOOST_THROW_EXCEPTION(std::runtime_error("Malformed joint trajectory request! Wrong number of joints."));
-          }
-
-          // handle
-          //simJointPosition
-          simJointPosition.clear();
-          boost::copy(pt.positions,std::back_inserter(simJointPosition));
-          //simJointVelocity
-          simJointVelocity.clear();
-          boost::copy(pt.velocities,std::back_inserter(simJointVelocity));
-          //simJointForce
-          simJointForce.clear();
-          boost::copy(pt.effort,std::back_inserter(simJointForce));
-
-          ///@todo: execute the rest of the trajectory
-          break;
+        // build into trajectory_ so a rejected trajectory leaves commands_ untouched
+        try {
+          buildTrajectory(*msg, trajectory_);
+        } catch (...) {
+          ROS_ERROR("Rejected joint trajectory: %s", boost::current_exception_diagnostic_information().c_str());
+          return;
         }
 
+        Command& command = commands_.back();
+        command.kind = msg->points.empty() ? Command::Stop : Command::Trajectory;
+        std::swap(command.trajectory, trajectory_);
+        if (debug && command.kind == Command::Trajectory) {
+          ROS_INFO("Executing joint trajectory with %zu points over %f seconds", command.trajectory.size(), command.trajectory.duration());
+        }
+        commands_.publish();
       }
 
 
@@ -255,36 +315,31 @@ namespace grl {
               ROS_INFO(info.c_str());
             }
 
+            // run_one() passes the new mode on to the driver
             interaction_mode = static_cast<grl::flatbuffer::ArmState>(i);
-            KukaDriverP_->set(interaction_mode);
             break;
           }
         }
 
       }
 
-      /// ROS joint trajectory callback
-      /// this code needs to execute the joint trajectory on the robot
+      /// ROS joint trajectory point callback
+      /// a single point preempts any trajectory being executed and is sent as it is
       void jt_pt_callback(const trajectory_msgs::JointTrajectoryPointConstPtr &msg) {
         boost::lock_guard<boost::mutex> lock(jt_mutex);
 
           // positions velocities ac
           if (msg->positions.size() != KUKA::LBRState::NUM_DOF) {
-            BOOST_THROW_EXCEPTION(std::runtime_error("Malformed joint trajectory request! Wrong number of joints."));
+            ROS_ERROR("Malformed joint trajectory point request! Wrong number of joints.");
+            return;
           }
 
-          // handle
-          //simJointPosition
-          simJointPosition.clear();
-          boost::copy(msg->positions,std::back_inserter(simJointPosition));
-          //simJointVelocity
-          simJointVelocity.clear();
-          boost::copy(msg->velocities,std::back_inserter(simJointVelocity));
-          //simJointForce
-          simJointForce.clear();
-          boost::copy(msg->effort,std::back_inserter(simJointForce));
-
-          ///@todo: execute the rest of the trajectory
+          Command& command = commands_.back();
+          command.kind = Command::Point;
+          command.position.assign(msg->positions.begin(), msg->positions.end());
+          command.velocity.assign(msg->velocities.begin(), msg->velocities.end());
+          command.effort.assign(msg->effort.begin(), msg->effort.end());
+          commands_.publish();
       }
 
 
@@ -300,6 +355,9 @@ namespace grl {
      ///
      /// @brief spin once, call this repeatedly to run the driver
      ///
+     /// Takes the latest goal from the ROS callbacks, sends the arm its command and
+     /// hands the state it reports to publish_one(). Only memory shared with the
+     /// other threads is the lock free TripleBuffer objects.
      ///
      bool run_one()
      {
@@ -308,12 +366,26 @@ namespace grl {
 
        if(KukaDriverP_){
 
+         applyCommand();
 
-         switch(interaction_mode) {
+         const grl::flatbuffer::ArmState mode = interaction_mode;
+         if(mode != applied_interaction_mode_) {
+           KukaDriverP_->set(mode);
+           applied_interaction_mode_ = mode;
+         }
+
+         switch(mode) {
            case grl::flatbuffer::ArmState::MoveArmJointServo:
              if (debug) {
               ROS_INFO("Arm is in SERVO Mode");
              }
+             if(trajectoryActive_) {
+               const grl::path::JointTrajectory& trajectory = commands_.front().trajectory;
+               const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - trajectoryStart_).count();
+               trajectory.sample(elapsed, simJointPosition);
+               // the last point stays in simJointPosition, so the arm holds it
+               if(elapsed >= trajectory.duration()) trajectoryActive_ = false;
+             }
              if(simJointPosition.size()) KukaDriverP_->set( simJointPosition, grl::revolute_joint_angle_open_chain_command_tag());
              /// @todo setting joint position clears joint force in KukaDriverP_. Is this right or should position and force be configurable simultaeously?
              //if(simJointForce.size()) KukaDriverP_->set( simJointForce, grl::revolute_joint_torque_open_chain_command_tag());
@@ -345,36 +417,18 @@ namespace grl {
 
          if(haveNewData)
          {
-
-           // We have the real kuka state read from the device now
-           // update real joint angle data
-           current_js_.position.clear();
-           KukaDriverP_->get(std::back_inserter(current_js_.position), grl::revolute_joint_angle_open_chain_state_tag());
-
-           current_js_.effort.clear();
-           KukaDriverP_->get(std::back_inserter(current_js_.effort), grl::revolute_joint_torque_open_chain_state_tag());
-
-           //current_js_.velocity.clear();
-           //grl::robot::arm::copy(friData_->monitoringMsg, std::back_inserter(current_js_.velocity), grl::revolute_joint_angle_open_chain_state_tag());
-           current_js_.header.stamp = ::ros::Time::now();
-           current_js_.header.seq += 1;
-           js_pub_.publish(current_js_);
-         }
-
-         if(haveNewData)
-         {
-             std::vector<double> wrench_vector;
-             KukaDriverP_->getWrench(std::back_inserter(wrench_vector));
-             if (!wrench_vector.empty())
-             {
-                 current_wrench.force.x = wrench_vector[0];
-                 current_wrench.force.y = wrench_vector[1];
-                 current_wrench.force.z = wrench_vector[2];
-                 current_wrench.torque.x = wrench_vector[3];
-                 current_wrench.torque.y = wrench_vector[4];
-                 current_wrench.torque.z = wrench_vector[5];
-             }
-              wrench_pub_.publish(current_wrench);
+           // We have the real kuka state read from the device now,
+           // the vectors keep their capacity so this does not allocate after the first cycles
+           ArmStateSample& sample = armStates_.back();
+           sample.position.clear();
+           KukaDriverP_->get(std::back_inserter(sample.position), grl::revolute_joint_angle_open_chain_state_tag());
+           sample.effort.clear();
+           KukaDriverP_->get(std::back_inserter(sample.effort), grl::revolute_joint_torque_open_chain_state_tag());
+           sample.wrench.clear();
+           KukaDriverP_->getWrench(std::back_inserter(sample.wrench));
+           sample.commandedPosition = simJointPosition;
+           sample.stamp = ::ros::Time::now();
+           armStates_.publish();
          }
 
        }
@@ -383,11 +437,51 @@ namespace grl {
        return haveNewData;
      }
 
+     ///
+     /// @brief publish the latest arm state from run_one(), if there is a new one
+     ///
+     /// Call this repeatedly from a thread other than the one calling run_one().
+     /// The joint state and wrench messages are members reused for every publication.
+     ///
+     bool publish_one()
+     {
+       if(!armStates_.update()) return false;
+       const ArmStateSample& sample = armStates_.front();
+
+       {
+         // the start of the next trajectory
+         boost::lock_guard<boost::mutex> lock(jt_mutex);
+         lastMeasuredPosition_ = sample.position;
+         lastCommandedPosition_ = sample.commandedPosition;
+       }
+
+       current_js_.position = sample.position;
+       current_js_.effort = sample.effort;
+       //current_js_.velocity.clear();
+       //grl::robot::arm::copy(friData_->monitoringMsg, std::back_inserter(current_js_.velocity), grl::revolute_joint_angle_open_chain_state_tag());
+       current_js_.header.stamp = sample.stamp;
+       current_js_.header.seq += 1;
+       js_pub_.publish(current_js_);
+
+       if (sample.wrench.size() >= 6)
+       {
+           current_wrench.force.x = sample.wrench[0];
+           current_wrench.force.y = sample.wrench[1];
+           current_wrench.force.z = sample.wrench[2];
+           current_wrench.torque.x = sample.wrench[3];
+           current_wrench.torque.y = sample.wrench[4];
+           current_wrench.torque.z = sample.wrench[5];
+       }
+       wrench_pub_.publish(current_wrench);
+       return true;
+     }
+
       boost::asio::io_service device_driver_io_service;
       std::unique_ptr<boost::asio::io_service::work> device_driver_workP_;
       std::unique_ptr<std::thread> driver_threadP;
 
       /// @todo replace all these simJoint elements with simple KukaLBRiiwaROSPlugin::State
+      /// @note the simJoint elements belong to the thread calling run_one()
       std::vector<double> simJointPosition;// = {0.0,0.0,0.0,0.0,0.0,0.0,0.0};
       std::vector<double> simJointVelocity = {0.0,0.0,0.0,0.0,0.0,0.0,0.0};
       std::vector<double> simJointForce;// = {0.0,0.0,0.0,0.0,0.0,0.0,0.0};
@@ -401,12 +495,124 @@ namespace grl {
 
     private:
 
+      /// a goal from a ROS callback for run_one()
+      struct Command
+      {
+        enum Kind { None, Trajectory, Point, Stop };
+
+        Command() : kind(None), trajectory(KUKA::LBRState::NUM_DOF)
+        {
+          trajectory.reserve(1000);
+          position.reserve(KUKA::LBRState::NUM_DOF);
+          velocity.reserve(KUKA::LBRState::NUM_DOF);
+          effort.reserve(KUKA::LBRState::NUM_DOF);
+        }
+
+        Kind kind;
+        grl::path::JointTrajectory trajectory; ///< for Trajectory
+        std::vector<double> position;          ///< for Point
+        std::vector<double> velocity;          ///< for Point
+        std::vector<double> effort;            ///< for Point
+      };
+
+      /// what the arm reported in one cycle of run_one(), for publish_one()
+      struct ArmStateSample
+      {
+        ArmStateSample()
+        {
+          position.reserve(KUKA::LBRState::NUM_DOF);
+          effort.reserve(KUKA::LBRState::NUM_DOF);
+          commandedPosition.reserve(KUKA::LBRState::NUM_DOF);
+          wrench.reserve(6);
+        }
+
+        std::vector<double> position;
+        std::vector<double> effort;
+        std::vector<double> commandedPosition;
+        std::vector<double> wrench;
+        ::ros::Time stamp;
+      };
+
+      /// @brief jt_callback with jt_mutex held, the trajectory to follow, empty for a stop
+      /// @throws std::runtime_error if the trajectory is malformed or, with TIME_OPTIMAL, leaves the joint limits
+      void buildTrajectory(const trajectory_msgs::JointTrajectory& msg, grl::path::JointTrajectory& trajectory)
+      {
+        for(auto &pt: msg.points) {
+          if (pt.positions.size() != KUKA::LBRState::NUM_DOF) {
+            BOOST_THROW_EXCEPTION(std::runtime_error("Malformed joint trajectory request! Wrong number of joints."));
+          }
+          if (!pt.velocities.empty() && pt.velocities.size() != KUKA::LBRState::NUM_DOF) {
+            BOOST_THROW_EXCEPTION(std::runtime_error("Malformed joint trajectory request! Wrong number of joint velocities."));
+          }
+        }
+
+        trajectory.clear();
+        if (msg.points.empty()) return;
+
+        const std::vector<double>& start = (lastCommandedPosition_.size() == KUKA::LBRState::NUM_DOF) ? lastCommandedPosition_ : lastMeasuredPosition_;
+        if (timeOptimalTrajectories_) {
+          // only the path is kept, a start equal to the first point is skipped
+          path_.clear();
+          if (start.size() == KUKA::LBRState::NUM_DOF) path_.addWaypoint(0.0, start);
+          for(auto &pt: msg.points) path_.addWaypoint(0.0, pt.positions);
+          topp_.retime(path_, trajectory);
+        } else {
+          if (msg.points.front().time_from_start.toSec() > 0.0 && start.size() == KUKA::LBRState::NUM_DOF) {
+            trajectory.addWaypoint(0.0, start);
+          }
+          // addWaypoint() throws if time_from_start decreases
+          for(auto &pt: msg.points) {
+            trajectory.addWaypoint(std::max(0.0, pt.time_from_start.toSec()), pt.positions, pt.velocities);
+          }
+        }
+      }
+
+      /// driver thread, start executing the latest command from the callbacks
+      void applyCommand()
+      {
+        if(!commands_.update()) return;
+        const Command& command = commands_.front();
+        switch(command.kind) {
+          case Command::Trajectory:
+            // commands_.front().trajectory stays valid until the next update()
+            trajectoryStart_ = std::chrono::steady_clock::now();
+            trajectoryActive_ = true;
+            break;
+          case Command::Point:
+            trajectoryActive_ = false;
+            simJointPosition = command.position;
+            simJointVelocity = command.velocity;
+            simJointForce = command.effort;
+            break;
+          case Command::Stop:
+            trajectoryActive_ = false;
+            break;
+          default:
+            break;
+        }
+      }
+
       bool debug;
       std::size_t iteration_count_ = 0;
-      
-      grl::flatbuffer::ArmState interaction_mode;
+
+      /// set by mode_callback, sent to the driver by run_one()
+      std::atomic<grl::flatbuffer::ArmState> interaction_mode;
+      grl::flatbuffer::ArmState applied_interaction_mode_;
 
       boost::mutex jt_mutex;
+      grl::TripleBuffer<Command> commands_;         ///< callbacks to run_one()
+      grl::TripleBuffer<ArmStateSample> armStates_; ///< run_one() to publish_one()
+      std::vector<double> lastMeasuredPosition_;     ///< guarded by jt_mutex
+      std::vector<double> lastCommandedPosition_;    ///< guarded by jt_mutex
+      bool timeOptimalTrajectories_ = false;         ///< guarded by jt_mutex
+      grl::path::TimeOptimalParameterization topp_;  ///< guarded by jt_mutex
+      grl::path::JointTrajectory path_{KUKA::LBRState::NUM_DOF}; ///< guarded by jt_mutex
+      grl::path::JointTrajectory trajectory_{KUKA::LBRState::NUM_DOF}; ///< built by jt_callback before it is published, guarded by jt_mutex
+
+      // only used by run_one()
+      std::chrono::steady_clock::time_point trajectoryStart_;
+      bool trajectoryActive_ = false;
+
       boost::shared_ptr<robot::arm::KukaDriver> KukaDriverP_;
       Params params_;
 
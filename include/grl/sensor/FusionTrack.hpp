@@ -7,12 +7,22 @@
 #include <system_error>
 #include <algorithm>
 #include <memory>
+#include <chrono>
+#include <thread>
+#include <future>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <utility>
 
 // FusionTrack Libraries
 #include <ftkInterface.h>
 #include <geometryHelper.hpp> // I would like to get rid of this and use only ftk functions + remove atracsys_DIR/bin from include directories
 
 #include "grl/TimeEvent.hpp"
+#include "grl/TimeSeriesRing.hpp"
 
 #ifdef HAVE_SPDLOG
 /// The spdlog library https://github.com/gabime/spdlog
@@ -31,6 +41,93 @@ namespace sensor
 namespace detail
 {
 void updateDeviceSerialNumber(uint64 device, void *user, ftkDeviceType type);
+
+/// @brief 64 bit FNV-1a hash of the contents of a file
+/// @return false if the file cannot be read
+inline bool hashFile(const std::string &fileName, uint64_t &hash)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if(!file) return false;
+    const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    hash = 14695981039346656037ull;
+    for(unsigned char c : contents)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return true;
+}
+
+/// identifies a geometry cache file and the ftkGeometry layout it was written with
+static const char geometryCacheMagic[8] = {'g','r','l','f','t','k','g','1'};
+
+/// @brief read a geometry written by saveCachedGeometry()
+/// @return false if there is no cache file, or it is for different ini contents or a different ftkGeometry
+inline bool loadCachedGeometry(const std::string &cacheFile, uint64_t iniHash, ftkGeometry &geometry)
+{
+    std::ifstream file(cacheFile, std::ios::binary);
+    char magic[sizeof(geometryCacheMagic)];
+    uint64_t hash = 0;
+    uint32_t size = 0;
+    ftkGeometry cached;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char *>(&hash), sizeof(hash));
+    file.read(reinterpret_cast<char *>(&size), sizeof(size));
+    file.read(reinterpret_cast<char *>(&cached), sizeof(cached));
+    if(!file || std::memcmp(magic, geometryCacheMagic, sizeof(magic)) != 0 ||
+       hash != iniHash || size != sizeof(ftkGeometry))
+    {
+        return false;
+    }
+    geometry = cached;
+    return true;
+}
+
+/// @brief save a parsed geometry so the next start does not parse its ini file again
+///
+/// Best effort, a directory that cannot be written only means the ini is parsed every time.
+inline void saveCachedGeometry(const std::string &cacheFile, uint64_t iniHash, const ftkGeometry &geometry)
+{
+    std::ofstream file(cacheFile, std::ios::binary | std::ios::trunc);
+    const uint32_t size = sizeof(ftkGeometry);
+    file.write(geometryCacheMagic, sizeof(geometryCacheMagic));
+    file.write(reinterpret_cast<const char *>(&iniHash), sizeof(iniHash));
+    file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    file.write(reinterpret_cast<const char *>(&geometry), sizeof(geometry));
+}
+
+/// @brief a marker pose in meters, with the rotation matrix converted to a quaternion
+inline RigidPose ftkMarkerToRigidPose(const ftkMarker &marker)
+{
+    RigidPose pose;
+    for(int i = 0; i < 3; ++i) pose.translation[i] = marker.translationMM[i] / 1000.0;
+
+    // branch on the largest diagonal term so the divisor never gets small
+    const float (&r)[3][3] = marker.rotation;
+    std::array<double,4> &q = pose.rotation;
+    const double trace = r[0][0] + r[1][1] + r[2][2];
+    if(trace > 0.0)
+    {
+        const double s = 2.0 * std::sqrt(1.0 + trace);
+        q = {{0.25 * s, (r[2][1] - r[1][2]) / s, (r[0][2] - r[2][0]) / s, (r[1][0] - r[0][1]) / s}};
+    }
+    else if(r[0][0] > r[1][1] && r[0][0] > r[2][2])
+    {
+        const double s = 2.0 * std::sqrt(1.0 + r[0][0] - r[1][1] - r[2][2]);
+        q = {{(r[2][1] - r[1][2]) / s, 0.25 * s, (r[0][1] + r[1][0]) / s, (r[0][2] + r[2][0]) / s}};
+    }
+    else if(r[1][1] > r[2][2])
+    {
+        const double s = 2.0 * std::sqrt(1.0 + r[1][1] - r[0][0] - r[2][2]);
+        q = {{(r[0][2] - r[2][0]) / s, (r[0][1] + r[1][0]) / s, 0.25 * s, (r[1][2] + r[2][1]) / s}};
+    }
+    else
+    {
+        const double s = 2.0 * std::sqrt(1.0 + r[2][2] - r[0][0] - r[1][1]);
+        q = {{(r[1][0] - r[0][1]) / s, (r[0][2] + r[2][0]) / s, (r[1][2] + r[2][1]) / s, 0.25 * s}};
+    }
+    return pose;
+}
 }
 
 /// @class FusionTrack provides a single threaded driver for
@@ -64,6 +161,16 @@ class FusionTrack
         uint64_t blockLimitMilliseconds = 100;
         /// Maximum number of attempts to connect to any FusionTrack device before giving up
         uint64_t maximumConnectionAttempts = 10;
+        /// Wait after the first failed connection attempt, doubled after each further failure
+        uint64_t connectionBackoffMilliseconds = 10;
+        /// Give up connecting once this much time has passed, even with attempts left, 0 for no limit
+        uint64_t connectionDeadlineMilliseconds = 5000;
+        /// Save each parsed geometry ini file next to it as <ini file>.cache and load that
+        /// instead of parsing the ini while the ini file contents are unchanged.
+        /// Off by default since the ini files may be in a directory that should not be written.
+        bool cacheGeometries = false;
+        /// Poses kept for each loaded geometry in markerPoseHistory(), 0 keeps none, otherwise at least 2
+        std::size_t markerPoseHistoryCapacity = 1024;
         /// Geometries aka fiducials aka markers to be loaded from ini files.
         /// The data loaded should not repeat IDs from MarkerIDs.
         std::vector<std::string> geometryFilenames;
@@ -161,6 +268,10 @@ class FusionTrack
         Params params;
         params.blockLimitMilliseconds = 100;
         params.maximumConnectionAttempts = 10;
+        params.connectionBackoffMilliseconds = 10;
+        params.connectionDeadlineMilliseconds = 5000;
+        params.cacheGeometries = false;
+        params.markerPoseHistoryCapacity = 1024;
         params.name = "/FusionTrack";
         params.localClockID = "/control_computer/clock/steady";
         params.deviceClockID = "/clock/device";
@@ -230,8 +341,20 @@ class FusionTrack
         return geom;
     }
 
+    /// Connect to the FusionTrack devices and load the geometries in params.
+    ///
+    /// Geometry files are read while the devices are enumerated, from their cache
+    /// files when Params::cacheGeometries is set, and the geometries are then set on
+    /// each device in turn, since all devices share one ftkLibrary handle. Failed connection attempts are
+    /// retried with exponential backoff until Params::maximumConnectionAttempts or
+    /// Params::connectionDeadlineMilliseconds runs out.
     FusionTrack(Params params = defaultParams()) : m_params(params)
     {
+        // a single pose can't be interpolated, so TimeSeriesRing needs 2
+        if(m_params.markerPoseHistoryCapacity == 1)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error("FusionTrack: markerPoseHistoryCapacity must be 0 or at least 2"));
+        }
 #ifdef HAVE_SPDLOG
         if(!params.loggerName.empty())
         {
@@ -239,10 +362,26 @@ class FusionTrack
         }
 
 #endif // HAVE_SPDLOG
-        ftkError error;
+        // geometry files do not need the devices, read them while searching
+        std::future<std::vector<GeometryFile> > geometryFiles =
+            std::async(std::launch::async, &FusionTrack::readGeometryFiles,
+                       m_params.geometryFilenames, m_params.cacheGeometries);
+
+        ftkError error = FTK_OK;
         // search for devices
+        const auto start = std::chrono::steady_clock::now();
+        const std::chrono::milliseconds deadline(m_params.connectionDeadlineMilliseconds);
+        std::chrono::milliseconds backoff(m_params.connectionBackoffMilliseconds);
         for(std::size_t i = 0; i < m_params.maximumConnectionAttempts; i++)
         {
+            if(i > 0)
+            {
+                // wait twice as long after each failure, but not past the deadline
+                const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+                if(deadline.count() && elapsed >= deadline) break;
+                std::this_thread::sleep_for(deadline.count() ? std::min(backoff, deadline - elapsed) : backoff);
+                backoff *= 2;
+            }
             m_ftkLibrary = ftkInit();
             // try a number of times before giving up
             error = ftkEnumerateDevices(m_ftkLibrary,
@@ -254,6 +393,7 @@ class FusionTrack
             } else {
                 ftkClose(&m_ftkLibrary);
                 m_ftkLibrary = nullptr;
+                clearDevices();
             }
         }
 
@@ -276,32 +416,73 @@ class FusionTrack
 
         // make sure we can find and load this tool ini file
         // data loaded from the ini file is also placed back in params
-        for(auto fileName : m_params.geometryFilenames)
+        std::vector<GeometryFile> geometries = geometryFiles.get();
+        for(auto &file : geometries)
         {
-            ftkGeometry geometry;
-            switch (loadGeometry(m_ftkLibrary, m_deviceSerialNumbers[0], fileName, geometry))
+            if(file.cached) continue;
+            switch (loadGeometry(m_ftkLibrary, m_deviceSerialNumbers[0], file.fileName, file.geometry))
             {
             case 1:
-                BOOST_THROW_EXCEPTION(std::runtime_error(std::string("FusionTrack: loaded ") + fileName + " from installation directory"));
+                BOOST_THROW_EXCEPTION(std::runtime_error(std::string("FusionTrack: loaded ") + file.fileName + " from installation directory"));
             case 0:
-                for(auto serialNumber : m_deviceSerialNumbers)
+                if(m_params.cacheGeometries && file.hashed)
                 {
-                    error = ftkSetGeometry(m_ftkLibrary, serialNumber, &geometry);
-                    if(error != FTK_OK)
-                    {
-                        BOOST_THROW_EXCEPTION(std::runtime_error(std::string("FusionTrack: unable to set geometry for tool ") + fileName + " (FusionTrack)"));
-                    }
+                    detail::saveCachedGeometry(file.fileName + ".cache", file.hash, file.geometry);
                 }
-                m_params.markerIDs.push_back(geometry.geometryId);
-                m_params.markerNames.push_back(fileName);
-                m_params.markerModelGeometries.push_back(ftkGeometryToMarkerModelGeometry(geometry));
                 break;
             default:
-                BOOST_THROW_EXCEPTION(std::runtime_error(std::string("FusionTrack: error, cannot load geometry file ") + fileName));
+                BOOST_THROW_EXCEPTION(std::runtime_error(std::string("FusionTrack: error, cannot load geometry file ") + file.fileName));
+            }
+        }
+
+        // every device shares m_ftkLibrary, which is not documented to be thread safe, so set them one at a time
+        for(auto serialNumber : m_deviceSerialNumbers)
+        {
+            for(auto &file : geometries)
+            {
+                ftkGeometry geometry = file.geometry;
+                if(ftkSetGeometry(m_ftkLibrary, serialNumber, &geometry) != FTK_OK)
+                {
+                    BOOST_THROW_EXCEPTION(std::runtime_error(std::string("FusionTrack: unable to set geometry for tool ") + file.fileName + " (FusionTrack)"));
+                }
+            }
+        }
+
+        for(auto &file : geometries)
+        {
+            m_params.markerIDs.push_back(file.geometry.geometryId);
+            m_params.markerNames.push_back(file.fileName);
+            m_params.markerModelGeometries.push_back(ftkGeometryToMarkerModelGeometry(file.geometry));
+
+            if(m_params.markerPoseHistoryCapacity > 0 && !markerPoseHistory(file.geometry.geometryId))
+            {
+                m_markerPoseHistories.emplace_back(file.geometry.geometryId,
+                    std::unique_ptr<MarkerPoseHistory>(new MarkerPoseHistory(m_params.markerPoseHistoryCapacity)));
             }
         }
     }
 
+    /// marker poses by the local system_clock time their frame was received
+    typedef TimeSeriesRing<RigidPose, std::chrono::system_clock::time_point, SlerpInterpolator> MarkerPoseHistory;
+
+    /// @brief the recent poses of a marker geometry on the first device, safe to read from
+    ///        any thread while another thread calls receive()
+    ///
+    /// receive() adds the first instance of each loaded geometry in every frame from the
+    /// first device, stamped with its TimeEvent::local_receive_time, the same system_clock
+    /// as KukaFRIClientDataDriver::joint_angle_history(). So the arm and the marker can be
+    /// looked up at each other's times with MarkerPoseHistory::at().
+    ///
+    /// @return null if the geometry was not loaded or Params::markerPoseHistoryCapacity is 0
+    const MarkerPoseHistory *markerPoseHistory(uint32_t geometryId) const
+    {
+        for(auto &history : m_markerPoseHistories)
+        {
+            if(history.first == geometryId) return history.second.get();
+        }
+        return nullptr;
+    }
+
     /// Frame stores FusionTrack data captured at a single point in time,
     /// it includes time stamps, the serial number of the device that captured
     /// the data, the actual image data,
@@ -611,6 +792,8 @@ class FusionTrack
             if(m_logger) m_logger->warn("FusionTrack::receive: marker overflow, please increase number of markers.  Only the first ", rs.Markers.size(), " marker(s) will processed.");
 #endif // HAVE_SPDLOG
         }
+
+        recordMarkerPoses(rs);
     }
 
     /// Get the serial numbers of all connected devices.
@@ -731,6 +914,65 @@ class FusionTrack
         frame.TimeStamp.local_clock_id = m_local_clock_ids[index];
     }
 
+    /// a geometry ini file, and its geometry once loaded
+    struct GeometryFile
+    {
+        std::string fileName;
+        bool hashed = false;  ///< hash of the ini file contents is valid
+        uint64_t hash = 0;
+        bool cached = false;  ///< geometry was loaded from the cache file
+        ftkGeometry geometry;
+    };
+
+    /// hash each geometry ini file and load the geometries that have an up to date cache file
+    static std::vector<GeometryFile> readGeometryFiles(std::vector<std::string> fileNames, bool useCache)
+    {
+        std::vector<GeometryFile> files(fileNames.size());
+        for(std::size_t i = 0; i < fileNames.size(); ++i)
+        {
+            GeometryFile &file = files[i];
+            file.fileName = fileNames[i];
+            if(!useCache) continue;
+            file.hashed = detail::hashFile(file.fileName, file.hash);
+            file.cached = file.hashed && detail::loadCachedGeometry(file.fileName + ".cache", file.hash, file.geometry);
+        }
+        return files;
+    }
+
+    /// add the first instance of each geometry in a frame from the first device to its history
+    void recordMarkerPoses(const Frame &frame)
+    {
+        if(m_markerPoseHistories.empty() || frame.SerialNumber != m_deviceSerialNumbers[0]) return;
+
+        // the inverse of UniversalTimeScaleClock::now()
+        const std::chrono::system_clock::time_point time(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            frame.TimeStamp.local_receive_time.time_since_epoch() +
+            std::chrono::seconds(cartographer::common::kUtsEpochOffsetFromUnixEpochInSeconds)));
+        // skip frames while the wall clock is set back, times must not decrease
+        if(time < m_lastMarkerPoseTime) return;
+        m_lastMarkerPoseTime = time;
+
+        for(auto &history : m_markerPoseHistories)
+        {
+            for(const ftkMarker &marker : frame.Markers)
+            {
+                if(marker.geometryId != history.first) continue;
+                history.second->push(time, detail::ftkMarkerToRigidPose(marker));
+                break;
+            }
+        }
+    }
+
+    /// forget the devices found by a failed enumeration
+    void clearDevices()
+    {
+        m_deviceSerialNumbers.clear();
+        m_device_types.clear();
+        m_event_names.clear();
+        m_local_clock_ids.clear();
+        m_device_clock_ids.clear();
+    }
+
 #ifdef HAVE_SPDLOG
     std::shared_ptr<spdlog::logger> m_logger;
 #endif // HAVE_SPDLOG
@@ -743,6 +985,9 @@ class FusionTrack
     std::vector<TimeEvent::UnsignedCharArray> m_event_names;
     std::vector<TimeEvent::UnsignedCharArray> m_local_clock_ids;
     std::vector<TimeEvent::UnsignedCharArray> m_device_clock_ids;
+    /// MarkerPoseHistory for each geometry id, fixed after construction so readers need no lock
+    std::vector<std::pair<uint32_t, std::unique_ptr<MarkerPoseHistory> > > m_markerPoseHistories;
+    std::chrono::system_clock::time_point m_lastMarkerPoseTime;
 };
 
 namespace detail
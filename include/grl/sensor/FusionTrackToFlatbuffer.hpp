@@ -258,7 +258,7 @@ toFlatBuffer(flatbuffers::FlatBufferBuilder &fbb,
 
     }
 
-    static const double microsecToSec = 1 / 1000000;
+    static const double microsecToSec = 1.0 / 1000000.0;
     double timestamp = frame.imageHeader.timestampUS * microsecToSec;
     uint64_t serialNumber = frame.SerialNumber;
     uint64_t hardwareTimestampUS = frame.imageHeader.timestampUS;
@@ -403,7 +403,7 @@ toFlatBuffer(flatbuffers::FlatBufferBuilder &fbb,
              const grl::sensor::FusionTrack &fusiontrack,
              const grl::sensor::FusionTrack::Frame &frame)
 {
-    static const double microsecToSec = 1 / 1000000;
+    static const double microsecToSec = 1.0 / 1000000.0;
     double timestamp = frame.imageHeader.timestampUS * microsecToSec;
     flatbuffers::Offset<grl::flatbuffer::FusionTrackParameters> parameters = toFlatBuffer(fbb, fusiontrack);
     flatbuffers::Offset<grl::flatbuffer::TimeEvent> timeEvent = toFlatBuffer(fbb, frame.TimeStamp);
@@ -0,0 +1,376 @@
+/// @file KinematicScene.hpp
+/// @brief In-process kinematic scene graph of joints, frames, dummies and paths.
+///
+/// KinematicScene mirrors the small subset of the V-REP scene API used by
+/// the grl arm drivers, so robot arm pipelines can run headless without
+/// v_repLib, a running simulator or a GUI license. Only kinematics are modeled,
+/// there are no dynamics, collisions or rendering.
+#ifndef _GRL_SIM_KINEMATIC_SCENE_HPP_
+#define _GRL_SIM_KINEMATIC_SCENE_HPP_
+
+#include <string>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <boost/exception/all.hpp>
+#include <boost/throw_exception.hpp>
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+
+namespace grl { namespace sim {
+
+/// @brief Headless kinematic scene with a V-REP style handle interface
+///
+/// Every object is identified by a unique integer handle and a unique name,
+/// objects form a tree through their parent handle where -1 is the world.
+/// The world pose of an object is the pose of its parent composed with
+/// its local pose, and for joints additionally with the intrinsic joint
+/// motion about or along the joint's local z axis, just like in V-REP.
+///
+/// Handles are indices into a contiguous vector so lookups are O(1), and
+/// world transforms are computed on demand by walking up the tree, which
+/// is cheap for the short chains found in robot arms.
+class KinematicScene {
+public:
+
+    enum ObjectType {
+        Frame,            // plain reference frame, i.e. a V-REP shape or model base
+        Dummy,            // V-REP dummy, typically a tip or target
+        RevoluteJoint,    // rotates about local z by the joint position in radians
+        PrismaticJoint,   // translates along local z by the joint position in meters
+        Path              // sequence of control point poses relative to the path frame
+    };
+
+    typedef Eigen::Affine3d Transform;
+    typedef std::vector<Transform,Eigen::aligned_allocator<Transform>> Transforms;
+
+    struct Object {
+        std::string name;
+        ObjectType  type;
+        int         parent;
+        /// pose relative to the parent, excluding any joint motion
+        Transform   localTransform;
+
+        // joint data, unused for other object types
+        double position       = 0.0;
+        double targetPosition = 0.0;
+        double force          = 0.0;
+        double lowerLimit     = -std::numeric_limits<double>::infinity();
+        double upperLimit     =  std::numeric_limits<double>::infinity();
+        bool   isCyclic       = true;
+
+        /// path control points relative to this object, unused for other object types
+        Transforms pathPoints;
+
+        /// arbitrary user data such as external torque, mirrors simAddObjectCustomData
+        std::unordered_map<int,std::string> customData;
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    typedef std::vector<Object,Eigen::aligned_allocator<Object>> Objects;
+
+    /// @brief add an object to the scene
+    /// @param parent handle of the parent object, -1 for the world
+    /// @return the handle of the new object
+    int addObject(const std::string& name, ObjectType type, int parent = -1, const Transform& localTransform = Transform::Identity())
+    {
+        if(nameToHandle_.count(name))
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error(std::string("KinematicScene::addObject: an object named ") + name + " already exists."));
+        }
+        if(parent != -1) checkHandle(parent);
+
+        Object object;
+        object.name = name;
+        object.type = type;
+        object.parent = parent;
+        object.localTransform = localTransform;
+        objects_.push_back(object);
+        int handle = static_cast<int>(objects_.size()) - 1;
+        nameToHandle_[name] = handle;
+        return handle;
+    }
+
+    /// @brief add a revolute or prismatic joint with position limits
+    ///
+    /// The joint is non-cyclic whenever finite limits are provided.
+    int addJoint(const std::string& name, int parent, const Transform& localTransform,
+                 double lowerLimit = -std::numeric_limits<double>::infinity(),
+                 double upperLimit =  std::numeric_limits<double>::infinity(),
+                 ObjectType type = RevoluteJoint)
+    {
+        int handle = addObject(name, type, parent, localTransform);
+        Object& joint = objects_[handle];
+        joint.lowerLimit = lowerLimit;
+        joint.upperLimit = upperLimit;
+        joint.isCyclic = !(std::isfinite(lowerLimit) && std::isfinite(upperLimit));
+        return handle;
+    }
+
+    /// @brief add a path made of control point poses relative to the path object
+    int addPath(const std::string& name, int parent, const Transform& localTransform, const Transforms& points)
+    {
+        int handle = addObject(name, Path, parent, localTransform);
+        objects_[handle].pathPoints = points;
+        return handle;
+    }
+
+    /// @brief Get the handle of a single object, otherwise throw an exception
+    /// @see grl::vrep::getHandle
+    int getHandle(const std::string& name) const
+    {
+        auto it = nameToHandle_.find(name);
+        if(it == nameToHandle_.end())
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error(std::string("KinematicScene::getHandle: Handle ") + name + " is not valid. Make sure the object you are looking for actually exists."));
+        }
+        return it->second;
+    }
+
+    /// @return the handle or -1 if the object does not exist, like simGetObjectHandle
+    int findHandle(const std::string& name) const
+    {
+        auto it = nameToHandle_.find(name);
+        return it == nameToHandle_.end() ? -1 : it->second;
+    }
+
+    /// @brief Get handles from a range of object names such as std::vector<std::string>
+    template<typename SinglePassRange, typename OutputIterator>
+    OutputIterator getHandles(const SinglePassRange& names, OutputIterator out) const
+    {
+        for(const std::string& name : names) *out++ = getHandle(name);
+        return out;
+    }
+
+    const Object& getObject(int handle) const { checkHandle(handle); return objects_[handle]; }
+    Object&       getObject(int handle)       { checkHandle(handle); return objects_[handle]; }
+
+    std::size_t size() const { return objects_.size(); }
+
+    /// @brief the transform caused by the joint movement, identity for non-joints
+    /// @see simGetJointMatrix
+    Transform getJointMotion(int handle) const
+    {
+        const Object& object = getObject(handle);
+        switch(object.type)
+        {
+            case RevoluteJoint:
+                return Transform(Eigen::AngleAxisd(object.position, Eigen::Vector3d::UnitZ()));
+            case PrismaticJoint:
+                return Transform(Eigen::Translation3d(0, 0, object.position));
+            default:
+                return Transform::Identity();
+        }
+    }
+
+    /// @brief pose of the object in the world frame
+    /// @see simGetObjectMatrix
+    Transform getObjectTransform(int handle) const
+    {
+        Transform world = Transform::Identity();
+        while(handle != -1)
+        {
+            const Object& object = getObject(handle);
+            world = object.localTransform * getJointMotion(handle) * world;
+            handle = object.parent;
+        }
+        return world;
+    }
+
+    /// @brief pose of the object relative to another object, -1 for the world frame
+    Transform getObjectTransform(int handle, int relativeToHandle) const
+    {
+        if(relativeToHandle == -1) return getObjectTransform(handle);
+        return getObjectTransform(relativeToHandle).inverse() * getObjectTransform(handle);
+    }
+
+    /// @brief set the pose of the object relative to another object, -1 for the world frame
+    ///
+    /// The local transform is updated so children follow the object.
+    /// @see simSetObjectMatrix
+    void setObjectTransform(int handle, const Transform& transform, int relativeToHandle = -1)
+    {
+        Object& object = getObject(handle);
+        Transform world = (relativeToHandle == -1) ? transform : Transform(getObjectTransform(relativeToHandle) * transform);
+        Transform parentWorld = (object.parent == -1) ? Transform::Identity() : getObjectTransform(object.parent);
+        object.localTransform = parentWorld.inverse() * world * getJointMotion(handle).inverse();
+    }
+
+    /// @brief set the intrinsic joint position, clamped to the joint limits
+    /// @see simSetJointPosition
+    void setJointPosition(int handle, double position)
+    {
+        Object& joint = getJoint(handle);
+        if(!joint.isCyclic) position = std::min(std::max(position, joint.lowerLimit), joint.upperLimit);
+        joint.position = position;
+    }
+
+    double getJointPosition(int handle) const { return getJoint(handle).position; }
+
+    /// @brief unit axis of motion of the joint in the world frame
+    Eigen::Vector3d getJointAxis(int handle) const
+    {
+        return getObjectTransform(handle).linear().col(2);
+    }
+
+    /// @brief V-REP layout of a transform: 3x4 row major matrix, elements 3, 7 and 11 are the position
+    /// @see http://www.coppeliarobotics.com/helpFiles/en/apiFunctions.htm#simGetJointMatrix
+    static std::array<float,12> toVrepMatrix(const Transform& transform)
+    {
+        std::array<float,12> m;
+        for(int row = 0; row < 3; ++row)
+        {
+            for(int col = 0; col < 4; ++col)
+            {
+                m[row*4+col] = static_cast<float>(transform.matrix()(row,col));
+            }
+        }
+        return m;
+    }
+
+    /// @brief geometric jacobian of a tip object with respect to a chain of joints
+    ///
+    /// Rows 0-2 are linear velocity and rows 3-5 angular velocity, both in
+    /// the world frame, one column per joint in the order given.
+    template<typename SinglePassRange>
+    Eigen::MatrixXd getJacobian(const SinglePassRange& jointHandles, int tipHandle) const
+    {
+        Eigen::Vector3d tip = getObjectTransform(tipHandle).translation();
+        Eigen::MatrixXd jacobian(6, std::distance(std::begin(jointHandles), std::end(jointHandles)));
+        int col = 0;
+        for(int jointHandle : jointHandles)
+        {
+            Transform jointWorld = getObjectTransform(jointHandle);
+            Eigen::Vector3d axis = jointWorld.linear().col(2);
+            if(getObject(jointHandle).type == PrismaticJoint)
+            {
+                jacobian.col(col) << axis, Eigen::Vector3d::Zero();
+            }
+            else
+            {
+                jacobian.col(col) << axis.cross(tip - jointWorld.translation()), axis;
+            }
+            ++col;
+        }
+        return jacobian;
+    }
+
+    /// @brief total length of the polyline through the path control points
+    double getPathLength(int handle) const
+    {
+        const Object& path = getObject(handle);
+        double length = 0;
+        for(std::size_t i = 1; i < path.pathPoints.size(); ++i)
+        {
+            length += (path.pathPoints[i].translation() - path.pathPoints[i-1].translation()).norm();
+        }
+        return length;
+    }
+
+    /// @brief world pose at a distance along the path, linear position and slerp orientation
+    ///
+    /// Distances outside the path are clamped to its ends.
+    /// @see simGetPositionOnPath simGetOrientationOnPath
+    Transform getPathTransformAtDistance(int handle, double distance) const
+    {
+        const Object& path = getObject(handle);
+        if(path.type != Path || path.pathPoints.empty())
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error(std::string("KinematicScene::getPathTransformAtDistance: ") + path.name + " is not a path with control points."));
+        }
+
+        Transform pathWorld = getObjectTransform(handle);
+        for(std::size_t i = 1; i < path.pathPoints.size(); ++i)
+        {
+            const Transform& a = path.pathPoints[i-1];
+            const Transform& b = path.pathPoints[i];
+            double segment = (b.translation() - a.translation()).norm();
+            if(distance <= segment || i+1 == path.pathPoints.size())
+            {
+                double t = (segment > 0) ? std::min(std::max(distance / segment, 0.0), 1.0) : 0.0;
+                Transform pose = Transform::Identity();
+                pose.translate(a.translation() + t * (b.translation() - a.translation()));
+                pose.rotate(Eigen::Quaterniond(a.linear()).slerp(t, Eigen::Quaterniond(b.linear())));
+                return pathWorld * pose;
+            }
+            distance -= segment;
+        }
+        return pathWorld * path.pathPoints.front();
+    }
+
+private:
+
+    void checkHandle(int handle) const
+    {
+        if(handle < 0 || static_cast<std::size_t>(handle) >= objects_.size())
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error(std::string("KinematicScene: invalid object handle ") + std::to_string(handle)));
+        }
+    }
+
+    const Object& getJoint(int handle) const
+    {
+        const Object& joint = getObject(handle);
+        if(joint.type != RevoluteJoint && joint.type != PrismaticJoint)
+        {
+            BOOST_THROW_EXCEPTION(std::runtime_error(std::string("KinematicScene: ") + joint.name + " is not a joint."));
+        }
+        return joint;
+    }
+
+    Object& getJoint(int handle)
+    {
+        return const_cast<Object&>(static_cast<const KinematicScene&>(*this).getJoint(handle));
+    }
+
+    Objects objects_;
+    std::unordered_map<std::string,int> nameToHandle_;
+};
+
+/// @brief Create a KUKA LBR iiwa 14 R820 with the same object names as the V-REP scene
+///
+/// Joint offsets and limits are from the KUKA LBR iiwa 14 R820 specification,
+/// the tool is a 0.1m mill along the flange z axis. Objects are named like the
+/// defaults in VrepRobotArmDriver::defaultParams(), with the suffix appended to
+/// every name, for example "#0" to match VrepRobotArmDriver::measuredArmParams().
+///
+/// @return handle of the robot base "Robotiiwa"
+inline int addKukaLBRiiwa14R820(KinematicScene& scene, const std::string& suffix = "", int parent = -1,
+                                const KinematicScene::Transform& baseTransform = KinematicScene::Transform::Identity())
+{
+    typedef KinematicScene::Transform Transform;
+    const double deg = M_PI/180.0;
+    // height of each joint above the base in the zero pose, where the arm points straight up
+    const std::array<double,7> heights{{0.1575, 0.36, 0.5645, 0.78, 0.9645, 1.18, 1.261}};
+    // rotation about x taking the base z axis to the joint axis: z, y, z, -y, z, y, z
+    const std::array<double,7> axisRotation{{0, -90*deg, 0, 90*deg, 0, -90*deg, 0}};
+    const std::array<double,7> limits{{170*deg, 120*deg, 170*deg, 120*deg, 170*deg, 120*deg, 175*deg}};
+
+    int base = scene.addObject("Robotiiwa" + suffix, KinematicScene::Frame, parent);
+    scene.setObjectTransform(base, baseTransform, parent);
+    scene.addObject("LBR_iiwa_14_R820_link1" + suffix, KinematicScene::Frame, base);
+
+    int previous = base;
+    for(std::size_t i = 0; i < heights.size(); ++i)
+    {
+        int joint = scene.addJoint("LBR_iiwa_14_R820_joint" + std::to_string(i+1) + suffix, previous,
+                                   Transform::Identity(), -limits[i], limits[i]);
+        scene.setObjectTransform(joint, Transform(Eigen::Translation3d(0, 0, heights[i]) * Eigen::AngleAxisd(axisRotation[i], Eigen::Vector3d::UnitX())), base);
+        scene.addObject("LBR_iiwa_14_R820_link" + std::to_string(i+2) + suffix, KinematicScene::Frame, joint);
+        previous = joint;
+    }
+
+    int flange = scene.addObject("RobotFlangeTip" + suffix, KinematicScene::Dummy, previous, Transform(Eigen::Translation3d(0, 0, 0.045)));
+    int tip = scene.addObject("RobotMillTip" + suffix, KinematicScene::Dummy, flange, Transform(Eigen::Translation3d(0, 0, 0.1)));
+    scene.addObject("RobotMillTipTarget" + suffix, KinematicScene::Dummy, base, scene.getObjectTransform(tip, base));
+    return base;
+}
+
+}} // grl::sim
+
+#endif // _GRL_SIM_KINEMATIC_SCENE_HPP_
@@ -0,0 +1,248 @@
+#ifndef _GRL_SIM_SIMULATED_ROBOT_ARM_DRIVER_HPP_
+#define _GRL_SIM_SIMULATED_ROBOT_ARM_DRIVER_HPP_
+
+#include <memory>
+#include <array>
+#include <vector>
+#include <string>
+#include <iterator>
+
+#include <boost/exception/all.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "grl/sim/KinematicScene.hpp"
+
+namespace grl { namespace sim {
+
+/// @brief Headless drop in replacement for grl::vrep::VrepRobotArmDriver
+///
+/// SimulatedRobotArmDriver exposes the same Params, State tuple, getState(),
+/// setState() and handle accessors as VrepRobotArmDriver, but operates on an
+/// in-process KinematicScene instead of a running V-REP instance. This lets
+/// KukaVrepPlugin style sync loops, IK and integration tests run without
+/// v_repLib at thousands of steps per second.
+///
+/// The tuple layouts must stay identical to VrepRobotArmDriver so templated
+/// code can be instantiated with either driver.
+///
+/// @see grl::vrep::VrepRobotArmDriver
+/// @see addKukaLBRiiwa14R820() to create a scene with the default object names
+class SimulatedRobotArmDriver : public std::enable_shared_from_this<SimulatedRobotArmDriver> {
+public:
+
+    enum ParamIndex {
+        JointNames,
+        RobotFlangeTipName, // the tip of the base robot model without tools, where tools get attached
+        RobotTipName,       // the tip of the robot tool or end effector, where stuff interacts
+        RobotTargetName,
+        RobotTargetBaseName,
+        RobotIkGroup
+    };
+
+    typedef std::tuple<
+        std::vector<std::string>,
+        std::string,
+        std::string,
+        std::string,
+        std::string,
+        std::string
+        > Params;
+
+    typedef std::tuple<
+        std::vector<int>,
+        int,
+        int,
+        int,
+        int,
+        int
+        > VrepHandleParams;
+
+    static const Params defaultParams()
+    {
+        std::vector<std::string> jointNames{
+                    "LBR_iiwa_14_R820_joint1" , // Joint1Handle,
+                    "LBR_iiwa_14_R820_joint2" , // Joint2Handle,
+                    "LBR_iiwa_14_R820_joint3" , // Joint3Handle,
+                    "LBR_iiwa_14_R820_joint4" , // Joint4Handle,
+                    "LBR_iiwa_14_R820_joint5" , // Joint5Handle,
+                    "LBR_iiwa_14_R820_joint6" , // Joint6Handle,
+                    "LBR_iiwa_14_R820_joint7"   // Joint7Handle,
+                    };
+
+        return std::make_tuple(
+                    jointNames                , // JointNames
+                    "RobotFlangeTip"          , // RobotFlangeTipName,
+                    "RobotMillTip"            , // RobotTipName,
+                    "RobotMillTipTarget"      , // RobotTargetName,
+                    "Robotiiwa"               , // RobotTargetBaseName,
+                    "IK_Group1_iiwa"            // RobotIkGroup
+                );
+    }
+
+    /// unique tag type so State never
+    /// conflicts with a similar tuple
+    struct JointStateTag{};
+
+    enum JointStateIndex {
+        JointPosition,
+        JointForce,
+        JointTargetPosition,
+        JointLowerPositionLimit,
+        JointUpperPositionLimit,
+        JointMatrix,
+        JointStateTagIndex,
+        ExternalTorque
+    };
+
+    typedef std::vector<float>               JointScalar;
+
+    /// 3x4 row major matrix with the position in elements 3, 7 and 11
+    /// @see KinematicScene::toVrepMatrix
+    typedef std::array<float,12> TransformationMatrix;
+    typedef std::vector<TransformationMatrix> TransformationMatrices;
+
+    typedef std::tuple<
+        JointScalar,            // jointPosition
+        JointScalar,            // jointForce
+        JointScalar,            // jointTargetPosition
+        JointScalar,            // JointLowerPositionLimit
+        JointScalar,            // JointUpperPositionLimit
+        TransformationMatrices, // jointTransformation
+        JointStateTag,          // JointStateTag unique identifying type so tuple doesn't conflict
+        JointScalar             // externalTorque
+    > State;
+
+    /// @param scene the scene containing all objects named in params, shared so
+    ///        several drivers such as a commanded and a measured arm can use one scene
+    SimulatedRobotArmDriver(std::shared_ptr<KinematicScene> scene, Params params = defaultParams())
+    : scene_(scene), params_(params)
+    {
+    }
+
+/// Look up all handles in the scene, throws if a required object does not exist.
+/// @warning getting the ik group is optional, so it does not throw an exception
+void construct() {
+    if(!scene_) BOOST_THROW_EXCEPTION(std::runtime_error("SimulatedRobotArmDriver::construct(): no KinematicScene was provided"));
+
+    // handles are stored in ParamIndex order
+    std::vector<int> jointHandle;
+    scene_->getHandles(std::get<JointNames>(params_), std::back_inserter(jointHandle));
+    handleParams_ =
+    std::make_tuple(
+         std::move(jointHandle)
+        ,scene_->getHandle(std::get<RobotFlangeTipName>  (params_))
+        ,scene_->getHandle(std::get<RobotTipName>        (params_))
+        ,scene_->getHandle(std::get<RobotTargetName>     (params_))
+        ,scene_->getHandle(std::get<RobotTargetBaseName> (params_))
+        ,scene_->findHandle(std::get<RobotIkGroup>       (params_))
+    );
+
+    allHandlesSet  = true;
+}
+
+/// @return false if ok, matching VrepRobotArmDriver::getState()
+bool getState(State& state){
+    if(!allHandlesSet) return false;
+    const std::vector<int>& jointHandle = std::get<JointNames>(handleParams_);
+
+    std::get<JointPosition>             (state).resize(jointHandle.size());
+    std::get<JointForce>                (state).resize(jointHandle.size());
+    std::get<JointTargetPosition>       (state).resize(jointHandle.size());
+    std::get<JointMatrix>               (state).resize(jointHandle.size());
+    std::get<JointLowerPositionLimit>   (state).resize(jointHandle.size());
+    std::get<JointUpperPositionLimit>   (state).resize(jointHandle.size());
+    std::get<ExternalTorque>            (state).resize(jointHandle.size());
+
+    for (std::size_t i=0 ; i < jointHandle.size() ; i++)
+    {
+        const KinematicScene::Object& joint = scene_->getObject(jointHandle[i]);
+        std::get<JointPosition>(state)[i]           = joint.position;
+        std::get<JointForce>(state)[i]              = joint.force;
+        std::get<JointTargetPosition>(state)[i]     = joint.targetPosition;
+        std::get<JointMatrix>(state)[i]             = KinematicScene::toVrepMatrix(scene_->getJointMotion(jointHandle[i]));
+        std::get<JointLowerPositionLimit>(state)[i] = joint.lowerLimit;
+        std::get<JointUpperPositionLimit>(state)[i] = joint.upperLimit;
+        std::get<ExternalTorque>(state)[i]          = externalTorque(joint);
+    }
+
+    return false;
+}
+
+/// Set the joint positions and external torques of the simulated arm,
+/// positions are clamped to the joint limits like V-REP does.
+/// @return true if the state was set, matching VrepRobotArmDriver::setState()
+bool setState(State& state) {
+    if(!allHandlesSet) return false;
+    const std::vector<int>& jointHandle = std::get<JointNames>(handleParams_);
+    const JointScalar& realJointPosition = std::get<JointPosition>(state);
+    const JointScalar& realJointForce = std::get<JointForce>(state);
+    const JointScalar& externalJointForce = std::get<ExternalTorque>(state);
+
+    for (std::size_t i=0 ; i < jointHandle.size() && i < realJointPosition.size() ; i++)
+    {
+        scene_->setJointPosition(jointHandle[i],realJointPosition[i]);
+        scene_->getObject(jointHandle[i]).targetPosition = realJointPosition[i];
+        if(i < realJointForce.size()) scene_->getObject(jointHandle[i]).force = realJointForce[i];
+    }
+
+    // stored the same way VrepRobotArmDriver stores it so scripts can read it back
+    for (std::size_t i=0 ; i < jointHandle.size() && i < externalJointForce.size() ; i++)
+    {
+        scene_->getObject(jointHandle[i]).customData[externalTorqueHandle] = boost::lexical_cast<std::string>(externalJointForce[i]);
+    }
+
+    return true;
+}
+
+const std::vector<int>& getJointHandles()
+{
+  return std::get<JointNames>(handleParams_);
+}
+
+const std::vector<std::string>& getJointNames()
+{
+  return std::get<JointNames>(params_);
+}
+
+const Params & getParams(){
+   return params_;
+}
+
+const VrepHandleParams & getVrepHandleParams(){
+   return handleParams_;
+}
+
+std::shared_ptr<KinematicScene> getScene(){
+   return scene_;
+}
+
+/// geometric jacobian of the robot tip with respect to the arm joints in the world frame
+/// @see grl::vrep::getJacobian
+Eigen::MatrixXd getJacobian()
+{
+  return scene_->getJacobian(getJointHandles(), std::get<RobotTipName>(handleParams_));
+}
+
+private:
+
+float externalTorque(const KinematicScene::Object& joint) const
+{
+    auto it = joint.customData.find(externalTorqueHandle);
+    return (it == joint.customData.end()) ? 0.0f : boost::lexical_cast<float>(it->second);
+}
+
+std::shared_ptr<KinematicScene> scene_;
+Params params_;
+VrepHandleParams handleParams_;
+
+/// This is a unique identifying handle for external torque values
+/// since they are set as custom data, same value as VrepRobotArmDriver.
+int externalTorqueHandle = 310832412;
+
+volatile bool allHandlesSet = false;
+
+};
+
+}} // grl::sim
+
+#endif // _GRL_SIM_SIMULATED_ROBOT_ARM_DRIVER_HPP_
@@ -14,6 +14,7 @@
 #include <boost/units/physical_dimensions/torque.hpp>
 #include <boost/units/physical_dimensions/force.hpp>
 #include <boost/units/physical_dimensions/angular_velocity.hpp>
+#include <boost/units/physical_dimensions/angular_acceleration.hpp>
 #include <boost/units/physical_dimensions/time.hpp>
 
 namespace grl {
@@ -48,6 +49,9 @@ namespace grl {
 	/// joint angle
 	struct revolute_joint_angle_open_chain_state_tag : revolute_joint_tag,  boost::units::plane_angle_base_dimension, open_chain_tag {};
 	
+	/// joint angle constraint (ex: largest angle either side of zero)
+	struct revolute_joint_angle_open_chain_state_constraint_tag : revolute_joint_angle_open_chain_state_tag, constraint_tag{};
+	
 	/// interpolated joint angle
 	struct revolute_joint_angle_interpolated_open_chain_state_tag : revolute_joint_tag, interpolated_state_tag, boost::units::plane_angle_base_dimension, open_chain_tag {};
     
@@ -57,6 +61,12 @@ namespace grl {
     /// joint velocity constraint (ex: max velocity)
 	struct revolute_joint_velocity_open_chain_state_constraint_tag : revolute_joint_velocity_open_chain_state_tag, constraint_tag{};
 	
+	/// joint acceleration
+	struct revolute_joint_acceleration_open_chain_state_tag : revolute_joint_tag,  boost::units::angular_acceleration_dimension, open_chain_tag {};
+    
+    /// joint acceleration constraint (ex: max acceleration)
+	struct revolute_joint_acceleration_open_chain_state_constraint_tag : revolute_joint_acceleration_open_chain_state_tag, constraint_tag{};
+	
 	/// joint torque
 	struct revolute_joint_torque_open_chain_state_tag : revolute_joint_tag, boost::units::torque_dimension, open_chain_tag {};
 	
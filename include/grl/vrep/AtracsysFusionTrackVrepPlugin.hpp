@@ -26,6 +26,7 @@
 #include "v_repLib.h"
 
 #include "grl/vector_ostream.hpp"
+#include "grl/TripleBuffer.hpp"
 
 #include "flatbuffers/flatbuffers.h"
 #include "flatbuffers/util.h"
@@ -138,21 +139,21 @@ public:
   void destruct()
   {
     m_shouldStop = true;
-    if (m_driverThread)
+    if (m_driverThread && m_driverThread->joinable())
     {
       m_driverThread->join();
     }
 
     for(auto &saveThreadP : m_saveRecordingThreads)
     {
-      m_driverThread->join();
+      if (saveThreadP->joinable()) saveThreadP->join();
     }
   }
 
   /// adds an object to active tracking, replacing existing objects with the same GeometryID
   void add_object(const MotionConfigParams mcp)
   {
-    std::lock_guard<std::mutex> lock(m_frameAccess);
+    std::lock_guard<std::mutex> lock(m_motionConfigAccess);
     MotionConfigParamsAddConfig(mcp, m_geometryIDToVrepMotionConfigMap);
   }
 
@@ -160,7 +161,7 @@ public:
   /// Does not modify fusiontrack params, such as any loaded geometry ini config files.
   void clear_objects()
   {
-    std::lock_guard<std::mutex> lock(m_frameAccess);
+    std::lock_guard<std::mutex> lock(m_motionConfigAccess);
     m_geometryIDToVrepMotionConfigMap.clear();
   }
 
@@ -168,7 +169,7 @@ public:
   /// Does not modify fusiontrack params, such as any loaded geometry ini config files.
   void remove_geometry(int GeometryID)
   {
-    std::lock_guard<std::mutex> lock(m_frameAccess);
+    std::lock_guard<std::mutex> lock(m_motionConfigAccess);
     m_geometryIDToVrepMotionConfigMap.erase(GeometryID);
   }
 
@@ -193,6 +194,10 @@ public:
     return is_active() && m_isRecording;
   }
 
+  /// @brief move the configured objects to the poses in the newest frame the tracker completed
+  ///
+  /// Does nothing when no frame arrived since the last call. Never waits for the
+  /// acquisition thread, and the acquisition thread never waits for it.
   void run_one()
   {
 
@@ -203,21 +208,23 @@ public:
       std::rethrow_exception(exceptionPtr);
     }
 
-    // don't try to lock or start sending the tracker data
+    // don't start sending the tracker data
     // until the device has established a connection
     if (!isConnectionEstablished_ || !allHandlesSet) {
       return;
     }
 
+    // take the newest completed frame, if there is one we have not applied yet
+    if (!m_frames.update()) {
+      return;
+    }
+    const grl::sensor::FusionTrack::Frame &frame = *m_frames.front();
 
-    std::lock_guard<std::mutex> lock(m_frameAccess);
-
-    // if any of the components haven't finished initializing, halt the program with an error
-    BOOST_VERIFY(m_receivedFrame && m_nextState && opticalTrackerP);
+    std::lock_guard<std::mutex> lock(m_motionConfigAccess);
 
     Eigen::Affine3f cameraToMarkerTransform; /// Relative distance between camera and marker?
 
-    for(auto &marker : m_receivedFrame->Markers)
+    for(auto &marker : frame.Markers)
     {
 
       cameraToMarkerTransform = sensor::ftkMarkerToAffine3f(marker);
@@ -272,7 +279,7 @@ public:
     /// Uncomment the line below to call the save_recording function in update()
     /// lock mutex before accessing file
 
-    std::lock_guard<std::mutex> lock(m_frameAccess);
+    std::lock_guard<std::mutex> lock(m_recordingAccess);
 
     // std::move std::move is used to indicate that an object (m_logFileBufferBuilderP) may be "moved from",
     // i.e. allowing the efficient transfer of resources from m_logFileBufferBuilderP to another objec.
@@ -309,7 +316,7 @@ public:
   // clear the recording buffer from memory immediately to start fresh
   void clear_recording()
   {
-    std::lock_guard<std::mutex> lock(m_frameAccess);
+    std::lock_guard<std::mutex> lock(m_recordingAccess);
     m_logFileBufferBuilderP.reset();
     m_KUKAiiwaFusionTrackMessageBufferP.reset();
   }
@@ -318,17 +325,16 @@ public:
 private:
   /// @todo support boost::asio
   /// Reads data off of the real optical tracker device in a separate thread
+  ///
+  /// Each frame is received into the producer side of m_frames and published when
+  /// complete, so the thread never waits for run_one() however long the simulator
+  /// takes. Only recording shares a mutex, with the rare save and clear calls.
   void update()
   {
     try
     {
       // initialize all of the real device states
-      std::lock_guard<std::mutex> lock(m_frameAccess);
       opticalTrackerP.reset(new grl::sensor::FusionTrack(params_.FusionTrackParams));
-      // std::move is used to indicate that an object t may be "moved from",
-      // i.e. allowing the efficient transfer of resources from t to another object.
-      m_receivedFrame = std::move(opticalTrackerP->makeFramePtr());
-      m_nextState = std::move(opticalTrackerP->makeFramePtr());
       isConnectionEstablished_ = true;
     }
     catch (...)
@@ -342,32 +348,30 @@ private:
     int counter = 0;
     while (!m_shouldStop)
     {
-      opticalTrackerP->receive(*m_nextState);
+      // the three frames are allocated by the first three passes, then reused
+      std::unique_ptr<grl::sensor::FusionTrack::Frame> &nextFrame = m_frames.back();
+      if (!nextFrame) nextFrame = opticalTrackerP->makeFramePtr();
+      opticalTrackerP->receive(*nextFrame);
+      if (m_isRecording)
       {
-          std::lock_guard<std::mutex> lock(m_frameAccess);
-          if (m_isRecording)
+          std::lock_guard<std::mutex> lock(m_recordingAccess);
+          // convert the buffer into a flatbuffer for recording and add it to the in memory buffer
+          // @todo TODO(ahundt) if there haven't been problems, delete this todo, but if recording in the driver thread is time consuming move the code to another thread
+          if (!m_logFileBufferBuilderP)
           {
-            // convert the buffer into a flatbuffer for recording and add it to the in memory buffer
-            // @todo TODO(ahundt) if there haven't been problems, delete this todo, but if recording in the driver thread is time consuming move the code to another thread
-            if (!m_logFileBufferBuilderP)
-            {
-              // flatbuffersbuilder does not yet exist
-              m_logFileBufferBuilderP = std::make_shared<flatbuffers::FlatBufferBuilder>();
-              m_KUKAiiwaFusionTrackMessageBufferP =
-                  std::make_shared<std::vector<flatbuffers::Offset<grl::flatbuffer::KUKAiiwaFusionTrackMessage>>>();
-            }
-            BOOST_VERIFY(m_logFileBufferBuilderP != nullptr);
-            BOOST_VERIFY(opticalTrackerP != nullptr);
-            BOOST_VERIFY(m_nextState != nullptr);
-            flatbuffers::Offset<grl::flatbuffer::KUKAiiwaFusionTrackMessage> oneKUKAiiwaFusionTrackMessage =
-                grl::toFlatBuffer(*m_logFileBufferBuilderP, *opticalTrackerP, *m_nextState);
-            m_KUKAiiwaFusionTrackMessageBufferP->push_back(oneKUKAiiwaFusionTrackMessage);
+            // flatbuffersbuilder does not yet exist
+            m_logFileBufferBuilderP = std::make_shared<flatbuffers::FlatBufferBuilder>();
+            m_KUKAiiwaFusionTrackMessageBufferP =
+                std::make_shared<std::vector<flatbuffers::Offset<grl::flatbuffer::KUKAiiwaFusionTrackMessage>>>();
           }
-          // Swaps the values.
-          std::swap(m_receivedFrame, m_nextState);
-
-
+          BOOST_VERIFY(m_logFileBufferBuilderP != nullptr);
+          BOOST_VERIFY(opticalTrackerP != nullptr);
+          flatbuffers::Offset<grl::flatbuffer::KUKAiiwaFusionTrackMessage> oneKUKAiiwaFusionTrackMessage =
+              grl::toFlatBuffer(*m_logFileBufferBuilderP, *opticalTrackerP, *nextFrame);
+          m_KUKAiiwaFusionTrackMessageBufferP->push_back(oneKUKAiiwaFusionTrackMessage);
       }
+      // hand the completed frame to run_one()
+      m_frames.publish();
     }
   }
 
@@ -390,14 +394,13 @@ private:
   /// @see update() run_one()
   std::atomic<bool> isConnectionEstablished_;
 
-  /// mutex that protects access of the main driver thread in update() from the separate vrep plugin messages thread
-  /// it also protects the recording buffer when recording is being started, stopped, or cleared
-  std::mutex m_frameAccess;
+  /// protects the recording buffer between update() and saving or clearing the recording
+  std::mutex m_recordingAccess;
+  /// protects m_geometryIDToVrepMotionConfigMap, never taken by update()
+  std::mutex m_motionConfigAccess;
 
-  /// the current frame available to the user, always acces after locking m_frameAccess
-  std::unique_ptr<grl::sensor::FusionTrack::Frame> m_receivedFrame;
-  /// the next frame state to access, always acces after locking m_frameAccess
-  std::unique_ptr<grl::sensor::FusionTrack::Frame> m_nextState;
+  /// frames from update() to run_one(), null until update() first fills them
+  grl::TripleBuffer<std::unique_ptr<grl::sensor::FusionTrack::Frame>> m_frames;
   /// builds up the file log in memory as data is received
   /// @todo TODO(ahundt) once using C++14 use unique_ptr https://stackoverflow.com/questions/8640393/move-capture-in-lambda
   std::shared_ptr<flatbuffers::FlatBufferBuilder> m_logFileBufferBuilderP;
@@ -407,7 +410,7 @@ private:
   /// should the driver stop collecting data from the atracsys devices
   std::atomic<bool> m_shouldStop;
   /// is data currently being recorded
-  std::atomic<bool> m_isRecording;
+  std::atomic<bool> m_isRecording{false};
   std::exception_ptr exceptionPtr;
 
   /// thread that polls the driver for new data and puts the data into the recording
@@ -2,7 +2,11 @@
 #define _HAND_EYE_CALIBRATION_VREP_PLUGIN_HPP_
 
 #include <iostream>
+#include <algorithm>
 #include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
 
 #include <boost/exception/all.hpp>
 #include <spdlog/spdlog.h>
@@ -10,6 +14,7 @@
 #include "grl/vrep/Eigen.hpp"
 #include "grl/vrep/Vrep.hpp"
 #include "camodocal/calib/HandEyeCalibration.h"
+#include "grl/calibration/PoseDiversitySelector.hpp"
 
 #include "v_repLib.h"
 
@@ -51,6 +56,16 @@ public:
         > Params;
 
 
+    /// State of the solve started by estimateHandEyeScrewAsync()
+    enum EstimateState {
+        EstimateIdle,      ///< no solve was started
+        EstimateRunning,   ///< solving on the worker thread
+        EstimateFinished,  ///< the estimate was found and applied to the simulation
+        EstimateCancelled, ///< cancelEstimate() stopped the solve, the previous estimate is kept
+        EstimateFailed,    ///< the solver threw an exception, see the log
+        EstimateSolved     ///< internal, found on the worker thread but not applied by run_one() yet
+    };
+
     static const Params defaultParams(){
         return std::make_tuple(
                     "Robotiiwa"               , // RobotBaseHandle,
@@ -65,6 +80,9 @@ HandEyeCalibrationVrepPlugin (Params params = defaultParams())
       :
       isFirstFrame(true),
       frameCount(0),
+      estimateState_(EstimateIdle),
+      estimateProgress_(0.0),
+      cancelEstimate_(false),
       params_(params)
 {
 /// @todo figure out how to re-enable when .so isn't loaded
@@ -104,6 +122,14 @@ void addFrame() {
     rvecsFiducial.push_back(eigenRotToEigenVector3dAngleAxis(fiducialInFirstFiducialBase.rotation()   ));
     tvecsFiducial.push_back(                                 fiducialInFirstFiducialBase.translation());
 
+    // constant time update, so convergence can be checked after every frame
+    if(incrementalCalib_.addMotion(rvecsArm.back(), tvecsArm.back(), rvecsFiducial.back(), tvecsFiducial.back())){
+      const camodocal::HandEyeCalibrationIncremental::Quality& quality = incrementalCalib_.quality();
+      logger_->info( "Incremental hand eye estimate from ", quality.motionCount, " motions, condition number: ", quality.conditionNumber,
+                     " uncertainty: ", quality.uncertainty, " rotation change: ", quality.rotationChange,
+                     " translation change: ", quality.translationChange, incrementalCalib_.hasConverged() ? " converged" : "");
+    }
+
 
    if(debug){
 
@@ -121,11 +147,16 @@ void addFrame() {
    }
 }
 
+~HandEyeCalibrationVrepPlugin(){
+   cancelEstimate();
+   if(estimateThread_.joinable()) estimateThread_.join();
+}
+
 /// @brief run solver to estimate the unknown transform and set the simulation to the estimated value
 ///
 /// after calling addFrame a number of times in different positions and orientations
 ///
-/// @todo probably want to run at least part of this in a separate thread.
+/// This blocks the V-REP thread until the solve completes, see estimateHandEyeScrewAsync().
 /// @todo evaluate if applyEstimate should not be called by this
 void estimateHandEyeScrew(){
 
@@ -143,6 +174,161 @@ void estimateHandEyeScrew(){
       transformEstimate.matrix()
   );
 
+  updateSimulationWithEstimate();
+}
+
+/// @brief start estimateHandEyeScrew() on a worker thread and return immediately
+///
+/// The frames added so far are copied, so addFrame() may still be called while solving.
+/// Poll getEstimateState() and getEstimateProgress(), and call run_one() from the
+/// V-REP thread, which applies the estimate to the simulation once it is found.
+///
+/// @return false if a solve is already running
+bool estimateHandEyeScrewAsync(){
+   BOOST_VERIFY(allHandlesSet);
+   if(estimateState_ == EstimateRunning || estimateState_ == EstimateSolved) return false;
+   if(estimateThread_.joinable()) estimateThread_.join();
+
+   logger_->info(  "Starting Hand Eye Screw Estimate on a worker thread with ", rvecsArm.size(), " frames");
+
+   estimateProgress_ = 0.0;
+   cancelEstimate_ = false;
+   estimateState_ = EstimateRunning;
+
+   auto rvecs1 = rvecsArm;
+   auto tvecs1 = tvecsArm;
+   auto rvecs2 = rvecsFiducial;
+   auto tvecs2 = tvecsFiducial;
+   Eigen::Matrix4d initialEstimate = transformEstimate.matrix();
+
+   estimateThread_ = std::thread([this,rvecs1,tvecs1,rvecs2,tvecs2,initialEstimate]() mutable {
+       try {
+           Eigen::Matrix4d estimate = initialEstimate;
+           bool solved = camodocal::HandEyeCalibration::estimateHandEyeScrew(rvecs1, tvecs1, rvecs2, tvecs2, estimate, false,
+               [this](double progress){
+                   estimateProgress_ = progress;
+                   return !cancelEstimate_;
+               });
+           if(solved)
+           {
+               std::lock_guard<std::mutex> lock(estimateMutex_);
+               asyncEstimate_ = estimate;
+               estimateState_ = EstimateSolved;
+           }
+           else
+           {
+               estimateState_ = EstimateCancelled;
+           }
+       } catch (const boost::exception& e) {
+           logger_->error("HandEyeCalibrationVrepPlugin: estimate failed:\n", boost::diagnostic_information(e));
+           estimateState_ = EstimateFailed;
+       } catch (const std::exception& e) {
+           logger_->error("HandEyeCalibrationVrepPlugin: estimate failed:\n", e.what());
+           estimateState_ = EstimateFailed;
+       }
+   });
+   return true;
+}
+
+/// @brief stop a running estimateHandEyeScrewAsync(), the solver stops at its next iteration
+void cancelEstimate(){
+   cancelEstimate_ = true;
+}
+
+/// @return one of EstimateState, EstimateSolved is reported as EstimateRunning until run_one() applies it
+EstimateState getEstimateState() const {
+   EstimateState state = static_cast<EstimateState>(estimateState_.load());
+   return (state == EstimateSolved) ? EstimateRunning : state;
+}
+
+/// @return fraction of the estimateHandEyeScrewAsync() solve completed from 0 to 1
+double getEstimateProgress() const {
+   return estimateProgress_;
+}
+
+/// @brief call from the V-REP thread, applies an estimate found by estimateHandEyeScrewAsync()
+///
+/// The V-REP API is only called here and never from the worker thread.
+/// If the simulation cannot be updated the state becomes EstimateFailed and the exception is rethrown.
+void run_one(){
+   if(estimateState_ != EstimateSolved) return;
+   {
+       std::lock_guard<std::mutex> lock(estimateMutex_);
+       transformEstimate.matrix() = asyncEstimate_;
+   }
+   try {
+       updateSimulationWithEstimate();
+   } catch (...) {
+       // otherwise every later run_one() would try again and getEstimateState() would report running forever
+       estimateState_ = EstimateFailed;
+       logger_->error("HandEyeCalibrationVrepPlugin: could not apply the estimate:\n", boost::current_exception_diagnostic_information());
+       throw;
+   }
+   estimateState_ = EstimateFinished;
+}
+
+/// @brief keep only the frames that best condition the estimate, see grl::calibration::PoseDiversitySelector
+///
+/// Call before estimateHandEyeScrew() when many near duplicate frames were added,
+/// for example by adding a frame every time step.
+///
+/// @param maxFrames keep at most this many frames, 0 keeps every informative frame
+/// @return the number of frames kept
+std::size_t selectInformativeFrames(std::size_t maxFrames = 0){
+   if(estimateState_ == EstimateRunning || estimateState_ == EstimateSolved || rvecsArm.empty()) return rvecsArm.size();
+
+   grl::calibration::PoseDiversitySelector::Poses poses;
+   for(std::size_t i = 0; i < rvecsArm.size(); ++i){
+     Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+     if(rvecsArm[i].norm() > 0) pose.linear() = Eigen::AngleAxisd(rvecsArm[i].norm(), rvecsArm[i].normalized()).toRotationMatrix();
+     pose.translation() = tvecsArm[i];
+     poses.push_back(pose);
+   }
+
+   auto params = grl::calibration::PoseDiversitySelector::defaultParams();
+   std::get<grl::calibration::PoseDiversitySelector::MaxFrames>(params) = maxFrames;
+   std::vector<std::size_t> selected = grl::calibration::PoseDiversitySelector(params).select(poses);
+   std::sort(selected.begin(), selected.end());
+
+   logger_->info("Hand eye calibration kept ", selected.size(), " informative frames of ", rvecsArm.size());
+
+   auto keep = [&selected](std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& values){
+     std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > kept;
+     for(std::size_t i : selected) kept.push_back(values[i]);
+     values.swap(kept);
+   };
+   keep(rvecsArm);
+   keep(tvecsArm);
+   keep(rvecsFiducial);
+   keep(tvecsFiducial);
+
+   incrementalCalib_.reset();
+   for(std::size_t i = 0; i < rvecsArm.size(); ++i){
+     incrementalCalib_.addMotion(rvecsArm[i], tvecsArm[i], rvecsFiducial[i], tvecsFiducial[i]);
+   }
+   return rvecsArm.size();
+}
+
+/// @brief the estimate updated by every addFrame() call without the Ceres refinement
+const camodocal::HandEyeCalibrationIncremental& getIncrementalEstimate() const {
+   return incrementalCalib_;
+}
+
+/// @brief apply the incremental estimate to the simulation, for example once it has converged
+/// @return false if too few frames were added to estimate the transform
+bool applyIncrementalEstimate(){
+   BOOST_VERIFY(allHandlesSet);
+   if(!incrementalCalib_.hasEstimate()) return false;
+   transformEstimate.matrix() = incrementalCalib_.estimate();
+   updateSimulationWithEstimate();
+   return true;
+}
+
+private:
+
+/// reads the measured sensor pose, applies transformEstimate to the simulation and logs the result
+void updateSimulationWithEstimate(){
+
 
     // get fiducial in optical tracker base frame
     int ret = simGetObjectPosition(opticalTrackerDetectedObjectName, opticalTrackerBase, detectedObjectPosition.begin());
@@ -168,6 +354,8 @@ void estimateHandEyeScrew(){
 
 }
 
+public:
+
 /// @brief  Will apply the stored estimate to the v-rep simulation value
 ///
 /// A default transform is saved when construct() was called
@@ -213,6 +401,7 @@ void initHandles() {
 
 
 camodocal::HandEyeCalibration handEyeCalib;
+camodocal::HandEyeCalibrationIncremental incrementalCalib_;
 std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > rvecsArm;
 std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > tvecsArm;
 std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > rvecsFiducial;
@@ -239,6 +428,14 @@ int opticalTrackerBase = -1;
 
 bool allHandlesSet = false;
 
+/// estimateHandEyeScrewAsync() worker state, written by the worker and read from the V-REP thread
+std::thread estimateThread_;
+std::atomic<int> estimateState_;
+std::atomic<double> estimateProgress_;
+std::atomic<bool> cancelEstimate_;
+std::mutex estimateMutex_;
+Eigen::Matrix4d asyncEstimate_;
+
 
 private:
 Params params_;
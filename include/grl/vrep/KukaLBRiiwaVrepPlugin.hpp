@@ -4,6 +4,10 @@
 #include <iostream>
 #include <memory>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <exception>
 
 #include <boost/exception/all.hpp>
 #include <boost/algorithm/string.hpp>
@@ -11,6 +15,9 @@
 #include "grl/kuka/KukaDriver.hpp"
 #include "grl/vrep/Vrep.hpp"
 #include "grl/vrep/VrepRobotArmDriver.hpp"
+#include "grl/vrep/VrepRobotArmJacobian.hpp"
+#include "grl/path/ForceControlledVelocity.hpp"
+#include "grl/TripleBuffer.hpp"
 #include <iterator>
 #include "v_repLib.h"
 
@@ -27,6 +34,13 @@ namespace grl { namespace vrep {
 ///    while(true) kukaPluginPG->run_one();
 /// @endcode
 ///
+/// The KukaDriver runs on a thread of its own started by construct(), at the
+/// FRI rate of 1 ms by default, see setDriverPeriod(). run_one() is called from
+/// the simulation thread and only exchanges the latest simulated joint goal and
+/// the latest measured arm state with it through lock free TripleBuffer objects,
+/// so network delays to the arm never stall the simulation step and the arm
+/// does not wait for the simulation either.
+///
 /// @todo this implementation is a bit hacky, redesign it
 /// @todo separate out grl specific code from general kuka control code
 /// @todo Template on robot driver and create a driver that just reads/writes to/from the simulation, then pass the two templates so the simulation and the real driver can be selected.
@@ -187,22 +201,75 @@ void construct(Params params){
   kukaDriverP_->set(flatbuffer::ArmState::MoveArmJointServo);
     std::cout << "KUKA COMMAND MODE: " << std::get<KukaCommandMode>(params) << "\n";
   initHandles();
+
+  driverRunning_ = true;
+  driver_threadP.reset(new std::thread([this]{ runDriver(); }));
+}
+
+/// @brief time between KukaDriver updates on the driver thread
+///
+/// The default of 1 ms matches the default FRI send period, call before construct().
+void setDriverPeriod(std::chrono::microseconds period){
+  driverPeriod_ = period;
 }
 
 
 void run_one(){
 
   if(!allHandlesSet) BOOST_THROW_EXCEPTION(std::runtime_error("KukaVrepPlugin: Handles have not been initialized, cannot run updates."));
+  if(driverFailed_) std::rethrow_exception(driverException_);
   getRealKukaAngles();
   bool isError = getStateFromVrep(); // true if there is an error
   allHandlesSet = !isError;
   /// @todo re-enable simulation feedback based on actual kuka state
   syncVrepAndKuka();
+  if(forceControlledVelocityP_) updateForceControlledPathFollowing();
 }
 
+/// @brief move the robot target along a vrep path at a velocity that drops as the tool tip force rises
+///
+/// Each run_one() the latest external joint torques from the KukaDriver are mapped
+/// to a tool tip force through the jacobian of the simulated arm, and the target
+/// object is advanced along the path as described in grl::path::ForceControlledVelocity.
+/// Following stops on its own at the end of the path, or with an error in the log
+/// if the path can no longer be read.
+///
+/// @param pathName name of the vrep path object to follow, for example MillHipCutPath
+void startForceControlledPathFollowing(const std::string& pathName, grl::path::ForceControlledVelocity::Params fcvParams = grl::path::ForceControlledVelocity::defaultParams()){
+    if(!allHandlesSet) BOOST_THROW_EXCEPTION(std::runtime_error("KukaVrepPlugin: Handles have not been initialized, cannot follow a path."));
+    forceControlledVelocityP_ = std::make_shared<grl::path::ForceControlledVelocity>(fcvParams);
+    pathHandle_ = grl::vrep::getHandle(pathName);
+    simFloat pathLength = 0;
+    if(simGetPathLength(pathHandle_, &pathLength) == -1)
+    {
+        forceControlledVelocityP_.reset();
+        BOOST_THROW_EXCEPTION(std::runtime_error(std::string("KukaVrepPlugin: could not get the length of path ") + pathName));
+    }
+    pathLength_ = pathLength;
+    pathDistance_ = 0.0;
+    measuredToolTipForce_ = 0.0;
+}
+
+void stopForceControlledPathFollowing(){
+    forceControlledVelocityP_.reset();
+}
+
+/// @return true while the target is being moved along the path
+bool isForceControlledPathFollowing() const { return static_cast<bool>(forceControlledVelocityP_); }
+
+/// distance in meters the target has moved along the path
+double getPathDistance() const { return pathDistance_; }
+
+/// length in meters of the path being followed
+double getPathLength() const { return pathLength_; }
+
+/// magnitude in newtons of the most recent tool tip force estimate
+double getMeasuredToolTipForce() const { return measuredToolTipForce_; }
+
 
 ~KukaVrepPlugin(){
 	device_driver_workP_.reset();
+    driverRunning_ = false;
     
     if(driver_threadP){
       device_driver_io_service.stop();
@@ -258,30 +325,80 @@ void getRealKukaAngles() {
 
 }
 
+/// @brief run the KukaDriver until the plugin is destroyed
+///
+/// Runs on the driver thread, the only thread that calls kukaDriverP_ after construct().
+/// The arm is not commanded until the simulation sent its first goal. Each goal
+/// is passed to the KukaDriver once, FRI then interpolates toward it over the
+/// simulation time step and the JAVA interface only sends when a goal arrives.
+void runDriver(){
+    try {
+        bool haveCommand = false;
+        auto next = std::chrono::steady_clock::now();
+        while(driverRunning_)
+        {
+            // a goal is set once, the driver keeps approaching it until the next one
+            const bool newCommand = driverCommands_.update();
+            if(newCommand)
+            {
+                /// @todo make this handled by template driver implementations/extensions
+                const DriverCommand& command = driverCommands_.front();
+                kukaDriverP_->set(command.timeStep,time_duration_command_tag());
+                kukaDriverP_->set( command.position, grl::revolute_joint_angle_open_chain_command_tag());
+                if(0) kukaDriverP_->set( command.force   , grl::revolute_joint_torque_open_chain_command_tag());
+                haveCommand = true;
+            }
+            // the state is only published when the driver received an update
+            if(haveCommand && kukaDriverP_->run_one(newCommand))
+            {
+                // We have the real kuka state read from the device now
+                DriverState& state = driverStates_.back();
+                state.position.clear();
+                kukaDriverP_->get(std::back_inserter(state.position), grl::revolute_joint_angle_open_chain_state_tag());
+                state.force.clear();
+                kukaDriverP_->get(std::back_inserter(state.force), grl::revolute_joint_torque_open_chain_state_tag());
+                state.externalTorque.clear();
+                kukaDriverP_->get(std::back_inserter(state.externalTorque), grl::revolute_joint_torque_external_open_chain_state_tag());
+                state.externalForce.clear();
+                kukaDriverP_->get(std::back_inserter(state.externalForce), grl::cartesian_external_force_tag());
+                driverStates_.publish();
+            }
+
+            // after a stall start a new period rather than trying to catch up
+            next += driverPeriod_;
+            const auto now = std::chrono::steady_clock::now();
+            if(next < now) next = now;
+            std::this_thread::sleep_until(next);
+        }
+    } catch(...) {
+        // run_one() rethrows it on the simulation thread
+        driverException_ = std::current_exception();
+        driverFailed_ = true;
+    }
+}
+
 void syncVrepAndKuka(){
     
         if(!allHandlesSet || !m_haveReceivedRealData) return;
     
-        /// @todo make this handled by template driver implementations/extensions
-        kukaDriverP_->set(simulationTimeStep_,time_duration_command_tag());
-        kukaDriverP_->set( simJointPosition, grl::revolute_joint_angle_open_chain_command_tag());
-        if(0) kukaDriverP_->set( simJointForce   , grl::revolute_joint_torque_open_chain_command_tag());
-    
-
-        kukaDriverP_->run_one();
-        // We have the real kuka state read from the device now
-        // update real joint angle data
-        realJointPosition.clear();
-        kukaDriverP_->get(std::back_inserter(realJointPosition), grl::revolute_joint_angle_open_chain_state_tag());
-        
-        realJointForce.clear();
-        kukaDriverP_->get(std::back_inserter(realJointForce), grl::revolute_joint_torque_open_chain_state_tag());
-    
-        realExternalJointTorque.clear();
-        kukaDriverP_->get(std::back_inserter(realExternalJointTorque), grl::revolute_joint_torque_external_open_chain_state_tag());
-    
-        realExternalForce.clear();
-        kukaDriverP_->get(std::back_inserter(realExternalForce), grl::cartesian_external_force_tag());
+        // the driver thread sends the latest goal with its next update
+        DriverCommand& command = driverCommands_.back();
+        command.timeStep = simulationTimeStep_;
+        command.position.assign(simJointPosition.begin(), simJointPosition.end());
+        command.force.assign(simJointForce.begin(), simJointForce.end());
+        driverCommands_.publish();
+
+        // update real joint angle data with the latest the driver thread received, if any
+        const bool haveNewState = driverStates_.update();
+        if(haveNewState)
+        {
+            const DriverState& state = driverStates_.front();
+            realJointPosition.assign(state.position.begin(), state.position.end());
+            realJointForce.assign(state.force.begin(), state.force.end());
+            realExternalJointTorque.assign(state.externalTorque.begin(), state.externalTorque.end());
+            realExternalForce.assign(state.externalForce.begin(), state.externalForce.end());
+            newExternalJointTorque_ = true;
+        }
     
     if(0){
         // debug output
@@ -308,7 +425,7 @@ void syncVrepAndKuka(){
     
     if(!allHandlesSet || !vrepMeasuredRobotArmDriverP_) return;
     
-    if (realJointPosition.size() > 0) { // if there are valid measured states
+    if (haveNewState && realJointPosition.size() > 0) { // if there are new valid measured states
         VrepRobotArmDriver::State measuredArmState;
         std::get<VrepRobotArmDriver::JointPosition>(measuredArmState) = realJointPosition;
         std::get<VrepRobotArmDriver::JointForce>(measuredArmState) = realJointForce;
@@ -319,6 +436,46 @@ void syncVrepAndKuka(){
     
 }
 
+/// one step of the force controlled velocity (fcv) path following started by startForceControlledPathFollowing()
+void updateForceControlledPathFollowing(){
+    if(!allHandlesSet || !vrepRobotArmDriverP_ || !forceControlledVelocityP_) return;
+
+    // the jacobian is only needed, and only computed, for a new torque sample while following
+    std::size_t numJoints = vrepRobotArmDriverP_->getJointHandles().size();
+    if(newExternalJointTorque_ && realExternalJointTorque.size() == numJoints)
+    {
+        newExternalJointTorque_ = false;
+        // jacobian rows are joints and columns are x,y,z,alpha,beta,gamma, so it is already J^T
+        Eigen::MatrixXf jacobianTranspose = getJacobian(*vrepRobotArmDriverP_);
+        if(jacobianTranspose.rows() == static_cast<int>(numJoints) && jacobianTranspose.cols() == 6)
+        {
+            Eigen::VectorXd externalTorque = Eigen::Map<const Eigen::VectorXf>(&realExternalJointTorque[0], numJoints).cast<double>();
+            Eigen::Matrix<double,6,1> wrench = grl::path::externalTorqueToToolTipWrench(jacobianTranspose.transpose().cast<double>(), externalTorque);
+            measuredToolTipForce_ = wrench.head<3>().norm();
+        }
+    }
+
+    pathDistance_ = forceControlledVelocityP_->step(pathDistance_, measuredToolTipForce_, simGetSimulationTimeStep(), pathLength_);
+
+    simFloat relativeDistance = (pathLength_ > 0.0) ? static_cast<simFloat>(pathDistance_ / pathLength_) : 1.0f;
+    simFloat position[3];
+    simFloat eulerAngles[3];
+    if(simGetPositionOnPath(pathHandle_, relativeDistance, position) == -1 ||
+       simGetOrientationOnPath(pathHandle_, relativeDistance, eulerAngles) == -1)
+    {
+        // throwing would make the plugin drop the whole arm connection, so only following stops
+        logger_->error("KukaVrepPlugin: could not get the pose on the path being followed, stopping path following");
+        forceControlledVelocityP_.reset();
+        return;
+    }
+
+    int target = std::get<VrepRobotArmDriver::RobotTargetName>(vrepRobotArmDriverP_->getVrepHandleParams());
+    simSetObjectPosition(target, -1, position);
+    simSetObjectOrientation(target, -1, eulerAngles);
+
+    if(pathDistance_ >= pathLength_) forceControlledVelocityP_.reset();
+}
+
 /// @todo if there aren't real limits set via the kuka model already then implement me
 void setArmLimits(){
 			//simSetJointInterval(simInt objectHandle,simBool cyclic,const simFloat* interval); //Sets the interval parameters of a joint (i.e. range values)
@@ -407,11 +564,39 @@ bool updateVrepFromKuka() {
             return false;
 }
 
+/// simulation thread to driver thread
+struct DriverCommand {
+    double timeStep = 0.0; ///< ms, time to reach the goal
+    std::vector<float> position = std::vector<float>(KUKA::LBRState::NUM_DOF, 0.0f);
+    std::vector<float> force = std::vector<float>(KUKA::LBRState::NUM_DOF, 0.0f);
+};
+
+/// driver thread to simulation thread, vectors keep their capacity so updates do not allocate
+struct DriverState {
+    DriverState() {
+        position.reserve(KUKA::LBRState::NUM_DOF);
+        force.reserve(KUKA::LBRState::NUM_DOF);
+        externalTorque.reserve(KUKA::LBRState::NUM_DOF);
+        externalForce.reserve(6);
+    }
+    std::vector<float> position;
+    std::vector<float> force;
+    std::vector<float> externalTorque;
+    std::vector<float> externalForce;
+};
+
 volatile bool allHandlesSet = false;
 volatile bool m_haveReceivedRealData = false;
 
 double simulationTimeStep_; // ms
 
+std::atomic<bool> driverRunning_{false};
+std::atomic<bool> driverFailed_{false};
+std::exception_ptr driverException_; ///< written before driverFailed_ is set
+std::chrono::microseconds driverPeriod_{1000};
+grl::TripleBuffer<DriverCommand> driverCommands_;
+grl::TripleBuffer<DriverState> driverStates_;
+
 boost::asio::io_service device_driver_io_service;
 std::unique_ptr<boost::asio::io_service::work> device_driver_workP_;
 std::unique_ptr<std::thread> driver_threadP;
@@ -436,6 +621,14 @@ std::vector<float> realJointForce           = { 0, 0, 0, 0, 0, 0, 0 };
 //std::vector<float> realJointTargetVelocity  = { 0, 0, 0, 0, 0, 0, 0 };
 std::vector<float> realExternalJointTorque  = { 0, 0, 0, 0, 0, 0, 0};
 std::vector<float> realExternalForce = { 0, 0, 0, 0, 0, 0};
+
+/// force controlled path following state, active while forceControlledVelocityP_ is set
+std::shared_ptr<grl::path::ForceControlledVelocity> forceControlledVelocityP_;
+int pathHandle_ = -1;
+double pathLength_ = 0.0;
+double pathDistance_ = 0.0;
+double measuredToolTipForce_ = 0.0;
+bool newExternalJointTorque_ = false; ///< set when the driver thread delivered torques not yet used for the tool tip force
 private:
 Params params_;
 Params measuredParams_;
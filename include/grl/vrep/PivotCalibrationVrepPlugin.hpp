@@ -2,12 +2,16 @@
 #define _PIVOT_CALIBRATION_VREP_PLUGIN_HPP_
 
 #include <iostream>
+#include <algorithm>
 #include <memory>
 
 #include <boost/exception/all.hpp>
 #include <boost/algorithm/string.hpp>
 #include <TRTK/PivotCalibration.hpp>
 
+#include "grl/calibration/RansacPivotCalibration.hpp"
+#include "grl/calibration/PoseDiversitySelector.hpp"
+
 #include <spdlog/spdlog.h>
 
 #include "grl/vrep/Eigen.hpp"
@@ -87,9 +91,16 @@ void construct(){
 ///
 /// If the algorithm string doesn't match an existing algorithm, this API will assume TWO_STEP_PROCEDURE.
 void setAlgorithm(std::string algorithm_){
-  algorithm = algorithm_;
-  // if (boost::iequals(algorithm, std::string("COMBINATORICAL_APPROACH"))) algorithm = TRTK::PivotCalibration<double>::Algorithm::COMBINATORICAL_APPROACH;
-  // else algorithm = TRTK::PivotCalibration<double>::Algorithm::TWO_STEP_PROCEDURE;
+  if (boost::iequals(algorithm_, std::string("COMBINATORICAL_APPROACH"))) algorithm = TRTK::PivotCalibration<double>::COMBINATORICAL_APPROACH;
+  else algorithm = TRTK::PivotCalibration<double>::TWO_STEP_PROCEDURE;
+  logger_->info("Pivot calibration algorithm: ", (algorithm == TRTK::PivotCalibration<double>::COMBINATORICAL_APPROACH) ? "COMBINATORICAL_APPROACH" : "TWO_STEP_PROCEDURE");
+}
+
+/// @brief reject outlier frames with grl::calibration::RansacPivotCalibration before running the selected algorithm
+///
+/// @param inlierThreshold meters between a frame's tip position and the pivot point for it to be used, 0 disables RANSAC
+void setRansac(double inlierThreshold){
+  ransacInlierThreshold = inlierThreshold;
 }
 
 void addFrame() {
@@ -121,6 +132,38 @@ void addFrame() {
    }
 }
 
+/// @brief keep only the frames that best condition the estimate, see grl::calibration::PoseDiversitySelector
+///
+/// @param maxFrames keep at most this many frames, 0 keeps every informative frame
+/// @return the number of frames kept
+std::size_t selectInformativeFrames(std::size_t maxFrames = 0){
+   grl::calibration::PoseDiversitySelector::Poses poses;
+   for(std::size_t i = 0; i < rvecsArm.size(); ++i){
+     Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+     pose.linear() = rvecsArm[i];
+     pose.translation() = tvecsArm[i];
+     poses.push_back(pose);
+   }
+
+   auto params = grl::calibration::PoseDiversitySelector::defaultParams();
+   std::get<grl::calibration::PoseDiversitySelector::CalibrationModel>(params) = grl::calibration::PoseDiversitySelector::PIVOT;
+   std::get<grl::calibration::PoseDiversitySelector::MaxFrames>(params) = maxFrames;
+   std::vector<std::size_t> selected = grl::calibration::PoseDiversitySelector(params).select(poses);
+   std::sort(selected.begin(), selected.end());
+
+   logger_->info("Pivot calibration kept ", selected.size(), " informative frames of ", rvecsArm.size());
+
+   std::vector<typename TRTK::PivotCalibrationTwoStep<double>::Matrix3T > rotations;
+   std::vector<typename TRTK::PivotCalibrationTwoStep<double>::Vector3T > locations;
+   for(std::size_t i : selected){
+     rotations.push_back(rvecsArm[i]);
+     locations.push_back(tvecsArm[i]);
+   }
+   rvecsArm.swap(rotations);
+   tvecsArm.swap(locations);
+   return rvecsArm.size();
+}
+
 /// @brief run solver to estimate the unknown transform and set the simulation to the estimated value
 ///
 /// after calling addFrame a number of times in different positions and orientations
@@ -132,13 +175,30 @@ void estimatePivotOffset(){
 
    BOOST_VERIFY(allHandlesSet);
   
-   /// TODO(ahundt) use Ransac pivot calibration wrapper because there will likely be noise
-   TRTK::PivotCalibrationTwoStep<double> pivotCalib;
-   pivotCalib.setLocations(TRTK::make_range(tvecsArm));
-   pivotCalib.setRotations(TRTK::make_range(rvecsArm));
-   
-   /// TODO(ahundt) Allow selection of "TWO_STEP_PROECDURE" and "COMBINATORIAL_APPROACH" from V-REP LUA API
-   //pivotCalib.setAlgorithm("TWO_STEP_PROCEDURE");
+   std::vector<typename TRTK::PivotCalibrationTwoStep<double>::Matrix3T > rotations;
+   std::vector<typename TRTK::PivotCalibrationTwoStep<double>::Vector3T > locations;
+   if(ransacInlierThreshold > 0.0){
+     // frames with a partially occluded marker would otherwise pull the least squares estimate away
+     auto ransacParams = grl::calibration::RansacPivotCalibration::defaultParams();
+     std::get<grl::calibration::RansacPivotCalibration::InlierThreshold>(ransacParams) = ransacInlierThreshold;
+     grl::calibration::RansacPivotCalibration ransac(ransacParams);
+     std::size_t inlierCount = ransac.compute(grl::calibration::RansacPivotCalibration::Rotations(rvecsArm.begin(), rvecsArm.end()),
+                                              grl::calibration::RansacPivotCalibration::Locations(tvecsArm.begin(), tvecsArm.end()));
+     logger_->info("Pivot calibration RANSAC kept ", inlierCount, " of ", rvecsArm.size(), " frames after ", ransac.getIterations(), " hypotheses, inlier RMSE: ", ransac.getRMSE());
+     for(std::size_t i = 0; i < rvecsArm.size(); ++i){
+       if(!ransac.getInliers()[i]) continue;
+       rotations.push_back(rvecsArm[i]);
+       locations.push_back(tvecsArm[i]);
+     }
+   } else {
+     rotations = rvecsArm;
+     locations = tvecsArm;
+   }
+
+   TRTK::PivotCalibration<double> pivotCalib;
+   pivotCalib.setAlgorithm(algorithm);
+   pivotCalib.setLocations(TRTK::make_range(locations));
+   pivotCalib.setRotations(TRTK::make_range(rotations));
    
    pivotCalib.compute();
    
@@ -211,8 +271,9 @@ void initHandles() {
 }
 
 std::shared_ptr<spdlog::logger> logger_;
-// TRTK::PivotCalibration<double>::Algorithm algorithm = TRTK::PivotCalibration<double>::Algorithm::TWO_STEP_PROCEDURE;
-std::string algorithm = "TWO_STEP_PROCEDURE";
+TRTK::PivotCalibration<double>::Algorithm algorithm = TRTK::PivotCalibration<double>::TWO_STEP_PROCEDURE;
+/// see setRansac(), 0 disables RANSAC
+double ransacInlierThreshold = 0.001;
 
 std::vector<typename TRTK::PivotCalibrationTwoStep<double>::Matrix3T > rvecsArm;
 std::vector<typename TRTK::PivotCalibrationTwoStep<double>::Vector3T > tvecsArm;
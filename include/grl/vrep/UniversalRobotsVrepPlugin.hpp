@@ -4,6 +4,10 @@
 #include <iostream>
 #include <memory>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <exception>
 
 #include <boost/range/algorithm/copy.hpp>
 #include <boost/asio.hpp>
@@ -16,6 +20,7 @@
 #include "grl/vrep/Vrep.hpp"
 #include "grl/vrep/VrepRobotArmDriver.hpp"
 #include "grl/vector_ostream.hpp"
+#include "grl/TripleBuffer.hpp"
 
 #include "v_repLib.h"
 
@@ -33,6 +38,13 @@ namespace grl { namespace vrep {
 ///    while(true) kukaPluginPG->run_one();
 /// @endcode
 ///
+/// All communication with the UR controller happens on an I/O thread started by
+/// construct(), which runs at the rate of the UR realtime interface, 125 Hz by
+/// default, see setIOPeriod(). run_one() is called from the simulation thread and
+/// only exchanges the latest measured joint state and the latest joint command
+/// with it through lock free TripleBuffer objects, so network delays to the
+/// controller never stall the simulation and the two rates are independent.
+///
 /// @todo this implementation is a bit hacky, redesign it
 /// @todo separate out grl specific code from general kuka control code
 /// @todo Template on robot driver and create a driver that just reads/writes to/from the simulation, then pass the two templates so the simulation and the real driver can be selected.
@@ -141,12 +153,24 @@ void construct(Params params){
   
   UniversalRobotsDriverP_.reset(new ur::UrHardwareInterfaceStandalone(std::string(std::get<LocalHostUniversalRobotsKoniUDPAddress >        (params))));
   initHandles();
+
+  ioRunning_ = true;
+  driver_threadP.reset(new std::thread([this]{ runIO(); }));
+}
+
+/// @brief time between exchanges with the UR controller on the I/O thread
+///
+/// The default of 8 ms matches the 125 Hz realtime interface of CB2 and CB3
+/// controllers, use 2 ms for the 500 Hz of e-Series controllers. Call before construct().
+void setIOPeriod(std::chrono::microseconds period){
+  ioPeriod_ = period;
 }
 
 
 void run_one(){
 
   if(!allHandlesSet) BOOST_THROW_EXCEPTION(std::runtime_error("UniversalRobotsVrepPlugin: Handles have not been initialized, cannot run updates."));
+  if(ioFailed_) std::rethrow_exception(ioException_);
   getRealUniversalRobotsAngles();
   bool isError = getStateFromVrep(); // true if there is an error
   allHandlesSet = !isError;
@@ -159,6 +183,7 @@ void run_one(){
 
 ~UniversalRobotsVrepPlugin(){
 	device_driver_workP_.reset();
+    ioRunning_ = false;
     
     if(driver_threadP){
       device_driver_io_service.stop();
@@ -197,19 +222,45 @@ void initHandles() {
 	allHandlesSet  = true;
 }
 
+/// @brief exchange commands and state with the UR controller until the plugin is destroyed
+///
+/// Runs on the I/O thread, the only thread that calls UniversalRobotsDriverP_ after construct().
+void runIO() {
+    try {
+      auto next = std::chrono::steady_clock::now();
+      while(ioRunning_)
+      {
+        if(commands_.update())
+        {
+          UniversalRobotsDriverP_->write_joint_position(commands_.front());
+        }
+
+        RealState& state = realStates_.back();
+        UniversalRobotsDriverP_->read_joint_position(state.position);
+        UniversalRobotsDriverP_->read_joint_velocity(state.velocity);
+        realStates_.publish();
+
+        // after a stall start a new period rather than trying to catch up
+        next += ioPeriod_;
+        const auto now = std::chrono::steady_clock::now();
+        if(next < now) next = now;
+        std::this_thread::sleep_until(next);
+      }
+    } catch(...) {
+      // run_one() rethrows it on the simulation thread
+      ioException_ = std::current_exception();
+      ioFailed_ = true;
+    }
+}
+
+/// copy the latest state the I/O thread received, does not wait for the controller
 void getRealUniversalRobotsAngles() {
-      /// @todo m_haveReceivedRealData = true is a DANGEROUS HACK!!!! REMOVE ME AFTER DEBUGGING
-      m_haveReceivedRealData = true;
-    if(UniversalRobotsDriverP_)
+    if(realStates_.update())
     {
-      std::vector<double> vals;
-      UniversalRobotsDriverP_->read_joint_position(vals);
-      realJointPosition.clear();
-      boost::copy(vals,std::back_inserter(realJointPosition));
-      
-      UniversalRobotsDriverP_->read_joint_velocity(vals);
-      realJointPosition.clear();
-      boost::copy(vals,std::back_inserter(realJointVelocity));
+      const RealState& state = realStates_.front();
+      realJointPosition.assign(state.position.begin(), state.position.end());
+      realJointVelocity.assign(state.velocity.begin(), state.velocity.end());
+      m_haveReceivedRealData = true;
     }
         
 #if BOOST_VERSION < 105900
@@ -226,12 +277,9 @@ void sendSimulatedJointAnglesToUniversalRobots(){
     
 /// @todo make this handled by template driver implementations/extensions
 
-        if( UniversalRobotsDriverP_)
-        {
-            std::vector<double> dpos;
-            boost::copy(simJointPosition,std::back_inserter(dpos));
-            UniversalRobotsDriverP_->write_joint_position(dpos);
-        }
+        // the I/O thread sends it with its next exchange
+        commands_.back().assign(simJointPosition.begin(), simJointPosition.end());
+        commands_.publish();
     
 }
 
@@ -293,9 +341,22 @@ bool updateVrepFromUniversalRobots() {
             return false;
 }
 
+/// joint state read by the I/O thread
+struct RealState {
+    std::vector<double> position = std::vector<double>(7, 0.0);
+    std::vector<double> velocity = std::vector<double>(7, 0.0);
+};
+
 volatile bool allHandlesSet = false;
 volatile bool m_haveReceivedRealData = false;
 
+std::atomic<bool> ioRunning_{false};
+std::atomic<bool> ioFailed_{false};
+std::exception_ptr ioException_; ///< written before ioFailed_ is set
+std::chrono::microseconds ioPeriod_{8000};
+grl::TripleBuffer<RealState> realStates_;  ///< I/O thread to run_one()
+grl::TripleBuffer<std::vector<double>> commands_{std::vector<double>(7, 0.0)}; ///< run_one() to the I/O thread
+
 boost::asio::io_service device_driver_io_service;
 std::unique_ptr<boost::asio::io_service::work> device_driver_workP_;
 std::unique_ptr<std::thread> driver_threadP;
@@ -1,6 +1,8 @@
 #ifndef HANDEYECALIBRATION_H
 #define HANDEYECALIBRATION_H
 
+#include <functional>
+
 #include <Eigen/Eigen>
 #include <Eigen/StdVector>
 
@@ -22,6 +24,56 @@ class HandEyeCalibration
 public:
     HandEyeCalibration();
 
+    /// @brief Receives the fraction of the solve completed from 0 to 1.
+    ///
+    /// May be called from the thread running estimateHandEyeScrew, typically
+    /// once per solver iteration. Return false to cancel the solve.
+    typedef std::function<bool (double progress)> ProgressCallback;
+
+    /// @brief Configures estimateHandEyeScrewRobust()
+    struct RobustOptions
+    {
+        enum Method
+        {
+            RANSAC, ///< keep the hypothesis with the most motions below inlierThreshold
+            LMEDS   ///< keep the hypothesis with the least median residual, no threshold needed
+        };
+
+        RobustOptions();
+
+        Method method;
+        int sampleSize;            ///< motions drawn for each hypothesis, at least 2 with non parallel rotation axes
+        int maxIterations;         ///< maximum number of hypotheses drawn
+        double inlierThreshold;    ///< RANSAC, largest PoseError residual (squared log of the motion error) of an inlier
+        double confidence;         ///< RANSAC, stop drawing once an outlier free sample was drawn with this probability
+        unsigned int threadCount;  ///< threads scoring hypotheses, 0 uses std::thread::hardware_concurrency()
+        unsigned int seed;         ///< random number seed, so results can be reproduced
+    };
+
+    /// @brief Configures the refinement run by estimateHandEyeScrew() after the initial estimate
+    ///
+    /// The defaults are the original refinement, CERES_AUTODIFF with DENSE_QR for
+    /// 500 iterations on one thread. fast() opts in to the analytic jacobians.
+    struct RefineOptions
+    {
+        enum Method
+        {
+            CERES_AUTODIFF, ///< Ceres with the automatically differentiated scalar PoseError residual, the original refinement
+            CERES_ANALYTIC, ///< Ceres with a 6 residual per motion cost function and hand written jacobians
+            GAUSS_NEWTON    ///< the CERES_ANALYTIC residuals solved directly with fixed size Eigen normal equations, no Ceres
+        };
+
+        RefineOptions();
+
+        /// CERES_ANALYTIC with DENSE_NORMAL_CHOLESKY for at most 100 iterations on all threads
+        static RefineOptions fast();
+
+        Method method;
+        int maxIterations;        ///< solver iterations, 500 by default
+        unsigned int threadCount; ///< Ceres threads evaluating residuals, 1 by default, 0 uses std::thread::hardware_concurrency()
+        double tolerance;         ///< GAUSS_NEWTON stops when the update step norm falls below this
+    };
+
     
     /// @brief Estimate an unknown rigid transform using two matching series of changing known rigid transforms.
     ///
@@ -47,16 +99,55 @@ public:
     /// @param rvecs2 vector of size N with each element containing the unit axis and angle for the second transform with size N
     /// @param tvecs2 vector of the translation for the second transform with size N
     ///
+    /// @param progress optional callback reporting progress, which can cancel the solve
+    ///
     /// @pre all sets of parameters must have the same number of elements
-    static void estimateHandEyeScrew(const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs1,
+    /// @return true when the estimate was written to H_12, false if progress cancelled the solve and H_12 is unchanged
+    static bool estimateHandEyeScrew(const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs1,
                                      const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs1,
                                      const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs2,
                                      const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs2,
-                                     Eigen::Matrix4d& H_12, bool planarMotion = false);
+                                     Eigen::Matrix4d& H_12, bool planarMotion = false,
+                                     const ProgressCallback& progress = ProgressCallback());
+
+    /// @brief estimateHandEyeScrew() with a choice of refinement, see RefineOptions
+    ///
+    /// CERES_ANALYTIC and GAUSS_NEWTON minimize the squared rotation and translation
+    /// error of every motion instead of the squared PoseError, which has the same
+    /// minimum for consistent motions and scales far better to thousands of motions.
+    static bool estimateHandEyeScrew(const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs1,
+                                     const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs1,
+                                     const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs2,
+                                     const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs2,
+                                     Eigen::Matrix4d& H_12, bool planarMotion,
+                                     const RefineOptions& refineOptions,
+                                     const ProgressCallback& progress = ProgressCallback());
     
     
     
     
+    /// @brief Estimate the unknown transform like estimateHandEyeScrew(), but robust to outlier motions.
+    ///
+    /// A single bad measurement, such as an optical tracker frame with a partially
+    /// occluded marker, corrupts the least squares fit over all motions. Instead
+    /// hypotheses are solved with the dual quaternion initial estimate from small
+    /// random subsets of the motions, every motion is scored against each hypothesis
+    /// with the same residual used by the refinement, and only the inliers of the
+    /// best hypothesis are passed to estimateHandEyeScrew().
+    ///
+    /// Hypotheses are solved and scored in parallel batches across threads.
+    ///
+    /// @param inliers optional output, set to true for each motion used in the final estimate
+    /// @return the number of inlier motions
+    /// @throws std::runtime_error if there are too few motions or no hypothesis could be solved
+    static std::size_t estimateHandEyeScrewRobust(const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs1,
+                                                  const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs1,
+                                                  const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs2,
+                                                  const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs2,
+                                                  Eigen::Matrix4d& H_12,
+                                                  const RobustOptions& options = RobustOptions(),
+                                                  std::vector<bool>* inliers = NULL);
+
     static void setVerbose(bool on = true); 
 
 private:
@@ -66,14 +157,104 @@ private:
     /// @brief Initial hand-eye screw estimate using fast but coarse Eigen::JacobiSVD
     static DualQuaterniond estimateHandEyeScrewInitial(Eigen::MatrixXd& T,bool planarMotion);
 
+    /// @brief Initial hand-eye screw estimate from the right singular vectors of T with the three smallest singular values
+    /// @param v6 v7 v8 columns 6, 7 and 8 of V in T = U S V^T
+    static DualQuaterniond estimateHandEyeScrewFromNullSpace(const Eigen::Matrix<double, 8, 1>& v6,
+                                                             const Eigen::Matrix<double, 8, 1>& v7,
+                                                             const Eigen::Matrix<double, 8, 1>& v8,
+                                                             bool planarMotion);
+
     /// @brief Refine hand-eye screw estimate using initial coarse estimate and Ceres Solver Library.
-    static void estimateHandEyeScrewRefine(DualQuaterniond& dq,
+    /// @return false if progress cancelled the refinement
+    static bool estimateHandEyeScrewRefine(DualQuaterniond& dq,
                               const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs1,
                               const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs1,
                               const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs2,
-                              const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs2);
+                              const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs2,
+                              const ProgressCallback& progress = ProgressCallback(),
+                              const RefineOptions& refineOptions = RefineOptions());
+
+    /// @brief Refine with a damped Gauss-Newton loop on the 6x6 normal equations of the rotation and translation update
+    /// @return false if progress cancelled the refinement
+    static bool estimateHandEyeScrewGaussNewton(DualQuaterniond& dq,
+                              const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs1,
+                              const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs1,
+                              const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs2,
+                              const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs2,
+                              const RefineOptions& refineOptions,
+                              const ProgressCallback& progress);
 
     static bool mVerbose;
+
+    friend class HandEyeCalibrationIncremental;
+};
+
+/// @brief Hand eye estimate that is updated in constant time as each motion is added.
+///
+/// HandEyeCalibration::estimateHandEyeScrew() stacks every motion into the 6N x 8
+/// matrix T and solves from scratch. Here the 8x8 normal equations T^T T are
+/// accumulated instead, one 6x8 block per motion. The right singular vectors of T
+/// are the eigenvectors of T^T T, so the same Daniilidis null space solution comes
+/// from an 8x8 eigen decomposition that costs the same for 3 or 3000 motions.
+///
+/// After each motion quality() reports how well the estimate is determined, so
+/// collection can stop as soon as it converges. The estimate is not refined with
+/// Ceres, pass the collected motions to HandEyeCalibration::estimateHandEyeScrew()
+/// for the final result.
+///
+/// usage:
+/// @code
+///    camodocal::HandEyeCalibrationIncremental incremental;
+///    incremental.addMotion(rvec1, tvec1, rvec2, tvec2);
+///    if (incremental.hasConverged()) H_12 = incremental.estimate();
+/// @endcode
+class HandEyeCalibrationIncremental
+{
+public:
+    /// @brief How well the motions added so far determine the estimate
+    struct Quality
+    {
+        Quality();
+
+        std::size_t motionCount;  ///< motions with a rotation added so far
+        double conditionNumber;   ///< sigma_1 / sigma_6 of T, infinite until the motions constrain all 6 degrees of freedom, large for near parallel rotation axes
+        double uncertainty;       ///< sqrt(sigma_7^2 + sigma_8^2) / sigma_6 of T, bounds how far noise tilts the solution null space, 0 for noise free motions
+        double rotationChange;    ///< radians the rotation estimate moved with the last motion
+        double translationChange; ///< distance the translation estimate moved with the last motion
+    };
+
+    HandEyeCalibrationIncremental();
+
+    /// @brief forget all motions
+    void reset();
+
+    /// @brief add one motion pair, in the same format as HandEyeCalibration::estimateHandEyeScrew()
+    /// @return true if the estimate was updated, false if the motion has no rotation or the estimate is still undetermined
+    bool addMotion(const Eigen::Vector3d& rvec1, const Eigen::Vector3d& tvec1,
+                   const Eigen::Vector3d& rvec2, const Eigen::Vector3d& tvec2);
+
+    /// @brief true once enough motions were added to solve for the transform
+    bool hasEstimate() const;
+
+    /// @brief the latest estimate, identity until hasEstimate() is true
+    const Eigen::Matrix4d& estimate() const;
+
+    const Quality& quality() const;
+
+    /// @brief true when the last motion moved the estimate less than the given amounts and the uncertainty is small
+    bool hasConverged(double maxRotationChange = 1e-3, double maxTranslationChange = 1e-4, double maxUncertainty = 1e-2) const;
+
+    /// @brief the accumulated normal equations T^T T
+    const Eigen::Matrix<double, 8, 8>& normalEquations() const;
+
+private:
+    Eigen::Matrix<double, 8, 8> m_TtransposeT;
+    Eigen::Matrix4d m_H_12;
+    bool m_hasEstimate;
+    Quality m_quality;
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
 }
@@ -0,0 +1,105 @@
+#ifndef HANDEYEMOTIONERROR_H
+#define HANDEYEMOTIONERROR_H
+
+#include <Eigen/Dense>
+
+#include "camodocal/EigenUtils.h"
+
+// residual and jacobians of one motion for the CERES_ANALYTIC and GAUSS_NEWTON refinements
+namespace camodocal
+{
+
+/// A motion pair as quaternions and rotation matrices, converted once instead of on every evaluation
+struct MotionPair
+{
+    MotionPair(const Eigen::Vector3d& r1, const Eigen::Vector3d& t1,
+               const Eigen::Vector3d& r2, const Eigen::Vector3d& t2)
+        : q1Conjugate(AngleAxisToQuaternion<double>(r1).conjugate()), q2(AngleAxisToQuaternion<double>(r2))
+        , R1transpose(q1Conjugate.toRotationMatrix()), R2(q2.toRotationMatrix())
+        , tvec1(t1), tvec2(t2)
+    {}
+
+    Eigen::Quaterniond q1Conjugate, q2;
+    Eigen::Matrix3d R1transpose, R2;
+    Eigen::Vector3d tvec1, tvec2;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/// matrix of p in p * q = L(p) [w x y z]^T
+inline Eigen::Matrix4d quaternionLeftMatrix(const Eigen::Quaterniond& p)
+{
+    Eigen::Matrix4d L;
+    L << p.w(), -p.x(), -p.y(), -p.z(),
+         p.x(),  p.w(), -p.z(),  p.y(),
+         p.y(),  p.z(),  p.w(), -p.x(),
+         p.z(), -p.y(),  p.x(),  p.w();
+    return L;
+}
+
+/// matrix of p in q * p = R(p) [w x y z]^T
+inline Eigen::Matrix4d quaternionRightMatrix(const Eigen::Quaterniond& p)
+{
+    Eigen::Matrix4d R;
+    R << p.w(), -p.x(), -p.y(), -p.z(),
+         p.x(),  p.w(),  p.z(), -p.y(),
+         p.y(), -p.z(),  p.w(),  p.x(),
+         p.z(),  p.y(), -p.x(),  p.w();
+    return R;
+}
+
+/// derivative of R(q) v, or R(q)^T v when transpose is set, with respect to the unit quaternion [w x y z]
+inline Eigen::Matrix<double, 3, 4> rotatedPointJacobian(const Eigen::Quaterniond& q, const Eigen::Vector3d& v, bool transpose)
+{
+    // R(q)^T = R(q^*), which flips the sign of the terms linear in the vector part
+    const double s = transpose ? -1.0 : 1.0;
+    const Eigen::Vector3d u = q.vec();
+    Eigen::Matrix<double, 3, 4> J;
+    J.col(0) = 2.0 * (q.w() * v + s * u.cross(v));
+    J.block<3,3>(0,1) = 2.0 * (u.dot(v) * Eigen::Matrix3d::Identity() + u * v.transpose() - v * u.transpose() - s * q.w() * skew(v));
+    return J;
+}
+
+/// @brief rotation and translation error of one motion for the transform q, t, with optional jacobians
+///
+/// The error transform is E = A^-1 X B X^-1, the residual is twice the vector part of its
+/// rotation, which is the rotation vector for small errors, followed by its translation.
+/// Rows of the jacobians are the residuals, columns of dq are w x y z.
+inline void motionError(const Eigen::Quaterniond& q, const Eigen::Vector3d& t, const MotionPair& motion,
+                        Eigen::Matrix<double, 6, 1>& residual,
+                        Eigen::Matrix<double, 6, 4>* dq = NULL,
+                        Eigen::Matrix<double, 6, 3>* dt = NULL)
+{
+    const Eigen::Matrix3d R = q.toRotationMatrix();
+    const Eigen::Quaterniond q2qConjugate = motion.q2 * q.conjugate();
+    const Eigen::Quaterniond qq2 = q * motion.q2;
+    const Eigen::Quaterniond qe = motion.q1Conjugate * qq2 * q.conjugate();
+    const double sign = (qe.w() < 0.0) ? -2.0 : 2.0;
+
+    const Eigen::Matrix3d RR2 = R * motion.R2;
+    const Eigen::Vector3d RtransposeT = R.transpose() * t;
+    const Eigen::Vector3d R2RtransposeT = motion.R2 * RtransposeT;
+
+    residual.head<3>() = sign * qe.vec();
+    residual.tail<3>() = motion.R1transpose * (R * motion.tvec2 + t - R * R2RtransposeT - motion.tvec1);
+
+    if (dq)
+    {
+        // d(q * c * q^*)/dq = R(c * q^*) + L(q * c) diag(1,-1,-1,-1)
+        Eigen::Matrix4d dConjugated = quaternionRightMatrix(q2qConjugate) + quaternionLeftMatrix(qq2) * Eigen::Vector4d(1, -1, -1, -1).asDiagonal();
+        dq->topRows<3>() = sign * (quaternionLeftMatrix(motion.q1Conjugate) * dConjugated).bottomRows<3>();
+        dq->bottomRows<3>() = motion.R1transpose * (rotatedPointJacobian(q, motion.tvec2, false)
+                                                  - rotatedPointJacobian(q, R2RtransposeT, false)
+                                                  - RR2 * rotatedPointJacobian(q, t, true));
+    }
+    if (dt)
+    {
+        // the rotation error does not depend on the translation
+        dt->topRows<3>().setZero();
+        dt->bottomRows<3>() = motion.R1transpose * (Eigen::Matrix3d::Identity() - RR2 * R.transpose());
+    }
+}
+
+}
+
+#endif
@@ -20,6 +20,11 @@
 #include "v_repLib.h"
 
 #define SIM_LUA_ARG_NIL_ALLOWED (65536)
+// combine with sim_lua_arg_charbuff to access the buffer in place instead of copying it,
+// for example a table packed with simPackFloatTable or grl.packFloatTable in grl.lua.
+// The item returned by getInDataPtr() is then only valid during the Lua callback.
+#define SIM_LUA_ARG_PACKED_VIEW (131072)
+#define SIM_LUA_ARG_FLAGS (SIM_LUA_ARG_NIL_ALLOWED|SIM_LUA_ARG_PACKED_VIEW)
 
 class CLuaFunctionData  
 {
@@ -29,6 +29,9 @@ public:
     CLuaFunctionDataItem(double v);
     CLuaFunctionDataItem(const std::string& v);
     CLuaFunctionDataItem(const char* bufferPtr,unsigned int bufferLength);
+    // packed buffers, returned to Lua as a single binary string instead of a table
+    CLuaFunctionDataItem(const float* packedData,unsigned int count);
+    CLuaFunctionDataItem(const double* packedData,unsigned int count);
 
     CLuaFunctionDataItem(const std::vector<bool>& v);
     CLuaFunctionDataItem(const std::vector<int>& v);
@@ -43,6 +46,14 @@ public:
     void setNilTable(int size);
     int getNilTableSize();
 
+    // in place access to buffer arguments, see SIM_LUA_ARG_PACKED_VIEW
+    void setBufferView(const char* bufferPtr,unsigned int bufferLength);
+    bool isBufferView();
+    const char* getBufferPtr();
+    unsigned int getBufferLength();
+    const float* getPackedFloats(unsigned int& count);
+    const double* getPackedDoubles(unsigned int& count);
+
     std::vector<bool> boolData;
     std::vector<int> intData;
     std::vector<float> floatData;
@@ -53,4 +64,7 @@ protected:
     int _nilTableSize;
     bool _isTable;
     int _type; // -1=nil,0=bool,1=int,2=float,3=string,4=buffer,5=double
+    // non owning pointer into the Lua call buffer, only valid during the callback
+    const char* _bufferView;
+    unsigned int _bufferViewLength;
 };
@@ -0,0 +1,97 @@
+// High throughput, multi client variant of CSocketInConnection.
+//
+// Speaks the same framing as CSocketInConnection (2 header id bytes, a 16 bit
+// packet size and a 16 bit count of packets left to read), so existing
+// remote API clients can connect unchanged, but:
+//  - any number of clients are served by one epoll loop instead of a single
+//    client blocking in select() with no timeout,
+//  - packets default to the largest size the 16 bit header can describe
+//    instead of 250 bytes, so replies are split into far fewer packets,
+//  - all packets of a reply are written with a single sendmsg() call
+//    instead of one send() per packet with a copied header,
+//  - a reply the client does not read right away is queued and sent once
+//    the client is writable, so a slow client never stalls the others,
+//  - the bytes read from a client per wakeup and the size of its messages
+//    are capped, so one client can neither starve the others nor use up memory,
+//  - client sockets use TCP_NODELAY and enlarged kernel buffers.
+//
+// Linux only, on other platforms use CSocketInConnection.
+
+#pragma once
+
+#if defined (__linux)
+
+#include <vector>
+#include <string>
+#include <deque>
+#include <map>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+class CSocketInConnectionEpoll
+{
+public:
+    // maxPacketSize includes the 6 byte header, socketBufferSize=0 keeps the kernel default.
+    // A client sending a message larger than maxMessageSize, or leaving more than that many reply bytes unread, is closed.
+    CSocketInConnectionEpoll(int theConnectionPort,unsigned short maxPacketSize=65535,char headerID1=59,char headerID2=57,int socketBufferSize=4*1024*1024,int maxMessageSize=64*1024*1024);
+    virtual ~CSocketInConnectionEpoll();
+
+    // bind and listen without blocking, clients are accepted while receiving
+    bool listenForClients();
+
+    // Waits up to timeoutMs (-1=forever) for a complete message from any client.
+    // Returns 1 and fills data and clientId on success, 0 on time out, -1 on error.
+    // data is swapped with the internal buffer so no copy of the message is made.
+    int receiveData(std::vector<char>& data,int& clientId,int timeoutMs=-1);
+
+    // Never waits for the client, what it does not take now is sent from receiveData().
+    // A client that closed its sending side is closed once all its messages were replied to.
+    bool replyToReceivedData(int clientId,const char* data,int dataSize);
+
+    // disconnects a single client and drops its messages not received yet, other clients are not affected
+    void closeClient(int clientId);
+    int getClientCount();
+    std::string getConnectedMachineIP(int clientId);
+
+protected:
+    struct SClient
+    {
+        std::string ip;
+        std::vector<char> inBuffer; // raw bytes received but not parsed yet
+        size_t inOffset;            // start of the unparsed bytes in inBuffer
+        std::vector<char> message;  // payload of the packets of the message being received
+        std::vector<char> outBuffer; // reply bytes the socket did not take yet
+        size_t outOffset;            // start of the unsent bytes in outBuffer
+        unsigned int events;         // epoll events currently registered
+        bool peerClosed;             // the client shut down its sending side
+    };
+
+    bool _acceptClients();
+    bool _readFromClient(int clientId);
+    bool _parseClientPackets(int clientId);
+    bool _sendReply(int clientId,SClient& c,struct iovec* iov,int iovCount);
+    bool _flushClient(int clientId);
+    bool _updateEvents(int clientId,SClient& c);
+    bool _isDone(int clientId);
+    void _tuneSocket(int socket);
+
+    int _socketServer;
+    int _epoll;
+    struct sockaddr_in _socketLocal;
+
+    int _socketConnectionPort;
+    int _socketBufferSize;
+    bool _socketConnectWasOk;
+
+    char _headerByte1;
+    char _headerByte2;
+    unsigned short _maxPacketSize;
+    int _maxMessageSize;
+
+    std::map<int,SClient> _clients;
+    std::deque<std::pair<int,std::vector<char> > > _completeMessages;
+    std::vector<char> _replyHeaders; // preallocated packet headers for writev
+};
+
+#endif /* __linux */
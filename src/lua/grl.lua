@@ -132,4 +132,107 @@ grl.setPoseRelativeToParent=function(objectHandle,parentHandle,objectPositionXYZ
 	simSetObjectParent(objectHandle,parentHandle,true)
 end
 
+--- @brief Pack a flat table of numbers into a binary string of 32 bit floats
+---
+--- Packed buffers are passed to plugins as a single sim_lua_arg_charbuff argument,
+--- which plugins registered with SIM_LUA_ARG_PACKED_VIEW read in place, avoiding a
+--- per element copy of large arrays such as path points, trajectories and point clouds.
+---
+--- @param numberTable flat table of numbers, for example {x1,y1,z1,x2,y2,z2}
+--- @return binary string with 4 bytes per number
+--- @see grl.unpackFloatTable
+grl.packFloatTable=function(numberTable)
+    return simPackFloatTable(numberTable)
+end
+
+--- @brief Pack a flat table of numbers into a binary string of 64 bit doubles
+--- @see grl.packFloatTable
+grl.packDoubleTable=function(numberTable)
+    return simPackDoubleTable(numberTable)
+end
+
+--- @brief Unpack a binary string of 32 bit floats into a flat table of numbers
+--- @see grl.packFloatTable
+grl.unpackFloatTable=function(buffer)
+    return simUnpackFloatTable(buffer)
+end
+
+--- @brief Unpack a binary string of 64 bit doubles into a flat table of numbers
+--- @see grl.packDoubleTable
+grl.unpackDoubleTable=function(buffer)
+    return simUnpackDoubleTable(buffer)
+end
+
+--- @brief Pack a table of equally sized rows, for example {{x,y,z},{x,y,z}}, into one buffer
+---
+--- @param rows table of tables of numbers, each row must have the same number of elements
+--- @param useDouble true to pack 64 bit doubles, otherwise 32 bit floats are packed
+--- @return buffer,stride the packed binary string and the number of elements per row
+grl.packRows=function(rows, useDouble)
+    local flat = {}
+    local stride = 0
+    if(#rows > 0) then
+        stride = #rows[1]
+    end
+    for i=1,#rows do
+        local row = rows[i]
+        for j=1,stride do
+            flat[(i-1)*stride+j] = row[j]
+        end
+    end
+    if(useDouble) then
+        return grl.packDoubleTable(flat), stride
+    end
+    return grl.packFloatTable(flat), stride
+end
+
+--- @brief Unpack a buffer created with grl.packRows into a table of rows
+---
+--- @param buffer binary string of floats or doubles
+--- @param stride number of elements per row
+--- @param useDouble true if the buffer contains 64 bit doubles, otherwise 32 bit floats
+--- @return table of tables of numbers
+grl.unpackRows=function(buffer, stride, useDouble)
+    local flat
+    if(useDouble) then
+        flat = grl.unpackDoubleTable(buffer)
+    else
+        flat = grl.unpackFloatTable(buffer)
+    end
+    local rows = {}
+    for i=1,math.floor(#flat/stride) do
+        local row = {}
+        for j=1,stride do
+            row[j] = flat[(i-1)*stride+j]
+        end
+        rows[i] = row
+    end
+    return rows
+end
+
+--- @brief Load a path file into the GrlPath plugin for fast native sampling
+---
+--- Unlike grl.loadPathFile no V-REP path object is created, the control points are
+--- kept in the v_repExtGrlPath plugin which precomputes the arc length so poses can be
+--- sampled without a per point round trip through lua.
+---
+--- @param fileName .csv or .txt V-REP path text file, any other extension is loaded as a VrepPath flatbuffer
+--- @return pathId for the simExtGrlPath functions, or -1 if loading failed
+grl.loadPathNative=function(fileName)
+    return simExtGrlPathLoad(fileName)
+end
+
+--- @brief Sample count evenly spaced poses along a path loaded with grl.loadPathNative
+---
+--- @param pathId id returned by grl.loadPathNative
+--- @param startDistance distance in meters from the start of the path of the first pose
+--- @param endDistance distance in meters from the start of the path of the last pose
+--- @param count number of poses to sample
+--- @param pathFrameHandle optional handle of the object the path is relative to, poses are then in the world frame
+--- @return table of poses {x,y,z,qx,qy,qz,qw}
+grl.samplePath=function(pathId, startDistance, endDistance, count, pathFrameHandle)
+    local buffer = simExtGrlPathSample(pathId, startDistance, endDistance, count, pathFrameHandle)
+    return grl.unpackRows(buffer, 7, true)
+end
+
 return grl
\ No newline at end of file
@@ -66,56 +66,19 @@ robone.cutBoneScript=function()
 				--simSwitchThread()
 
 			else
-				-- Calculate path length
-				pathLength = simGetPathLength(CreatedPathHandle)
 				-- Move to start of path
-
 				simMoveToObject(target,CreatedPathHandle,3,0,0.2,0.02)
-				newPosition = 0
-
 
-
-				-- Create empty vector for tool tip forces (x,y,z,alpha,beta,gamma,joint dependence(?))
-				--toolTipForces = matrix(7,1,0)
-				toolTipForces = {0,0,0,0,0,0,0}
-				newPos = simGetPositionOnPath(CreatedPathHandle,0)
-				-- While not at end of path, traverse path
-				while newPosition < pathLength do
-					print("VREP JOINT POSITIONS")
-				for i=1,7,1 do
-					print(simGetJointPosition(jointHandles[i]))
-				end
-					externalJointTorque = getExternalJointTorque(measuredJointHandles, externalTorqueHandle)
-
-					measuredForce = calcToolTipForce(IKGroupHandle, externalJointTorque)
-					print("MEASURED FORCE: "..measuredForce)
-
-					position = simGetPathPosition(CreatedPathHandle)
-					offset = 0.001
-					newPosition = position+offset
-
-					simSetPathPosition(CreatedPathHandle, newPosition)
-					nextPos = simGetPositionOnPath(CreatedPathHandle, newPosition/pathLength)
-					nextEul = simGetOrientationOnPath(CreatedPathHandle, newPosition/pathLength)
-					nextQuat = simGetQuaternionFromMatrix(simBuildMatrix({0,0,0},nextEul))
-					nextVel = {0,0,0,0}
-					for i=1,3,1 do
-						nextVel[i] = 3*(nextPos[i]-newPos[i])
+				-- The force controlled velocity (fcv) loop runs in the KukaLBRiiwa plugin,
+				-- which estimates the tool tip force from the external joint torques
+				-- and moves the target along the path, slowing down as the force rises.
+				if robone.startForceControlledCut(CreatedPathHandle, maxCutVelocity, maxCutForce) then
+					while robone.isForceControlledCutRunning() do
+						simSwitchThread()
 					end
-			--timeBefore = simGetSimulationTime()
-			--print("Time nonRML takes: ".. timeBefore-timeAfter)
-			--print("Time before RML: "..timeBefore)
-			result,newPos,newQuat,currentVel,currentAccel,timeLeft=simRMLMoveToPosition(target,-1,-1,currentVel,currentAccel,maxVel,maxAccel,maxJerk,nextPos,nextQuat,nextVel)
-			--timeAfter = simGetSimulationTime()
-			--print("Time after RML: "..timeAfter)
-			--print("Time RML takes: ".. timeAfter-timeBefore)
-			--print("Time left: "..timeLeft)
-
-
-					--fcv(IKGroupHandle, CreatedPathHandle, maxVel, maxForce, measuredForce, pathLength)
-
-					--simSwitchThread()
-
+				else
+					simAddStatusbarMessage('robone.cutBoneScript: force controlled cutting needs the KukaLBRiiwa plugin to be started')
+					simSwitchThread()
 				end
 				simSetPathPosition(CreatedPathHandle, 0)
 			end
@@ -159,104 +122,6 @@ robone.cutBoneScript=function()
 	--accel=40
 	--jerk=80
 
-	function constrain(arg, min, max)
-		if (arg < min) then
-			return min
-		elseif (arg > max) then
-			return max
-		else
-			return arg
-		end
-	end
-
-	function forceToOffset(measuredForce, maxForce, maxOffset)
-		measuredForce = constrain(measuredForce, 0, maxForce)
-
-		-- Natural log model
-		return (maxOffset/math.log(maxForce+1)) * math.log(maxForce + 1 - measuredForce)
-		-- Square root model
-		--return maxOffset * math.sqrt(1 - measuredForce/maxForce
-
-		--return maxOffset - 0.0004*measuredForce
-	end
-
-	function getExternalJointTorque(measuredJointHandles, externalTorqueHandle)
-		-- Create empty vector for external joint torques
-		externalJointTorque = {0,0,0,0,0,0,0}
-
-		sumOfTorques = 0
-		print("TORQUES:")
-		for i=1,7,1 do
-			externalTorqueData = simGetObjectCustomData(measuredJointHandles[i],externalTorqueHandle)
-			if not (externalTorqueData == nil) then
-				numberJointTorque = tonumber(externalTorqueData)
-				if not (numberJointTorque == nil) then
-					externalJointTorque[i] = numberJointTorque
-					print(externalJointTorque[i].." ")
-					sumOfTorques = sumOfTorques + math.abs(externalJointTorque[i])
-				end
-			end
-		end
-		print("\n")
-		return externalJointTorque
-	end
-
-
-	function calcToolTipForce(ikGroupHandle, externalTorques)
-
-		if not (simComputeJacobian(ikGroupHandle, 0) == -1) then
-			jacobian, jacobianSize = simGetIkGroupMatrix(ikGroupHandle, 0)
-
-			for i=1,3,1 do
-				sumOfTransformedTorques = 0;
-				for j=1,jacobianSize[1],1 do
-					--print("JACOBIAN: "..jacobian[(i-1)*jacobianSize[1]+j])
-					sumOfTransformedTorques = sumOfTransformedTorques+jacobian[(i-1)*jacobianSize[1]+j]*externalTorques[j]
-				end
-				toolTipForces[i] = sumOfTransformedTorques;
-			end
-			--toolTipForces = matrixJacobianTranspose*externalJointTorque
-		end
-
-		return math.sqrt(toolTipForces[1]*toolTipForces[1]+toolTipForces[2]*toolTipForces[2]+toolTipForces[3]*toolTipForces[3])
-	end
-
-	function fcv(ikGroupHandle, CreatedPathHandle, maxVelocity, maxForce, measuredForce, pathLength)
-
-		-- selection parameter for simRMLPos for default behavior
-		selection = {1,1,1,1,1,1,1}
-
-		-- Get position (in meters) on the path (0 = start, pathLength = end)
-		position = simGetPathPosition(CreatedPathHandle)
-
-		--measuredForce = sumOfTorques
-		timeStep = simGetSimulationTimeStep()
-		maxOffset = maxVelocity*timeStep
-
-
-		-- Calculate the "speed" (magnitude of position) we wish to move based on force (in meters)
-		offset = constrain(forceToOffset(measuredForce, maxForce, maxOffset), 0, maxOffset)
-		newPosition = position + offset
-		--print("OFFSET: "..maxOffset)
-
-		-- Move intrinsic path position to next position
-		simSetPathPosition(CreatedPathHandle, newPosition)
-
-		-- Get the XYZ coordinates of the next position along the path
-		nextXyzPosition = simGetPositionOnPath(CreatedPathHandle, newPosition/pathLength)
-		nextOrientation = simGetOrientationOnPath(CreatedPathHandle, newPosition/pathLength)
-
-		if not useRMLSmoothing then
-			-- Move to the next position on the path
-			simSetObjectPosition(target, -1, nextXyzPosition)
-			simSetObjectOrientation(target, -1, nextOrientation)
-
-		else
-			nextQuat = simGetQuaternionFromMatrix(simBuildMatrix({0,0,0},nextOrientation))
-			--simRMLMoveToPosition(target,-1,-1,
-		end
-	end
-
 	target=simGetObjectHandle('RobotMillTipTarget')
 	targetBase=simGetObjectHandle('Robotiiwa')
 	bone=simGetObjectHandle('FemurBone')
@@ -299,8 +164,9 @@ robone.cutBoneScript=function()
 	useGrlInverseKinematics=true
 	print("useGrlInverseKinematics V-REP plugin: " , useGrlInverseKinematics )
 
-	-- Using RML library for smooth FCV path following
-	useRMLSmoothing = false
+	-- Force controlled velocity (fcv) cutting parameters, see robone.startForceControlledCut
+	maxCutVelocity = 0.04 -- m/s along the path when no force is measured
+	maxCutForce = 30      -- N at the tool tip where motion stops
 
 	if (grl.isModuleLoaded('GrlInverseKinematics') and useGrlInverseKinematics) then
 		simExtGrlInverseKinematicsStart()
@@ -315,6 +181,37 @@ robone.cutBoneScript=function()
 end
 
 
+--- @brief Start moving the RobotMillTipTarget along a path with force controlled velocity
+---
+--- The controller runs in the KukaLBRiiwa plugin: each update it maps the external
+--- joint torques of the real arm through the jacobian to a tool tip force and
+--- advances the target along the path, slowing down as the force approaches maxForce.
+---
+--- @param pathHandle handle of the vrep path object to follow
+--- @param maxVelocity velocity along the path in m/s when no force is measured
+--- @param maxForce tool tip force in N where motion stops
+--- @param forceToVelocityModel optional, options are 'LOG' (default) and 'SQRT'
+--- @return true if path following started
+robone.startForceControlledCut=function(pathHandle, maxVelocity, maxForce, forceToVelocityModel)
+    if not grl.isModuleLoaded('KukaLBRiiwa') then
+        return false
+    end
+    return simExtKukaLBRiiwaStartPathFollowing(simGetObjectName(pathHandle), maxVelocity, maxForce, forceToVelocityModel)
+end
+
+--- @brief Stop moving the target along the path, it stays at its current position
+robone.stopForceControlledCut=function()
+    if grl.isModuleLoaded('KukaLBRiiwa') then
+        simExtKukaLBRiiwaStopPathFollowing()
+    end
+end
+
+--- @return true until the end of the path is reached or robone.stopForceControlledCut is called
+robone.isForceControlledCutRunning=function()
+    local running = simExtKukaLBRiiwaGetPathFollowingState()
+    return running
+end
+
 ------------------------------------------
 -- Run Hand Eye Calibration Procedure   --
 ------------------------------------------
@@ -376,9 +273,17 @@ robone.handEyeCalibScript=function()
 		-- move back to start position
 		simRMLMoveToPosition(target,targetBase,-1,currentVel,currentAccel,maxVel,maxAccel,maxJerk,startP,startO,nil)
 
-		-- calculate the transform
-		simExtHandEyeCalibFindTransform()
-		simExtHandEyeCalibApplyTransform()
+		-- calculate the transform on a worker thread so the simulation and arm keep running,
+		-- the plugin applies the estimate once it is found
+		simExtHandEyeCalibFindTransformAsync()
+		local state, progress = simExtHandEyeCalibGetProgress()
+		while state == 1 do
+			simSwitchThread()
+			state, progress = simExtHandEyeCalibGetProgress()
+		end
+		if state ~= 2 then
+			simAddStatusbarMessage('robone.handEyeCalibScript: hand eye calibration did not finish, state: '..state)
+		end
 
 	-- check for fusiontrack
 	if (not grl.isModuleLoaded('AtracsysFusionTrack')) then
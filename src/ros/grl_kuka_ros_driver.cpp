@@ -1,7 +1,29 @@
 #include <grl/ros/KukaLBRiiwaROSPlugin.hpp>
 
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 using namespace grl::ros;
 
+/// Ask for SCHED_FIFO priority for the calling thread, which needs CAP_SYS_NICE
+/// or an rtprio limit in /etc/security/limits.conf, and carry on without it otherwise.
+static void trySetRealtimePriority(int priority)
+{
+#ifdef __linux__
+  sched_param param;
+  param.sched_priority = std::min(priority, sched_get_priority_max(SCHED_FIFO));
+  if(pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+  {
+    ROS_WARN("Could not give the KUKA driver thread real time priority, running it at normal priority");
+  }
+#endif
+}
 
 int main(int argc, char **argv) {
 
@@ -15,14 +37,35 @@ int main(int argc, char **argv) {
   std::shared_ptr<KukaLBRiiwaROSPlugin> plugin(std::make_shared<KukaLBRiiwaROSPlugin>());
   plugin->construct();
 
-  ::ros::Rate rate(1000);
-  while (::ros::ok()) {
-    ::ros::spinOnce();
+  // ROS callbacks run on their own thread, so message bursts never delay the arm
+  ::ros::AsyncSpinner spinner(1);
+  spinner.start();
+
+  // the 1 kHz driver cycle gets a thread to itself
+  std::thread driverThread([plugin]() {
+    trySetRealtimePriority(80);
+    const std::chrono::microseconds period(1000);
+    auto next = std::chrono::steady_clock::now();
+    while (::ros::ok()) {
+      plugin->run_one();
 
-    plugin->run_one();
+      next += period;
+      const auto now = std::chrono::steady_clock::now();
+      // after a stall start a fresh cycle rather than running several back to back
+      if (next < now) next = now;
+      std::this_thread::sleep_until(next);
+    }
+  });
 
+  // publish the arm state on this thread as the driver produces it
+  ::ros::Rate rate(1000);
+  while (::ros::ok()) {
+    plugin->publish_one();
     rate.sleep();
   }
 
+  driverThread.join();
+  spinner.stop();
+
   return 0;
 }
@@ -31,7 +31,7 @@ void CLuaFunctionData::getInputDataForFunctionRegistration(const int* dat,std::v
     outDat.clear();
     outDat.push_back(dat[0]);
     for (int i=0;i<dat[0];i++)
-        outDat.push_back((dat[1+2*i+0]|SIM_LUA_ARG_NIL_ALLOWED)-SIM_LUA_ARG_NIL_ALLOWED);
+        outDat.push_back((dat[1+2*i+0]|SIM_LUA_ARG_FLAGS)-SIM_LUA_ARG_FLAGS);
 }
 
 std::vector<CLuaFunctionDataItem>* CLuaFunctionData::getInDataPtr()
@@ -90,7 +90,7 @@ bool CLuaFunctionData::readDataFromLua(const SLuaCallBack* p,const int* expected
         }
         if (!done)
         {
-            if (p->inputArgTypeAndSize[i*2+0]!=((expectedArguments[1+i*2+0]|SIM_LUA_ARG_NIL_ALLOWED)-SIM_LUA_ARG_NIL_ALLOWED))
+            if (p->inputArgTypeAndSize[i*2+0]!=((expectedArguments[1+i*2+0]|SIM_LUA_ARG_FLAGS)-SIM_LUA_ARG_FLAGS))
             {
                 std::ostringstream str;
                 str << "Argument " << i+1 << " is not correct.";
@@ -215,6 +215,13 @@ bool CLuaFunctionData::readDataFromLua(const SLuaCallBack* p,const int* expected
                         simSetLastError(functionName,str.str().c_str());
                         return(false);
                     }
+                    else if (expectedArguments[1+i*2+0]&SIM_LUA_ARG_PACKED_VIEW)
+                    { // refer to the buffer in place, no copy
+                        CLuaFunctionDataItem dat;
+                        dat.setBufferView(p->inputCharBuff+charBuffArgInd,p->inputArgTypeAndSize[i*2+1]);
+                        charBuffArgInd+=p->inputArgTypeAndSize[i*2+1];
+                        _inData.push_back(dat);
+                    }
                     else
                     {
                         CLuaFunctionDataItem dat(p->inputCharBuff+charBuffArgInd,p->inputArgTypeAndSize[i*2+1]);
@@ -274,7 +281,7 @@ bool CLuaFunctionData::readDataFromLua_luaFunctionCall(const SLuaCallBack* p,con
         }
         if (!done)
         {
-            if (p->outputArgTypeAndSize[i*2+0]!=((expectedArguments[1+i*2+0]|SIM_LUA_ARG_NIL_ALLOWED)-SIM_LUA_ARG_NIL_ALLOWED))
+            if (p->outputArgTypeAndSize[i*2+0]!=((expectedArguments[1+i*2+0]|SIM_LUA_ARG_FLAGS)-SIM_LUA_ARG_FLAGS))
             {
                 std::ostringstream str;
                 str << "Return argument " << i+1 << " is not correct.";
@@ -519,9 +526,9 @@ void CLuaFunctionData::writeDataToLua(SLuaCallBack* p)
                 }
                 if (_outData[i].getType()==4)
                 {
-                    p->outputArgTypeAndSize[i*2+1]=int(_outData[i].stringData[0].length());
+                    p->outputArgTypeAndSize[i*2+1]=int(_outData[i].getBufferLength());
                     p->outputArgTypeAndSize[i*2+0]=sim_lua_arg_charbuff;
-                    charBuffDataCnt+=int(_outData[i].stringData[0].length());
+                    charBuffDataCnt+=int(_outData[i].getBufferLength());
                 }
             }
         }
@@ -594,8 +601,8 @@ void CLuaFunctionData::writeDataToLua(SLuaCallBack* p)
                 }
                 if (_outData[i].getType()==4)
                 {
-                    for (int j=0;j<int(_outData[i].stringData[0].length());j++)
-                        p->outputCharBuff[charBuffDataOff++]=_outData[i].stringData[0][j];
+                    std::memcpy(p->outputCharBuff+charBuffDataOff,_outData[i].getBufferPtr(),_outData[i].getBufferLength());
+                    charBuffDataOff+=int(_outData[i].getBufferLength());
                 }
             }
         }
@@ -719,9 +726,9 @@ void CLuaFunctionData::writeDataToLua_luaFunctionCall(SLuaCallBack* p,const int*
                 }
                 if (_inData[i].getType()==4)
                 {
-                    p->inputArgTypeAndSize[i*2+1]=int(_inData[i].stringData[0].length());
+                    p->inputArgTypeAndSize[i*2+1]=int(_inData[i].getBufferLength());
                     p->inputArgTypeAndSize[i*2+0]=sim_lua_arg_charbuff;
-                    charBuffDataCnt+=int(_inData[i].stringData[0].length());
+                    charBuffDataCnt+=int(_inData[i].getBufferLength());
                 }
             }
         }
@@ -794,8 +801,8 @@ void CLuaFunctionData::writeDataToLua_luaFunctionCall(SLuaCallBack* p,const int*
                 }
                 if (_inData[i].getType()==4)
                 {
-                    for (int j=0;j<int(_inData[i].stringData[0].length());j++)
-                        p->inputCharBuff[charBuffDataOff++]=_inData[i].stringData[0][j];
+                    std::memcpy(p->inputCharBuff+charBuffDataOff,_inData[i].getBufferPtr(),_inData[i].getBufferLength());
+                    charBuffDataOff+=int(_inData[i].getBufferLength());
                 }
             }
         }
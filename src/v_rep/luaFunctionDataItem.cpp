@@ -15,10 +15,14 @@
 // This file was automatically created for V-REP release V3.3.2 on August 29th 2016
 
 #include "luaFunctionDataItem.h"
+#include <cstring>
+#include <cstdint>
 
 CLuaFunctionDataItem::CLuaFunctionDataItem()
 {
     _nilTableSize=0;
+    _bufferView=NULL;
+    _bufferViewLength=0;
     _isTable=false;
     _type=-1; // nil
 }
@@ -26,6 +30,8 @@ CLuaFunctionDataItem::CLuaFunctionDataItem()
 CLuaFunctionDataItem::CLuaFunctionDataItem(bool v)
 {
     _nilTableSize=0;
+    _bufferView=NULL;
+    _bufferViewLength=0;
     _isTable=false;
     _type=0;
     boolData.push_back(v);
@@ -34,6 +40,8 @@ CLuaFunctionDataItem::CLuaFunctionDataItem(bool v)
 CLuaFunctionDataItem::CLuaFunctionDataItem(int v)
 {
     _nilTableSize=0;
+    _bufferView=NULL;
+    _bufferViewLength=0;
     _isTable=false;
     _type=1;
     intData.push_back(v);
@@ -42,6 +50,8 @@ CLuaFunctionDataItem::CLuaFunctionDataItem(int v)
 CLuaFunctionDataItem::CLuaFunctionDataItem(float v)
 {
     _nilTableSize=0;
+    _bufferView=NULL;
+    _bufferViewLength=0;
     _isTable=false;
     _type=2;
     floatData.push_back(v);
@@ -50,6 +60,8 @@ CLuaFunctionDataItem::CLuaFunctionDataItem(float v)
 CLuaFunctionDataItem::CLuaFunctionDataItem(double v)
 {
     _nilTableSize=0;
+    _bufferView=NULL;
+    _bufferViewLength=0;
     _isTable=false;
     _type=5;
     doubleData.push_back(v);
@@ -58,6 +70,8 @@ CLuaFunctionDataItem::CLuaFunctionDataItem(double v)
 CLuaFunctionDataItem::CLuaFunctionDataItem(const std::string& v)
 {
     _nilTableSize=0;
+    _bufferView=NULL;
+    _bufferViewLength=0;
     _isTable=false;
     _type=3;
     stringData.push_back(v);
@@ -66,15 +80,39 @@ CLuaFunctionDataItem::CLuaFunctionDataItem(const std::string& v)
 CLuaFunctionDataItem::CLuaFunctionDataItem(const char* bufferPtr,unsigned int bufferLength)
 {
     _nilTableSize=0;
+    _bufferView=NULL;
+    _bufferViewLength=0;
     _isTable=false;
     _type=4;
     std::string v(bufferPtr,bufferLength);
     stringData.push_back(v);
 }
 
+CLuaFunctionDataItem::CLuaFunctionDataItem(const float* packedData,unsigned int count)
+{
+    _nilTableSize=0;
+    _bufferView=NULL;
+    _bufferViewLength=0;
+    _isTable=false;
+    _type=4;
+    stringData.push_back(std::string(reinterpret_cast<const char*>(packedData),count*sizeof(float)));
+}
+
+CLuaFunctionDataItem::CLuaFunctionDataItem(const double* packedData,unsigned int count)
+{
+    _nilTableSize=0;
+    _bufferView=NULL;
+    _bufferViewLength=0;
+    _isTable=false;
+    _type=4;
+    stringData.push_back(std::string(reinterpret_cast<const char*>(packedData),count*sizeof(double)));
+}
+
 CLuaFunctionDataItem::CLuaFunctionDataItem(const std::vector<bool>& v)
 {
     _nilTableSize=0;
+    _bufferView=NULL;
+    _bufferViewLength=0;
     _isTable=true;
     _type=0;
     boolData.assign(v.begin(),v.end());
@@ -83,6 +121,8 @@ CLuaFunctionDataItem::CLuaFunctionDataItem(const std::vector<bool>& v)
 CLuaFunctionDataItem::CLuaFunctionDataItem(const std::vector<int>& v)
 {
     _nilTableSize=0;
+    _bufferView=NULL;
+    _bufferViewLength=0;
     _isTable=true;
     _type=1;
     intData.assign(v.begin(),v.end());
@@ -91,6 +131,8 @@ CLuaFunctionDataItem::CLuaFunctionDataItem(const std::vector<int>& v)
 CLuaFunctionDataItem::CLuaFunctionDataItem(const std::vector<float>& v)
 {
     _nilTableSize=0;
+    _bufferView=NULL;
+    _bufferViewLength=0;
     _isTable=true;
     _type=2;
     floatData.assign(v.begin(),v.end());
@@ -99,6 +141,8 @@ CLuaFunctionDataItem::CLuaFunctionDataItem(const std::vector<float>& v)
 CLuaFunctionDataItem::CLuaFunctionDataItem(const std::vector<double>& v)
 {
     _nilTableSize=0;
+    _bufferView=NULL;
+    _bufferViewLength=0;
     _isTable=true;
     _type=5;
     doubleData.assign(v.begin(),v.end());
@@ -107,6 +151,8 @@ CLuaFunctionDataItem::CLuaFunctionDataItem(const std::vector<double>& v)
 CLuaFunctionDataItem::CLuaFunctionDataItem(const std::vector<std::string>& v)
 {
     _nilTableSize=0;
+    _bufferView=NULL;
+    _bufferViewLength=0;
     _isTable=true;
     _type=3;
     stringData.assign(v.begin(),v.end());
@@ -139,3 +185,62 @@ int CLuaFunctionDataItem::getNilTableSize()
 {
     return(_nilTableSize);
 }
+
+void CLuaFunctionDataItem::setBufferView(const char* bufferPtr,unsigned int bufferLength)
+{ // the buffer is not copied, so the item must not outlive the Lua callback it was read in
+    _isTable=false;
+    _type=4;
+    _bufferView=bufferPtr;
+    _bufferViewLength=bufferLength;
+}
+
+bool CLuaFunctionDataItem::isBufferView()
+{
+    return(_bufferView!=NULL);
+}
+
+const char* CLuaFunctionDataItem::getBufferPtr()
+{
+    if (_bufferView!=NULL)
+        return(_bufferView);
+    if ( (_type==4)&&(stringData.size()>0) )
+        return(stringData[0].data());
+    return(NULL);
+}
+
+unsigned int CLuaFunctionDataItem::getBufferLength()
+{
+    if (_bufferView!=NULL)
+        return(_bufferViewLength);
+    if ( (_type==4)&&(stringData.size()>0) )
+        return((unsigned int)stringData[0].length());
+    return(0);
+}
+
+const float* CLuaFunctionDataItem::getPackedFloats(unsigned int& count)
+{ // in place when the buffer is suitably aligned, otherwise copied once into floatData
+    const char* ptr=getBufferPtr();
+    count=getBufferLength()/sizeof(float);
+    if (ptr==NULL)
+        return(NULL);
+    if (reinterpret_cast<std::uintptr_t>(ptr)%alignof(float)==0)
+        return(reinterpret_cast<const float*>(ptr));
+    floatData.resize(count);
+    if (count>0)
+        std::memcpy(floatData.data(),ptr,count*sizeof(float));
+    return(floatData.data());
+}
+
+const double* CLuaFunctionDataItem::getPackedDoubles(unsigned int& count)
+{ // in place when the buffer is suitably aligned, otherwise copied once into doubleData
+    const char* ptr=getBufferPtr();
+    count=getBufferLength()/sizeof(double);
+    if (ptr==NULL)
+        return(NULL);
+    if (reinterpret_cast<std::uintptr_t>(ptr)%alignof(double)==0)
+        return(reinterpret_cast<const double*>(ptr));
+    doubleData.resize(count);
+    if (count>0)
+        std::memcpy(doubleData.data(),ptr,count*sizeof(double));
+    return(doubleData.data());
+}
@@ -0,0 +1,442 @@
+// High throughput, multi client variant of CSocketInConnection, see socketInConnectionEpoll.h
+
+#include "socketInConnectionEpoll.h"
+
+#if defined (__linux)
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <climits>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+
+#define HEADER_LENGTH 6 // byte1=id1, byte2=id2, byte3+byte4=packetSize, byte5+byte6=packetsLeftToRead
+#define RECEIVE_CHUNK_SIZE 65536
+#define MAX_EPOLL_EVENTS 64
+#define MAX_READ_PER_WAKEUP (1024*1024) // bytes read from one client before the others are served
+
+static bool _setNonBlocking(int socket)
+{
+    int flags=fcntl(socket,F_GETFL,0);
+    return( (flags!=-1)&&(fcntl(socket,F_SETFL,flags|O_NONBLOCK)!=-1) );
+}
+
+static long long _getMonotonicTimeInMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return((long long)ts.tv_sec*1000+ts.tv_nsec/1000000);
+}
+
+CSocketInConnectionEpoll::CSocketInConnectionEpoll(int theConnectionPort,unsigned short maxPacketSize/*=65535*/,char headerID1/*=59*/,char headerID2/*=57*/,int socketBufferSize/*=4*1024*1024*/,int maxMessageSize/*=64*1024*1024*/)
+{
+    _socketConnectionPort=theConnectionPort;
+    _socketBufferSize=socketBufferSize;
+    _socketConnectWasOk=false;
+    _headerByte1=headerID1;
+    _headerByte2=headerID2;
+    _maxPacketSize=maxPacketSize;
+    if (_maxPacketSize<=HEADER_LENGTH)
+        _maxPacketSize=HEADER_LENGTH+1;
+    _maxMessageSize=maxMessageSize;
+    _socketServer=-1;
+    _epoll=-1;
+    memset(&_socketLocal,0,sizeof(struct sockaddr_in));
+}
+
+CSocketInConnectionEpoll::~CSocketInConnectionEpoll()
+{
+    for (std::map<int,SClient>::iterator it=_clients.begin();it!=_clients.end();++it)
+        close(it->first);
+    _clients.clear();
+    if (_socketServer!=-1)
+        close(_socketServer);
+    if (_epoll!=-1)
+        close(_epoll);
+}
+
+bool CSocketInConnectionEpoll::listenForClients()
+{
+    _socketLocal.sin_family=AF_INET;
+    _socketLocal.sin_addr.s_addr=INADDR_ANY;
+    _socketLocal.sin_port=htons((u_short)_socketConnectionPort);
+    _socketServer=socket(AF_INET,SOCK_STREAM,0);
+    if (_socketServer==-1)
+        return(false); // socket failed.
+
+    int reuse=1;
+    setsockopt(_socketServer,SOL_SOCKET,SO_REUSEADDR,&reuse,sizeof(reuse));
+    // accepted sockets inherit the buffer sizes, which must be set before listen to affect the TCP window
+    _tuneSocket(_socketServer);
+
+    if (bind(_socketServer,(struct sockaddr*)&_socketLocal,sizeof(_socketLocal))!=0)
+        return(false); // bind failed.
+
+    if (listen(_socketServer,SOMAXCONN)!=0)
+        return(false); // listen failed.
+
+    if (!_setNonBlocking(_socketServer))
+        return(false);
+
+    _epoll=epoll_create1(0);
+    if (_epoll==-1)
+        return(false);
+
+    struct epoll_event ev;
+    memset(&ev,0,sizeof(ev));
+    ev.events=EPOLLIN;
+    ev.data.fd=_socketServer;
+    if (epoll_ctl(_epoll,EPOLL_CTL_ADD,_socketServer,&ev)!=0)
+        return(false);
+
+    _socketConnectWasOk=true;
+    return(true);
+}
+
+int CSocketInConnectionEpoll::receiveData(std::vector<char>& data,int& clientId,int timeoutMs/*=-1*/)
+{ // Returns 1 if a message was received, 0=we had a read time out, -1=we have an error
+    if (!_socketConnectWasOk)
+        return(-1);
+
+    long long deadline=_getMonotonicTimeInMs()+timeoutMs;
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    while (true)
+    {
+        if (!_completeMessages.empty())
+        {
+            clientId=_completeMessages.front().first;
+            data.swap(_completeMessages.front().second);
+            _completeMessages.pop_front();
+            return(1);
+        }
+
+        int waitMs=-1;
+        if (timeoutMs>=0)
+        {
+            waitMs=int(deadline-_getMonotonicTimeInMs());
+            if (waitMs<0)
+                return(0);
+        }
+
+        int eventCount=epoll_wait(_epoll,events,MAX_EPOLL_EVENTS,waitMs);
+        if (eventCount<0)
+        {
+            if (errno==EINTR)
+                continue;
+            return(-1);
+        }
+        if (eventCount==0)
+            return(0);
+
+        for (int i=0;i<eventCount;i++)
+        {
+            int fd=events[i].data.fd;
+            if (fd==_socketServer)
+                _acceptClients();
+            else if (events[i].events&(EPOLLERR|EPOLLHUP))
+                closeClient(fd);
+            else
+            {
+                bool keep=true;
+                if (events[i].events&EPOLLOUT) // a slow client took more of its queued replies
+                    keep=_flushClient(fd)&&(!_isDone(fd));
+                if ( keep&&(events[i].events&(EPOLLIN|EPOLLRDHUP)) )
+                    keep=_readFromClient(fd);
+                if (!keep)
+                    closeClient(fd);
+            }
+        }
+    }
+}
+
+bool CSocketInConnectionEpoll::replyToReceivedData(int clientId,const char* data,int dataSize)
+{
+    std::map<int,SClient>::iterator it=_clients.find(clientId);
+    if ( (!_socketConnectWasOk)||(it==_clients.end()) )
+        return(false);
+    if (dataSize==0)
+        return(false);
+    SClient& c=it->second;
+    if (c.outBuffer.size()-c.outOffset>size_t(_maxMessageSize))
+    { // the client stopped reading its replies
+        closeClient(clientId);
+        return(false);
+    }
+
+    int payloadPerPacket=_maxPacketSize-HEADER_LENGTH;
+    int packetCount=(dataSize+payloadPerPacket-1)/payloadPerPacket;
+    if (packetCount>65536)
+        return(false); // the packets left field can't describe this
+
+    // one header and one payload entry per packet, all sent with one sendmsg
+    _replyHeaders.resize(packetCount*HEADER_LENGTH);
+    std::vector<struct iovec> iov(packetCount*2);
+    int ptr=0;
+    for (int i=0;i<packetCount;i++)
+    {
+        unsigned short sizeToSend=(unsigned short)std::min(payloadPerPacket,dataSize-ptr);
+        unsigned short packetsLeft=(unsigned short)(packetCount-1-i);
+        char* header=&_replyHeaders[i*HEADER_LENGTH];
+        header[0]=_headerByte1;
+        header[1]=_headerByte2;
+        memcpy(header+2,&sizeToSend,sizeof(sizeToSend));
+        memcpy(header+4,&packetsLeft,sizeof(packetsLeft));
+        iov[i*2+0].iov_base=header;
+        iov[i*2+0].iov_len=HEADER_LENGTH;
+        iov[i*2+1].iov_base=const_cast<char*>(data+ptr);
+        iov[i*2+1].iov_len=sizeToSend;
+        ptr+=sizeToSend;
+    }
+    if (!_sendReply(clientId,c,&iov[0],int(iov.size())))
+    {
+        closeClient(clientId);
+        return(false);
+    }
+    if (_isDone(clientId))
+        closeClient(clientId);
+    return(true);
+}
+
+void CSocketInConnectionEpoll::closeClient(int clientId)
+{
+    std::map<int,SClient>::iterator it=_clients.find(clientId);
+    if (it==_clients.end())
+        return;
+    epoll_ctl(_epoll,EPOLL_CTL_DEL,clientId,NULL);
+    close(clientId);
+    _clients.erase(it);
+    // the next client accepted may get the same fd, so it must not receive the messages queued for this one
+    _completeMessages.erase(std::remove_if(_completeMessages.begin(),_completeMessages.end(),
+                                           [clientId](const std::pair<int,std::vector<char> >& m){ return(m.first==clientId); }),
+                            _completeMessages.end());
+}
+
+int CSocketInConnectionEpoll::getClientCount()
+{
+    return(int(_clients.size()));
+}
+
+std::string CSocketInConnectionEpoll::getConnectedMachineIP(int clientId)
+{
+    std::map<int,SClient>::iterator it=_clients.find(clientId);
+    if (it==_clients.end())
+        return("NONE (reception line is not open)");
+    return(it->second.ip);
+}
+
+bool CSocketInConnectionEpoll::_acceptClients()
+{
+    while (true)
+    {
+        struct sockaddr_in from;
+        socklen_t fromlen=sizeof(from);
+        int client=accept(_socketServer,(struct sockaddr*)&from,&fromlen);
+        if (client==-1)
+            return( (errno==EAGAIN)||(errno==EWOULDBLOCK) );
+
+        _setNonBlocking(client);
+        _tuneSocket(client);
+
+        struct epoll_event ev;
+        memset(&ev,0,sizeof(ev));
+        ev.events=EPOLLIN|EPOLLRDHUP;
+        ev.data.fd=client;
+        if (epoll_ctl(_epoll,EPOLL_CTL_ADD,client,&ev)!=0)
+        {
+            close(client);
+            continue;
+        }
+        SClient& c=_clients[client];
+        c.ip=inet_ntoa(from.sin_addr);
+        c.inOffset=0;
+        c.outOffset=0;
+        c.events=ev.events;
+        c.peerClosed=false;
+        c.inBuffer.reserve(RECEIVE_CHUNK_SIZE);
+    }
+}
+
+bool CSocketInConnectionEpoll::_readFromClient(int clientId)
+{ // reads up to MAX_READ_PER_WAKEUP bytes, epoll reports the rest next time, returns false when the client should be closed
+    std::map<int,SClient>::iterator it=_clients.find(clientId);
+    if (it==_clients.end())
+        return(false);
+    SClient& c=it->second;
+    size_t readNow=0;
+    while (readNow<MAX_READ_PER_WAKEUP)
+    {
+        size_t oldSize=c.inBuffer.size();
+        c.inBuffer.resize(oldSize+RECEIVE_CHUNK_SIZE);
+        ssize_t nb=recv(clientId,&c.inBuffer[oldSize],RECEIVE_CHUNK_SIZE,0);
+        if (nb>0)
+        {
+            c.inBuffer.resize(oldSize+nb);
+            readNow+=nb;
+            continue;
+        }
+        c.inBuffer.resize(oldSize);
+        if (nb==0)
+        { // the client shut down its sending side, but can still read the replies to what it sent
+            c.peerClosed=true;
+            return( _parseClientPackets(clientId)&&(!_isDone(clientId))&&_updateEvents(clientId,c) );
+        }
+        if ( (errno==EAGAIN)||(errno==EWOULDBLOCK) )
+            break;
+        if (errno!=EINTR)
+            return(false);
+    }
+    return(_parseClientPackets(clientId));
+}
+
+bool CSocketInConnectionEpoll::_parseClientPackets(int clientId)
+{
+    SClient& c=_clients[clientId];
+    while (c.inBuffer.size()-c.inOffset>=HEADER_LENGTH)
+    {
+        const char* header=&c.inBuffer[c.inOffset];
+        if ( (header[0]!=_headerByte1)||(header[1]!=_headerByte2) )
+            return(false); // Error, wrong header
+        unsigned short dataLength;
+        unsigned short packetsLeft;
+        memcpy(&dataLength,header+2,sizeof(dataLength));
+        memcpy(&packetsLeft,header+4,sizeof(packetsLeft));
+        if (c.inBuffer.size()-c.inOffset<size_t(HEADER_LENGTH+dataLength))
+            break; // wait for the rest of the packet
+        if (c.message.size()+dataLength>size_t(_maxMessageSize))
+            return(false); // Error, message too large
+        c.message.insert(c.message.end(),header+HEADER_LENGTH,header+HEADER_LENGTH+dataLength);
+        c.inOffset+=HEADER_LENGTH+dataLength;
+        if (packetsLeft==0)
+        {
+            _completeMessages.push_back(std::make_pair(clientId,std::vector<char>()));
+            _completeMessages.back().second.swap(c.message);
+        }
+    }
+    // drop the consumed bytes, rarely moving any memory since messages usually arrive complete
+    if (c.inOffset==c.inBuffer.size())
+    {
+        c.inBuffer.clear();
+        c.inOffset=0;
+    }
+    else if (c.inOffset>c.inBuffer.size()/2)
+    {
+        c.inBuffer.erase(c.inBuffer.begin(),c.inBuffer.begin()+c.inOffset);
+        c.inOffset=0;
+    }
+    return(true);
+}
+
+bool CSocketInConnectionEpoll::_sendReply(int clientId,SClient& c,struct iovec* iov,int iovCount)
+{ // sends what the socket takes right now and queues the rest, never waits for the client
+    while ( (iovCount>0)&&(c.outBuffer.empty()) )
+    {
+        struct msghdr msg;
+        memset(&msg,0,sizeof(msg));
+        msg.msg_iov=iov;
+        msg.msg_iovlen=std::min(iovCount,IOV_MAX);
+        ssize_t nb=sendmsg(clientId,&msg,MSG_NOSIGNAL);
+        if (nb<0)
+        {
+            if (errno==EINTR)
+                continue;
+            if ( (errno==EAGAIN)||(errno==EWOULDBLOCK) )
+                break;
+            return(false);
+        }
+        while ( (nb>0)&&(iovCount>0) )
+        {
+            if (size_t(nb)>=iov->iov_len)
+            {
+                nb-=iov->iov_len;
+                iov++;
+                iovCount--;
+            }
+            else
+            {
+                iov->iov_base=(char*)iov->iov_base+nb;
+                iov->iov_len-=nb;
+                nb=0;
+            }
+        }
+    }
+    if (iovCount==0)
+        return(true);
+    // behind earlier replies or the kernel buffer is full, receiveData() sends it once the client is writable
+    for (int i=0;i<iovCount;i++)
+        c.outBuffer.insert(c.outBuffer.end(),(char*)iov[i].iov_base,(char*)iov[i].iov_base+iov[i].iov_len);
+    return(_flushClient(clientId));
+}
+
+bool CSocketInConnectionEpoll::_flushClient(int clientId)
+{ // sends queued reply bytes until the kernel buffer is full, returns false on error
+    std::map<int,SClient>::iterator it=_clients.find(clientId);
+    if (it==_clients.end())
+        return(false);
+    SClient& c=it->second;
+    while (c.outOffset<c.outBuffer.size())
+    {
+        ssize_t nb=send(clientId,&c.outBuffer[c.outOffset],c.outBuffer.size()-c.outOffset,MSG_NOSIGNAL);
+        if (nb<0)
+        {
+            if (errno==EINTR)
+                continue;
+            if ( (errno==EAGAIN)||(errno==EWOULDBLOCK) )
+                break;
+            return(false);
+        }
+        c.outOffset+=nb;
+    }
+    if (c.outOffset==c.outBuffer.size())
+    {
+        c.outBuffer.clear();
+        c.outOffset=0;
+    }
+    return(_updateEvents(clientId,c));
+}
+
+bool CSocketInConnectionEpoll::_updateEvents(int clientId,SClient& c)
+{ // read until the client shuts down its sending side, wait for writable only while replies are queued
+    unsigned int events=(c.peerClosed?0:(EPOLLIN|EPOLLRDHUP))|(c.outBuffer.empty()?0:EPOLLOUT);
+    if (events==c.events)
+        return(true);
+    struct epoll_event ev;
+    memset(&ev,0,sizeof(ev));
+    ev.events=events;
+    ev.data.fd=clientId;
+    if (epoll_ctl(_epoll,EPOLL_CTL_MOD,clientId,&ev)!=0)
+        return(false);
+    c.events=events;
+    return(true);
+}
+
+bool CSocketInConnectionEpoll::_isDone(int clientId)
+{ // a client that shut down its sending side is done once all it sent was replied to
+    std::map<int,SClient>::iterator it=_clients.find(clientId);
+    if ( (it==_clients.end())||(!it->second.peerClosed)||(!it->second.outBuffer.empty()) )
+        return(false);
+    for (size_t i=0;i<_completeMessages.size();i++)
+    {
+        if (_completeMessages[i].first==clientId)
+            return(false);
+    }
+    return(true);
+}
+
+void CSocketInConnectionEpoll::_tuneSocket(int socket)
+{
+    int noDelay=1;
+    setsockopt(socket,IPPROTO_TCP,TCP_NODELAY,&noDelay,sizeof(noDelay));
+    if (_socketBufferSize>0)
+    {
+        setsockopt(socket,SOL_SOCKET,SO_SNDBUF,&_socketBufferSize,sizeof(_socketBufferSize));
+        setsockopt(socket,SOL_SOCKET,SO_RCVBUF,&_socketBufferSize,sizeof(_socketBufferSize));
+    }
+}
+
+#endif /* __linux */
@@ -0,0 +1,467 @@
+// Copyright 2006-2014 Coppelia Robotics GmbH. All rights reserved.
+// marc@coppeliarobotics.com
+// www.coppeliarobotics.com
+//
+// -------------------------------------------------------------------
+// THIS FILE IS DISTRIBUTED "AS IS", WITHOUT ANY EXPRESS OR IMPLIED
+// WARRANTY. THE USER WILL USE IT AT HIS/HER OWN RISK. THE ORIGINAL
+// AUTHORS AND COPPELIA ROBOTICS GMBH WILL NOT BE LIABLE FOR DATA LOSS,
+// DAMAGES, LOSS OF PROFITS OR ANY OTHER KIND OF LOSS WHILE USING OR
+// MISUSING THIS SOFTWARE.
+//
+// You are free to use/modify/distribute this file for whatever purpose!
+// -------------------------------------------------------------------
+//
+// This file was automatically created for V-REP release V3.2.0 on Feb. 3rd 2015
+
+#include <map>
+#include <memory>
+
+#include <spdlog/spdlog.h>
+
+#include "luaFunctionData.h"
+#include "v_repExtGrlPath.h"
+#include "grl/path/ArcLengthPath.hpp"
+#include "grl/path/VrepPathFlatbuffer.hpp"
+#include "grl/vrep/Eigen.hpp"
+
+#include "v_repLib.h"
+
+#ifdef _WIN32
+#include <shlwapi.h>
+#pragma comment(lib, "Shlwapi.lib")
+#endif /* _WIN32 */
+
+#if defined(__linux) || defined(__APPLE__)
+#include <unistd.h>
+#include <string.h>
+#define _stricmp(x, y) strcasecmp(x, y)
+#endif
+
+#define PLUGIN_VERSION 1
+
+LIBRARY vrepLib; // the V-REP library that we will dynamically load and bind
+
+/// paths loaded from lua, indexed by the id returned from simExtGrlPathLoad
+std::map<int, std::shared_ptr<grl::path::ArcLengthPath>> pathsPG;
+int nextPathIdG = 0;
+std::shared_ptr<spdlog::logger> loggerPG;
+
+/// @return the path or nullptr after setting the lua error if the id is invalid
+std::shared_ptr<grl::path::ArcLengthPath> getPath(int pathId, const char *functionName)
+{
+	auto it = pathsPG.find(pathId);
+	if (it == pathsPG.end())
+	{
+		simSetLastError(functionName, "Invalid path id, load the path with simExtGrlPathLoad first.");
+		return nullptr;
+	}
+	return it->second;
+}
+
+/// Report the exception being handled as the lua error of functionName, call only from a catch block
+void setLastErrorFromException(const char *functionName)
+{
+	std::string err;
+	try
+	{
+		throw;
+	}
+	catch (const boost::exception &e)
+	{
+		err = boost::diagnostic_information(e);
+	}
+	catch (const std::exception &e)
+	{
+		err = e.what();
+	}
+	catch (...)
+	{
+		err = "unknown exception";
+	}
+	simSetLastError(functionName, err.c_str());
+	std::string message(std::string("v_repExtGrlPath error in ") + functionName + ":\n" + err);
+	simAddStatusbarMessage(message.c_str());
+	loggerPG->error(message);
+}
+
+/// Transform a sampled pose in place from the path frame into the frame of a V-REP object
+void transformPoses(double *poses, std::size_t count, const Eigen::Affine3d &transform)
+{
+	const std::size_t stride = grl::path::ArcLengthPath::PoseStride;
+	Eigen::Quaterniond rotation(transform.rotation());
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		Eigen::Map<Eigen::Vector3d> position(poses + i * stride);
+		Eigen::Map<Eigen::Quaterniond> orientation(poses + i * stride + 3);
+		position = transform * Eigen::Vector3d(position);
+		orientation = rotation * orientation;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//   Load a path from a VrepPath flatbuffer or a V-REP path text file
+/////////////////////////////////////////////////////////////////////////////
+
+#define LUA_SIM_EXT_GRL_PATH_LOAD_COMMAND "simExtGrlPathLoad"
+
+const int inArgs_LUA_SIM_EXT_GRL_PATH_LOAD[] = {
+	1,
+	sim_lua_arg_string, 0 // string file name
+};
+
+std::string LUA_SIM_EXT_GRL_PATH_LOAD_CALL_TIP("number pathId=simExtGrlPathLoad(string fileName) -- .csv and .txt files are loaded as V-REP path text files, others as VrepPath flatbuffers, returns -1 on failure");
+
+void LUA_SIM_EXT_GRL_PATH_LOAD(SLuaCallBack *p)
+{
+	CLuaFunctionData D;
+	int pathId = -1;
+	try
+	{
+		if (D.readDataFromLua(p, inArgs_LUA_SIM_EXT_GRL_PATH_LOAD, inArgs_LUA_SIM_EXT_GRL_PATH_LOAD[0], LUA_SIM_EXT_GRL_PATH_LOAD_COMMAND))
+		{
+			std::vector<CLuaFunctionDataItem> *inData = D.getInDataPtr();
+			std::string fileName(inData->at(0).stringData[0]);
+			auto path = std::make_shared<grl::path::ArcLengthPath>(grl::path::loadVrepPathFile(fileName));
+			pathId = nextPathIdG++;
+			pathsPG[pathId] = path;
+			loggerPG->info("v_repExtGrlPath loaded {} with {} control points and length {}m", fileName, path->size(), path->length());
+		}
+	}
+	catch (...)
+	{
+		setLastErrorFromException(LUA_SIM_EXT_GRL_PATH_LOAD_COMMAND);
+	}
+	D.pushOutData(CLuaFunctionDataItem(pathId));
+	D.writeDataToLua(p);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//   Release a loaded path
+/////////////////////////////////////////////////////////////////////////////
+
+#define LUA_SIM_EXT_GRL_PATH_ERASE_COMMAND "simExtGrlPathErase"
+
+const int inArgs_LUA_SIM_EXT_GRL_PATH_ERASE[] = {
+	1,
+	sim_lua_arg_int, 0 // path id
+};
+
+std::string LUA_SIM_EXT_GRL_PATH_ERASE_CALL_TIP("boolean result=simExtGrlPathErase(number pathId)");
+
+void LUA_SIM_EXT_GRL_PATH_ERASE(SLuaCallBack *p)
+{
+	CLuaFunctionData D;
+	bool success = false;
+	try
+	{
+		if (D.readDataFromLua(p, inArgs_LUA_SIM_EXT_GRL_PATH_ERASE, inArgs_LUA_SIM_EXT_GRL_PATH_ERASE[0], LUA_SIM_EXT_GRL_PATH_ERASE_COMMAND))
+		{
+			std::vector<CLuaFunctionDataItem> *inData = D.getInDataPtr();
+			success = pathsPG.erase(inData->at(0).intData[0]) > 0;
+		}
+	}
+	catch (...)
+	{
+		setLastErrorFromException(LUA_SIM_EXT_GRL_PATH_ERASE_COMMAND);
+	}
+	D.pushOutData(CLuaFunctionDataItem(success));
+	D.writeDataToLua(p);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//   Total arc length of a path in meters
+/////////////////////////////////////////////////////////////////////////////
+
+#define LUA_SIM_EXT_GRL_PATH_GET_LENGTH_COMMAND "simExtGrlPathGetLength"
+
+const int inArgs_LUA_SIM_EXT_GRL_PATH_GET_LENGTH[] = {
+	1,
+	sim_lua_arg_int, 0 // path id
+};
+
+std::string LUA_SIM_EXT_GRL_PATH_GET_LENGTH_CALL_TIP("number length=simExtGrlPathGetLength(number pathId)");
+
+void LUA_SIM_EXT_GRL_PATH_GET_LENGTH(SLuaCallBack *p)
+{
+	CLuaFunctionData D;
+	try
+	{
+		if (D.readDataFromLua(p, inArgs_LUA_SIM_EXT_GRL_PATH_GET_LENGTH, inArgs_LUA_SIM_EXT_GRL_PATH_GET_LENGTH[0], LUA_SIM_EXT_GRL_PATH_GET_LENGTH_COMMAND))
+		{
+			std::vector<CLuaFunctionDataItem> *inData = D.getInDataPtr();
+			auto path = getPath(inData->at(0).intData[0], LUA_SIM_EXT_GRL_PATH_GET_LENGTH_COMMAND);
+			if (path)
+			{
+				D.pushOutData(CLuaFunctionDataItem(path->length()));
+			}
+		}
+	}
+	catch (...)
+	{
+		setLastErrorFromException(LUA_SIM_EXT_GRL_PATH_GET_LENGTH_COMMAND);
+	}
+	D.writeDataToLua(p);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//   Pose at a distance along the path, O(log n) in the number of control points
+/////////////////////////////////////////////////////////////////////////////
+
+#define LUA_SIM_EXT_GRL_PATH_GET_POSE_AT_DISTANCE_COMMAND "simExtGrlPathGetPoseAtDistance"
+
+const int inArgs_LUA_SIM_EXT_GRL_PATH_GET_POSE_AT_DISTANCE[] = {
+	3,
+	sim_lua_arg_int, 0,                            // path id
+	sim_lua_arg_double, 0,                         // distance in meters from the start of the path
+	sim_lua_arg_int | SIM_LUA_ARG_NIL_ALLOWED, 0   // optional handle of the object the path is relative to, nil for world
+};
+
+std::string LUA_SIM_EXT_GRL_PATH_GET_POSE_AT_DISTANCE_CALL_TIP("table_3 position,table_4 quaternion=simExtGrlPathGetPoseAtDistance(number pathId,number distance,number pathFrameHandle=nil) -- pose in the world frame when pathFrameHandle is given");
+
+void LUA_SIM_EXT_GRL_PATH_GET_POSE_AT_DISTANCE(SLuaCallBack *p)
+{
+	CLuaFunctionData D;
+	try
+	{
+		if (D.readDataFromLua(p, inArgs_LUA_SIM_EXT_GRL_PATH_GET_POSE_AT_DISTANCE, 2, LUA_SIM_EXT_GRL_PATH_GET_POSE_AT_DISTANCE_COMMAND))
+		{
+			std::vector<CLuaFunctionDataItem> *inData = D.getInDataPtr();
+			auto path = getPath(inData->at(0).intData[0], LUA_SIM_EXT_GRL_PATH_GET_POSE_AT_DISTANCE_COMMAND);
+			if (path)
+			{
+				std::vector<double> pose(grl::path::ArcLengthPath::PoseStride);
+				double distance = inData->at(1).doubleData[0];
+				path->sample(&distance, &distance + 1, pose.begin());
+				if (inData->size() > 2 && inData->at(2).getType() == 1)
+				{
+					transformPoses(&pose[0], 1, getObjectTransform(inData->at(2).intData[0]));
+				}
+				D.pushOutData(CLuaFunctionDataItem(std::vector<float>(pose.begin(), pose.begin() + 3)));
+				D.pushOutData(CLuaFunctionDataItem(std::vector<float>(pose.begin() + 3, pose.end())));
+			}
+		}
+	}
+	catch (...)
+	{
+		setLastErrorFromException(LUA_SIM_EXT_GRL_PATH_GET_POSE_AT_DISTANCE_COMMAND);
+	}
+	D.writeDataToLua(p);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//   Sample evenly spaced poses, returned as one packed buffer of doubles
+/////////////////////////////////////////////////////////////////////////////
+
+#define LUA_SIM_EXT_GRL_PATH_SAMPLE_COMMAND "simExtGrlPathSample"
+
+const int inArgs_LUA_SIM_EXT_GRL_PATH_SAMPLE[] = {
+	5,
+	sim_lua_arg_int, 0,                            // path id
+	sim_lua_arg_double, 0,                         // start distance in meters
+	sim_lua_arg_double, 0,                         // end distance in meters
+	sim_lua_arg_int, 0,                            // number of samples
+	sim_lua_arg_int | SIM_LUA_ARG_NIL_ALLOWED, 0   // optional handle of the object the path is relative to, nil for world
+};
+
+std::string LUA_SIM_EXT_GRL_PATH_SAMPLE_CALL_TIP("string poses=simExtGrlPathSample(number pathId,number startDistance,number endDistance,number count,number pathFrameHandle=nil) -- packed doubles x,y,z,qx,qy,qz,qw per pose, see grl.unpackRows");
+
+void LUA_SIM_EXT_GRL_PATH_SAMPLE(SLuaCallBack *p)
+{
+	CLuaFunctionData D;
+	try
+	{
+		if (D.readDataFromLua(p, inArgs_LUA_SIM_EXT_GRL_PATH_SAMPLE, 4, LUA_SIM_EXT_GRL_PATH_SAMPLE_COMMAND))
+		{
+			std::vector<CLuaFunctionDataItem> *inData = D.getInDataPtr();
+			auto path = getPath(inData->at(0).intData[0], LUA_SIM_EXT_GRL_PATH_SAMPLE_COMMAND);
+			int count = inData->at(3).intData[0];
+			if (path && count > 0)
+			{
+				std::vector<double> poses(count * grl::path::ArcLengthPath::PoseStride);
+				path->sampleUniform(inData->at(1).doubleData[0], inData->at(2).doubleData[0], count, poses.begin());
+				if (inData->size() > 4 && inData->at(4).getType() == 1)
+				{
+					transformPoses(&poses[0], count, getObjectTransform(inData->at(4).intData[0]));
+				}
+				D.pushOutData(CLuaFunctionDataItem(&poses[0], (unsigned int)poses.size()));
+			}
+		}
+	}
+	catch (...)
+	{
+		setLastErrorFromException(LUA_SIM_EXT_GRL_PATH_SAMPLE_COMMAND);
+	}
+	D.writeDataToLua(p);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//   Sample poses at arbitrary distances passed as a packed buffer of doubles
+/////////////////////////////////////////////////////////////////////////////
+
+#define LUA_SIM_EXT_GRL_PATH_SAMPLE_AT_COMMAND "simExtGrlPathSampleAt"
+
+const int inArgs_LUA_SIM_EXT_GRL_PATH_SAMPLE_AT[] = {
+	3,
+	sim_lua_arg_int, 0,                                   // path id
+	sim_lua_arg_charbuff | SIM_LUA_ARG_PACKED_VIEW, 0,    // distances packed with grl.packDoubleTable, read in place
+	sim_lua_arg_int | SIM_LUA_ARG_NIL_ALLOWED, 0          // optional handle of the object the path is relative to, nil for world
+};
+
+std::string LUA_SIM_EXT_GRL_PATH_SAMPLE_AT_CALL_TIP("string poses=simExtGrlPathSampleAt(number pathId,string packedDistances,number pathFrameHandle=nil) -- packed doubles x,y,z,qx,qy,qz,qw per pose, see grl.unpackRows");
+
+void LUA_SIM_EXT_GRL_PATH_SAMPLE_AT(SLuaCallBack *p)
+{
+	CLuaFunctionData D;
+	try
+	{
+		if (D.readDataFromLua(p, inArgs_LUA_SIM_EXT_GRL_PATH_SAMPLE_AT, 2, LUA_SIM_EXT_GRL_PATH_SAMPLE_AT_COMMAND))
+		{
+			std::vector<CLuaFunctionDataItem> *inData = D.getInDataPtr();
+			auto path = getPath(inData->at(0).intData[0], LUA_SIM_EXT_GRL_PATH_SAMPLE_AT_COMMAND);
+			unsigned int count = 0;
+			const double *distances = inData->at(1).getPackedDoubles(count);
+			if (path && count > 0)
+			{
+				std::vector<double> poses(count * grl::path::ArcLengthPath::PoseStride);
+				path->sample(distances, distances + count, poses.begin());
+				if (inData->size() > 2 && inData->at(2).getType() == 1)
+				{
+					transformPoses(&poses[0], count, getObjectTransform(inData->at(2).intData[0]));
+				}
+				D.pushOutData(CLuaFunctionDataItem(&poses[0], (unsigned int)poses.size()));
+			}
+		}
+	}
+	catch (...)
+	{
+		setLastErrorFromException(LUA_SIM_EXT_GRL_PATH_SAMPLE_AT_COMMAND);
+	}
+	D.writeDataToLua(p);
+}
+
+/// v-rep plugin: http://www.coppeliarobotics.com/helpFiles/en/plugins.htm
+/// This is the plugin start routine (called just once, just after the plugin was loaded):
+VREP_DLLEXPORT unsigned char v_repStart(void *reservedPointer, int reservedInt)
+{
+	try
+	{
+		loggerPG = spdlog::stdout_logger_mt("console");
+	}
+	catch (spdlog::spdlog_ex ex)
+	{
+		loggerPG = spdlog::get("console");
+	}
+	// Dynamically load and bind V-REP functions:
+	// ******************************************
+	// 1. Figure out this plugin's directory:
+	char curDirAndFile[1024];
+#ifdef _WIN32
+	GetModuleFileName(NULL, curDirAndFile, 1023);
+	PathRemoveFileSpec(curDirAndFile);
+#elif defined(__linux) || defined(__APPLE__)
+	getcwd(curDirAndFile, sizeof(curDirAndFile));
+#endif
+	std::string currentDirAndPath(curDirAndFile);
+	// 2. Append the V-REP library's name:
+	std::string temp(currentDirAndPath);
+#ifdef _WIN32
+	temp += "\\v_rep.dll";
+#elif defined(__linux)
+	temp += "/libv_rep.so";
+#elif defined(__APPLE__)
+	temp += "/libv_rep.dylib";
+#endif /* __linux || __APPLE__ */
+	// 3. Load the V-REP library:
+	vrepLib = loadVrepLibrary(temp.c_str());
+	if (vrepLib == NULL)
+	{
+		loggerPG->error("Error, could not find or correctly load the V-REP library. Cannot start 'GrlPath' plugin.\n");
+		return (0); // Means error, V-REP will unload this plugin
+	}
+	if (getVrepProcAddresses(vrepLib) == 0)
+	{
+		loggerPG->error("Error, could not find all required functions in the V-REP library. Cannot start 'GrlPath' plugin.\n");
+		unloadVrepLibrary(vrepLib);
+		return (0); // Means error, V-REP will unload this plugin
+	}
+	// ******************************************
+
+	// Check the version of V-REP:
+	// ******************************************
+	int vrepVer;
+	simGetIntegerParameter(sim_intparam_program_version, &vrepVer);
+	if (vrepVer < 30302) // packed double buffers need V-REP 3.3.2
+	{
+		loggerPG->error("Sorry, your V-REP copy is somewhat old. Cannot start 'GrlPath' plugin.\n");
+		unloadVrepLibrary(vrepLib);
+		return (0); // Means error, V-REP will unload this plugin
+	}
+	// ******************************************
+
+	std::vector<int> inArgs;
+	/// Register lua callbacks
+	CLuaFunctionData::getInputDataForFunctionRegistration(inArgs_LUA_SIM_EXT_GRL_PATH_LOAD, inArgs);
+	simRegisterCustomLuaFunction(LUA_SIM_EXT_GRL_PATH_LOAD_COMMAND,
+								 LUA_SIM_EXT_GRL_PATH_LOAD_CALL_TIP.c_str(),
+								 &inArgs[0],
+								 LUA_SIM_EXT_GRL_PATH_LOAD);
+
+	CLuaFunctionData::getInputDataForFunctionRegistration(inArgs_LUA_SIM_EXT_GRL_PATH_ERASE, inArgs);
+	simRegisterCustomLuaFunction(LUA_SIM_EXT_GRL_PATH_ERASE_COMMAND,
+								 LUA_SIM_EXT_GRL_PATH_ERASE_CALL_TIP.c_str(),
+								 &inArgs[0],
+								 LUA_SIM_EXT_GRL_PATH_ERASE);
+
+	CLuaFunctionData::getInputDataForFunctionRegistration(inArgs_LUA_SIM_EXT_GRL_PATH_GET_LENGTH, inArgs);
+	simRegisterCustomLuaFunction(LUA_SIM_EXT_GRL_PATH_GET_LENGTH_COMMAND,
+								 LUA_SIM_EXT_GRL_PATH_GET_LENGTH_CALL_TIP.c_str(),
+								 &inArgs[0],
+								 LUA_SIM_EXT_GRL_PATH_GET_LENGTH);
+
+	CLuaFunctionData::getInputDataForFunctionRegistration(inArgs_LUA_SIM_EXT_GRL_PATH_GET_POSE_AT_DISTANCE, inArgs);
+	simRegisterCustomLuaFunction(LUA_SIM_EXT_GRL_PATH_GET_POSE_AT_DISTANCE_COMMAND,
+								 LUA_SIM_EXT_GRL_PATH_GET_POSE_AT_DISTANCE_CALL_TIP.c_str(),
+								 &inArgs[0],
+								 LUA_SIM_EXT_GRL_PATH_GET_POSE_AT_DISTANCE);
+
+	CLuaFunctionData::getInputDataForFunctionRegistration(inArgs_LUA_SIM_EXT_GRL_PATH_SAMPLE, inArgs);
+	simRegisterCustomLuaFunction(LUA_SIM_EXT_GRL_PATH_SAMPLE_COMMAND,
+								 LUA_SIM_EXT_GRL_PATH_SAMPLE_CALL_TIP.c_str(),
+								 &inArgs[0],
+								 LUA_SIM_EXT_GRL_PATH_SAMPLE);
+
+	CLuaFunctionData::getInputDataForFunctionRegistration(inArgs_LUA_SIM_EXT_GRL_PATH_SAMPLE_AT, inArgs);
+	simRegisterCustomLuaFunction(LUA_SIM_EXT_GRL_PATH_SAMPLE_AT_COMMAND,
+								 LUA_SIM_EXT_GRL_PATH_SAMPLE_AT_CALL_TIP.c_str(),
+								 &inArgs[0],
+								 LUA_SIM_EXT_GRL_PATH_SAMPLE_AT);
+
+	loggerPG->info("GrlPath plugin initialized. Build date/time: ", __DATE__, " ", __TIME__, "\n");
+
+	return (PLUGIN_VERSION); // initialization went fine, we return the version number of this plugin (can be queried with simGetModuleName)
+}
+
+// This is the plugin end routine (called just once, when V-REP is ending, i.e. releasing this plugin):
+VREP_DLLEXPORT void v_repEnd()
+{
+	pathsPG.clear();
+	unloadVrepLibrary(vrepLib); // release the library
+}
+
+// This is the plugin messaging routine (i.e. V-REP calls this function very often, with various messages):
+VREP_DLLEXPORT void *v_repMessage(int message, int *auxiliaryData, void *customData, int *replyData)
+{ // This is called quite often. Just watch out for messages/events you want to handle
+	// Keep following 5 lines at the beginning and unchanged:
+	int errorModeSaved;
+	simGetIntegerParameter(sim_intparam_error_report_mode, &errorModeSaved);
+	simSetIntegerParameter(sim_intparam_error_report_mode, sim_api_errormessage_ignore);
+	void *retVal = NULL;
+
+	// paths are loaded explicitly from lua and kept until erased or the plugin is released,
+	// so there are no simulation events to handle here.
+
+	// Keep following unchanged:
+	simSetIntegerParameter(sim_intparam_error_report_mode, errorModeSaved); // restore previous settings
+	return (retVal);
+}
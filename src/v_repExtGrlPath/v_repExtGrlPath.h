@@ -0,0 +1,30 @@
+// Copyright 2006-2014 Coppelia Robotics GmbH. All rights reserved. 
+// marc@coppeliarobotics.com
+// www.coppeliarobotics.com
+// 
+// -------------------------------------------------------------------
+// THIS FILE IS DISTRIBUTED "AS IS", WITHOUT ANY EXPRESS OR IMPLIED
+// WARRANTY. THE USER WILL USE IT AT HIS/HER OWN RISK. THE ORIGINAL
+// AUTHORS AND COPPELIA ROBOTICS GMBH WILL NOT BE LIABLE FOR DATA LOSS,
+// DAMAGES, LOSS OF PROFITS OR ANY OTHER KIND OF LOSS WHILE USING OR
+// MISUSING THIS SOFTWARE.
+// 
+// You are free to use/modify/distribute this file for whatever purpose!
+// -------------------------------------------------------------------
+//
+// This file was automatically created for V-REP release V3.2.0 on Feb. 3rd 2015
+
+#pragma once
+
+#ifdef _WIN32
+	#define VREP_DLLEXPORT extern "C" __declspec(dllexport)
+#endif /* _WIN32 */
+#if defined (__linux) || defined (__APPLE__)
+	#define VREP_DLLEXPORT extern "C"
+#endif /* __linux || __APPLE__ */
+
+
+// The 3 required entry points of the V-REP plugin:
+VREP_DLLEXPORT unsigned char v_repStart(void* reservedPointer,int reservedInt);
+VREP_DLLEXPORT void v_repEnd();
+VREP_DLLEXPORT void* v_repMessage(int message,int* auxiliaryData,void* customData,int* replyData);
@@ -1,10 +1,17 @@
 #include "camodocal/calib/HandEyeCalibration.h"
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <thread>
 #include <boost/throw_exception.hpp>
 
 #include "ceres/ceres.h"
 #include "camodocal/calib/DualQuaternion.h"
+#include "camodocal/calib/HandEyeMotionError.h"
 #include "camodocal/EigenUtils.h"
 
 namespace camodocal
@@ -50,6 +57,75 @@ public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
+/// PoseError with hand written jacobians and a residual per rotation and translation axis, see motionError()
+class PoseErrorAnalytic : public ceres::SizedCostFunction<6, 4, 3>
+{
+public:
+    PoseErrorAnalytic(const Eigen::Vector3d& r1, const Eigen::Vector3d& t1,
+                      const Eigen::Vector3d& r2, const Eigen::Vector3d& t2)
+        : m_motion(r1, t1, r2, t2)
+    {}
+
+    virtual bool Evaluate(double const* const* parameters, double* residuals, double** jacobians) const
+    {
+        Eigen::Quaterniond q(parameters[0][0], parameters[0][1], parameters[0][2], parameters[0][3]);
+        Eigen::Map<const Eigen::Vector3d> t(parameters[1]);
+
+        Eigen::Matrix<double, 6, 1> residual;
+        Eigen::Matrix<double, 6, 4> dq;
+        Eigen::Matrix<double, 6, 3> dt;
+        bool wantJacobians = (jacobians != NULL);
+        motionError(q, t, m_motion, residual,
+                    (wantJacobians && jacobians[0]) ? &dq : NULL,
+                    (wantJacobians && jacobians[1]) ? &dt : NULL);
+
+        Eigen::Map<Eigen::Matrix<double, 6, 1> > residualOut(residuals);
+        residualOut = residual;
+        if (wantJacobians && jacobians[0])
+        {
+            Eigen::Map<Eigen::Matrix<double, 6, 4, Eigen::RowMajor> > dqOut(jacobians[0]);
+            dqOut = dq;
+        }
+        if (wantJacobians && jacobians[1])
+        {
+            Eigen::Map<Eigen::Matrix<double, 6, 3, Eigen::RowMajor> > dtOut(jacobians[1]);
+            dtOut = dt;
+        }
+        return true;
+    }
+
+private:
+    MotionPair m_motion;
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/// Forwards ceres iterations to a HandEyeCalibration::ProgressCallback
+class RefineProgressCallback : public ceres::IterationCallback
+{
+public:
+    RefineProgressCallback(const HandEyeCalibration::ProgressCallback& progress,
+                           double begin, double end, int maxIterations)
+        : m_progress(progress), m_begin(begin), m_end(end), m_maxIterations(maxIterations)
+    {}
+
+    ceres::CallbackReturnType operator()(const ceres::IterationSummary& summary)
+    {
+        double fraction = std::min(1.0, double(summary.iteration) / double(m_maxIterations));
+        if (m_progress && !m_progress(m_begin + (m_end - m_begin) * fraction))
+        {
+            return ceres::SOLVER_ABORT;
+        }
+        return ceres::SOLVER_CONTINUE;
+    }
+
+private:
+    const HandEyeCalibration::ProgressCallback& m_progress;
+    double m_begin, m_end;
+    int m_maxIterations;
+};
+
 bool HandEyeCalibration::mVerbose = true;
 
 HandEyeCalibration::HandEyeCalibration()
@@ -74,7 +150,8 @@ static Eigen::MatrixXd ScrewToStransposeBlockofT(
                                                     const Eigen::Matrix<T, 3, 1>& b_prime
                                                     )
 {
-        Eigen::MatrixXd Stranspose(6,8);
+        // the upper right 3x4 block is zero and never assigned below
+        Eigen::MatrixXd Stranspose = Eigen::MatrixXd::Zero(6,8);
 
 
         typedef Eigen::Matrix<T, 3, 1> VecT;
@@ -117,14 +194,46 @@ static Eigen::MatrixXd AxisAngleToSTransposeBlockOfT(
         return ScrewToStransposeBlockofT(a,a_prime,b,b_prime);
 }
 
+HandEyeCalibration::RefineOptions::RefineOptions()
+    : method(CERES_AUTODIFF)
+    , maxIterations(500)
+    , threadCount(1)
+    , tolerance(1e-12)
+{}
+
+HandEyeCalibration::RefineOptions
+HandEyeCalibration::RefineOptions::fast()
+{
+    RefineOptions options;
+    options.method = CERES_ANALYTIC;
+    options.maxIterations = 100;
+    options.threadCount = 0;
+    return options;
+}
+
 // docs in header
-void
+bool
 HandEyeCalibration::estimateHandEyeScrew(const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs1,
                                          const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs1,
                                          const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs2,
                                          const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs2,
                                          Eigen::Matrix4d& H_12,
-                                         bool planarMotion)
+                                         bool planarMotion,
+                                         const ProgressCallback& progress)
+{
+    return estimateHandEyeScrew(rvecs1, tvecs1, rvecs2, tvecs2, H_12, planarMotion, RefineOptions(), progress);
+}
+
+// docs in header
+bool
+HandEyeCalibration::estimateHandEyeScrew(const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs1,
+                                         const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs1,
+                                         const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs2,
+                                         const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs2,
+                                         Eigen::Matrix4d& H_12,
+                                         bool planarMotion,
+                                         const RefineOptions& refineOptions,
+                                         const ProgressCallback& progress)
 {
     int motionCount = rvecs1.size();
 
@@ -144,17 +253,27 @@ HandEyeCalibration::estimateHandEyeScrew(const std::vector<Eigen::Vector3d, Eige
         T.block<6,8>(i * 6, 0) = AxisAngleToSTransposeBlockOfT(rvec1,tvec1,rvec2,tvec2);
     }
 
+    // building T and the svd are quick relative to the refinement
+    if (progress && !progress(0.05)) return false;
+
     auto dq = estimateHandEyeScrewInitial(T,planarMotion);
 
+    if (progress && !progress(0.1)) return false;
 
-    H_12 = dq.toMatrix();
     if (mVerbose)
     {
         std::cout << "# INFO: Before refinement: H_12 = " << std::endl;
-        std::cout << H_12 << std::endl;
+        std::cout << dq.toMatrix() << std::endl;
     }
 
-    estimateHandEyeScrewRefine(dq, rvecs1, tvecs1, rvecs2, tvecs2);
+    if (refineOptions.method == RefineOptions::GAUSS_NEWTON)
+    {
+        if (!estimateHandEyeScrewGaussNewton(dq, rvecs1, tvecs1, rvecs2, tvecs2, refineOptions, progress)) return false;
+    }
+    else if (!estimateHandEyeScrewRefine(dq, rvecs1, tvecs1, rvecs2, tvecs2, progress, refineOptions))
+    {
+        return false;
+    }
 
     H_12 = dq.toMatrix();
     if (mVerbose)
@@ -162,6 +281,9 @@ HandEyeCalibration::estimateHandEyeScrew(const std::vector<Eigen::Vector3d, Eige
         std::cout << "# INFO: After refinement: H_12 = " << std::endl;
         std::cout << H_12 << std::endl;
     }
+
+    if (progress) progress(1.0);
+    return true;
 }
 
 
@@ -173,7 +295,8 @@ HandEyeCalibration::estimateHandEyeScrewInitial(Eigen::MatrixXd& T,
 
 
     // dq(r1, t1) = dq * dq(r2, t2) * dq.inv
-    Eigen::JacobiSVD<Eigen::MatrixXd> svd(T, Eigen::ComputeFullU | Eigen::ComputeFullV);
+    // only V is used, a full U would be 6N x 6N and dominate the time for many motions
+    Eigen::JacobiSVD<Eigen::MatrixXd> svd(T, Eigen::ComputeFullV);
 
     // v7 and v8 span the null space of T, v6 may also be one
     // if rank = 5.
@@ -181,6 +304,18 @@ HandEyeCalibration::estimateHandEyeScrewInitial(Eigen::MatrixXd& T,
     Eigen::Matrix<double, 8, 1> v7 = svd.matrixV().block<8,1>(0,6);
     Eigen::Matrix<double, 8, 1> v8 = svd.matrixV().block<8,1>(0,7);
 
+    return estimateHandEyeScrewFromNullSpace(v6, v7, v8, planarMotion);
+}
+
+// docs in header
+DualQuaterniond
+HandEyeCalibration::estimateHandEyeScrewFromNullSpace(const Eigen::Matrix<double, 8, 1>& v6,
+                                                      const Eigen::Matrix<double, 8, 1>& v7In,
+                                                      const Eigen::Matrix<double, 8, 1>& v8,
+                                                      bool planarMotion)
+{
+    Eigen::Matrix<double, 8, 1> v7 = v7In;
+
     // if rank = 5
     if (planarMotion) //(rank == 5)
     {
@@ -297,24 +432,35 @@ HandEyeCalibration::solveQuadraticEquation(double a, double b, double c, double&
 }
 
 // docs in header
-void
+bool
 HandEyeCalibration::estimateHandEyeScrewRefine(DualQuaterniond& dq,
                                   const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs1,
                                   const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs1,
                                   const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs2,
-                                  const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs2)
+                                  const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs2,
+                                  const ProgressCallback& progress,
+                                  const RefineOptions& refineOptions)
 {
     Eigen::Matrix4d H = dq.toMatrix();
     double p[7] = {dq.real().w(), dq.real().x(), dq.real().y(), dq.real().z(),
                    H(0, 3), H(1, 3), H(2, 3)};
 
+    const bool analytic = (refineOptions.method != RefineOptions::CERES_AUTODIFF);
+
     ceres::Problem problem;
     for (size_t i = 0; i < rvecs1.size(); i++)
     {
         // ceres deletes the objects allocated here for the user
-        ceres::CostFunction* costFunction =
-            new ceres::AutoDiffCostFunction<PoseError, 1, 4, 3>(
-                new PoseError(rvecs1[i], tvecs1[i], rvecs2[i], tvecs2[i]));
+        ceres::CostFunction* costFunction = NULL;
+        if (analytic)
+        {
+            costFunction = new PoseErrorAnalytic(rvecs1[i], tvecs1[i], rvecs2[i], tvecs2[i]);
+        }
+        else
+        {
+            costFunction = new ceres::AutoDiffCostFunction<PoseError, 1, 4, 3>(
+                               new PoseError(rvecs1[i], tvecs1[i], rvecs2[i], tvecs2[i]));
+        }
 
         problem.AddResidualBlock(costFunction, NULL, p, p + 4);
     }
@@ -326,9 +472,14 @@ HandEyeCalibration::estimateHandEyeScrewRefine(DualQuaterniond& dq,
     problem.SetParameterization(p, quaternionParameterization);
 
     ceres::Solver::Options options;
-    options.linear_solver_type = ceres::DENSE_QR;
+    // with 7 parameters the 7x7 normal equations are far cheaper than a QR of the whole jacobian
+    options.linear_solver_type = analytic ? ceres::DENSE_NORMAL_CHOLESKY : ceres::DENSE_QR;
     options.jacobi_scaling = true;
-    options.max_num_iterations = 500;
+    options.max_num_iterations = refineOptions.maxIterations;
+    options.num_threads = (refineOptions.threadCount == 0) ? std::max(1u, std::thread::hardware_concurrency()) : refineOptions.threadCount;
+
+    RefineProgressCallback refineProgress(progress, 0.1, 1.0, options.max_num_iterations);
+    if (progress) options.callbacks.push_back(&refineProgress);
 
     ceres::Solver::Summary summary;
     ceres::Solve(options, &problem, &summary);
@@ -338,10 +489,456 @@ HandEyeCalibration::estimateHandEyeScrewRefine(DualQuaterniond& dq,
         std::cout << summary.BriefReport() << std::endl;
     }
 
+    if (summary.termination_type == ceres::USER_FAILURE) return false;
+
     Eigen::Quaterniond q(p[0], p[1], p[2], p[3]);
     Eigen::Vector3d t;
     t << p[4], p[5], p[6];
     dq = DualQuaterniond(q, t);
+    return true;
+}
+
+// docs in header
+bool
+HandEyeCalibration::estimateHandEyeScrewGaussNewton(DualQuaterniond& dq,
+                                       const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs1,
+                                       const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs1,
+                                       const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs2,
+                                       const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs2,
+                                       const RefineOptions& refineOptions,
+                                       const ProgressCallback& progress)
+{
+    std::vector<MotionPair, Eigen::aligned_allocator<MotionPair> > motions;
+    motions.reserve(rvecs1.size());
+    for (std::size_t i = 0; i < rvecs1.size(); ++i)
+    {
+        motions.push_back(MotionPair(rvecs1[i], tvecs1[i], rvecs2[i], tvecs2[i]));
+    }
+
+    Eigen::Quaterniond q = dq.real().normalized();
+    Eigen::Vector3d t = dq.toMatrix().block<3,1>(0,3);
+
+    // sum of squared residuals, with the 6x6 normal equations in the rotation vector and translation update
+    auto linearize = [&](const Eigen::Quaterniond& q, const Eigen::Vector3d& t,
+                         Eigen::Matrix<double, 6, 6>* JtJ, Eigen::Matrix<double, 6, 1>* Jtr)
+    {
+        // q * [1, delta/2] perturbs the rotation by the rotation vector delta
+        Eigen::Matrix<double, 4, 3> dqdDelta = 0.5 * quaternionLeftMatrix(q).rightCols<3>();
+
+        Eigen::Matrix<double, 6, 1> residual;
+        Eigen::Matrix<double, 6, 4> dq;
+        Eigen::Matrix<double, 6, 3> dt;
+        Eigen::Matrix<double, 6, 6> J;
+        double cost = 0;
+        if (JtJ) JtJ->setZero();
+        if (Jtr) Jtr->setZero();
+        for (std::size_t i = 0; i < motions.size(); ++i)
+        {
+            motionError(q, t, motions[i], residual, JtJ ? &dq : NULL, JtJ ? &dt : NULL);
+            cost += residual.squaredNorm();
+            if (!JtJ) continue;
+            J.leftCols<3>() = dq * dqdDelta;
+            J.rightCols<3>() = dt;
+            JtJ->noalias() += J.transpose() * J;
+            Jtr->noalias() += J.transpose() * residual;
+        }
+        return cost;
+    };
+
+    Eigen::Matrix<double, 6, 6> JtJ;
+    Eigen::Matrix<double, 6, 1> Jtr;
+    double cost = linearize(q, t, &JtJ, &Jtr);
+    // levenberg marquardt damping keeps the step bounded, planar motions leave a direction unobservable
+    double damping = 1e-6;
+    int iteration = 0;
+    for (; iteration < refineOptions.maxIterations; ++iteration)
+    {
+        if (progress && !progress(0.1 + 0.9 * double(iteration) / double(refineOptions.maxIterations))) return false;
+
+        Eigen::Matrix<double, 6, 6> A = JtJ;
+        A.diagonal() += damping * (JtJ.diagonal().array() + 1e-12).matrix();
+        Eigen::Matrix<double, 6, 1> step = -A.ldlt().solve(Jtr);
+        if (!step.allFinite()) break;
+
+        Eigen::Vector3d halfDelta = 0.5 * step.head<3>();
+        double angle = halfDelta.norm();
+        Eigen::Quaterniond deltaQ(std::cos(angle), 0, 0, 0);
+        deltaQ.vec() = (angle > 0) ? Eigen::Vector3d(std::sin(angle) / angle * halfDelta) : halfDelta;
+        Eigen::Quaterniond qNew = (q * deltaQ).normalized();
+        Eigen::Vector3d tNew = t + step.tail<3>();
+
+        double newCost = linearize(qNew, tNew, NULL, NULL);
+        if (newCost <= cost)
+        {
+            q = qNew;
+            t = tNew;
+            bool converged = (step.norm() < refineOptions.tolerance) || (cost - newCost <= refineOptions.tolerance * cost);
+            cost = linearize(q, t, &JtJ, &Jtr);
+            damping = std::max(damping * 0.1, 1e-12);
+            if (converged) break;
+        }
+        else
+        {
+            damping *= 10.0;
+            if (damping > 1e12) break;
+        }
+    }
+
+    if (mVerbose)
+    {
+        std::cout << "# INFO: Gauss-Newton refinement finished after " << iteration << " iterations with cost " << cost << std::endl;
+    }
+
+    dq = DualQuaterniond(q, t);
+    return true;
+}
+
+HandEyeCalibration::RobustOptions::RobustOptions()
+    : method(RANSAC)
+    , sampleSize(3)
+    , maxIterations(500)
+    , inlierThreshold(1e-4)
+    , confidence(0.99)
+    , threadCount(0)
+    , seed(0)
+{}
+
+/// A motion pair as dual quaternions, precomputed once for scoring every hypothesis
+struct ScoredMotion
+{
+    DualQuaterniond dq1Inverse;
+    DualQuaterniond dq2;
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/// Same residual as PoseError, evaluated in double without the ceres jet types
+static double poseResidual(const DualQuaterniond& dq, const DualQuaterniond& dqInverse, const ScoredMotion& motion)
+{
+    DualQuaterniond diff = (motion.dq1Inverse * dq * motion.dq2 * dqInverse).log();
+    return diff.real().squaredNorm() + diff.dual().squaredNorm();
+}
+
+/// One random subset of motions, the estimate solved from it and its score
+struct RobustHypothesis
+{
+    std::vector<int> sample;
+    Eigen::Matrix4d H;
+    bool valid;
+    std::size_t inlierCount;
+    double score; ///< lower is better
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+// docs in header
+std::size_t
+HandEyeCalibration::estimateHandEyeScrewRobust(const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs1,
+                                               const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs1,
+                                               const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& rvecs2,
+                                               const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& tvecs2,
+                                               Eigen::Matrix4d& H_12,
+                                               const RobustOptions& options,
+                                               std::vector<bool>* inliers)
+{
+    const int sampleSize = std::max(options.sampleSize, 2);
+    const std::size_t motionCount = rvecs1.size();
+
+    // motions without rotation have no screw axis and can't be part of a sample
+    std::vector<int> sampleable;
+    std::vector<Eigen::Matrix<double,6,8>, Eigen::aligned_allocator<Eigen::Matrix<double,6,8> > > blocks(motionCount);
+    std::vector<ScoredMotion, Eigen::aligned_allocator<ScoredMotion> > motions(motionCount);
+    for (std::size_t i = 0; i < motionCount; ++i)
+    {
+        motions[i].dq1Inverse = DualQuaterniond(AngleAxisToQuaternion<double>(rvecs1[i]), tvecs1[i]).inverse();
+        motions[i].dq2 = DualQuaterniond(AngleAxisToQuaternion<double>(rvecs2[i]), tvecs2[i]);
+        if (rvecs1[i].norm() == 0 || rvecs2[i].norm() == 0) continue;
+        blocks[i] = AxisAngleToSTransposeBlockOfT(rvecs1[i], tvecs1[i], rvecs2[i], tvecs2[i]);
+        sampleable.push_back(int(i));
+    }
+
+    if (int(sampleable.size()) < sampleSize)
+    {
+        std::ostringstream ss;
+        ss << "camodocal::HandEyeCalibration::estimateHandEyeScrewRobust error: " << sampleable.size()
+           << " motions with a rotation are available but a sample needs " << sampleSize;
+        BOOST_THROW_EXCEPTION(std::runtime_error(ss.str()));
+    }
+
+    unsigned int threadCount = options.threadCount;
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    std::mt19937 gen(options.seed);
+    std::vector<int> pool(sampleable);
+
+    // solve and score one hypothesis, reads only shared const data so batches run in parallel
+    auto evaluate = [&](RobustHypothesis& hypothesis, std::vector<double>& residuals)
+    {
+        hypothesis.valid = false;
+        Eigen::MatrixXd T(sampleSize * 6, 8);
+        for (int j = 0; j < sampleSize; ++j)
+        {
+            T.block<6,8>(j * 6, 0) = blocks[hypothesis.sample[j]];
+        }
+
+        DualQuaterniond dq;
+        try
+        {
+            dq = estimateHandEyeScrewInitial(T, false);
+        }
+        catch (const std::exception&)
+        {
+            // degenerate sample, such as parallel rotation axes
+            return;
+        }
+        hypothesis.H = dq.toMatrix();
+        if (!hypothesis.H.allFinite()) return;
+
+        DualQuaterniond dqInverse = dq.inverse();
+        residuals.resize(motionCount);
+        hypothesis.inlierCount = 0;
+        double sum = 0;
+        for (std::size_t i = 0; i < motionCount; ++i)
+        {
+            residuals[i] = poseResidual(dq, dqInverse, motions[i]);
+            if (!std::isfinite(residuals[i])) residuals[i] = std::numeric_limits<double>::max();
+            if (residuals[i] <= options.inlierThreshold)
+            {
+                ++hypothesis.inlierCount;
+                sum += residuals[i];
+            }
+        }
+
+        if (options.method == RobustOptions::LMEDS)
+        {
+            std::nth_element(residuals.begin(), residuals.begin() + motionCount / 2, residuals.end());
+            hypothesis.score = residuals[motionCount / 2];
+        }
+        else
+        {
+            // most inliers first, then the smallest inlier residual breaks ties
+            hypothesis.score = double(motionCount - hypothesis.inlierCount) + sum / (double(motionCount) * options.inlierThreshold + 1.0);
+        }
+        hypothesis.valid = true;
+    };
+
+    RobustHypothesis best;
+    best.valid = false;
+    best.score = std::numeric_limits<double>::max();
+
+    int maxIterations = std::max(options.maxIterations, 1);
+    int iterations = 0;
+    const int batchSize = int(threadCount) * 8;
+    std::vector<RobustHypothesis, Eigen::aligned_allocator<RobustHypothesis> > batch;
+
+    while (iterations < maxIterations)
+    {
+        // draw the samples serially so the result only depends on the seed
+        batch.resize(std::min(batchSize, maxIterations - iterations));
+        for (std::size_t b = 0; b < batch.size(); ++b)
+        {
+            for (int j = 0; j < sampleSize; ++j)
+            {
+                std::uniform_int_distribution<int> dis(j, int(pool.size()) - 1);
+                std::swap(pool[j], pool[dis(gen)]);
+            }
+            batch[b].sample.assign(pool.begin(), pool.begin() + sampleSize);
+        }
+
+        std::vector<std::thread> threads;
+        for (unsigned int t = 0; t < threadCount; ++t)
+        {
+            threads.push_back(std::thread([&, t]()
+            {
+                std::vector<double> residuals;
+                for (std::size_t b = t; b < batch.size(); b += threadCount)
+                {
+                    evaluate(batch[b], residuals);
+                }
+            }));
+        }
+        for (auto& thread : threads) thread.join();
+
+        iterations += int(batch.size());
+
+        for (std::size_t b = 0; b < batch.size(); ++b)
+        {
+            if (batch[b].valid && batch[b].score < best.score) best = batch[b];
+        }
+
+        // adapt the number of hypotheses to the inlier ratio seen so far
+        if (best.valid && options.method == RobustOptions::RANSAC && best.inlierCount > 0)
+        {
+            double inlierRatio = double(best.inlierCount) / double(motionCount);
+            double outlierFreeProbability = std::pow(inlierRatio, sampleSize);
+            if (outlierFreeProbability >= 1.0) break;
+            double needed = std::log(1.0 - options.confidence) / std::log(1.0 - outlierFreeProbability);
+            if (std::isfinite(needed)) maxIterations = std::min(maxIterations, std::max(iterations, int(std::ceil(needed))));
+        }
+    }
+
+    if (!best.valid)
+    {
+        BOOST_THROW_EXCEPTION(std::runtime_error("camodocal::HandEyeCalibration::estimateHandEyeScrewRobust error: no hypothesis could be solved, the motions are probably degenerate"));
+    }
+
+    // classify the motions against the best hypothesis
+    double threshold = options.inlierThreshold;
+    if (options.method == RobustOptions::LMEDS)
+    {
+        // robust standard deviation estimate, Rousseeuw and Leroy 1987
+        double sigma = 1.4826 * (1.0 + 5.0 / std::max(1.0, double(motionCount) - double(sampleSize))) * std::sqrt(best.score);
+        threshold = (2.5 * sigma) * (2.5 * sigma);
+    }
+
+    Eigen::Matrix4d bestH = best.H;
+    DualQuaterniond dq(Eigen::Quaterniond(Eigen::Matrix3d(bestH.block<3,3>(0,0))), Eigen::Vector3d(bestH.block<3,1>(0,3)));
+    DualQuaterniond dqInverse = dq.inverse();
+
+    std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > inlierRvecs1, inlierTvecs1, inlierRvecs2, inlierTvecs2;
+    if (inliers) inliers->assign(motionCount, false);
+    for (std::size_t i = 0; i < motionCount; ++i)
+    {
+        if (poseResidual(dq, dqInverse, motions[i]) > threshold) continue;
+        if (inliers) (*inliers)[i] = true;
+        inlierRvecs1.push_back(rvecs1[i]);
+        inlierTvecs1.push_back(tvecs1[i]);
+        inlierRvecs2.push_back(rvecs2[i]);
+        inlierTvecs2.push_back(tvecs2[i]);
+    }
+
+    if (mVerbose)
+    {
+        std::cout << "# INFO: Robust hand eye estimate kept " << inlierRvecs1.size() << " of " << motionCount
+                  << " motions after " << iterations << " hypotheses" << std::endl;
+    }
+
+    if (int(inlierRvecs1.size()) < sampleSize)
+    {
+        // the residuals are too large for the threshold, fall back to the best hypothesis
+        H_12 = bestH;
+        return inlierRvecs1.size();
+    }
+
+    // initial estimate and ceres refinement on the inliers only
+    estimateHandEyeScrew(inlierRvecs1, inlierTvecs1, inlierRvecs2, inlierTvecs2, H_12);
+    return inlierRvecs1.size();
+}
+
+HandEyeCalibrationIncremental::Quality::Quality()
+    : motionCount(0)
+    , conditionNumber(std::numeric_limits<double>::infinity())
+    , uncertainty(std::numeric_limits<double>::infinity())
+    , rotationChange(std::numeric_limits<double>::infinity())
+    , translationChange(std::numeric_limits<double>::infinity())
+{}
+
+HandEyeCalibrationIncremental::HandEyeCalibrationIncremental()
+{
+    reset();
+}
+
+void
+HandEyeCalibrationIncremental::reset()
+{
+    m_TtransposeT.setZero();
+    m_H_12.setIdentity();
+    m_hasEstimate = false;
+    m_quality = Quality();
+}
+
+// docs in header
+bool
+HandEyeCalibrationIncremental::addMotion(const Eigen::Vector3d& rvec1, const Eigen::Vector3d& tvec1,
+                                         const Eigen::Vector3d& rvec2, const Eigen::Vector3d& tvec2)
+{
+    // same as estimateHandEyeScrew, motions without rotation have no screw axis
+    if (rvec1.norm() == 0 || rvec2.norm() == 0) return false;
+
+    Eigen::Matrix<double, 6, 8> Stranspose = AxisAngleToSTransposeBlockOfT(rvec1, tvec1, rvec2, tvec2);
+    m_TtransposeT.noalias() += Stranspose.transpose() * Stranspose;
+    ++m_quality.motionCount;
+
+    // eigenvalues of T^T T are the squared singular values of T in increasing order,
+    // so column 0 of the eigenvectors is v8 of the svd, column 1 is v7 and column 2 is v6
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, 8, 8> > eigen(m_TtransposeT);
+    if (eigen.info() != Eigen::Success) return false;
+
+    Eigen::Matrix<double, 8, 1> sigmaSquared = eigen.eigenvalues().cwiseMax(0.0);
+    const double sigma1 = std::sqrt(sigmaSquared(7));
+    const double sigma6 = std::sqrt(sigmaSquared(2));
+
+    // a single motion, or motions about parallel axes, leave more than a 2d null space
+    if (sigma1 == 0.0 || sigma6 <= sigma1 * 1e-8)
+    {
+        m_quality.conditionNumber = std::numeric_limits<double>::infinity();
+        m_quality.uncertainty = std::numeric_limits<double>::infinity();
+        return false;
+    }
+
+    m_quality.conditionNumber = sigma1 / sigma6;
+    // the null space is tilted by at most the residual over the gap to the next singular value
+    m_quality.uncertainty = std::sqrt(sigmaSquared(0) + sigmaSquared(1)) / sigma6;
+
+    DualQuaterniond dq;
+    try
+    {
+        dq = HandEyeCalibration::estimateHandEyeScrewFromNullSpace(eigen.eigenvectors().col(2),
+                                                                   eigen.eigenvectors().col(1),
+                                                                   eigen.eigenvectors().col(0),
+                                                                   false);
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+
+    Eigen::Matrix4d H_12 = dq.toMatrix();
+    if (!H_12.allFinite()) return false;
+
+    if (m_hasEstimate)
+    {
+        Eigen::Quaterniond previous(Eigen::Matrix3d(m_H_12.block<3,3>(0,0)));
+        Eigen::Quaterniond current(Eigen::Matrix3d(H_12.block<3,3>(0,0)));
+        m_quality.rotationChange = previous.angularDistance(current);
+        m_quality.translationChange = (H_12.block<3,1>(0,3) - m_H_12.block<3,1>(0,3)).norm();
+    }
+
+    m_H_12 = H_12;
+    m_hasEstimate = true;
+    return true;
+}
+
+bool
+HandEyeCalibrationIncremental::hasEstimate() const
+{
+    return m_hasEstimate;
+}
+
+const Eigen::Matrix4d&
+HandEyeCalibrationIncremental::estimate() const
+{
+    return m_H_12;
+}
+
+const HandEyeCalibrationIncremental::Quality&
+HandEyeCalibrationIncremental::quality() const
+{
+    return m_quality;
+}
+
+// docs in header
+bool
+HandEyeCalibrationIncremental::hasConverged(double maxRotationChange, double maxTranslationChange, double maxUncertainty) const
+{
+    return m_hasEstimate
+        && m_quality.rotationChange <= maxRotationChange
+        && m_quality.translationChange <= maxTranslationChange
+        && m_quality.uncertainty <= maxUncertainty;
+}
+
+const Eigen::Matrix<double, 8, 8>&
+HandEyeCalibrationIncremental::normalEquations() const
+{
+    return m_TtransposeT;
 }
 
 }
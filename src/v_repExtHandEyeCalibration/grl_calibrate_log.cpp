@@ -0,0 +1,275 @@
+/// @file grl_calibrate_log.cpp
+/// @brief Headless hand eye and pivot calibration of recorded LogKUKAiiwaFusionTrack (.flik) files.
+///
+/// Recomputes the calibrations otherwise run inside V-REP with the simExtHandEyeCalib*
+/// and simExtPivotCalib* lua functions. Each file is one session and sessions are
+/// calibrated in parallel, then the transforms and residuals are printed in file order.
+/// By default a session recorded with the arm is hand eye calibrated, and a session
+/// with only the tracker, such as pivoting a tool by hand, is pivot calibrated.
+///
+/// usage:
+/// @code
+///    grl_calibrate_log --marker tool session1.flik session2.flik
+/// @endcode
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <exception>
+
+#include <boost/program_options.hpp>
+#include <boost/exception/diagnostic_information.hpp>
+
+#include "camodocal/calib/HandEyeCalibration.h"
+#include "grl/calibration/LogKUKAiiwaFusionTrackPoses.hpp"
+#include "grl/calibration/TimeAlignedPoses.hpp"
+#include "grl/calibration/PoseDiversitySelector.hpp"
+#include "grl/calibration/RansacPivotCalibration.hpp"
+
+namespace po = boost::program_options;
+using namespace grl::calibration;
+
+typedef std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > Vector3dVector;
+
+struct Options
+{
+    std::string marker;
+    double maxGap;
+    double timeOffset;
+    std::string calibration; ///< auto, handeye, pivot or all
+    std::size_t maxFrames;
+    double handEyeInlierThreshold;
+    double pivotInlierThreshold;
+};
+
+/// x y z qx qy qz qw, the same order as the flatbuffer Pose
+std::string poseToString(const Eigen::Affine3d& pose)
+{
+    Eigen::Quaterniond q(pose.rotation());
+    std::ostringstream os;
+    os << std::setprecision(9)
+       << pose.translation().x() << " " << pose.translation().y() << " " << pose.translation().z() << " "
+       << q.x() << " " << q.y() << " " << q.z() << " " << q.w();
+    return os.str();
+}
+
+std::string residualsToString(const ResidualStatistics& stats)
+{
+    std::ostringstream os;
+    os << "motions: " << stats.count
+       << " rms rotation (rad): " << stats.rmsRotation << " max: " << stats.maxRotation
+       << " rms translation (m): " << stats.rmsTranslation << " max: " << stats.maxTranslation;
+    return os.str();
+}
+
+/// the marker with the most measurements when none was requested
+std::string chooseMarker(const LogPoses& logPoses, const std::string& marker)
+{
+    if(!marker.empty()) return marker;
+    std::string best;
+    std::size_t bestCount = 0;
+    for(const auto& markerPoses : logPoses.markerPoses)
+    {
+        if(markerPoses.second.size() > bestCount)
+        {
+            best = markerPoses.first;
+            bestCount = markerPoses.second.size();
+        }
+    }
+    return best;
+}
+
+void calibrateHandEye(const Poses& flangePoses, const Poses& markerPoses, const Options& options, std::ostream& os)
+{
+    Poses arm = flangePoses;
+    Poses tracker = markerPoses;
+    if(options.maxFrames)
+    {
+        PoseDiversitySelector::Params params = PoseDiversitySelector::defaultParams();
+        std::get<PoseDiversitySelector::MaxFrames>(params) = options.maxFrames;
+        std::vector<std::size_t> selected = PoseDiversitySelector(params).select(flangePoses);
+        arm.clear();
+        tracker.clear();
+        for(std::size_t index : selected)
+        {
+            arm.push_back(flangePoses[index]);
+            tracker.push_back(markerPoses[index]);
+        }
+        os << "  selected " << selected.size() << " informative frames of " << flangePoses.size() << "\n";
+    }
+
+    Vector3dVector rvecsArm, tvecsArm, rvecsTracker, tvecsTracker;
+    posesToMotions(arm, rvecsArm, tvecsArm);
+    posesToMotions(tracker, rvecsTracker, tvecsTracker);
+
+    // sessions already run in parallel, so each solve stays on its own thread
+    camodocal::HandEyeCalibration::RefineOptions refineOptions = camodocal::HandEyeCalibration::RefineOptions::fast();
+    refineOptions.threadCount = 1;
+    Eigen::Matrix4d H_12 = Eigen::Matrix4d::Identity();
+    camodocal::HandEyeCalibration::estimateHandEyeScrew(rvecsArm, tvecsArm, rvecsTracker, tvecsTracker, H_12, false, refineOptions);
+    Eigen::Affine3d markerInFlange(H_12);
+    os << "  hand eye marker in flange: " << poseToString(markerInFlange) << "\n"
+       << "    " << residualsToString(handEyeResiduals(flangePoses, markerPoses, markerInFlange)) << "\n";
+
+    camodocal::HandEyeCalibration::RobustOptions robustOptions;
+    robustOptions.threadCount = 1;
+    if(options.handEyeInlierThreshold > 0.0) robustOptions.inlierThreshold = options.handEyeInlierThreshold;
+    std::vector<bool> inliers;
+    std::size_t inlierCount = camodocal::HandEyeCalibration::estimateHandEyeScrewRobust(rvecsArm, tvecsArm, rvecsTracker, tvecsTracker,
+                                                                                         H_12, robustOptions, &inliers);
+    Eigen::Affine3d robustMarkerInFlange(H_12);
+    os << "  robust hand eye marker in flange: " << poseToString(robustMarkerInFlange)
+       << " inliers: " << inlierCount << " of " << inliers.size() << "\n"
+       << "    " << residualsToString(handEyeResiduals(flangePoses, markerPoses, robustMarkerInFlange)) << "\n";
+}
+
+void calibratePivot(const StampedPoses& markerPoses, const Options& options, std::ostream& os)
+{
+    RansacPivotCalibration::Rotations rotations;
+    RansacPivotCalibration::Locations locations;
+    for(const StampedPose& stamped : markerPoses)
+    {
+        rotations.push_back(stamped.pose.rotation());
+        locations.push_back(stamped.pose.translation());
+    }
+
+    RansacPivotCalibration::Params params = RansacPivotCalibration::defaultParams();
+    std::get<RansacPivotCalibration::ThreadCount>(params) = 1;
+    if(options.pivotInlierThreshold > 0.0) std::get<RansacPivotCalibration::InlierThreshold>(params) = options.pivotInlierThreshold;
+    RansacPivotCalibration ransac(params);
+    std::size_t inlierCount = ransac.compute(rotations, locations);
+
+    const Eigen::Vector3d& tip = ransac.getTranslation();
+    const Eigen::Vector3d& pivotPoint = ransac.getPivotPoint();
+    os << std::setprecision(9)
+       << "  pivot tip in marker: " << tip.x() << " " << tip.y() << " " << tip.z()
+       << " pivot point in tracker: " << pivotPoint.x() << " " << pivotPoint.y() << " " << pivotPoint.z() << "\n"
+       << "    inliers: " << inlierCount << " of " << locations.size() << " rmse (m): " << ransac.getRMSE()
+       << " hypotheses: " << ransac.getIterations() << "\n";
+}
+
+/// @return the report of one session, errors are reported instead of thrown so other sessions still run
+std::string calibrateSession(const std::string& fileName, const Options& options)
+{
+    std::ostringstream os;
+    os << fileName << "\n";
+    try
+    {
+        LogPoses logPoses = loadLogKUKAiiwaFusionTrackPoses(fileName);
+        std::string marker = chooseMarker(logPoses, options.marker);
+        auto markerPoses = logPoses.markerPoses.find(marker);
+        if(markerPoses == logPoses.markerPoses.end() || markerPoses->second.empty())
+        {
+            os << "  error: no poses of marker \"" << marker << "\"\n";
+            return os.str();
+        }
+        os << "  marker \"" << marker << "\" poses: " << markerPoses->second.size()
+           << " flange poses: " << logPoses.flangePoses.size() << "\n";
+
+        // auto picks the calibration the session was recorded for
+        const bool autoHandEye = options.calibration == "auto" && !logPoses.flangePoses.empty();
+        const bool autoPivot = options.calibration == "auto" && logPoses.flangePoses.empty();
+        if(autoHandEye) os << "  calibration: handeye, the session has flange poses\n";
+        if(autoPivot) os << "  calibration: pivot, the session has no flange poses\n";
+
+        if(autoHandEye || options.calibration == "handeye" || options.calibration == "all")
+        {
+            Poses trackerPoses, flangePoses;
+            alignPoses(markerPoses->second, logPoses.flangePoses, options.maxGap, options.timeOffset, trackerPoses, flangePoses);
+            os << "  time aligned pairs: " << trackerPoses.size() << "\n";
+            if(trackerPoses.size() < 3) os << "  error: too few time aligned poses for hand eye calibration\n";
+            else calibrateHandEye(flangePoses, trackerPoses, options, os);
+        }
+
+        if(autoPivot || options.calibration == "pivot" || options.calibration == "all")
+        {
+            calibratePivot(markerPoses->second, options, os);
+        }
+    }
+    catch(const boost::exception& e)
+    {
+        os << "  error: " << boost::diagnostic_information(e) << "\n";
+    }
+    catch(const std::exception& e)
+    {
+        os << "  error: " << e.what() << "\n";
+    }
+    return os.str();
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    unsigned int threadCount = 0;
+    std::vector<std::string> logFiles;
+
+    po::options_description desc("Calibrate recorded LogKUKAiiwaFusionTrack (.flik) sessions without V-REP.\nAllowed options");
+    desc.add_options()
+        ("help", "print this help message")
+        ("log", po::value<std::vector<std::string>>(&logFiles), "LogKUKAiiwaFusionTrack files, one per session, may also be given without --log")
+        ("marker", po::value<std::string>(&options.marker)->default_value(""), "name or ID of the tracked marker, defaults to the marker seen most often")
+        ("calibration", po::value<std::string>(&options.calibration)->default_value("auto"), "options are auto, handeye, pivot, all, auto runs handeye on sessions with flange poses and pivot on the others")
+        ("max-gap", po::value<double>(&options.maxGap)->default_value(0.01), "seconds, the most a flange pose may be from a marker pose it is interpolated to")
+        ("time-offset", po::value<double>(&options.timeOffset)->default_value(0.0), "seconds added to marker times before aligning, such as a known tracker latency")
+        ("max-frames", po::value<std::size_t>(&options.maxFrames)->default_value(0), "hand eye frames kept by pose diversity selection, 0 keeps all")
+        ("handeye-threshold", po::value<double>(&options.handEyeInlierThreshold)->default_value(0.0), "robust hand eye inlier threshold, 0 keeps the default")
+        ("pivot-threshold", po::value<double>(&options.pivotInlierThreshold)->default_value(0.0), "pivot inlier threshold in meters, 0 keeps the default")
+        ("threads", po::value<unsigned int>(&threadCount)->default_value(0), "sessions calibrated in parallel, 0 uses std::thread::hardware_concurrency()")
+    ;
+    po::positional_options_description positional;
+    positional.add("log", -1);
+
+    po::variables_map vm;
+    try
+    {
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+        po::notify(vm);
+    }
+    catch(const po::error& e)
+    {
+        std::cerr << e.what() << "\n" << desc << "\n";
+        return 1;
+    }
+
+    if(vm.count("help") || logFiles.empty())
+    {
+        std::cout << desc << "\n";
+        return logFiles.empty() ? 1 : 0;
+    }
+
+    const std::string& calibration = options.calibration;
+    if(calibration != "auto" && calibration != "handeye" && calibration != "pivot" && calibration != "all")
+    {
+        std::cerr << "unknown calibration " << calibration << ", options are auto, handeye, pivot, all\n";
+        return 1;
+    }
+
+    if(threadCount == 0) threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    threadCount = std::min<std::size_t>(threadCount, logFiles.size());
+
+    // the solver prints to std::cout, which would interleave with the reports of other sessions
+    camodocal::HandEyeCalibration::setVerbose(false);
+
+    // workers take the next session until none are left
+    std::vector<std::string> reports(logFiles.size());
+    std::atomic<std::size_t> nextSession(0);
+    std::vector<std::thread> workers;
+    for(unsigned int i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back([&](){
+            for(std::size_t session = nextSession++; session < logFiles.size(); session = nextSession++)
+            {
+                reports[session] = calibrateSession(logFiles[session], options);
+            }
+        });
+    }
+    for(std::thread& worker : workers) worker.join();
+
+    for(const std::string& report : reports) std::cout << report;
+    return 0;
+}
@@ -15,6 +15,8 @@
 // This file was automatically created for V-REP release V3.2.0 on Feb. 3rd 2015
 
 
+#include <limits>
+
 #include "luaFunctionData.h"
 #include "v_repExtHandEyeCalibration.h"
 #include "grl/vrep/HandEyeCalibrationVrepPlugin.hpp"
@@ -144,6 +146,93 @@ void LUA_SIM_EXT_HAND_EYE_CALIB_RESTORE_SENSOR_POSITION(SLuaCallBack* p)
   }
 }
 
+/// Starts the estimate on a worker thread so the simulation keeps running, see simExtHandEyeCalibGetProgress
+void LUA_SIM_EXT_HAND_EYE_CALIB_FIND_TRANSFORM_ASYNC(SLuaCallBack* p)
+{
+  CLuaFunctionData D;
+  bool started = false;
+  if (handEyeCalibrationPG) {
+    started = handEyeCalibrationPG->estimateHandEyeScrewAsync();
+  }
+  D.pushOutData(CLuaFunctionDataItem(started));
+  D.writeDataToLua(p);
+}
+
+/// Returns the state and progress from 0 to 1 of simExtHandEyeCalibFindTransformAsync
+void LUA_SIM_EXT_HAND_EYE_CALIB_GET_PROGRESS(SLuaCallBack* p)
+{
+  CLuaFunctionData D;
+  int state = grl::HandEyeCalibrationVrepPlugin::EstimateIdle;
+  float progress = 0;
+  if (handEyeCalibrationPG) {
+    state = handEyeCalibrationPG->getEstimateState();
+    progress = static_cast<float>(handEyeCalibrationPG->getEstimateProgress());
+  }
+  D.pushOutData(CLuaFunctionDataItem(state));
+  D.pushOutData(CLuaFunctionDataItem(progress));
+  D.writeDataToLua(p);
+}
+
+void LUA_SIM_EXT_HAND_EYE_CALIB_CANCEL(SLuaCallBack* p)
+{
+  if (handEyeCalibrationPG) {
+    handEyeCalibrationPG->cancelEstimate();
+  }
+}
+
+/// Returns how well the frames added so far determine the estimate, updated by every simExtHandEyeCalibAddFrame
+void LUA_SIM_EXT_HAND_EYE_CALIB_GET_INCREMENTAL_QUALITY(SLuaCallBack* p)
+{
+  CLuaFunctionData D;
+  int motionCount = 0;
+  float conditionNumber = std::numeric_limits<float>::infinity();
+  float uncertainty = std::numeric_limits<float>::infinity();
+  bool converged = false;
+  if (handEyeCalibrationPG) {
+    const camodocal::HandEyeCalibrationIncremental& incremental = handEyeCalibrationPG->getIncrementalEstimate();
+    motionCount = static_cast<int>(incremental.quality().motionCount);
+    conditionNumber = static_cast<float>(incremental.quality().conditionNumber);
+    uncertainty = static_cast<float>(incremental.quality().uncertainty);
+    converged = incremental.hasConverged();
+  }
+  D.pushOutData(CLuaFunctionDataItem(motionCount));
+  D.pushOutData(CLuaFunctionDataItem(conditionNumber));
+  D.pushOutData(CLuaFunctionDataItem(uncertainty));
+  D.pushOutData(CLuaFunctionDataItem(converged));
+  D.writeDataToLua(p);
+}
+
+void LUA_SIM_EXT_HAND_EYE_CALIB_APPLY_INCREMENTAL_TRANSFORM(SLuaCallBack* p)
+{
+  CLuaFunctionData D;
+  bool applied = false;
+  if (handEyeCalibrationPG) {
+    applied = handEyeCalibrationPG->applyIncrementalEstimate();
+  }
+  D.pushOutData(CLuaFunctionDataItem(applied));
+  D.writeDataToLua(p);
+}
+
+const int inArgs_HAND_EYE_CALIB_SELECT_FRAMES[]={
+ 1,                                            //   Example Value              // Parameter name
+ sim_lua_arg_int|SIM_LUA_ARG_NIL_ALLOWED,0,    //  100                       , // MaxFrames, nil keeps every informative frame
+};
+
+/// Drops near duplicate frames before simExtHandEyeCalibFindTransform, returns the number of frames kept
+void LUA_SIM_EXT_HAND_EYE_CALIB_SELECT_FRAMES(SLuaCallBack* p)
+{
+  CLuaFunctionData D;
+  int kept = 0;
+  if (handEyeCalibrationPG && D.readDataFromLua(p,inArgs_HAND_EYE_CALIB_SELECT_FRAMES,0,"simExtHandEyeCalibSelectFrames")) {
+    std::vector<CLuaFunctionDataItem>* inData=D.getInDataPtr();
+    std::size_t maxFrames = 0;
+    if (inData->size() > 0 && inData->at(0).getType() == 1) maxFrames = static_cast<std::size_t>(std::max(0, inData->at(0).intData[0]));
+    kept = static_cast<int>(handEyeCalibrationPG->selectInformativeFrames(maxFrames));
+  }
+  D.pushOutData(CLuaFunctionDataItem(kept));
+  D.writeDataToLua(p);
+}
+
 /// @todo implement and connect up this function
 /// Returns the current transform estimate in a format that vrep understands
 void LUA_SIM_EXT_HAND_EYE_CALIB_GET_TRANSFORM(SLuaCallBack* p)
@@ -212,6 +301,12 @@ VREP_DLLEXPORT unsigned char v_repStart(void* reservedPointer,int reservedInt)
 	simRegisterCustomLuaFunction("simExtHandEyeCalibReset","number result=simExtHandEyeCalibReset()",noArgs,LUA_SIM_EXT_HAND_EYE_CALIB_RESET);
 	simRegisterCustomLuaFunction("simExtHandEyeCalibAddFrame","number result=simExtHandEyeCalibAddFrame()",noArgs,LUA_SIM_EXT_HAND_EYE_CALIB_ADD_FRAME);
 	simRegisterCustomLuaFunction("simExtHandEyeCalibFindTransform","number result=simExtHandEyeCalibFindTransform()",noArgs,LUA_SIM_EXT_HAND_EYE_CALIB_FIND_TRANSFORM);
+	simRegisterCustomLuaFunction("simExtHandEyeCalibFindTransformAsync","boolean started=simExtHandEyeCalibFindTransformAsync() -- solves on a worker thread, the estimate is applied when the state is finished",noArgs,LUA_SIM_EXT_HAND_EYE_CALIB_FIND_TRANSFORM_ASYNC);
+	simRegisterCustomLuaFunction("simExtHandEyeCalibGetProgress","number state,number progress=simExtHandEyeCalibGetProgress() -- state 0 idle, 1 running, 2 finished, 3 cancelled, 4 failed; progress from 0 to 1",noArgs,LUA_SIM_EXT_HAND_EYE_CALIB_GET_PROGRESS);
+	simRegisterCustomLuaFunction("simExtHandEyeCalibCancel","simExtHandEyeCalibCancel() -- stops simExtHandEyeCalibFindTransformAsync, the previous estimate is kept",noArgs,LUA_SIM_EXT_HAND_EYE_CALIB_CANCEL);
+	simRegisterCustomLuaFunction("simExtHandEyeCalibGetIncrementalQuality","number motionCount,number conditionNumber,number uncertainty,boolean converged=simExtHandEyeCalibGetIncrementalQuality() -- updated by every simExtHandEyeCalibAddFrame, frames can stop being added once converged",noArgs,LUA_SIM_EXT_HAND_EYE_CALIB_GET_INCREMENTAL_QUALITY);
+	simRegisterCustomLuaFunction("simExtHandEyeCalibApplyIncrementalTransform","boolean applied=simExtHandEyeCalibApplyIncrementalTransform() -- applies the estimate from simExtHandEyeCalibGetIncrementalQuality without the slower refinement",noArgs,LUA_SIM_EXT_HAND_EYE_CALIB_APPLY_INCREMENTAL_TRANSFORM);
+	simRegisterCustomLuaFunction("simExtHandEyeCalibSelectFrames","number keptFrames=simExtHandEyeCalibSelectFrames(number maxFrames=nil) -- drops near duplicate frames that would slow the solve without improving it",inArgs_HAND_EYE_CALIB_SELECT_FRAMES,LUA_SIM_EXT_HAND_EYE_CALIB_SELECT_FRAMES);
 	simRegisterCustomLuaFunction("simExtHandEyeCalibApplyTransform","number result=simExtHandEyeCalibApplyTransform()",noArgs,LUA_SIM_EXT_HAND_EYE_CALIB_APPLY_TRANSFORM);
 	simRegisterCustomLuaFunction("simExtHandEyeCalibRestoreSensorPosition","number result=simExtHandEyeCalibRestoreSensorPosition()",noArgs,LUA_SIM_EXT_HAND_EYE_CALIB_RESTORE_SENSOR_POSITION);
 
@@ -301,8 +396,14 @@ VREP_DLLEXPORT void* v_repMessage(int message,int* auxiliaryData,void* customDat
 		if (handEyeCalibrationPG)// && HandEyeCalibrationPG->allHandlesSet == true // allHandlesSet now handled internally
 		{
 
-          // run one loop synchronizing the arm and plugin
-          // handEyeCalibrationPG->run_one();
+          // apply an estimate found on the worker thread, the V-REP API must be called from this thread
+          try {
+              handEyeCalibrationPG->run_one();
+          } catch (const boost::exception& e){
+              std::string err("v_repExtHandEyeCalibration plugin could not apply the estimate:\n" + boost::diagnostic_information(e));
+              simAddStatusbarMessage( err.c_str());
+              loggerPG->error(err);
+          }
 
 		}
 	}
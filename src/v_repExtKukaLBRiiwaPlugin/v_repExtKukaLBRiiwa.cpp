@@ -40,6 +40,9 @@ LIBRARY vrepLib; // the V-REP library that we will dynamically load and bind
 #define strConCat(x,y,z)	CONCAT(x,y,z)
 #define LUA_GET_SENSOR_DATA_COMMAND "simExtSkeleton_getSensorData"
 #define LUA_KUKA_LBR_IIWA_START_COMMAND "simExtKukaLBRiiwaStart"
+#define LUA_KUKA_LBR_IIWA_START_PATH_FOLLOWING_COMMAND "simExtKukaLBRiiwaStartPathFollowing"
+#define LUA_KUKA_LBR_IIWA_STOP_PATH_FOLLOWING_COMMAND "simExtKukaLBRiiwaStopPathFollowing"
+#define LUA_KUKA_LBR_IIWA_GET_PATH_FOLLOWING_STATE_COMMAND "simExtKukaLBRiiwaGetPathFollowingState"
 
 
 
@@ -159,6 +162,92 @@ void LUA_SIM_EXT_KUKA_LBR_IIWA_START(SLuaCallBack* p)
 }
 
 
+const int inArgs_KUKA_LBR_IIWA_START_PATH_FOLLOWING[]={
+ 4,                    //   Example Value              // Parameter name
+ sim_lua_arg_string,0, //  "MillHipCutPath"          , // PathName, vrep path object to move the RobotTarget along
+ sim_lua_arg_float,0,  //  0.04                      , // MaxVelocity in m/s when no force is measured
+ sim_lua_arg_float,0,  //  30                        , // MaxForce in N at the tool tip where motion stops
+ sim_lua_arg_string|SIM_LUA_ARG_NIL_ALLOWED,0, // "LOG" , // ForceToVelocityModel (options are LOG, SQRT)
+};
+
+std::string LUA_KUKA_LBR_IIWA_START_PATH_FOLLOWING_CALL_TIP("boolean result=simExtKukaLBRiiwaStartPathFollowing(string PathName, number MaxVelocity, number MaxForce, string ForceToVelocityModel=nil) -- moves the robot target along the path, slowing down as the tool tip force estimated from the external joint torques rises, ForceToVelocityModel options are LOG and SQRT");
+
+void LUA_SIM_EXT_KUKA_LBR_IIWA_START_PATH_FOLLOWING(SLuaCallBack* p)
+{
+    CLuaFunctionData D;
+    bool success = false;
+    if (D.readDataFromLua(p,inArgs_KUKA_LBR_IIWA_START_PATH_FOLLOWING,3,LUA_KUKA_LBR_IIWA_START_PATH_FOLLOWING_COMMAND))
+    {
+        if (kukaPluginPG)
+        {
+            std::vector<CLuaFunctionDataItem>* inData=D.getInDataPtr();
+            auto fcvParams = grl::path::ForceControlledVelocity::defaultParams();
+            std::string PathName                                                              (inData->at(0).stringData[0]);
+            std::get<grl::path::ForceControlledVelocity::MaxVelocity>(fcvParams)           = inData->at(1).floatData[0];
+            std::get<grl::path::ForceControlledVelocity::MaxForce>(fcvParams)              = inData->at(2).floatData[0];
+            if (inData->size() > 3 && inData->at(3).getType() == 3)
+            {
+                std::get<grl::path::ForceControlledVelocity::ForceToVelocityModel>(fcvParams) = inData->at(3).stringData[0];
+            }
+
+            try {
+                kukaPluginPG->startForceControlledPathFollowing(PathName, fcvParams);
+                success = true;
+            } catch (const boost::exception& e){
+                // the arm connection is fine, so only report the error and keep the plugin running
+                std::string err("v_repExtKukaLBRiiwa plugin could not start path following:\n" + boost::diagnostic_information(e));
+                simAddStatusbarMessage( err.c_str());
+                loggerPG->error( err );
+            }
+        }
+        else
+        {
+            simSetLastError(LUA_KUKA_LBR_IIWA_START_PATH_FOLLOWING_COMMAND, "Call simExtKukaLBRiiwaStart before starting path following.");
+        }
+    }
+    D.pushOutData(CLuaFunctionDataItem(success));
+    D.writeDataToLua(p);
+}
+
+const int inArgs_KUKA_LBR_IIWA_STOP_PATH_FOLLOWING[]={
+ 0
+};
+
+std::string LUA_KUKA_LBR_IIWA_STOP_PATH_FOLLOWING_CALL_TIP("simExtKukaLBRiiwaStopPathFollowing() -- the robot target stays where it is on the path");
+
+void LUA_SIM_EXT_KUKA_LBR_IIWA_STOP_PATH_FOLLOWING(SLuaCallBack* p)
+{
+    CLuaFunctionData D;
+    if (kukaPluginPG) kukaPluginPG->stopForceControlledPathFollowing();
+    D.writeDataToLua(p);
+}
+
+const int inArgs_KUKA_LBR_IIWA_GET_PATH_FOLLOWING_STATE[]={
+ 0
+};
+
+std::string LUA_KUKA_LBR_IIWA_GET_PATH_FOLLOWING_STATE_CALL_TIP("boolean running, number distance, number pathLength, number measuredForce=simExtKukaLBRiiwaGetPathFollowingState() -- running is false once the end of the path is reached or following was stopped");
+
+void LUA_SIM_EXT_KUKA_LBR_IIWA_GET_PATH_FOLLOWING_STATE(SLuaCallBack* p)
+{
+    CLuaFunctionData D;
+    bool running = false;
+    double distance = 0, pathLength = 0, measuredForce = 0;
+    if (kukaPluginPG)
+    {
+        running       = kukaPluginPG->isForceControlledPathFollowing();
+        distance      = kukaPluginPG->getPathDistance();
+        pathLength    = kukaPluginPG->getPathLength();
+        measuredForce = kukaPluginPG->getMeasuredToolTipForce();
+    }
+    D.pushOutData(CLuaFunctionDataItem(running));
+    D.pushOutData(CLuaFunctionDataItem(static_cast<float>(distance)));
+    D.pushOutData(CLuaFunctionDataItem(static_cast<float>(pathLength)));
+    D.pushOutData(CLuaFunctionDataItem(static_cast<float>(measuredForce)));
+    D.writeDataToLua(p);
+}
+
+
 // This is the plugin start routine (called just once, just after the plugin was loaded):
 VREP_DLLEXPORT unsigned char v_repStart(void* reservedPointer,int reservedInt)
 {
@@ -225,6 +314,33 @@ VREP_DLLEXPORT unsigned char v_repStart(void* reservedPointer,int reservedInt)
         LUA_SIM_EXT_KUKA_LBR_IIWA_START
     );
 
+    CLuaFunctionData::getInputDataForFunctionRegistration(inArgs_KUKA_LBR_IIWA_START_PATH_FOLLOWING,inArgs);
+	simRegisterCustomLuaFunction
+    (
+        LUA_KUKA_LBR_IIWA_START_PATH_FOLLOWING_COMMAND,
+        LUA_KUKA_LBR_IIWA_START_PATH_FOLLOWING_CALL_TIP.c_str(),
+        &inArgs[0],
+        LUA_SIM_EXT_KUKA_LBR_IIWA_START_PATH_FOLLOWING
+    );
+
+    CLuaFunctionData::getInputDataForFunctionRegistration(inArgs_KUKA_LBR_IIWA_STOP_PATH_FOLLOWING,inArgs);
+	simRegisterCustomLuaFunction
+    (
+        LUA_KUKA_LBR_IIWA_STOP_PATH_FOLLOWING_COMMAND,
+        LUA_KUKA_LBR_IIWA_STOP_PATH_FOLLOWING_CALL_TIP.c_str(),
+        &inArgs[0],
+        LUA_SIM_EXT_KUKA_LBR_IIWA_STOP_PATH_FOLLOWING
+    );
+
+    CLuaFunctionData::getInputDataForFunctionRegistration(inArgs_KUKA_LBR_IIWA_GET_PATH_FOLLOWING_STATE,inArgs);
+	simRegisterCustomLuaFunction
+    (
+        LUA_KUKA_LBR_IIWA_GET_PATH_FOLLOWING_STATE_COMMAND,
+        LUA_KUKA_LBR_IIWA_GET_PATH_FOLLOWING_STATE_CALL_TIP.c_str(),
+        &inArgs[0],
+        LUA_SIM_EXT_KUKA_LBR_IIWA_GET_PATH_FOLLOWING_STATE
+    );
+
 
 
 	// Expected input arguments are: int sensorIndex, float floatParameters[3], int intParameters[2]
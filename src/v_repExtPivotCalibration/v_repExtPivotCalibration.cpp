@@ -98,21 +98,40 @@ std::string LUA_SIM_EXT_PIVOT_CALIB_ALGORITHM_CALL_TIP("number result=simExtPivo
 
 void LUA_SIM_EXT_PIVOT_CALIB_ALGORITHM(SLuaCallBack* p)
 {
-  if (!pivotCalibrationPG) {
+  if (pivotCalibrationPG) {
 
     loggerPG->info( "v_repExtPivotCalibration Setting Algorithm\n");
 
     	CLuaFunctionData data;
 
-    	if (pivotCalibrationPG.get()!=nullptr && data.readDataFromLua(p,inArgs_PIVOT_CALIB_ALGORITHM,inArgs_PIVOT_CALIB_ALGORITHM[0],"simExtPivotCalibAlgorithm"))
+    	if (data.readDataFromLua(p,inArgs_PIVOT_CALIB_ALGORITHM,inArgs_PIVOT_CALIB_ALGORITHM[0],"simExtPivotCalibAlgorithm"))
         {
     		std::vector<CLuaFunctionDataItem>* inData=data.getInDataPtr();
             std::string AlgorithmName((inData->at(0 ).stringData[0]));
             pivotCalibrationPG->setAlgorithm(AlgorithmName);
 
         }
-        else
+  }
+}
+
+const int inArgs_PIVOT_CALIB_RANSAC[]={
+ 1,                   //   Example Value              // Parameter name
+ sim_lua_arg_float,0, //  0.001                     , // InlierThreshold,
+};
+
+std::string LUA_SIM_EXT_PIVOT_CALIB_RANSAC_CALL_TIP("simExtPivotCalibRansac(number InlierThreshold) -- meters from the pivot point for a frame to be used, 0 disables outlier rejection");
+
+
+void LUA_SIM_EXT_PIVOT_CALIB_RANSAC(SLuaCallBack* p)
+{
+  if (pivotCalibrationPG) {
+
+    	CLuaFunctionData data;
+
+    	if (data.readDataFromLua(p,inArgs_PIVOT_CALIB_RANSAC,inArgs_PIVOT_CALIB_RANSAC[0],"simExtPivotCalibRansac"))
         {
+    		std::vector<CLuaFunctionDataItem>* inData=data.getInDataPtr();
+            pivotCalibrationPG->setRansac(inData->at(0).floatData[0]);
         }
   }
 }
@@ -141,7 +160,13 @@ void LUA_SIM_EXT_PIVOT_CALIB_ADD_FRAME(SLuaCallBack* p)
 void LUA_SIM_EXT_PIVOT_CALIB_FIND_TRANSFORM(SLuaCallBack* p)
 {
   if (pivotCalibrationPG) {
-    pivotCalibrationPG->estimatePivotOffset();
+    try {
+      pivotCalibrationPG->estimatePivotOffset();
+    } catch (const boost::exception& e) {
+      loggerPG->error("v_repExtPivotCalibration estimate failed:\n", boost::diagnostic_information(e));
+    } catch (const std::exception& e) {
+      loggerPG->error("v_repExtPivotCalibration estimate failed:\n", e.what());
+    }
   }
 }
 
@@ -161,6 +186,26 @@ void LUA_SIM_EXT_PIVOT_CALIB_RESTORE_SENSOR_POSITION(SLuaCallBack* p)
   }
 }
 
+const int inArgs_PIVOT_CALIB_SELECT_FRAMES[]={
+ 1,                                            //   Example Value              // Parameter name
+ sim_lua_arg_int|SIM_LUA_ARG_NIL_ALLOWED,0,    //  100                       , // MaxFrames, nil keeps every informative frame
+};
+
+/// Drops near duplicate frames before simExtPivotCalibFindTransform, returns the number of frames kept
+void LUA_SIM_EXT_PIVOT_CALIB_SELECT_FRAMES(SLuaCallBack* p)
+{
+  CLuaFunctionData D;
+  int kept = 0;
+  if (pivotCalibrationPG && D.readDataFromLua(p,inArgs_PIVOT_CALIB_SELECT_FRAMES,0,"simExtPivotCalibSelectFrames")) {
+    std::vector<CLuaFunctionDataItem>* inData=D.getInDataPtr();
+    std::size_t maxFrames = 0;
+    if (inData->size() > 0 && inData->at(0).getType() == 1) maxFrames = static_cast<std::size_t>(std::max(0, inData->at(0).intData[0]));
+    kept = static_cast<int>(pivotCalibrationPG->selectInformativeFrames(maxFrames));
+  }
+  D.pushOutData(CLuaFunctionDataItem(kept));
+  D.writeDataToLua(p);
+}
+
 /// @todo implement and connect up this function
 /// Returns the current transform estimate in a format that vrep understands
 void LUA_SIM_EXT_PIVOT_CALIB_GET_TRANSFORM(SLuaCallBack* p)
@@ -226,6 +271,8 @@ VREP_DLLEXPORT unsigned char v_repStart(void* reservedPointer,int reservedInt)
 	int noArgs[]={0}; // no input arguments
 	simRegisterCustomLuaFunction("simExtPivotCalibStart",LUA_SIM_EXT_PIVOT_CALIB_START_CALL_TIP.c_str(),inArgs_PIVOT_CALIB_START,LUA_SIM_EXT_PIVOT_CALIB_START);
 	simRegisterCustomLuaFunction("simExtPivotCalibAlgorithm",LUA_SIM_EXT_PIVOT_CALIB_ALGORITHM_CALL_TIP.c_str(),inArgs_PIVOT_CALIB_ALGORITHM,LUA_SIM_EXT_PIVOT_CALIB_ALGORITHM);
+	simRegisterCustomLuaFunction("simExtPivotCalibRansac",LUA_SIM_EXT_PIVOT_CALIB_RANSAC_CALL_TIP.c_str(),inArgs_PIVOT_CALIB_RANSAC,LUA_SIM_EXT_PIVOT_CALIB_RANSAC);
+	simRegisterCustomLuaFunction("simExtPivotCalibSelectFrames","number keptFrames=simExtPivotCalibSelectFrames(number maxFrames=nil) -- drops near duplicate frames that would slow the solve without improving it",inArgs_PIVOT_CALIB_SELECT_FRAMES,LUA_SIM_EXT_PIVOT_CALIB_SELECT_FRAMES);
 	simRegisterCustomLuaFunction("simExtPivotCalibStop","number result=simExtPivotCalibStop()",noArgs,LUA_SIM_EXT_PIVOT_CALIB_STOP);
 	simRegisterCustomLuaFunction("simExtPivotCalibReset","number result=simExtPivotCalibReset()",noArgs,LUA_SIM_EXT_PIVOT_CALIB_RESET);
 	simRegisterCustomLuaFunction("simExtPivotCalibAddFrame","number result=simExtPivotCalibAddFrame()",noArgs,LUA_SIM_EXT_PIVOT_CALIB_ADD_FRAME);
@@ -0,0 +1,56 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE ArcLengthPath_test
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+#include "grl/path/ArcLengthPath.hpp"
+
+BOOST_AUTO_TEST_SUITE(ArcLengthPath_test)
+
+BOOST_AUTO_TEST_CASE(PoseAtDistance)
+{
+    grl::path::ControlPoints points(3);
+    points[1].position = Eigen::Vector3d(1, 0, 0);
+    points[2].position = Eigen::Vector3d(1, 2, 0);
+    points[2].orientation = grl::path::vrepEulerToQuaternion(0, 0, M_PI/2);
+    grl::path::ArcLengthPath path(points);
+
+    BOOST_CHECK_CLOSE(path.length(), 3.0, 1e-9);
+
+    Eigen::Vector3d position;
+    Eigen::Quaterniond orientation;
+    path.poseAtDistance(2.0, position, orientation);
+    BOOST_CHECK(position.isApprox(Eigen::Vector3d(1, 1, 0)));
+    BOOST_CHECK(orientation.isApprox(grl::path::vrepEulerToQuaternion(0, 0, M_PI/4)));
+
+    // distances past the end are clamped
+    path.poseAtDistance(10.0, position, orientation);
+    BOOST_CHECK(position.isApprox(Eigen::Vector3d(1, 2, 0)));
+}
+
+BOOST_AUTO_TEST_CASE(SortedAndUnsortedSamplesMatch)
+{
+    grl::path::ControlPoints points(4);
+    points[1].position = Eigen::Vector3d(1, 0, 0);
+    points[2].position = Eigen::Vector3d(1, 1, 0);
+    points[3].position = Eigen::Vector3d(1, 1, 1);
+    grl::path::ArcLengthPath path(points);
+
+    std::vector<double> sorted;
+    path.sampleUniform(0.0, path.length(), 7, std::back_inserter(sorted));
+    BOOST_CHECK_EQUAL(sorted.size(), 7 * grl::path::ArcLengthPath::PoseStride);
+
+    std::vector<double> distances = {3.0, 0.5, 2.5, 1.0, 0.0, 2.0, 1.5};
+    std::vector<double> unsorted;
+    path.sample(distances.begin(), distances.end(), std::back_inserter(unsorted));
+    for(std::size_t i = 0; i < distances.size(); ++i)
+    {
+        std::size_t j = static_cast<std::size_t>(distances[i] / 0.5);
+        for(std::size_t k = 0; k < grl::path::ArcLengthPath::PoseStride; ++k)
+        {
+            BOOST_CHECK_SMALL(unsorted[i*7+k] - sorted[j*7+k], 1e-9);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,42 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE ForceControlledVelocity_test
+#include <boost/test/unit_test.hpp>
+
+#include "grl/path/ForceControlledVelocity.hpp"
+#include "grl/sim/KinematicScene.hpp"
+
+BOOST_AUTO_TEST_SUITE(ForceControlledVelocity_test)
+
+BOOST_AUTO_TEST_CASE(VelocityFallsWithForce)
+{
+    grl::path::ForceControlledVelocity fcv(std::make_tuple(0.04, 30.0, std::string("LOG")));
+    BOOST_CHECK_CLOSE(fcv.velocity(0.0), 0.04, 1e-9);
+    BOOST_CHECK_SMALL(fcv.velocity(30.0), 1e-12);
+    BOOST_CHECK_SMALL(fcv.velocity(100.0), 1e-12);
+    BOOST_CHECK(fcv.velocity(10.0) > fcv.velocity(20.0));
+
+    // the distance is clamped to the end of the path
+    BOOST_CHECK_CLOSE(fcv.step(0.0, 0.0, 0.05, 1.0), 0.002, 1e-9);
+    BOOST_CHECK_CLOSE(fcv.step(0.999, 0.0, 0.05, 1.0), 1.0, 1e-9);
+
+    BOOST_CHECK_THROW(grl::path::ForceControlledVelocity(std::make_tuple(0.04, 30.0, std::string("CUBIC"))), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(ToolTipForceFromExternalTorque)
+{
+    grl::sim::KinematicScene scene;
+    grl::sim::addKukaLBRiiwa14R820(scene);
+    std::vector<int> joints;
+    for(int i = 1; i <= 7; ++i) joints.push_back(scene.getHandle("LBR_iiwa_14_R820_joint" + std::to_string(i)));
+    for(std::size_t i = 0; i < joints.size(); ++i) scene.setJointPosition(joints[i], 0.2 * (i+1) - 0.5);
+
+    Eigen::MatrixXd jacobian = scene.getJacobian(joints, scene.getHandle("RobotMillTip"));
+    Eigen::Matrix<double,6,1> wrench;
+    wrench << 3.0, -4.0, 12.0, 0.0, 0.0, 0.0;
+    Eigen::VectorXd externalTorque = jacobian.transpose() * wrench;
+
+    Eigen::Matrix<double,6,1> estimate = grl::path::externalTorqueToToolTipWrench(jacobian, externalTorque);
+    BOOST_CHECK_CLOSE(estimate.head<3>().norm(), 13.0, 1e-6);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
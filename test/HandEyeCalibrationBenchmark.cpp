@@ -0,0 +1,55 @@
+/// @file HandEyeCalibrationBenchmark.cpp
+/// @brief Times each camodocal::HandEyeCalibration refinement method on 100 to 10,000 noisy motions.
+///
+/// usage: HandEyeCalibrationBenchmark [repetitions]
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "camodocal/calib/HandEyeCalibration.h"
+#include "HandEyeCalibrationTestMotions.hpp"
+
+int main(int argc, char** argv)
+{
+    int repetitions = (argc > 1) ? std::atoi(argv[1]) : 3;
+    camodocal::HandEyeCalibration::setVerbose(false);
+
+    Eigen::Matrix4d H_12_expected = expectedHandEye();
+
+    struct Method { const char* name; camodocal::HandEyeCalibration::RefineOptions options; };
+    std::vector<Method> methods(3);
+    methods[0].name = "ceres autodiff"; // the default RefineOptions
+    methods[1].name = "ceres analytic";
+    methods[1].options = camodocal::HandEyeCalibration::RefineOptions::fast();
+    methods[2].name = "gauss newton";
+    methods[2].options.method = camodocal::HandEyeCalibration::RefineOptions::GAUSS_NEWTON;
+
+    std::cout << std::setw(8) << "motions" << std::setw(18) << "method" << std::setw(14) << "ms"
+              << std::setw(16) << "rotation err" << std::setw(18) << "translation err" << std::endl;
+
+    HandEyeVectors rvecs1, tvecs1, rvecs2, tvecs2;
+    const int motionCounts[] = {100, 300, 1000, 3000, 10000};
+    for (int motionCount : motionCounts)
+    {
+        makeHandEyeMotions(motionCount, motionCount, 1e-4, H_12_expected, rvecs1, tvecs1, rvecs2, tvecs2);
+        for (const Method& method : methods)
+        {
+            Eigen::Matrix4d H_12 = Eigen::Matrix4d::Identity();
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < repetitions; ++r)
+            {
+                camodocal::HandEyeCalibration::estimateHandEyeScrew(rvecs1, tvecs1, rvecs2, tvecs2, H_12, false, method.options);
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repetitions;
+
+            Eigen::AngleAxisd rotationError(Eigen::Matrix3d(H_12.block<3,3>(0,0).transpose() * H_12_expected.block<3,3>(0,0)));
+            double translationError = (H_12.block<3,1>(0,3) - H_12_expected.block<3,1>(0,3)).norm();
+            std::cout << std::setw(8) << motionCount << std::setw(18) << method.name << std::setw(14) << ms
+                      << std::setw(16) << rotationError.angle() << std::setw(18) << translationError << std::endl;
+        }
+    }
+    return 0;
+}
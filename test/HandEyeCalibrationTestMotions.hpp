@@ -0,0 +1,60 @@
+/// @file HandEyeCalibrationTestMotions.hpp
+/// @brief Synthetic arm and marker motions with a known hand eye transform for the hand eye tests and benchmark.
+#ifndef _GRL_HAND_EYE_CALIBRATION_TEST_MOTIONS_HPP_
+#define _GRL_HAND_EYE_CALIBRATION_TEST_MOTIONS_HPP_
+
+#include <random>
+#include <vector>
+
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+
+typedef std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > HandEyeVectors;
+
+/// the transform between the arm and the marker the tests recover
+inline Eigen::Matrix4d expectedHandEye()
+{
+    Eigen::Matrix4d H_12 = Eigen::Matrix4d::Identity();
+    H_12.block<3,3>(0,0) = Eigen::AngleAxisd(0.4, Eigen::Vector3d(0.1, 0.2, 0.3).normalized()).toRotationMatrix();
+    H_12.block<3,1>(0,3) << 0.5, 0.6, 0.7;
+    return H_12;
+}
+
+/// @brief motions about random axes in the axis angle format of camodocal::HandEyeCalibration
+///
+/// Marker motion i is H_i, up to 1 rad about each axis and 0.5 m along it, and arm
+/// motion i is H_12 * H_i * H_12^-1. The motions only depend on the seed, the noise
+/// is drawn separately, so the same seed with and without noise gives the same motions.
+///
+/// @param noise standard deviation in meters added to each marker translation, 0 for exact motions
+inline void makeHandEyeMotions(int motionCount, unsigned int seed, double noise, const Eigen::Matrix4d& H_12,
+                               HandEyeVectors& rvecs1, HandEyeVectors& tvecs1, HandEyeVectors& rvecs2, HandEyeVectors& tvecs2)
+{
+    std::mt19937 gen(seed);
+    std::mt19937 noiseGen(seed + 1);
+    std::uniform_real_distribution<> angle(-1.0, 1.0);
+    std::uniform_real_distribution<> offset(-0.5, 0.5);
+    std::normal_distribution<> gaussian(0.0, noise > 0.0 ? noise : 1.0);
+
+    rvecs1.clear(); tvecs1.clear(); rvecs2.clear(); tvecs2.clear();
+    for (int i = 0; i < motionCount; ++i)
+    {
+        Eigen::Matrix4d H = Eigen::Matrix4d::Identity();
+        H.block<3,3>(0,0) = (Eigen::AngleAxisd(angle(gen), Eigen::Vector3d::UnitZ()) *
+                             Eigen::AngleAxisd(angle(gen), Eigen::Vector3d::UnitY()) *
+                             Eigen::AngleAxisd(angle(gen), Eigen::Vector3d::UnitX())).toRotationMatrix();
+        H.block<3,1>(0,3) << offset(gen), offset(gen), offset(gen);
+
+        Eigen::Matrix4d H1 = H_12 * H * H_12.inverse();
+        Eigen::AngleAxisd angleAxis1(H1.block<3,3>(0,0));
+        Eigen::AngleAxisd angleAxis2(H.block<3,3>(0,0));
+
+        rvecs1.push_back(angleAxis1.angle() * angleAxis1.axis());
+        tvecs1.push_back(H1.block<3,1>(0,3));
+        rvecs2.push_back(angleAxis2.angle() * angleAxis2.axis());
+        tvecs2.push_back(H.block<3,1>(0,3));
+        if (noise > 0.0) tvecs2.back() += Eigen::Vector3d(gaussian(noiseGen), gaussian(noiseGen), gaussian(noiseGen));
+    }
+}
+
+#endif // _GRL_HAND_EYE_CALIBRATION_TEST_MOTIONS_HPP_
@@ -2,11 +2,14 @@
 #define BOOST_TEST_MODULE HandEyeCalibration_test
 #include <boost/math/constants/constants.hpp>
 #include <boost/test/unit_test.hpp>
+#include <cmath>
 #include <iostream>
 #include <random>
 
 #include "camodocal/calib/HandEyeCalibration.h"
+#include "camodocal/calib/HandEyeMotionError.h"
 #include "camodocal/EigenUtils.h"
+#include "HandEyeCalibrationTestMotions.hpp"
 
 BOOST_AUTO_TEST_SUITE(HandEyeCalibration_test)
 
@@ -234,6 +237,140 @@ BOOST_AUTO_TEST_CASE(PlanarMotionWithNoise)
 //    }
 }
 
+BOOST_AUTO_TEST_CASE(RobustToOutlierMotions)
+{
+    camodocal::HandEyeCalibration::setVerbose(false);
+
+    Eigen::Matrix4d H_12_expected = expectedHandEye();
+    HandEyeVectors rvecs1, tvecs1, rvecs2, tvecs2;
+    int motionCount = 40;
+    int outlierCount = 8;
+    makeHandEyeMotions(motionCount, 1, 0.0, H_12_expected, rvecs1, tvecs1, rvecs2, tvecs2);
+
+    // corrupt some measurements like a partially occluded marker would
+    for (int i = 0; i < motionCount; i += motionCount / outlierCount) tvecs2[i] += Eigen::Vector3d(0.05, -0.08, 0.1);
+
+    camodocal::HandEyeCalibration::RobustOptions options;
+    options.seed = 7;
+    std::vector<bool> inliers;
+
+    Eigen::Matrix4d H_12;
+    std::size_t inlierCount = camodocal::HandEyeCalibration::estimateHandEyeScrewRobust(rvecs1, tvecs1, rvecs2, tvecs2, H_12, options, &inliers);
+    BOOST_CHECK_EQUAL(inlierCount, std::size_t(motionCount - outlierCount));
+    BOOST_CHECK(!inliers[0]);
+    BOOST_CHECK(inliers[1]);
+    BOOST_CHECK(H_12.isApprox(H_12_expected, 1e-6));
+
+    options.method = camodocal::HandEyeCalibration::RobustOptions::LMEDS;
+    inlierCount = camodocal::HandEyeCalibration::estimateHandEyeScrewRobust(rvecs1, tvecs1, rvecs2, tvecs2, H_12, options);
+    BOOST_CHECK_EQUAL(inlierCount, std::size_t(motionCount - outlierCount));
+    BOOST_CHECK(H_12.isApprox(H_12_expected, 1e-6));
+}
+
+BOOST_AUTO_TEST_CASE(GaussNewtonRefinement)
+{
+    camodocal::HandEyeCalibration::setVerbose(false);
+
+    Eigen::Matrix4d H_12_expected = expectedHandEye();
+    HandEyeVectors rvecs1, tvecs1, rvecs2, tvecs2, noisyRvecs1, noisyTvecs1, noisyRvecs2, noisyTvecs2;
+    makeHandEyeMotions(1000, 5, 0.0, H_12_expected, rvecs1, tvecs1, rvecs2, tvecs2);
+    makeHandEyeMotions(1000, 5, 1e-4, H_12_expected, noisyRvecs1, noisyTvecs1, noisyRvecs2, noisyTvecs2);
+
+    camodocal::HandEyeCalibration::RefineOptions options;
+    options.method = camodocal::HandEyeCalibration::RefineOptions::GAUSS_NEWTON;
+
+    Eigen::Matrix4d H_12;
+    BOOST_CHECK(camodocal::HandEyeCalibration::estimateHandEyeScrew(rvecs1, tvecs1, rvecs2, tvecs2, H_12, false, options));
+    BOOST_CHECK(H_12.isApprox(H_12_expected, 1e-9));
+
+    BOOST_CHECK(camodocal::HandEyeCalibration::estimateHandEyeScrew(noisyRvecs1, noisyTvecs1, noisyRvecs2, noisyTvecs2, H_12, false, options));
+    BOOST_CHECK(H_12.isApprox(H_12_expected, 1e-4));
+
+    // a cancelled refinement leaves H_12 unchanged
+    Eigen::Matrix4d unchanged = Eigen::Matrix4d::Identity();
+    BOOST_CHECK(!camodocal::HandEyeCalibration::estimateHandEyeScrew(rvecs1, tvecs1, rvecs2, tvecs2, unchanged, false, options,
+                                                                     [](double progress){ return progress < 0.1; }));
+    BOOST_CHECK(unchanged.isIdentity());
+}
+
+BOOST_AUTO_TEST_CASE(AnalyticJacobians)
+{
+    HandEyeVectors rvecs1, tvecs1, rvecs2, tvecs2;
+    makeHandEyeMotions(20, 9, 1e-3, expectedHandEye(), rvecs1, tvecs1, rvecs2, tvecs2);
+
+    // away from the solution so every term of the jacobians contributes
+    Eigen::Quaterniond q(Eigen::AngleAxisd(0.7, Eigen::Vector3d(0.3, -0.5, 0.2).normalized()));
+    Eigen::Vector3d t(0.2, -0.4, 0.9);
+    const double h = 1e-6;
+
+    for (std::size_t i = 0; i < rvecs1.size(); ++i)
+    {
+        camodocal::MotionPair motion(rvecs1[i], tvecs1[i], rvecs2[i], tvecs2[i]);
+        Eigen::Matrix<double, 6, 1> residual, plus, minus;
+        Eigen::Matrix<double, 6, 4> dq;
+        Eigen::Matrix<double, 6, 3> dt;
+        camodocal::motionError(q, t, motion, residual, &dq, &dt);
+
+        // ceres moves the quaternion by [1, delta] * q, so compare in that tangent space
+        Eigen::Matrix<double, 6, 3> dqTangent = dq * camodocal::quaternionRightMatrix(q).rightCols<3>();
+        for (int j = 0; j < 3; ++j)
+        {
+            Eigen::Vector3d delta = Eigen::Vector3d::Zero();
+            delta(j) = h;
+            camodocal::motionError(Eigen::Quaterniond(1.0, delta(0), delta(1), delta(2)).normalized() * q, t, motion, plus);
+            camodocal::motionError(Eigen::Quaterniond(1.0, -delta(0), -delta(1), -delta(2)).normalized() * q, t, motion, minus);
+            Eigen::Matrix<double, 6, 1> numeric = (plus - minus) / (2.0 * h);
+            BOOST_CHECK_SMALL((numeric - dqTangent.col(j)).norm(), 1e-6);
+
+            camodocal::motionError(q, t + delta, motion, plus);
+            camodocal::motionError(q, t - delta, motion, minus);
+            numeric = (plus - minus) / (2.0 * h);
+            BOOST_CHECK_SMALL((numeric - dt.col(j)).norm(), 1e-6);
+        }
+    }
+
+    // the ceres cost function built on them reaches the same transform as autodiff
+    camodocal::HandEyeCalibration::setVerbose(false);
+    camodocal::HandEyeCalibration::RefineOptions autodiff, analytic = camodocal::HandEyeCalibration::RefineOptions::fast();
+    Eigen::Matrix4d H_autodiff, H_analytic;
+    makeHandEyeMotions(100, 9, 0.0, expectedHandEye(), rvecs1, tvecs1, rvecs2, tvecs2);
+    BOOST_CHECK(camodocal::HandEyeCalibration::estimateHandEyeScrew(rvecs1, tvecs1, rvecs2, tvecs2, H_autodiff, false, autodiff));
+    BOOST_CHECK(camodocal::HandEyeCalibration::estimateHandEyeScrew(rvecs1, tvecs1, rvecs2, tvecs2, H_analytic, false, analytic));
+    BOOST_CHECK(H_analytic.isApprox(H_autodiff, 1e-9));
+    BOOST_CHECK(H_analytic.isApprox(expectedHandEye(), 1e-9));
+}
+
+BOOST_AUTO_TEST_CASE(IncrementalEstimate)
+{
+    Eigen::Matrix4d H_12_expected = expectedHandEye();
+    HandEyeVectors rvecs1, tvecs1, rvecs2, tvecs2;
+    makeHandEyeMotions(200, 3, 1e-4, H_12_expected, rvecs1, tvecs1, rvecs2, tvecs2);
+
+    camodocal::HandEyeCalibrationIncremental incremental;
+    BOOST_CHECK(!incremental.hasEstimate());
+
+    double firstUncertainty = 0;
+    for (int i = 0; i < 200; ++i)
+    {
+        bool updated = incremental.addMotion(rvecs1[i], tvecs1[i], rvecs2[i], tvecs2[i]);
+
+        // a single motion leaves the rotation about its screw axis undetermined
+        BOOST_CHECK_EQUAL(updated, i > 0);
+        if (i == 1) firstUncertainty = incremental.quality().uncertainty;
+    }
+
+    const camodocal::HandEyeCalibrationIncremental::Quality& quality = incremental.quality();
+    BOOST_CHECK_EQUAL(quality.motionCount, std::size_t(200));
+    BOOST_CHECK(std::isfinite(quality.conditionNumber));
+    BOOST_CHECK_LT(quality.uncertainty, firstUncertainty);
+    BOOST_CHECK(incremental.hasConverged());
+    BOOST_CHECK(incremental.estimate().isApprox(H_12_expected, 1e-3));
+
+    incremental.reset();
+    BOOST_CHECK(!incremental.hasEstimate());
+    BOOST_CHECK_EQUAL(incremental.quality().motionCount, std::size_t(0));
+}
+
 /*
 TEST(HandEyeCalibration, EstimateWithUnitTranslation)
 {
@@ -0,0 +1,128 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE IterativeClosestPoint_test
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+
+#include "grl/registration/IterativeClosestPoint.hpp"
+
+BOOST_AUTO_TEST_SUITE(IterativeClosestPoint_test)
+
+/// points and outward normals on the faces of a box about the size of a bone fragment, in meters
+static void makeBox(int count, Eigen::Matrix3Xd& points, Eigen::Matrix3Xd& normals, unsigned int seed)
+{
+    const Eigen::Vector3d halfSize(0.03, 0.02, 0.01);
+    const Eigen::Vector3d faceArea(halfSize.y() * halfSize.z(), halfSize.x() * halfSize.z(), halfSize.x() * halfSize.y());
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<> uniform(-1.0, 1.0);
+    std::discrete_distribution<> axisByArea({faceArea.x(), faceArea.y(), faceArea.z()});
+    std::bernoulli_distribution side(0.5);
+    points.resize(3, count);
+    normals.resize(3, count);
+    for(int i = 0; i < count; ++i)
+    {
+        int axis = axisByArea(gen);
+        double sign = side(gen) ? 1.0 : -1.0;
+        Eigen::Vector3d point(uniform(gen), uniform(gen), uniform(gen));
+        point(axis) = sign;
+        points.col(i) = halfSize.cwiseProduct(point);
+        normals.col(i) = sign * Eigen::Vector3d::Unit(axis);
+    }
+}
+
+static Eigen::Affine3d makeOffset()
+{
+    Eigen::Affine3d offset = Eigen::Affine3d::Identity();
+    offset.linear() = Eigen::AngleAxisd(0.1, Eigen::Vector3d(0.3, -0.2, 1.0).normalized()).toRotationMatrix();
+    offset.translation() = Eigen::Vector3d(0.004, -0.003, 0.005);
+    return offset;
+}
+
+/// rotation angle and translation between the estimate and the expected transform
+static void checkTransform(const Eigen::Affine3d& estimate, const Eigen::Affine3d& expected, double angle, double translation)
+{
+    Eigen::Affine3d error = estimate * expected.inverse();
+    BOOST_CHECK_SMALL(Eigen::AngleAxisd(error.rotation()).angle(), angle);
+    BOOST_CHECK_SMALL(error.translation().norm(), translation);
+}
+
+BOOST_AUTO_TEST_CASE(PointToPointAndPointToPlane)
+{
+    Eigen::Matrix3Xd modelPoints, modelNormals, digitized, unused;
+    makeBox(20000, modelPoints, modelNormals, 1);
+    makeBox(300, digitized, unused, 2);
+    grl::registration::TargetModel model(modelPoints, modelNormals);
+
+    // digitized points measured in a frame offset from the model
+    Eigen::Affine3d offset = makeOffset();
+    Eigen::Matrix3Xd measured = offset.inverse() * digitized;
+
+    grl::registration::IterativeClosestPoint pointToPoint;
+    const grl::registration::IterativeClosestPoint::Result& result = pointToPoint.align(measured, model);
+    BOOST_CHECK(result.converged);
+    BOOST_CHECK_EQUAL(result.inliers, 300u);
+    checkTransform(result.transform, offset, 0.01, 0.001);
+
+    grl::registration::IterativeClosestPoint::Params params = grl::registration::IterativeClosestPoint::defaultParams();
+    std::get<grl::registration::IterativeClosestPoint::Metric>(params) = grl::registration::IterativeClosestPoint::POINT_TO_PLANE;
+    grl::registration::IterativeClosestPoint pointToPlane(params);
+    const grl::registration::IterativeClosestPoint::Result& planeResult = pointToPlane.align(measured, model);
+    checkTransform(planeResult.transform, offset, 0.01, 0.001);
+    BOOST_CHECK(planeResult.iterations <= result.iterations);
+
+    // the same buffers and kd-tree are reused, starting from the answer stays there
+    const Eigen::Affine3d planeTransform = planeResult.transform;
+    const grl::registration::IterativeClosestPoint::Result& again = pointToPlane.align(measured, model, planeTransform);
+    BOOST_CHECK(again.converged);
+    checkTransform(again.transform, planeTransform, 0.001, 0.0001);
+}
+
+BOOST_AUTO_TEST_CASE(RobustToOutlierPoints)
+{
+    Eigen::Matrix3Xd modelPoints, modelNormals, digitized, unused;
+    makeBox(20000, modelPoints, modelNormals, 3);
+    makeBox(300, digitized, unused, 4);
+    grl::registration::TargetModel model(modelPoints, modelNormals);
+
+    // a tenth of the digitized points are accidental clicks away from the bone
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<> away(0.01, 0.03);
+    for(int i = 0; i < digitized.cols(); i += 10) digitized.col(i) += away(gen) * digitized.col(i).normalized();
+
+    Eigen::Affine3d offset = makeOffset();
+    Eigen::Matrix3Xd measured = offset.inverse() * digitized;
+
+    grl::registration::IterativeClosestPoint::Params params = grl::registration::IterativeClosestPoint::defaultParams();
+    std::get<grl::registration::IterativeClosestPoint::Robust>(params) = grl::registration::IterativeClosestPoint::SPARSE;
+    std::get<grl::registration::IterativeClosestPoint::RobustParameter>(params) = 0.8;
+    grl::registration::IterativeClosestPoint sparse(params);
+    checkTransform(sparse.align(measured, model).transform, offset, 0.02, 0.001);
+
+    std::get<grl::registration::IterativeClosestPoint::Robust>(params) = grl::registration::IterativeClosestPoint::TUKEY;
+    std::get<grl::registration::IterativeClosestPoint::RobustParameter>(params) = 0.005;
+    grl::registration::IterativeClosestPoint tukey(params);
+    checkTransform(tukey.align(measured, model).transform, offset, 0.01, 0.001);
+}
+
+BOOST_AUTO_TEST_CASE(TimeBudget)
+{
+    Eigen::Matrix3Xd modelPoints, modelNormals, digitized, unused;
+    makeBox(20000, modelPoints, modelNormals, 6);
+    makeBox(5000, digitized, unused, 7);
+    grl::registration::TargetModel model(modelPoints);
+
+    grl::registration::IterativeClosestPoint::Params params = grl::registration::IterativeClosestPoint::defaultParams();
+    std::get<grl::registration::IterativeClosestPoint::StopTolerance>(params) = 0.0;
+    std::get<grl::registration::IterativeClosestPoint::TimeBudget>(params) = 0.001;
+    grl::registration::IterativeClosestPoint icp(params);
+    const grl::registration::IterativeClosestPoint::Result& result = icp.align(makeOffset().inverse() * digitized, model);
+    BOOST_CHECK(result.timedOut);
+    BOOST_CHECK(!result.converged);
+    BOOST_CHECK(result.iterations < 100);
+
+    std::get<grl::registration::IterativeClosestPoint::Metric>(params) = grl::registration::IterativeClosestPoint::POINT_TO_PLANE;
+    icp.setParams(params);
+    BOOST_CHECK_THROW(icp.align(digitized, model), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
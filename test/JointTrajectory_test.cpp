@@ -0,0 +1,87 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE JointTrajectory_test
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+
+#include "grl/path/JointTrajectory.hpp"
+
+BOOST_AUTO_TEST_SUITE(JointTrajectory_test)
+
+BOOST_AUTO_TEST_CASE(LinearAndHermiteInterpolation)
+{
+    grl::path::JointTrajectory trajectory(2);
+    trajectory.addWaypoint(0.0, {0.0, 1.0});
+    trajectory.addWaypoint(1.0, {1.0, 1.0});
+    trajectory.addWaypoint(3.0, {2.0, 0.0}, {0.0, 0.0});
+    trajectory.addWaypoint(5.0, {0.0, 0.0}, {0.0, 0.0});
+    BOOST_CHECK_EQUAL(trajectory.size(), 4u);
+    BOOST_CHECK_EQUAL(trajectory.duration(), 5.0);
+
+    std::vector<double> q;
+    trajectory.sample(-1.0, q);
+    BOOST_CHECK_EQUAL(q[0], 0.0);
+    trajectory.sample(0.5, q);
+    BOOST_CHECK_CLOSE(q[0], 0.5, 1e-9);
+    BOOST_CHECK_CLOSE(q[1], 1.0, 1e-9);
+    // linear when one end has no velocity
+    trajectory.sample(2.0, q);
+    BOOST_CHECK_CLOSE(q[0], 1.5, 1e-9);
+    // cubic through zero velocities, halfway and symmetric about the middle
+    trajectory.sample(4.0, q);
+    BOOST_CHECK_CLOSE(q[0], 1.0, 1e-9);
+    std::vector<double> early, late;
+    trajectory.sample(3.5, early);
+    trajectory.sample(4.5, late);
+    BOOST_CHECK_CLOSE(early[0] + late[0], 2.0, 1e-9);
+    BOOST_CHECK(early[0] > 1.5);
+    // held after the end
+    trajectory.sample(10.0, q);
+    BOOST_CHECK_EQUAL(q[0], 0.0);
+    BOOST_CHECK_EQUAL(q[1], 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(StreamingMatchesRandomAccess)
+{
+    grl::path::JointTrajectory trajectory(7);
+    for(int i = 0; i <= 100; ++i)
+    {
+        std::vector<double> q(7), v(7);
+        for(int j = 0; j < 7; ++j) { q[j] = std::sin(0.1 * i + j); v[j] = 5.0 * std::cos(0.1 * i + j); }
+        trajectory.addWaypoint(0.02 * i, q, v);
+    }
+
+    // a 1 kHz control loop, then jumps backwards and forwards
+    std::vector<double> times;
+    for(int tick = 0; tick <= 2100; ++tick) times.push_back(tick * 0.001);
+    for(double t : {1.73, 0.011, 1.999, 0.5, 0.52, 0.0, 2.0}) times.push_back(t);
+
+    // a copy sampled in reverse order in between, so its remembered segment is rarely the right one
+    grl::path::JointTrajectory reversed(trajectory);
+    std::vector<double> streamed, fresh;
+    for(double t : times)
+    {
+        trajectory.sample(t, streamed);
+        reversed.sample(2.0 - t, fresh);
+        reversed.sample(t, fresh);
+        BOOST_REQUIRE(streamed == fresh);
+        // the spline passes close to the sampled sine
+        for(int j = 0; j < 7; ++j) BOOST_CHECK_SMALL(streamed[j] - std::sin(5.0 * std::min(t, 2.0) + j), 1e-5);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MalformedWaypoints)
+{
+    grl::path::JointTrajectory trajectory(7);
+    std::vector<double> q(7, 0.0);
+    BOOST_CHECK_THROW(trajectory.sample(0.0, q), std::runtime_error);
+    BOOST_CHECK_THROW(trajectory.addWaypoint(0.0, std::vector<double>(6, 0.0)), std::runtime_error);
+    BOOST_CHECK_THROW(trajectory.addWaypoint(0.0, q, std::vector<double>(3, 0.0)), std::runtime_error);
+    BOOST_CHECK_THROW(trajectory.addWaypoint(-1.0, q), std::runtime_error);
+    trajectory.addWaypoint(1.0, q);
+    BOOST_CHECK_THROW(trajectory.addWaypoint(0.5, q), std::runtime_error);
+    trajectory.addWaypoint(1.0, q);
+    BOOST_CHECK_EQUAL(trajectory.size(), 2u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
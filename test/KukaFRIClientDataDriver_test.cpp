@@ -0,0 +1,152 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE KukaFRIClientDataDriver_test
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+#include "grl/kuka/KukaFRIdriver.hpp"
+#include "pb_encode.h"
+#include "pb_decode.h"
+
+BOOST_AUTO_TEST_SUITE(KukaFRIClientDataDriver_test)
+
+typedef grl::robot::arm::KukaFRIClientDataDriver<> Driver;
+
+/// a stand in for the robot controller sending FRI monitor messages over loopback
+class FakeRobot
+{
+public:
+    FakeRobot(boost::asio::io_service& ios, short robotPort, short driverPort)
+        : socket_(ios), robotPort_(robotPort), driverPort_(driverPort), sequenceCounter_(0)
+    {
+        open();
+    }
+
+    /// bind the robot port and start a new FRI session
+    void open()
+    {
+        socket_.open(boost::asio::ip::udp::v4());
+        socket_.set_option(boost::asio::socket_base::reuse_address(true));
+        socket_.bind(boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), robotPort_));
+        socket_.connect(boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), driverPort_));
+        sequenceCounter_ = 0;
+    }
+
+    void close() { socket_.close(); }
+
+    /// one monitor message of an arm in MONITORING_READY asking for a reply to every message
+    void send()
+    {
+        FRIMonitoringMessage msg;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.header.messageIdentifier = KUKA::LBRState::LBRMONITORMESSAGEID;
+        msg.header.sequenceCounter = sequenceCounter_++;
+        msg.has_connectionInfo = true;
+        msg.connectionInfo.sessionState = static_cast<FRISessionState>(KUKA::FRI::MONITORING_READY);
+        msg.connectionInfo.quality = static_cast<FRIConnectionQuality>(KUKA::FRI::GOOD);
+        msg.connectionInfo.has_sendPeriod = true;
+        msg.connectionInfo.sendPeriod = 1;
+        msg.connectionInfo.has_receiveMultiplier = true;
+        msg.connectionInfo.receiveMultiplier = 1;
+
+        uint8_t buffer[KUKA::FRI::FRI_MONITOR_MSG_MAX_SIZE];
+        pb_ostream_t stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
+        BOOST_REQUIRE(pb_encode(&stream, FRIMonitoringMessage_fields, &msg));
+        socket_.send(boost::asio::buffer(buffer, stream.bytes_written));
+    }
+
+    /// the driver's reply to the last message, false if none arrived in time
+    bool receive(FRICommandMessage& reply)
+    {
+        boost::system::error_code ec;
+        if (!grl::robot::arm::wait_for_receive(socket_, std::chrono::milliseconds(100), ec)) return false;
+        uint8_t buffer[KUKA::FRI::FRI_COMMAND_MSG_MAX_SIZE];
+        const std::size_t size = socket_.receive(boost::asio::buffer(buffer), 0, ec);
+        if (ec) return false;
+        std::memset(&reply, 0, sizeof(reply));
+        pb_istream_t stream = pb_istream_from_buffer(buffer, size);
+        return pb_decode(&stream, FRICommandMessage_fields, &reply);
+    }
+
+    /// send one message and check the reply continues the session
+    void exchange(uint32_t expectedReplyCounter)
+    {
+        const uint32_t sent = sequenceCounter_;
+        send();
+        FRICommandMessage reply;
+        BOOST_REQUIRE(receive(reply));
+        BOOST_CHECK_EQUAL(reply.header.sequenceCounter, expectedReplyCounter);
+        BOOST_CHECK_EQUAL(reply.header.reflectedSequenceCounter, sent);
+    }
+
+private:
+    boost::asio::ip::udp::socket socket_;
+    short robotPort_;
+    short driverPort_;
+    uint32_t sequenceCounter_;
+};
+
+/// poll until the driver reaches the state or a second passed
+static bool waitForState(const Driver& driver, Driver::ConnectionState state)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (driver.connection_state() != state && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return driver.connection_state() == state;
+}
+
+BOOST_AUTO_TEST_CASE(ReconnectsAfterTheRobotStopsSending)
+{
+    const short driverPort = 30310, robotPort = 30311;
+    Driver driver(std::make_tuple(std::string(grl::robot::arm::KUKA_LBR_IIWA_14_R820),
+                                  std::string("127.0.0.1"), std::to_string(driverPort),
+                                  std::string("127.0.0.1"), std::to_string(robotPort),
+                                  Driver::run_automatically));
+    driver.set_receive_timeout(std::chrono::milliseconds(50));
+    BOOST_CHECK_EQUAL(driver.connection_state(), Driver::connecting);
+    BOOST_CHECK(!driver.is_active());
+
+    // the first session, replies count up from 0
+    boost::asio::io_service ios;
+    FakeRobot robot(ios, robotPort, driverPort);
+    for (uint32_t i = 0; i < 20; ++i) robot.exchange(i);
+    BOOST_CHECK_EQUAL(driver.connection_state(), Driver::connected);
+    BOOST_CHECK(driver.is_active());
+    BOOST_CHECK_EQUAL(driver.reconnect_count(), 0);
+
+    // the robot goes away right after a message, so the reply is refused
+    robot.send();
+    robot.close();
+    const std::clock_t cpuStart = std::clock();
+    const auto wallStart = std::chrono::steady_clock::now();
+    BOOST_REQUIRE(waitForState(driver, Driver::reconnecting));
+    BOOST_CHECK(!driver.is_active());
+    BOOST_CHECK_EQUAL(driver.reconnect_count(), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // the refused replies don't make the driver spin while it waits
+    const double cpuSeconds = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    BOOST_CHECK_LT(cpuSeconds, 0.5 * wallSeconds);
+    BOOST_CHECK_EQUAL(driver.connection_state(), Driver::reconnecting);
+
+    // a new session restarts the reply counter and reflects the new messages
+    robot.open();
+    for (uint32_t i = 0; i < 20; ++i) robot.exchange(i);
+    BOOST_CHECK_EQUAL(driver.connection_state(), Driver::connected);
+    BOOST_CHECK(driver.is_active());
+    BOOST_CHECK_EQUAL(driver.reconnect_count(), 1);
+
+    // dropping again counts again
+    robot.close();
+    BOOST_REQUIRE(waitForState(driver, Driver::reconnecting));
+    robot.open();
+    robot.exchange(0);
+    BOOST_CHECK(waitForState(driver, Driver::connected));
+    BOOST_CHECK_EQUAL(driver.reconnect_count(), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
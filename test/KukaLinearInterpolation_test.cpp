@@ -0,0 +1,89 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE KukaLinearInterpolation_test
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "grl/kuka/KukaFRIdriver.hpp"
+
+BOOST_AUTO_TEST_SUITE(KukaLinearInterpolation_test)
+
+/// the joint angles in a nanopb repeated double field of an FRI message
+static double* jointValues(void* arg)
+{
+    return static_cast<tRepeatedDoubleArguments*>(arg)->value;
+}
+
+/// an FRI message arriving every millisecond from an arm standing at the zero position
+static void initializeMonitoringMessage(KUKA::FRI::ClientData& friData)
+{
+    FRIMonitoringMessage& monitoringMsg = friData.monitoringMsg;
+    monitoringMsg.has_connectionInfo = true;
+    monitoringMsg.connectionInfo.has_sendPeriod = true;
+    monitoringMsg.connectionInfo.sendPeriod = 1;
+    monitoringMsg.monitorData.has_measuredJointPosition = true;
+    monitoringMsg.ipoData.has_jointPosition = true;
+    for(int i = 0; i < KUKA::LBRState::NUM_DOF; ++i)
+    {
+        jointValues(monitoringMsg.monitorData.measuredJointPosition.value.arg)[i] = 0.0;
+        jointValues(monitoringMsg.ipoData.jointPosition.value.arg)[i] = 0.0;
+    }
+}
+
+/// one FRI tick of an arm that follows the command exactly
+static void tick(grl::robot::arm::LinearInterpolation& step_alg, KUKA::FRI::ClientData& friData)
+{
+    step_alg.lowLevelTimestep(friData, grl::revolute_joint_angle_open_chain_command_tag());
+    for(int i = 0; i < KUKA::LBRState::NUM_DOF; ++i)
+    {
+        jointValues(friData.monitoringMsg.monitorData.measuredJointPosition.value.arg)[i] =
+            jointValues(friData.commandMsg.commandData.jointPosition.value.arg)[i];
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ReachesTheGoalInTheTimeStep)
+{
+    KUKA::FRI::ClientData friData(KUKA::LBRState::NUM_DOF);
+    initializeMonitoringMessage(friData);
+
+    // a 10 ms simulation time step with a goal well within the velocity limits
+    const std::size_t timeStepMS = 10;
+    boost::container::static_vector<double,7> goal(KUKA::LBRState::NUM_DOF, 0.005);
+    grl::robot::arm::LinearInterpolation step_alg;
+    BOOST_CHECK(!step_alg.hasCommandData());
+    step_alg.setGoal(std::make_tuple(goal, timeStepMS));
+
+    // the goal is set once, so it is not approached asymptotically
+    for(std::size_t t = 0; t < timeStepMS; ++t)
+    {
+        BOOST_CHECK(step_alg.hasCommandData());
+        tick(step_alg, friData);
+    }
+    BOOST_CHECK(!step_alg.hasCommandData());
+
+    const double* measured = jointValues(friData.monitoringMsg.monitorData.measuredJointPosition.value.arg);
+    for(int i = 0; i < KUKA::LBRState::NUM_DOF; ++i)
+    {
+        BOOST_CHECK_CLOSE(measured[i], goal[i], 1e-6);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MovesEvenlyTowardTheGoal)
+{
+    KUKA::FRI::ClientData friData(KUKA::LBRState::NUM_DOF);
+    initializeMonitoringMessage(friData);
+
+    boost::container::static_vector<double,7> goal(KUKA::LBRState::NUM_DOF, 0.004);
+    grl::robot::arm::LinearInterpolation step_alg;
+    step_alg.setGoal(std::make_tuple(goal, std::size_t(4)));
+
+    // a quarter of the way each tick
+    const double* measured = jointValues(friData.monitoringMsg.monitorData.measuredJointPosition.value.arg);
+    for(int t = 1; t <= 4; ++t)
+    {
+        tick(step_alg, friData);
+        BOOST_CHECK_CLOSE(measured[0], 0.001 * t, 1e-6);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
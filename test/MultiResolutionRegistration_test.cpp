@@ -0,0 +1,62 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE MultiResolutionRegistration_test
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+
+#include "grl/registration/MultiResolutionRegistration.hpp"
+#include "TriangleMeshTestFixtures.hpp"
+
+BOOST_AUTO_TEST_SUITE(MultiResolutionRegistration_test)
+
+BOOST_AUTO_TEST_CASE(CoarseToFine)
+{
+    auto coarse = makeBone(2);
+    auto fine = makeBone(5);
+
+    // points on the fine surface, as a tracked pointer would digitize them
+    std::mt19937 gen(4);
+    std::uniform_real_distribution<> coordinate(-0.25, 0.25);
+    Eigen::Matrix3Xd surface(3, 500);
+    grl::registration::TriangleMeshBVH::ClosestPoint closest;
+    for(int i = 0; i < surface.cols(); ++i)
+    {
+        fine->closestPoint(Eigen::Vector3d(coordinate(gen), coordinate(gen), coordinate(gen)), closest);
+        surface.col(i) = closest.point;
+    }
+
+    // far enough from the model that only the global alignment finds it
+    Eigen::Affine3d pointsInTracker = Eigen::Affine3d::Identity();
+    pointsInTracker.linear() = Eigen::AngleAxisd(2.5, Eigen::Vector3d(1.0, -2.0, 0.5).normalized()).toRotationMatrix();
+    pointsInTracker.translation() = Eigen::Vector3d(0.4, -0.1, 1.2);
+    Eigen::Matrix3Xd measured = pointsInTracker * surface;
+
+    grl::registration::MultiResolutionRegistration registration({coarse, fine});
+    const grl::registration::MultiResolutionRegistration::Result& result = registration.align(measured);
+    Eigen::Affine3d error = result.transform * pointsInTracker;
+    BOOST_CHECK_SMALL(Eigen::AngleAxisd(error.rotation()).angle(), 1e-6);
+    BOOST_CHECK_SMALL(error.translation().norm(), 1e-6);
+    BOOST_CHECK_SMALL(result.rmse, 1e-6);
+    BOOST_REQUIRE_EQUAL(result.iterations.size(), 2u);
+    BOOST_CHECK(result.iterations[0] > 0 && result.iterations[1] > 0);
+    BOOST_CHECK(!result.timedOut);
+
+    // the coarse model alone stops at its meshing error
+    grl::registration::MultiResolutionRegistration coarseOnly({coarse});
+    BOOST_CHECK(coarseOnly.align(measured).rmse > 100.0 * result.rmse);
+
+    // from a nearby estimate without global alignment
+    grl::registration::MultiResolutionRegistration::Params params = grl::registration::MultiResolutionRegistration::defaultParams();
+    std::get<grl::registration::MultiResolutionRegistration::GlobalAlignment>(params) = false;
+    registration.setParams(params);
+    Eigen::Affine3d nearby = Eigen::AngleAxisd(0.1, Eigen::Vector3d::UnitZ()) * pointsInTracker.inverse();
+    error = registration.align(measured, nearby).transform * pointsInTracker;
+    BOOST_CHECK_SMALL(Eigen::AngleAxisd(error.rotation()).angle(), 1e-6);
+
+    // an exhausted time budget returns the best estimate so far
+    std::get<grl::registration::MultiResolutionRegistration::TimeBudget>(params) = 1e-9;
+    registration.setParams(params);
+    BOOST_CHECK(registration.align(measured, nearby).timedOut);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,78 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE OnlineRegistration_test
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+
+#include "grl/registration/OnlineRegistration.hpp"
+#include "TriangleMeshTestFixtures.hpp"
+
+BOOST_AUTO_TEST_SUITE(OnlineRegistration_test)
+
+static double rotationError(const Eigen::Affine3d& estimate, const Eigen::Affine3d& truth)
+{
+    return Eigen::AngleAxisd((estimate * truth).rotation()).angle();
+}
+
+BOOST_AUTO_TEST_CASE(ConvergesWhileDigitizing)
+{
+    auto bone = makeBone(4);
+
+    // points on the surface in a random order, as a pointer sweeps over it
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<> coordinate(-0.25, 0.25);
+    Eigen::Matrix3Xd surface(3, 600);
+    grl::registration::TriangleMeshBVH::ClosestPoint closest;
+    for(int i = 0; i < surface.cols(); ++i)
+    {
+        bone->closestPoint(Eigen::Vector3d(coordinate(gen), coordinate(gen), coordinate(gen)), closest);
+        surface.col(i) = closest.point;
+    }
+    Eigen::Affine3d modelInTracker = Eigen::Affine3d::Identity();
+    modelInTracker.linear() = Eigen::AngleAxisd(0.7, Eigen::Vector3d(1.0, 1.0, 0.0).normalized()).toRotationMatrix();
+    modelInTracker.translation() = Eigen::Vector3d(0.1, 0.2, 1.0);
+    Eigen::Matrix3Xd measured = modelInTracker * surface;
+
+    // a landmark estimate a few millimeters and degrees off
+    Eigen::Affine3d landmarkEstimate = Eigen::Translation3d(0.002, -0.001, 0.001)
+                                     * Eigen::AngleAxisd(0.03, Eigen::Vector3d(0.2, 0.5, 1.0).normalized())
+                                     * modelInTracker.inverse();
+    grl::registration::OnlineRegistration registration(bone, landmarkEstimate);
+
+    std::vector<double> errors;
+    for(int i = 0; i < measured.cols(); ++i)
+    {
+        const grl::registration::OnlineRegistration::State& state = registration.addPoint(measured.col(i));
+        if(i % 100 == 99) errors.push_back(rotationError(state.transform, modelInTracker));
+        if(i < 11) BOOST_CHECK_EQUAL(state.updates, 0);
+    }
+    const grl::registration::OnlineRegistration::State& state = registration.state();
+    // converged well before digitization finished
+    BOOST_CHECK_SMALL(errors.front(), 1e-4);
+    BOOST_CHECK_SMALL(errors.back(), 1e-6);
+    BOOST_CHECK_SMALL((state.transform * modelInTracker).translation().norm(), 1e-6);
+    BOOST_CHECK_SMALL(state.rmse, 1e-6);
+    BOOST_CHECK(state.converged);
+    BOOST_CHECK_EQUAL(state.pointsAdded, 600u);
+    BOOST_CHECK_EQUAL(state.inliers, 600);
+
+    // a stray point far from the bone is not used
+    registration.addPoint(modelInTracker * Eigen::Vector3d(0.0, 0.0, 0.5));
+    BOOST_CHECK_EQUAL(registration.state().inliers, 600);
+    BOOST_CHECK_SMALL(rotationError(registration.state().transform, modelInTracker), 1e-6);
+
+    // the stored points are bounded, the estimate is kept
+    grl::registration::OnlineRegistration::Params params = grl::registration::OnlineRegistration::defaultParams();
+    std::get<grl::registration::OnlineRegistration::MaxPoints>(params) = 100;
+    registration.setParams(params);
+    BOOST_CHECK_EQUAL(registration.points().cols(), 100);
+    for(int i = 0; i < measured.cols(); ++i) registration.addPoint(measured.col(i));
+    BOOST_CHECK_EQUAL(registration.points().cols(), 100);
+    BOOST_CHECK_SMALL(rotationError(registration.state().transform, modelInTracker), 1e-6);
+
+    registration.reset(landmarkEstimate);
+    BOOST_CHECK_EQUAL(registration.points().cols(), 0);
+    BOOST_CHECK_EQUAL(registration.state().pointsAdded, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
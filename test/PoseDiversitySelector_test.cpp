@@ -0,0 +1,89 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE PoseDiversitySelector_test
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+
+#include "grl/calibration/PoseDiversitySelector.hpp"
+#include "grl/calibration/RansacPivotCalibration.hpp"
+
+BOOST_AUTO_TEST_SUITE(PoseDiversitySelector_test)
+
+/// a recorded pivoting session, the tool dwells at each orientation for many frames
+static void makePivotSession(grl::calibration::PoseDiversitySelector::Poses& poses,
+                             const Eigen::Vector3d& tipOffset, const Eigen::Vector3d& pivotPoint)
+{
+    std::mt19937 gen(21);
+    std::uniform_real_distribution<> angle(-0.6, 0.6);
+    std::normal_distribution<> jitter(0.0, 0.002);
+    std::normal_distribution<> noise(0.0, 0.0002);
+    for(int dwell = 0; dwell < 40; ++dwell)
+    {
+        Eigen::Matrix3d R = (Eigen::AngleAxisd(angle(gen), Eigen::Vector3d::UnitX()) *
+                             Eigen::AngleAxisd(angle(gen), Eigen::Vector3d::UnitY()) *
+                             Eigen::AngleAxisd(angle(gen), Eigen::Vector3d::UnitZ())).toRotationMatrix();
+        for(int frame = 0; frame < 100; ++frame)
+        {
+            Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+            pose.linear() = R * Eigen::AngleAxisd(jitter(gen), Eigen::Vector3d(jitter(gen), jitter(gen), 1.0).normalized()).toRotationMatrix();
+            pose.translation() = pivotPoint - pose.linear() * tipOffset + Eigen::Vector3d(noise(gen), noise(gen), noise(gen));
+            poses.push_back(pose);
+        }
+    }
+}
+
+static double pivotError(const grl::calibration::PoseDiversitySelector::Poses& poses, const std::vector<std::size_t>& indices, const Eigen::Vector3d& tipOffset)
+{
+    grl::calibration::RansacPivotCalibration::Rotations rotations;
+    grl::calibration::RansacPivotCalibration::Locations locations;
+    for(const auto& pose : poses)
+    {
+        rotations.push_back(pose.linear());
+        locations.push_back(pose.translation());
+    }
+    Eigen::Vector3d translation, pivotPoint;
+    BOOST_REQUIRE(grl::calibration::RansacPivotCalibration::solve(rotations, locations, indices, translation, pivotPoint));
+    return (translation - tipOffset).norm();
+}
+
+BOOST_AUTO_TEST_CASE(ReducesPivotFramesAtEqualAccuracy)
+{
+    const Eigen::Vector3d tipOffset(0.01, -0.02, 0.15);
+    const Eigen::Vector3d pivotPoint(0.3, 0.1, -0.2);
+    grl::calibration::PoseDiversitySelector::Poses poses;
+    makePivotSession(poses, tipOffset, pivotPoint);
+
+    auto params = grl::calibration::PoseDiversitySelector::defaultParams();
+    std::get<grl::calibration::PoseDiversitySelector::CalibrationModel>(params) = grl::calibration::PoseDiversitySelector::PIVOT;
+    grl::calibration::PoseDiversitySelector selector(params);
+    std::vector<std::size_t> selected = selector.select(poses);
+
+    std::vector<std::size_t> all(poses.size());
+    for(std::size_t i = 0; i < all.size(); ++i) all[i] = i;
+
+    BOOST_CHECK_LE(selected.size() * 10, poses.size());
+    BOOST_CHECK_LT(pivotError(poses, selected, tipOffset), 0.0005);
+    BOOST_CHECK_LT(pivotError(poses, all, tipOffset), 0.0005);
+}
+
+BOOST_AUTO_TEST_CASE(SkipsDuplicateHandEyeMotions)
+{
+    grl::calibration::PoseDiversitySelector::Poses poses;
+    Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+    for(int i = 0; i < 50; ++i) poses.push_back(pose);
+    pose.linear() = Eigen::AngleAxisd(0.5, Eigen::Vector3d::UnitX()).toRotationMatrix();
+    for(int i = 0; i < 50; ++i) poses.push_back(pose);
+    pose.linear() = Eigen::AngleAxisd(0.5, Eigen::Vector3d::UnitY()).toRotationMatrix();
+    for(int i = 0; i < 50; ++i) poses.push_back(pose);
+
+    grl::calibration::PoseDiversitySelector selector;
+    std::vector<std::size_t> selected = selector.select(poses);
+
+    // the reference pose and one pose about each of the two rotation axes
+    BOOST_REQUIRE_EQUAL(selected.size(), std::size_t(3));
+    BOOST_CHECK_EQUAL(selected[0], std::size_t(0));
+    BOOST_CHECK_EQUAL(std::min(selected[1], selected[2]) / 50, std::size_t(1));
+    BOOST_CHECK_EQUAL(std::max(selected[1], selected[2]) / 50, std::size_t(2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
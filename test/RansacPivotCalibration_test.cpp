@@ -0,0 +1,77 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE RansacPivotCalibration_test
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <Eigen/Geometry>
+
+#include "grl/calibration/RansacPivotCalibration.hpp"
+
+BOOST_AUTO_TEST_SUITE(RansacPivotCalibration_test)
+
+BOOST_AUTO_TEST_CASE(IgnoresOutlierFrames)
+{
+    const Eigen::Vector3d tipOffset(0.01, -0.02, 0.15);
+    const Eigen::Vector3d pivotPoint(0.3, 0.1, -0.2);
+
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<> angle(-0.6, 0.6);
+    std::normal_distribution<> noise(0.0, 0.0001);
+
+    grl::calibration::RansacPivotCalibration::Rotations rotations;
+    grl::calibration::RansacPivotCalibration::Locations locations;
+    const int frameCount = 200;
+    for(int i = 0; i < frameCount; ++i)
+    {
+        Eigen::Matrix3d R = (Eigen::AngleAxisd(angle(gen), Eigen::Vector3d::UnitX()) *
+                             Eigen::AngleAxisd(angle(gen), Eigen::Vector3d::UnitY()) *
+                             Eigen::AngleAxisd(angle(gen), Eigen::Vector3d::UnitZ())).toRotationMatrix();
+        Eigen::Vector3d t = pivotPoint - R * tipOffset + Eigen::Vector3d(noise(gen), noise(gen), noise(gen));
+        // every fifth frame has a partially occluded marker
+        if(i % 5 == 0) t += Eigen::Vector3d(0.02, 0.0, -0.01);
+        rotations.push_back(R);
+        locations.push_back(t);
+    }
+
+    grl::calibration::RansacPivotCalibration ransac;
+    std::size_t inlierCount = ransac.compute(rotations, locations);
+
+    BOOST_CHECK_EQUAL(inlierCount, std::size_t(frameCount - frameCount / 5));
+    BOOST_CHECK(!ransac.getInliers()[0]);
+    BOOST_CHECK(ransac.getInliers()[1]);
+    BOOST_CHECK_SMALL((ransac.getTranslation() - tipOffset).norm(), 1e-4);
+    BOOST_CHECK_SMALL((ransac.getPivotPoint() - pivotPoint).norm(), 1e-4);
+    BOOST_CHECK_LT(ransac.getRMSE(), 0.001);
+    BOOST_CHECK_LT(ransac.getIterations(), 1000);
+
+    // a single least squares fit over all frames is pulled away by the outliers
+    std::vector<std::size_t> all(frameCount);
+    for(int i = 0; i < frameCount; ++i) all[i] = std::size_t(i);
+    Eigen::Vector3d translation, pivot;
+    BOOST_CHECK(grl::calibration::RansacPivotCalibration::solve(rotations, locations, all, translation, pivot));
+    BOOST_CHECK_GT((pivot - pivotPoint).norm(), 0.001);
+}
+
+BOOST_AUTO_TEST_CASE(RejectsDegenerateFrames)
+{
+    // without any change in rotation the tip offset is unobservable
+    grl::calibration::RansacPivotCalibration::Rotations rotations(10, Eigen::Matrix3d::Identity());
+    grl::calibration::RansacPivotCalibration::Locations locations(10, Eigen::Vector3d(0.1, 0.2, 0.3));
+
+    grl::calibration::RansacPivotCalibration ransac;
+    BOOST_CHECK_THROW(ransac.compute(rotations, locations), std::runtime_error);
+    BOOST_CHECK_THROW(ransac.compute(grl::calibration::RansacPivotCalibration::Rotations(1, Eigen::Matrix3d::Identity()),
+                                     grl::calibration::RansacPivotCalibration::Locations(1, Eigen::Vector3d::Zero())), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(RejectsSamplesOfTwoFrames)
+{
+    // R1 - R2 has rank 2 at most, so every two frame sample would be degenerate
+    grl::calibration::RansacPivotCalibration::Params params = grl::calibration::RansacPivotCalibration::defaultParams();
+    std::get<grl::calibration::RansacPivotCalibration::SampleSize>(params) = 2;
+    BOOST_CHECK_THROW(grl::calibration::RansacPivotCalibration ransac(params), std::runtime_error);
+    std::get<grl::calibration::RansacPivotCalibration::SampleSize>(params) = 3;
+    BOOST_CHECK_NO_THROW(grl::calibration::RansacPivotCalibration ransac(params));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,82 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE SimulatedRobotArmDriver_test
+#include <boost/test/unit_test.hpp>
+#include <memory>
+
+#include "grl/sim/SimulatedRobotArmDriver.hpp"
+
+BOOST_AUTO_TEST_SUITE(SimulatedRobotArmDriver_test)
+
+BOOST_AUTO_TEST_CASE(ZeroPoseIsStraightUp)
+{
+    auto scene = std::make_shared<grl::sim::KinematicScene>();
+    grl::sim::addKukaLBRiiwa14R820(*scene);
+    auto driver = std::make_shared<grl::sim::SimulatedRobotArmDriver>(scene);
+    driver->construct();
+
+    Eigen::Vector3d tip = scene->getObjectTransform(scene->getHandle("RobotMillTip")).translation();
+    BOOST_CHECK_SMALL(tip.x(), 1e-9);
+    BOOST_CHECK_SMALL(tip.y(), 1e-9);
+    BOOST_CHECK_CLOSE(tip.z(), 1.406, 1e-6);
+    BOOST_CHECK_EQUAL(driver->getJointHandles().size(), 7);
+}
+
+BOOST_AUTO_TEST_CASE(SetStateRoundTrip)
+{
+    typedef grl::sim::SimulatedRobotArmDriver Driver;
+    auto scene = std::make_shared<grl::sim::KinematicScene>();
+    grl::sim::addKukaLBRiiwa14R820(*scene);
+    auto driver = std::make_shared<Driver>(scene);
+    driver->construct();
+
+    Driver::State state;
+    std::get<Driver::JointPosition>(state)  = {0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f, 10.0f};
+    std::get<Driver::ExternalTorque>(state) = {1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f};
+    BOOST_CHECK(driver->setState(state));
+
+    Driver::State measured;
+    BOOST_CHECK(!driver->getState(measured));
+    BOOST_CHECK_CLOSE(std::get<Driver::JointPosition>(measured)[3], 0.4f, 1e-4);
+    // joint 7 is clamped to its 175 degree limit
+    BOOST_CHECK_CLOSE(std::get<Driver::JointPosition>(measured)[6], std::get<Driver::JointUpperPositionLimit>(measured)[6], 1e-4);
+    BOOST_CHECK_CLOSE(std::get<Driver::ExternalTorque>(measured)[4], 5.f, 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(JacobianMatchesFiniteDifference)
+{
+    auto scene = std::make_shared<grl::sim::KinematicScene>();
+    grl::sim::addKukaLBRiiwa14R820(*scene);
+    auto driver = std::make_shared<grl::sim::SimulatedRobotArmDriver>(scene);
+    driver->construct();
+
+    const std::vector<int>& joints = driver->getJointHandles();
+    int tip = scene->getHandle("RobotMillTip");
+    for(std::size_t i = 0; i < joints.size(); ++i) scene->setJointPosition(joints[i], 0.3 * (i+1) - 1.0);
+
+    Eigen::MatrixXd jacobian = driver->getJacobian();
+    const double delta = 1e-6;
+    for(std::size_t i = 0; i < joints.size(); ++i)
+    {
+        double q = scene->getJointPosition(joints[i]);
+        Eigen::Vector3d before = scene->getObjectTransform(tip).translation();
+        scene->setJointPosition(joints[i], q + delta);
+        Eigen::Vector3d after = scene->getObjectTransform(tip).translation();
+        scene->setJointPosition(joints[i], q);
+        BOOST_CHECK_SMALL(((after - before) / delta - jacobian.block<3,1>(0,i)).norm(), 1e-4);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(PathInterpolation)
+{
+    grl::sim::KinematicScene scene;
+    grl::sim::KinematicScene::Transforms points(3, grl::sim::KinematicScene::Transform::Identity());
+    points[1].translate(Eigen::Vector3d(1, 0, 0));
+    points[2].translate(Eigen::Vector3d(1, 2, 0));
+    int path = scene.addPath("Path", -1, grl::sim::KinematicScene::Transform::Identity(), points);
+
+    BOOST_CHECK_CLOSE(scene.getPathLength(path), 3.0, 1e-9);
+    BOOST_CHECK(scene.getPathTransformAtDistance(path, 2.0).translation().isApprox(Eigen::Vector3d(1, 1, 0)));
+    BOOST_CHECK(scene.getPathTransformAtDistance(path, 10.0).translation().isApprox(Eigen::Vector3d(1, 2, 0)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
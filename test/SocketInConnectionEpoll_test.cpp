@@ -0,0 +1,275 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE SocketInConnectionEpoll_test
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "socketInConnectionEpoll.h"
+
+BOOST_AUTO_TEST_SUITE(SocketInConnectionEpoll_test)
+
+/// a server listening on the first free port from 19990, small packets so replies are split
+static std::unique_ptr<CSocketInConnectionEpoll> listenOnFreePort(int& port, unsigned short maxPacketSize = 106,
+                                                                  int socketBufferSize = 4*1024*1024, int maxMessageSize = 64*1024*1024)
+{
+    for(port = 19990; port < 20090; ++port)
+    {
+        std::unique_ptr<CSocketInConnectionEpoll> server(
+            new CSocketInConnectionEpoll(port, maxPacketSize, 59, 57, socketBufferSize, maxMessageSize));
+        if(server->listenForClients()) return server;
+    }
+    BOOST_FAIL("no free port to listen on");
+    return nullptr;
+}
+
+/// a blocking remote API style client connected over loopback
+static int connectClient(int port)
+{
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    BOOST_REQUIRE(client != -1);
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = inet_addr("127.0.0.1");
+    BOOST_REQUIRE(connect(client, (struct sockaddr*)&address, sizeof(address)) == 0);
+    return client;
+}
+
+/// frame the payload into packets of at most payloadPerPacket bytes with the default header ids
+static std::vector<char> frame(const std::vector<char>& payload, std::size_t payloadPerPacket)
+{
+    std::vector<char> bytes;
+    const std::size_t packetCount = (payload.size() + payloadPerPacket - 1) / payloadPerPacket;
+    for(std::size_t i = 0; i < packetCount; ++i)
+    {
+        const std::size_t offset = i * payloadPerPacket;
+        const unsigned short size = static_cast<unsigned short>(std::min(payloadPerPacket, payload.size() - offset));
+        const unsigned short packetsLeft = static_cast<unsigned short>(packetCount - 1 - i);
+        char header[6] = {59, 57};
+        std::memcpy(header + 2, &size, sizeof(size));
+        std::memcpy(header + 4, &packetsLeft, sizeof(packetsLeft));
+        bytes.insert(bytes.end(), header, header + 6);
+        bytes.insert(bytes.end(), payload.begin() + offset, payload.begin() + offset + size);
+    }
+    return bytes;
+}
+
+static void sendAll(int client, const std::vector<char>& bytes)
+{
+    BOOST_REQUIRE(send(client, bytes.data(), bytes.size(), 0) == ssize_t(bytes.size()));
+}
+
+static void recvAll(int client, char* data, std::size_t size)
+{
+    while(size)
+    {
+        const ssize_t nb = recv(client, data, size, 0);
+        BOOST_REQUIRE(nb > 0);
+        data += nb;
+        size -= nb;
+    }
+}
+
+/// reassemble one reply, counting the packets it was split into
+static std::vector<char> receiveReply(int client, int& packetCount)
+{
+    std::vector<char> reply;
+    packetCount = 0;
+    for(unsigned short packetsLeft = 1; packetsLeft != 0; ++packetCount)
+    {
+        char header[6];
+        recvAll(client, header, sizeof(header));
+        BOOST_REQUIRE(header[0] == 59 && header[1] == 57);
+        unsigned short size;
+        std::memcpy(&size, header + 2, sizeof(size));
+        std::memcpy(&packetsLeft, header + 4, sizeof(packetsLeft));
+        const std::size_t offset = reply.size();
+        reply.resize(offset + size);
+        recvAll(client, reply.data() + offset, size);
+    }
+    return reply;
+}
+
+static std::vector<char> pattern(std::size_t size, int seed)
+{
+    std::vector<char> data(size);
+    for(std::size_t i = 0; i < size; ++i) data[i] = static_cast<char>(i * 7 + seed);
+    return data;
+}
+
+BOOST_AUTO_TEST_CASE(ReceivesAndRepliesOverLoopback)
+{
+    int port;
+    std::unique_ptr<CSocketInConnectionEpoll> server = listenOnFreePort(port);
+    int client = connectClient(port);
+
+    // a message split into three packets arrives as one
+    const std::vector<char> request = pattern(250, 1);
+    sendAll(client, frame(request, 100));
+    std::vector<char> data;
+    int clientId = -1;
+    BOOST_REQUIRE_EQUAL(server->receiveData(data, clientId, 2000), 1);
+    BOOST_CHECK(data == request);
+    BOOST_CHECK_EQUAL(server->getClientCount(), 1);
+    BOOST_CHECK_EQUAL(server->getConnectedMachineIP(clientId), "127.0.0.1");
+
+    // 106 byte packets carry 100 bytes each after the header
+    const std::vector<char> response = pattern(1000, 3);
+    BOOST_REQUIRE(server->replyToReceivedData(clientId, response.data(), int(response.size())));
+    int packetCount = 0;
+    BOOST_CHECK(receiveReply(client, packetCount) == response);
+    BOOST_CHECK_EQUAL(packetCount, 10);
+
+    // nothing else was sent
+    BOOST_CHECK_EQUAL(server->receiveData(data, clientId, 50), 0);
+    close(client);
+}
+
+BOOST_AUTO_TEST_CASE(ClosingAClientDropsItsQueuedMessages)
+{
+    int port;
+    std::unique_ptr<CSocketInConnectionEpoll> server = listenOnFreePort(port);
+    int client = connectClient(port);
+
+    // both messages arrive in one read, so the second is still queued after the first is received
+    std::vector<char> bytes = frame(pattern(10, 1), 100);
+    const std::vector<char> second = frame(pattern(10, 2), 100);
+    bytes.insert(bytes.end(), second.begin(), second.end());
+    sendAll(client, bytes);
+
+    std::vector<char> data;
+    int clientId = -1;
+    BOOST_REQUIRE_EQUAL(server->receiveData(data, clientId, 2000), 1);
+    BOOST_CHECK(data == pattern(10, 1));
+    server->closeClient(clientId);
+    BOOST_CHECK_EQUAL(server->getClientCount(), 0);
+
+    // a new client likely reuses the fd, it must only get its own message
+    int other = connectClient(port);
+    sendAll(other, frame(pattern(10, 5), 100));
+    BOOST_REQUIRE_EQUAL(server->receiveData(data, clientId, 2000), 1);
+    BOOST_CHECK(data == pattern(10, 5));
+    BOOST_CHECK_EQUAL(server->receiveData(data, clientId, 50), 0);
+
+    close(other);
+    close(client);
+}
+
+BOOST_AUTO_TEST_CASE(ServesSeveralClients)
+{
+    int port;
+    std::unique_ptr<CSocketInConnectionEpoll> server = listenOnFreePort(port);
+    std::vector<int> clients;
+    for(int i = 0; i < 4; ++i)
+    {
+        clients.push_back(connectClient(port));
+        sendAll(clients.back(), frame(pattern(30, i), 100));
+    }
+
+    // each client gets the reply to its own message
+    for(int i = 0; i < 4; ++i)
+    {
+        std::vector<char> data;
+        int clientId = -1;
+        BOOST_REQUIRE_EQUAL(server->receiveData(data, clientId, 2000), 1);
+        BOOST_REQUIRE(server->replyToReceivedData(clientId, data.data(), int(data.size())));
+    }
+    for(int i = 0; i < 4; ++i)
+    {
+        int packetCount = 0;
+        BOOST_CHECK(receiveReply(clients[i], packetCount) == pattern(30, i));
+        close(clients[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(HalfClosedClientGetsItsReply)
+{
+    int port;
+    std::unique_ptr<CSocketInConnectionEpoll> server = listenOnFreePort(port);
+    int client = connectClient(port);
+
+    // the request and the end of the stream arrive together
+    sendAll(client, frame(pattern(50, 1), 100));
+    BOOST_REQUIRE(shutdown(client, SHUT_WR) == 0);
+    std::vector<char> data;
+    int clientId = -1;
+    BOOST_REQUIRE_EQUAL(server->receiveData(data, clientId, 2000), 1);
+    BOOST_CHECK(data == pattern(50, 1));
+    BOOST_REQUIRE(server->replyToReceivedData(clientId, data.data(), int(data.size())));
+
+    // closed once replied to
+    int packetCount = 0;
+    BOOST_CHECK(receiveReply(client, packetCount) == pattern(50, 1));
+    BOOST_CHECK_EQUAL(server->getClientCount(), 0);
+    char byte;
+    BOOST_CHECK_EQUAL(recv(client, &byte, 1, 0), 0);
+    close(client);
+}
+
+BOOST_AUTO_TEST_CASE(SlowReaderDoesNotStallOthers)
+{
+    int port;
+    std::unique_ptr<CSocketInConnectionEpoll> server = listenOnFreePort(port, 65535, 16*1024);
+    int slow = connectClient(port);
+    int smallBuffer = 16*1024;
+    setsockopt(slow, SOL_SOCKET, SO_RCVBUF, &smallBuffer, sizeof(smallBuffer));
+    int other = connectClient(port);
+
+    std::vector<char> data;
+    int clientId = -1;
+    sendAll(slow, frame(pattern(10, 1), 100));
+    BOOST_REQUIRE_EQUAL(server->receiveData(data, clientId, 2000), 1);
+    const int slowId = clientId;
+
+    // far more than the socket buffers hold, the rest is queued instead of waited on
+    const std::vector<char> large = pattern(8*1024*1024, 2);
+    const auto start = std::chrono::steady_clock::now();
+    BOOST_REQUIRE(server->replyToReceivedData(slowId, large.data(), int(large.size())));
+    BOOST_CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+
+    sendAll(other, frame(pattern(20, 3), 100));
+    BOOST_REQUIRE_EQUAL(server->receiveData(data, clientId, 2000), 1);
+    BOOST_CHECK(clientId != slowId);
+    BOOST_REQUIRE(server->replyToReceivedData(clientId, data.data(), int(data.size())));
+    int packetCount = 0;
+    BOOST_CHECK(receiveReply(other, packetCount) == pattern(20, 3));
+
+    // receiveData sends the queued rest while the slow client reads
+    std::vector<char> reply;
+    std::atomic<bool> done(false);
+    std::thread reader([&]{ int count = 0; reply = receiveReply(slow, count); done = true; });
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while(!done && std::chrono::steady_clock::now() < deadline) server->receiveData(data, clientId, 10);
+    reader.join();
+    BOOST_CHECK(reply == large);
+
+    close(other);
+    close(slow);
+}
+
+BOOST_AUTO_TEST_CASE(OversizedMessageClosesClient)
+{
+    int port;
+    std::unique_ptr<CSocketInConnectionEpoll> server = listenOnFreePort(port, 106, 4*1024*1024, 1000);
+    int client = connectClient(port);
+
+    sendAll(client, frame(pattern(2000, 1), 100));
+    std::vector<char> data;
+    int clientId = -1;
+    BOOST_CHECK_EQUAL(server->receiveData(data, clientId, 200), 0);
+    BOOST_CHECK_EQUAL(server->getClientCount(), 0);
+    close(client);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
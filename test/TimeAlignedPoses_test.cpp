@@ -0,0 +1,91 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE TimeAlignedPoses_test
+#include <boost/test/unit_test.hpp>
+
+#include "grl/calibration/TimeAlignedPoses.hpp"
+
+BOOST_AUTO_TEST_SUITE(TimeAlignedPoses_test)
+
+/// flange moving at constant velocity about and along z, sampled every period seconds from start
+static grl::calibration::StampedPoses makeFlangePoses(double start, double period, int count)
+{
+    grl::calibration::StampedPoses poses;
+    for(int i = 0; i < count; ++i)
+    {
+        grl::calibration::StampedPose stamped;
+        stamped.time = start + period * i;
+        stamped.pose.linear() = Eigen::AngleAxisd(0.5 * stamped.time, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+        stamped.pose.translation() = Eigen::Vector3d(0.0, 0.0, 0.1 * stamped.time);
+        poses.push_back(stamped);
+    }
+    return poses;
+}
+
+BOOST_AUTO_TEST_CASE(InterpolatesAtReferenceTimes)
+{
+    grl::calibration::StampedPoses flange = makeFlangePoses(0.0, 0.004, 250);
+    grl::calibration::StampedPoses markers = makeFlangePoses(0.001, 0.0033, 300);
+    // a stall in the flange stream, markers inside it must be dropped
+    flange.erase(flange.begin() + 100, flange.begin() + 150);
+
+    grl::calibration::Poses markerOut, flangeOut;
+    std::size_t count = grl::calibration::alignPoses(markers, flange, 0.005, 0.0, markerOut, flangeOut);
+    BOOST_CHECK_EQUAL(count, markerOut.size());
+    BOOST_CHECK_EQUAL(count, flangeOut.size());
+    BOOST_CHECK(count > 200 && count < 300);
+
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        // the motion is linear in time, so interpolation is exact
+        BOOST_CHECK_SMALL((markerOut[i].matrix() - flangeOut[i].matrix()).norm(), 1e-9);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(HandEyeResidualsOfExactTransform)
+{
+    Eigen::Affine3d X = Eigen::Affine3d::Identity();
+    X.linear() = Eigen::AngleAxisd(0.4, Eigen::Vector3d(0.1, 0.2, 0.3).normalized()).toRotationMatrix();
+    X.translation() = Eigen::Vector3d(0.05, 0.06, 0.07);
+    Eigen::Affine3d trackerToBase = Eigen::Affine3d::Identity();
+    trackerToBase.translation() = Eigen::Vector3d(1.0, 0.5, 0.2);
+
+    grl::calibration::Poses arm, tracker;
+    for(int i = 0; i < 20; ++i)
+    {
+        Eigen::Affine3d flange = Eigen::Affine3d::Identity();
+        flange.linear() = Eigen::AngleAxisd(0.1 * i, Eigen::Vector3d(1.0, 0.1 * i, 0.3).normalized()).toRotationMatrix();
+        flange.translation() = Eigen::Vector3d(0.4 + 0.01 * i, -0.02 * i, 0.3);
+        arm.push_back(flange);
+        tracker.push_back(trackerToBase.inverse() * flange * X);
+    }
+
+    grl::calibration::ResidualStatistics stats = grl::calibration::handEyeResiduals(arm, tracker, X);
+    BOOST_CHECK_EQUAL(stats.count, 19u);
+    BOOST_CHECK_SMALL(stats.maxRotation, 1e-6);
+    BOOST_CHECK_SMALL(stats.maxTranslation, 1e-9);
+
+    // consecutive motions rotate about 0.1 rad, which scales the translation error of a wrong X down by about as much
+    Eigen::Affine3d wrong = X;
+    wrong.translation().x() += 0.05;
+    BOOST_CHECK(grl::calibration::handEyeResiduals(arm, tracker, wrong).rmsTranslation > 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(MotionsAreBetweenConsecutivePoses)
+{
+    // one step along x then one rotation about z, each motion is only its own step
+    grl::calibration::Poses poses(3, Eigen::Affine3d::Identity());
+    poses[1].translation() = Eigen::Vector3d(0.1, 0.0, 0.0);
+    poses[2] = poses[1];
+    poses[2].linear() = Eigen::AngleAxisd(0.3, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+
+    std::vector<Eigen::Vector3d> rvecs, tvecs;
+    grl::calibration::posesToMotions(poses, rvecs, tvecs);
+    BOOST_REQUIRE_EQUAL(rvecs.size(), 2u);
+    BOOST_REQUIRE_EQUAL(tvecs.size(), 2u);
+    BOOST_CHECK_SMALL(rvecs[0].norm(), 1e-12);
+    BOOST_CHECK_CLOSE(tvecs[0].x(), 0.1, 1e-9);
+    BOOST_CHECK_CLOSE(rvecs[1].z(), 0.3, 1e-9);
+    BOOST_CHECK_SMALL(tvecs[1].norm(), 1e-12);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,179 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE TimeOptimalParameterization_test
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <chrono>
+#include <limits>
+#include <iostream>
+
+#include "grl/path/TimeOptimalParameterization.hpp"
+
+BOOST_AUTO_TEST_SUITE(TimeOptimalParameterization_test)
+
+typedef grl::path::TimeOptimalParameterization TOPP;
+
+/// the full limits with no position limits
+static TOPP::Params limits(const std::vector<double>& vmax, const std::vector<double>& amax, int gridPoints)
+{
+    TOPP::Params params = TOPP::defaultParams();
+    std::get<TOPP::VelocityLimits>(params) = vmax;
+    std::get<TOPP::AccelerationLimits>(params) = amax;
+    std::get<TOPP::GridPoints>(params) = gridPoints;
+    return params;
+}
+
+BOOST_AUTO_TEST_CASE(StraightLineIsTrapezoidal)
+{
+    // one joint moving 2 rad with 1 rad/s and 2 rad/s^2 accelerates for 0.5 s,
+    // cruises for 1.5 s and decelerates for 0.5 s
+    grl::path::TimeOptimalParameterization topp(limits({1.0, 1.0}, {2.0, 2.0}, 1000));
+    grl::path::JointTrajectory path(2), retimed;
+    path.addWaypoint(0.0, {0.0, 0.5});
+    path.addWaypoint(0.0, {2.0, 0.5});
+    topp.retime(path, retimed);
+    BOOST_CHECK_CLOSE(retimed.duration(), 2.5, 1.0);
+
+    std::vector<double> q;
+    retimed.sample(0.0, q);
+    BOOST_CHECK_SMALL(q[0], 1e-9);
+    retimed.sample(retimed.duration(), q);
+    BOOST_CHECK_CLOSE(q[0], 2.0, 1e-9);
+    BOOST_CHECK_CLOSE(q[1], 0.5, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(CurvedPathKeepsLimits)
+{
+    const std::vector<double> vmax{1.5, 1.0, 2.0};
+    const std::vector<double> amax{3.0, 2.0, 4.0};
+    grl::path::TimeOptimalParameterization topp(limits(vmax, amax, 400));
+    grl::path::JointTrajectory path(3), retimed;
+    for(int i = 0; i <= 20; ++i)
+    {
+        const double s = i / 20.0;
+        path.addWaypoint(0.0, {std::sin(3.0 * s), s * s, std::cos(2.0 * s)});
+    }
+    // a repeated waypoint is skipped
+    path.addWaypoint(0.0, path.positions(20));
+
+    const auto start = std::chrono::steady_clock::now();
+    topp.retime(path, retimed);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "retimed 21 waypoints on 400 grid points in " << seconds * 1e3 << " ms, duration " << retimed.duration() << " s\n";
+
+    // passes through every waypoint
+    for(std::size_t w = 0; w < path.size(); ++w)
+    {
+        const std::vector<double> waypoint = path.positions(w);
+        double closest = std::numeric_limits<double>::infinity();
+        for(std::size_t i = 0; i < retimed.size(); ++i)
+        {
+            const std::vector<double> q = retimed.positions(i);
+            double distance = 0.0;
+            for(int j = 0; j < 3; ++j) distance += (q[j] - waypoint[j]) * (q[j] - waypoint[j]);
+            closest = std::min(closest, std::sqrt(distance));
+        }
+        BOOST_CHECK_SMALL(closest, 1e-9);
+    }
+
+    // finite differences of the sampled trajectory stay within the limits, allowing
+    // for the limits only being enforced at the grid points
+    const double dt = 1e-3;
+    std::vector<double> q0, q1, q2;
+    double worstVelocity = 0.0, worstAcceleration = 0.0;
+    for(double t = 0.0; t + 2.0 * dt <= retimed.duration(); t += dt)
+    {
+        retimed.sample(t, q0);
+        retimed.sample(t + dt, q1);
+        retimed.sample(t + 2.0 * dt, q2);
+        for(int j = 0; j < 3; ++j)
+        {
+            worstVelocity = std::max(worstVelocity, std::abs(q1[j] - q0[j]) / dt / vmax[j]);
+            worstAcceleration = std::max(worstAcceleration, std::abs(q2[j] - 2.0 * q1[j] + q0[j]) / (dt * dt) / amax[j]);
+        }
+    }
+    BOOST_CHECK_LE(worstVelocity, 1.01);
+    BOOST_CHECK_LE(worstAcceleration, 1.1);
+    // and some joint gets close to a limit, or it would not be time optimal
+    BOOST_CHECK_GE(std::max(worstVelocity, worstAcceleration), 0.95);
+}
+
+BOOST_AUTO_TEST_CASE(StationaryPathAndBadInput)
+{
+    grl::path::TimeOptimalParameterization topp(limits({1.0}, {1.0}, 100));
+    grl::path::JointTrajectory path(1), retimed;
+    BOOST_CHECK_THROW(topp.retime(path, retimed), std::runtime_error);
+    path.addWaypoint(0.0, {0.3});
+    path.addWaypoint(1.0, {0.3});
+    topp.retime(path, retimed);
+    BOOST_CHECK_EQUAL(retimed.size(), 1u);
+    BOOST_CHECK_EQUAL(retimed.duration(), 0.0);
+
+    grl::path::JointTrajectory twoJoints(2);
+    twoJoints.addWaypoint(0.0, {0.0, 0.0});
+    BOOST_CHECK_THROW(topp.retime(twoJoints, retimed), std::runtime_error);
+    BOOST_CHECK_THROW(topp.setParams(limits({1.0}, {0.0}, 100)), std::runtime_error);
+
+    TOPP::Params tooFast = limits({1.0}, {1.0}, 100);
+    std::get<TOPP::VelocityScaling>(tooFast) = 1.5;
+    BOOST_CHECK_THROW(topp.setParams(tooFast), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(ScalingSlowsTheMotion)
+{
+    // at half the velocity and acceleration the 2 rad move of StraightLineIsTrapezoidal
+    // accelerates for 0.5 s, cruises for 3.5 s and decelerates for 0.5 s
+    TOPP::Params params = limits({1.0}, {2.0}, 1000);
+    std::get<TOPP::VelocityScaling>(params) = 0.5;
+    std::get<TOPP::AccelerationScaling>(params) = 0.5;
+    grl::path::TimeOptimalParameterization topp(params);
+    grl::path::JointTrajectory path(1), retimed;
+    path.addWaypoint(0.0, {0.0});
+    path.addWaypoint(0.0, {2.0});
+    topp.retime(path, retimed);
+    BOOST_CHECK_CLOSE(retimed.duration(), 4.5, 1.0);
+}
+
+BOOST_AUTO_TEST_CASE(RejectsSplinesOutsideThePositionLimits)
+{
+    TOPP::Params params = limits({1.0}, {2.0}, 200);
+    std::get<TOPP::PositionLowerLimits>(params) = {-1.0};
+    std::get<TOPP::PositionUpperLimits>(params) = {1.0};
+    grl::path::TimeOptimalParameterization topp(params);
+    grl::path::JointTrajectory path(1), retimed;
+
+    // going out to the limit and back keeps to it
+    path.addWaypoint(0.0, {0.0});
+    path.addWaypoint(0.0, {1.0});
+    path.addWaypoint(0.0, {0.0});
+    BOOST_CHECK_NO_THROW(topp.retime(path, retimed));
+
+    // a waypoint outside the limits
+    path.clear();
+    path.addWaypoint(0.0, {0.0});
+    path.addWaypoint(0.0, {1.5});
+    BOOST_CHECK_THROW(topp.retime(path, retimed), std::runtime_error);
+    BOOST_CHECK(retimed.empty());
+}
+
+BOOST_AUTO_TEST_CASE(RejectsOvershootBetweenWaypoints)
+{
+    // both waypoints are at the upper limit of joint 0, but the spline bulges
+    // past it between them while joint 1 turns around
+    TOPP::Params params = limits({1.0, 1.0}, {2.0, 2.0}, 200);
+    std::get<TOPP::PositionLowerLimits>(params) = {-1.0, -1.0};
+    std::get<TOPP::PositionUpperLimits>(params) = {1.0, 1.0};
+    grl::path::TimeOptimalParameterization topp(params);
+    grl::path::JointTrajectory path(2), retimed;
+    path.addWaypoint(0.0, {0.0, 0.0});
+    path.addWaypoint(0.0, {1.0, 0.5});
+    path.addWaypoint(0.0, {1.0, -0.5});
+    path.addWaypoint(0.0, {0.0, 0.0});
+    BOOST_CHECK_THROW(topp.retime(path, retimed), std::runtime_error);
+
+    std::get<TOPP::PositionUpperLimits>(params) = {2.0, 2.0};
+    topp.setParams(params);
+    BOOST_CHECK_NO_THROW(topp.retime(path, retimed));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
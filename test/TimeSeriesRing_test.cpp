@@ -0,0 +1,115 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE TimeSeriesRing_test
+#include <boost/test/unit_test.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "grl/TimeSeriesRing.hpp"
+
+BOOST_AUTO_TEST_SUITE(TimeSeriesRing_test)
+
+typedef std::chrono::system_clock::time_point TimePoint;
+
+static TimePoint milliseconds(int ms)
+{
+    return TimePoint(std::chrono::milliseconds(ms));
+}
+
+BOOST_AUTO_TEST_CASE(InterpolatesWithinTheHistory)
+{
+    grl::TimeSeriesRing<std::array<double,2>> ring(4);
+    std::array<double,2> value{{-1.0, -1.0}};
+    BOOST_CHECK(!ring.at(milliseconds(0), value));
+
+    // value is {t, 2t} at t = 0, 10, ... 50 ms, only the last four are kept
+    for(int i = 0; i <= 5; ++i) ring.push(milliseconds(10 * i), std::array<double,2>{{10.0 * i, 20.0 * i}});
+    BOOST_CHECK_EQUAL(ring.size(), 4u);
+
+    BOOST_CHECK(ring.at(milliseconds(35), value));
+    BOOST_CHECK_CLOSE(value[0], 35.0, 1e-9);
+    BOOST_CHECK_CLOSE(value[1], 70.0, 1e-9);
+    BOOST_CHECK(ring.at(milliseconds(20), value));
+    BOOST_CHECK_CLOSE(value[0], 20.0, 1e-9);
+    BOOST_CHECK(ring.at(milliseconds(50), value));
+    BOOST_CHECK_CLOSE(value[0], 50.0, 1e-9);
+
+    // before the oldest sample kept and after the newest
+    BOOST_CHECK(!ring.at(milliseconds(15), value));
+    BOOST_CHECK(!ring.at(milliseconds(51), value));
+
+    TimePoint oldest, newest;
+    BOOST_CHECK(ring.range(oldest, newest));
+    BOOST_CHECK(oldest == milliseconds(20));
+    BOOST_CHECK(newest == milliseconds(50));
+
+    BOOST_CHECK_THROW(ring.push(milliseconds(40), value), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(SlerpsRotations)
+{
+    // rotating about z at 1 rad per 10 ms while moving along x
+    grl::TimeSeriesRing<grl::RigidPose, TimePoint, grl::SlerpInterpolator> ring(8);
+    for(int i = 0; i < 3; ++i)
+    {
+        const double angle = i;
+        grl::RigidPose pose;
+        pose.translation = {{0.1 * i, 0.0, 0.0}};
+        pose.rotation = {{std::cos(angle / 2.0), 0.0, 0.0, std::sin(angle / 2.0)}};
+        // q and -q are the same rotation, interpolation must not go the long way
+        if(i == 2) for(double& q : pose.rotation) q = -q;
+        ring.push(milliseconds(10 * i), pose);
+    }
+
+    grl::RigidPose pose;
+    BOOST_REQUIRE(ring.at(milliseconds(15), pose));
+    const double sign = pose.rotation[0] < 0.0 ? -1.0 : 1.0;
+    BOOST_CHECK_CLOSE(pose.translation[0], 0.15, 1e-9);
+    BOOST_CHECK_CLOSE(sign * pose.rotation[0], std::cos(0.75), 1e-9);
+    BOOST_CHECK_CLOSE(sign * pose.rotation[3], std::sin(0.75), 1e-9);
+    BOOST_CHECK_SMALL(pose.rotation[1], 1e-12);
+}
+
+BOOST_AUTO_TEST_CASE(ReadersNeverSeeATornSample)
+{
+    // every element of sample i holds i, sampled each millisecond
+    const int count = 200000;
+    grl::TimeSeriesRing<std::array<double,16>> ring(64);
+
+    std::atomic<bool> done(false);
+    std::thread writer([&]{
+        std::array<double,16> sample;
+        for(int i = 0; i < count; ++i)
+        {
+            sample.fill(i);
+            ring.push(milliseconds(i), sample);
+        }
+        done = true;
+    });
+
+    std::size_t torn = 0;
+    std::size_t lookups = 0;
+    std::array<double,16> value;
+    // the last pass starts after the writer finished, so at least it looks something up
+    for(bool finished = false; !finished;)
+    {
+        finished = done;
+        TimePoint oldest, newest;
+        if(!ring.range(oldest, newest)) continue;
+        // halfway between the newest two samples, interpolation gives i + 0.5 in every element
+        const TimePoint query = newest - std::chrono::microseconds(500);
+        if(!ring.at(query, value)) continue;
+        ++lookups;
+        for(double element : value) if(element != value[0]) ++torn;
+        if(std::abs(value[0] - std::floor(value[0]) - 0.5) > 1e-9) ++torn;
+    }
+    writer.join();
+
+    BOOST_CHECK_EQUAL(torn, 0u);
+    BOOST_CHECK(lookups > 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
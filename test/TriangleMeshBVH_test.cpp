@@ -0,0 +1,225 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE TriangleMeshBVH_test
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+
+#include "grl/registration/TriangleMeshBVH.hpp"
+#include "grl/registration/IterativeClosestPoint.hpp"
+#include "TriangleMeshTestFixtures.hpp"
+
+BOOST_AUTO_TEST_SUITE(TriangleMeshBVH_test)
+
+/// closest point by checking every triangle, projecting onto the plane and clamping to the edges
+static double bruteForceDistance(const grl::registration::TriangleMesh& mesh, const Eigen::Vector3d& p)
+{
+    double best = std::numeric_limits<double>::infinity();
+    for(int t = 0; t < mesh.triangleCount(); ++t)
+    {
+        Eigen::Vector3d a = mesh.vertex(t,0), b = mesh.vertex(t,1), c = mesh.vertex(t,2);
+        Eigen::Vector3d n = (b - a).cross(c - a).normalized();
+        Eigen::Vector3d q = p - n.dot(p - a) * n;
+        bool inside = (b - a).cross(q - a).dot(n) >= 0 && (c - b).cross(q - b).dot(n) >= 0 && (a - c).cross(q - c).dot(n) >= 0;
+        if(inside) best = std::min(best, (p - q).norm());
+        const Eigen::Vector3d corners[3] = {a, b, c};
+        for(int e = 0; e < 3; ++e)
+        {
+            Eigen::Vector3d s0 = corners[e], s1 = corners[(e+1)%3];
+            double u = std::max(0.0, std::min(1.0, (p - s0).dot(s1 - s0) / (s1 - s0).squaredNorm()));
+            best = std::min(best, (p - (s0 + u * (s1 - s0))).norm());
+        }
+    }
+    return best;
+}
+
+BOOST_AUTO_TEST_CASE(ClosestPointAndSignedDistance)
+{
+    grl::registration::TriangleMesh mesh = makeSphere(0.05, 3);
+    grl::registration::TriangleMeshBVH bvh(mesh);
+
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<> coordinate(-0.08, 0.08);
+    Eigen::Matrix3Xd points(3, 500);
+    for(int i = 0; i < points.cols(); ++i) points.col(i) = Eigen::Vector3d(coordinate(gen), coordinate(gen), coordinate(gen));
+
+    Eigen::Matrix3Xd closest, normals;
+    Eigen::VectorXd signedDistances;
+    bvh.closestPoints(points, closest, normals, signedDistances, 2);
+    for(int i = 0; i < points.cols(); ++i)
+    {
+        Eigen::Vector3d p = points.col(i);
+        BOOST_CHECK_SMALL(std::abs(signedDistances(i)) - bruteForceDistance(mesh, p), 1e-12);
+        BOOST_CHECK_SMALL((closest.col(i) - p).norm() - std::abs(signedDistances(i)), 1e-12);
+        BOOST_CHECK_CLOSE(normals.col(i).norm(), 1.0, 1e-9);
+        // the sphere is inscribed in the mesh, so inside and outside only differ near the surface
+        if(p.norm() < 0.045) BOOST_CHECK(signedDistances(i) < 0.0);
+        if(p.norm() > 0.0501) BOOST_CHECK(signedDistances(i) > 0.0);
+        BOOST_CHECK_EQUAL(signedDistances(i), bvh.signedDistance(p));
+    }
+
+    // a proximity check only searches within the given distance
+    grl::registration::TriangleMeshBVH::ClosestPoint result;
+    BOOST_CHECK(!bvh.closestPoint(Eigen::Vector3d(0.0, 0.0, 0.07), result, 0.01));
+    BOOST_CHECK(bvh.closestPoint(Eigen::Vector3d(0.0, 0.0, 0.055), result, 0.01));
+    BOOST_CHECK_CLOSE(result.signedDistance, 0.005, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(LoadStlFiles)
+{
+    grl::registration::TriangleMesh sphere = makeSphere(50.0, 1);
+    Eigen::Matrix3Xd normals = sphere.faceNormals();
+    const std::string asciiFile = "TriangleMeshBVH_test_ascii.stl";
+    const std::string binaryFile = "TriangleMeshBVH_test_binary.stl";
+    {
+        std::ofstream ascii(asciiFile);
+        ascii << "solid sphere\n";
+        for(int t = 0; t < sphere.triangleCount(); ++t)
+        {
+            ascii << " facet normal " << normals(0,t) << " " << normals(1,t) << " " << normals(2,t) << "\n  outer loop\n";
+            for(int corner = 0; corner < 3; ++corner)
+            {
+                Eigen::Vector3d v = sphere.vertex(t,corner);
+                ascii << "   vertex " << v.x() << " " << v.y() << " " << v.z() << "\n";
+            }
+            ascii << "  endloop\n endfacet\n";
+        }
+        ascii << "endsolid sphere\n";
+
+        // binary files may also start with "solid"
+        std::ofstream binary(binaryFile, std::ios::binary);
+        char header[80] = "solid binary";
+        binary.write(header, 80);
+        uint32_t count = sphere.triangleCount();
+        binary.write(reinterpret_cast<const char*>(&count), 4);
+        for(int t = 0; t < sphere.triangleCount(); ++t)
+        {
+            float values[12];
+            for(int i = 0; i < 3; ++i) values[i] = float(normals(i,t));
+            for(int corner = 0; corner < 3; ++corner)
+                for(int i = 0; i < 3; ++i) values[3 + 3*corner + i] = float(sphere.vertex(t,corner)(i));
+            binary.write(reinterpret_cast<const char*>(values), sizeof(values));
+            uint16_t attributes = 0;
+            binary.write(reinterpret_cast<const char*>(&attributes), 2);
+        }
+    }
+
+    for(const std::string& file : {asciiFile, binaryFile})
+    {
+        // millimeters to meters
+        grl::registration::TriangleMesh mesh = grl::registration::loadStlFile(file, 0.001);
+        BOOST_CHECK_EQUAL(mesh.triangleCount(), sphere.triangleCount());
+        BOOST_CHECK_EQUAL(mesh.vertexCount(), sphere.vertexCount());
+        grl::registration::TriangleMeshBVH bvh(mesh);
+        BOOST_CHECK(bvh.signedDistance(Eigen::Vector3d::Zero()) < 0.0);
+        BOOST_CHECK(bvh.signedDistance(Eigen::Vector3d(0.1, 0.0, 0.0)) > 0.0);
+        std::remove(file.c_str());
+    }
+    BOOST_CHECK_THROW(grl::registration::loadStlFile("TriangleMeshBVH_test_missing.stl"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(CachedHierarchy)
+{
+    grl::registration::TriangleMesh sphere = makeSphere(50.0, 2);
+    const std::string stlFile = "TriangleMeshBVH_test_cached.stl";
+    const std::string cacheFile = "TriangleMeshBVH_test_cached.bvh";
+    {
+        std::ofstream binary(stlFile, std::ios::binary);
+        char header[80] = {};
+        binary.write(header, 80);
+        uint32_t count = sphere.triangleCount();
+        binary.write(reinterpret_cast<const char*>(&count), 4);
+        for(int t = 0; t < sphere.triangleCount(); ++t)
+        {
+            float values[12] = {};
+            for(int corner = 0; corner < 3; ++corner)
+                for(int i = 0; i < 3; ++i) values[3 + 3*corner + i] = float(sphere.vertex(t,corner)(i));
+            binary.write(reinterpret_cast<const char*>(values), sizeof(values));
+            uint16_t attributes = 0;
+            binary.write(reinterpret_cast<const char*>(&attributes), 2);
+        }
+    }
+    std::remove(cacheFile.c_str());
+
+    // without a cache file nothing is written next to the model
+    auto uncached = grl::registration::loadTriangleMeshBVH(stlFile, 0.001);
+    BOOST_CHECK_EQUAL(uncached->mesh().triangleCount(), sphere.triangleCount());
+    BOOST_CHECK(!std::ifstream(stlFile + ".bvh").good());
+
+    auto built = grl::registration::loadTriangleMeshBVH(stlFile, 0.001, cacheFile);
+    BOOST_CHECK(std::ifstream(cacheFile).good());
+    auto cached = grl::registration::loadTriangleMeshBVH(stlFile, 0.001, cacheFile);
+    BOOST_CHECK(cached != built);
+    BOOST_CHECK_EQUAL(cached->mesh().triangleCount(), built->mesh().triangleCount());
+
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<> coordinate(-0.08, 0.08);
+    grl::registration::TriangleMeshBVH::ClosestPoint fromBuilt, fromCached;
+    for(int i = 0; i < 100; ++i)
+    {
+        Eigen::Vector3d p(coordinate(gen), coordinate(gen), coordinate(gen));
+        built->closestPoint(p, fromBuilt);
+        cached->closestPoint(p, fromCached);
+        BOOST_CHECK_EQUAL(fromBuilt.triangle, fromCached.triangle);
+        BOOST_CHECK_EQUAL(fromBuilt.signedDistance, fromCached.signedDistance);
+    }
+
+    // a different scale must not reuse the cache
+    auto scaled = grl::registration::loadTriangleMeshBVH(stlFile, 0.002, cacheFile);
+    BOOST_CHECK_CLOSE(scaled->bounds().sizes().x(), 2.0 * built->bounds().sizes().x(), 1e-9);
+
+    // a truncated cache is rebuilt rather than trusted
+    std::string bytes;
+    {
+        std::ifstream cache(cacheFile, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(cache), std::istreambuf_iterator<char>());
+    }
+    std::istringstream partial(bytes.substr(32, bytes.size() / 2));
+    BOOST_CHECK_THROW(grl::registration::TriangleMeshBVH::load(partial), std::runtime_error);
+    std::ofstream(cacheFile, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size() / 2);
+    auto rebuilt = grl::registration::loadTriangleMeshBVH(stlFile, 0.002, cacheFile);
+    BOOST_CHECK_EQUAL(rebuilt->mesh().triangleCount(), sphere.triangleCount());
+    BOOST_CHECK(rebuilt->signedDistance(Eigen::Vector3d::Zero()) < 0.0);
+
+    std::remove(stlFile.c_str());
+    std::remove(cacheFile.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(PointToPlaneRegistrationOnTheSurface)
+{
+    // a coarse flattened sphere, where the closest vertex is far from the closest surface point
+    grl::registration::TriangleMesh mesh = makeSphere(0.03, 2);
+    mesh.vertices.row(2) *= 0.5;
+    mesh.vertices.row(0) *= 1.5;
+    grl::registration::TriangleMeshBVH bvh(mesh);
+
+    // digitized points exactly on the surface
+    std::mt19937 gen(2);
+    std::uniform_real_distribution<> coordinate(-0.05, 0.05);
+    Eigen::Matrix3Xd surface(3, 200);
+    grl::registration::TriangleMeshBVH::ClosestPoint closest;
+    for(int i = 0; i < surface.cols(); ++i)
+    {
+        bvh.closestPoint(Eigen::Vector3d(coordinate(gen), coordinate(gen), coordinate(gen)), closest);
+        surface.col(i) = closest.point;
+    }
+
+    Eigen::Affine3d offset = Eigen::Affine3d::Identity();
+    offset.linear() = Eigen::AngleAxisd(0.1, Eigen::Vector3d(0.3, -0.2, 1.0).normalized()).toRotationMatrix();
+    offset.translation() = Eigen::Vector3d(0.003, -0.002, 0.002);
+
+    grl::registration::IterativeClosestPoint::Params params = grl::registration::IterativeClosestPoint::defaultParams();
+    std::get<grl::registration::IterativeClosestPoint::Metric>(params) = grl::registration::IterativeClosestPoint::POINT_TO_PLANE;
+    std::get<grl::registration::IterativeClosestPoint::StopTolerance>(params) = 1e-8;
+    grl::registration::IterativeClosestPoint icp(params);
+    const grl::registration::IterativeClosestPoint::Result& result = icp.align(offset.inverse() * surface, bvh);
+    Eigen::Affine3d error = result.transform * offset.inverse();
+    BOOST_CHECK_SMALL(Eigen::AngleAxisd(error.rotation()).angle(), 1e-4);
+    BOOST_CHECK_SMALL(error.translation().norm(), 1e-5);
+    BOOST_CHECK_SMALL(result.rmse, 1e-6);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,73 @@
+/// @file TriangleMeshTestFixtures.hpp
+/// @brief Closed meshes from a subdivided octahedron for the BVH and registration tests.
+#ifndef _GRL_TRIANGLE_MESH_TEST_FIXTURES_HPP_
+#define _GRL_TRIANGLE_MESH_TEST_FIXTURES_HPP_
+
+#include <map>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "grl/registration/TriangleMeshBVH.hpp"
+
+/// @brief unit sphere from an octahedron split into 4 triangles per subdivision, wound counter clockwise from outside
+///
+/// @param shape maps each unit vertex direction to its position, which keeps the surface closed
+template<typename Shape>
+grl::registration::TriangleMesh makeOctahedronMesh(int subdivisions, Shape shape)
+{
+    std::vector<Eigen::Vector3d> vertices = {
+        Eigen::Vector3d::UnitX(), -Eigen::Vector3d::UnitX(), Eigen::Vector3d::UnitY(),
+        -Eigen::Vector3d::UnitY(), Eigen::Vector3d::UnitZ(), -Eigen::Vector3d::UnitZ()};
+    std::vector<Eigen::Vector3i> triangles = {
+        {0,2,4}, {2,1,4}, {1,3,4}, {3,0,4}, {2,0,5}, {1,2,5}, {3,1,5}, {0,3,5}};
+    for(int s = 0; s < subdivisions; ++s)
+    {
+        std::map<std::pair<int,int>,int> midpoints;
+        auto midpoint = [&](int a, int b){
+            auto key = std::make_pair(std::min(a,b), std::max(a,b));
+            auto found = midpoints.find(key);
+            if(found != midpoints.end()) return found->second;
+            vertices.push_back((vertices[a] + vertices[b]).normalized());
+            return midpoints[key] = int(vertices.size()) - 1;
+        };
+        std::vector<Eigen::Vector3i> subdivided;
+        for(const Eigen::Vector3i& t : triangles)
+        {
+            int ab = midpoint(t(0),t(1)), bc = midpoint(t(1),t(2)), ca = midpoint(t(2),t(0));
+            subdivided.push_back(Eigen::Vector3i(t(0),ab,ca));
+            subdivided.push_back(Eigen::Vector3i(ab,t(1),bc));
+            subdivided.push_back(Eigen::Vector3i(ca,bc,t(2)));
+            subdivided.push_back(Eigen::Vector3i(ab,bc,ca));
+        }
+        triangles.swap(subdivided);
+    }
+
+    grl::registration::TriangleMesh mesh;
+    mesh.vertices.resize(3, vertices.size());
+    for(std::size_t v = 0; v < vertices.size(); ++v) mesh.vertices.col(v) = shape(vertices[v]);
+    mesh.triangles.resize(3, triangles.size());
+    for(std::size_t t = 0; t < triangles.size(); ++t) mesh.triangles.col(t) = triangles[t];
+    return mesh;
+}
+
+/// closed sphere centered on the origin
+inline grl::registration::TriangleMesh makeSphere(double radius, int subdivisions)
+{
+    return makeOctahedronMesh(subdivisions, [radius](const Eigen::Vector3d& u){ return Eigen::Vector3d(radius * u); });
+}
+
+/// @brief a lumpy closed surface with distinct principal axes and no mirror symmetry, standing in for a bone model
+///
+/// More subdivisions mesh the same shape more finely, like the low and high resolution models of one bone.
+inline std::shared_ptr<const grl::registration::TriangleMeshBVH> makeBone(int subdivisions)
+{
+    grl::registration::TriangleMesh mesh = makeOctahedronMesh(subdivisions, [](const Eigen::Vector3d& u){
+        double radius = 1.0 + 0.3*u.x()*u.x()*u.x() + 0.2*u.y()*u.y()*u.y() + 0.1*u.z()*u.z()*u.z();
+        return Eigen::Vector3d(Eigen::Vector3d(0.2, 0.05, 0.03).cwiseProduct(radius * u));
+    });
+    return std::make_shared<const grl::registration::TriangleMeshBVH>(mesh);
+}
+
+#endif // _GRL_TRIANGLE_MESH_TEST_FIXTURES_HPP_
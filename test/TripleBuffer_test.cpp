@@ -0,0 +1,67 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE TripleBuffer_test
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+#include <vector>
+
+#include "grl/TripleBuffer.hpp"
+
+BOOST_AUTO_TEST_SUITE(TripleBuffer_test)
+
+BOOST_AUTO_TEST_CASE(LatestValueWins)
+{
+    grl::TripleBuffer<int> buffer(-1);
+    BOOST_CHECK(!buffer.update());
+    BOOST_CHECK_EQUAL(buffer.front(), -1);
+
+    buffer.back() = 1;
+    buffer.publish();
+    buffer.back() = 2;
+    buffer.publish();
+    BOOST_CHECK(buffer.update());
+    BOOST_CHECK_EQUAL(buffer.front(), 2);
+    BOOST_CHECK(!buffer.update());
+    BOOST_CHECK_EQUAL(buffer.front(), 2);
+
+    buffer.back() = 3;
+    buffer.publish();
+    BOOST_CHECK(buffer.update());
+    BOOST_CHECK_EQUAL(buffer.front(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(ConsumerNeverSeesATornValue)
+{
+    // every element of a published vector holds its sequence number
+    const std::size_t count = 200000;
+    grl::TripleBuffer<std::vector<std::size_t> > buffer(std::vector<std::size_t>(64, 0));
+
+    std::thread producer([&]{
+        for(std::size_t sequence = 1; sequence <= count; ++sequence)
+        {
+            std::vector<std::size_t>& back = buffer.back();
+            for(std::size_t& value : back) value = sequence;
+            buffer.publish();
+        }
+    });
+
+    std::size_t previous = 0;
+    std::size_t torn = 0;
+    std::size_t updates = 0;
+    while(previous < count)
+    {
+        if(!buffer.update()) continue;
+        ++updates;
+        const std::vector<std::size_t>& front = buffer.front();
+        for(std::size_t value : front) if(value != front.front()) ++torn;
+        BOOST_REQUIRE(front.front() > previous);
+        previous = front.front();
+    }
+    producer.join();
+
+    BOOST_CHECK_EQUAL(torn, 0u);
+    BOOST_CHECK(updates > 0);
+    BOOST_CHECK_EQUAL(previous, count);
+}
+
+BOOST_AUTO_TEST_SUITE_END()